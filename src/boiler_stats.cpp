@@ -0,0 +1,137 @@
+#include "boiler_stats.hpp"
+#include <cmath>
+
+namespace OpenTherm
+{
+    namespace Stats
+    {
+        using Entities::Id;
+
+        BoilerStats::BoilerStats()
+            : window_s_(DEFAULT_WINDOW_S), next_window_s_(DEFAULT_WINDOW_S), started_(false), window_start_ms_(0),
+              delta_t_ewma_(DELTA_T_ALPHA), last_flow_(0.0f), last_return_(0.0f), flow_ms_(0), return_ms_(0),
+              flow_pending_(false), return_pending_(false)
+        {
+        }
+
+        bool BoilerStats::setWindow(uint32_t seconds)
+        {
+            if (seconds < MIN_WINDOW_S || seconds > MAX_WINDOW_S)
+                return false;
+            next_window_s_ = seconds;
+            if (!started_)
+                window_s_ = seconds;
+            return true;
+        }
+
+        void BoilerStats::pairDeltaT(uint32_t now_ms)
+        {
+            if (!flow_pending_ || !return_pending_)
+                return;
+
+            // The reading that just arrived is `now_ms`; the other one may be stale
+            // (its partner read failed, or the two are in different tiers)
+            bool flow_older = (int32_t)(flow_ms_ - return_ms_) < 0;
+            if (now_ms - (flow_older ? flow_ms_ : return_ms_) > DELTA_T_MAX_SKEW_MS)
+            {
+                if (flow_older)
+                    flow_pending_ = false;
+                else
+                    return_pending_ = false;
+                return;
+            }
+
+            float delta = last_flow_ - last_return_;
+            delta_t_.add(delta);
+            delta_t_ewma_.add(delta);
+            flow_pending_ = false;
+            return_pending_ = false;
+        }
+
+        void BoilerStats::add(Id id, float value, uint32_t now_ms)
+        {
+            if (!std::isfinite(value))
+                return;
+            if (!started_)
+            {
+                started_ = true;
+                window_start_ms_ = now_ms;
+            }
+
+            switch (id)
+            {
+            case Id::BOILER_TEMP:
+                flow_.add(value);
+                last_flow_ = value;
+                flow_ms_ = now_ms;
+                flow_pending_ = true;
+                pairDeltaT(now_ms);
+                break;
+            case Id::RETURN_TEMP:
+                last_return_ = value;
+                return_ms_ = now_ms;
+                return_pending_ = true;
+                pairDeltaT(now_ms);
+                break;
+            case Id::MODULATION:
+                modulation_.add(value);
+                break;
+            case Id::FLAME:
+                flame_.set(value != 0.0f, now_ms);
+                break;
+            case Id::CH_MODE:
+                ch_.set(value != 0.0f, now_ms);
+                break;
+            case Id::DHW_MODE:
+                dhw_.set(value != 0.0f, now_ms);
+                break;
+            default:
+                break;
+            }
+        }
+
+        uint32_t BoilerStats::msUntilDue(uint32_t now_ms) const
+        {
+            if (!started_)
+                return UINT32_MAX;
+            uint32_t elapsed = now_ms - window_start_ms_;
+            uint32_t window_ms = window_s_ * 1000;
+            return elapsed < window_ms ? window_ms - elapsed : 0;
+        }
+
+        Summary BoilerStats::close(uint32_t now_ms)
+        {
+            Summary s = {};
+            s.window_ms = now_ms - window_start_ms_;
+
+            s.has_flow = flow_.count() > 0;
+            s.flow_min = flow_.min();
+            s.flow_max = flow_.max();
+            s.flow_mean = flow_.mean();
+
+            s.has_delta_t = delta_t_.count() > 0;
+            s.delta_t_mean = delta_t_.mean();
+            s.delta_t_ewma = delta_t_ewma_.value();
+
+            s.has_modulation = modulation_.count() > 0;
+            s.modulation_mean = modulation_.mean();
+
+            s.has_flame = flame_.known();
+            uint32_t flame_ms = flame_.take(now_ms);
+            s.flame_duty = s.window_ms > 0 ? 100.0f * (float)flame_ms / (float)s.window_ms : 0.0f;
+
+            s.has_modes = ch_.known() || dhw_.known();
+            s.ch_s = ch_.take(now_ms) / 1000;
+            s.dhw_s = dhw_.take(now_ms) / 1000;
+
+            // The next window; the EWMA and the mode/flame states carry over
+            flow_.reset();
+            delta_t_.reset();
+            modulation_.reset();
+            window_start_ms_ = now_ms;
+            window_s_ = next_window_s_;
+            return s;
+        }
+
+    } // namespace Stats
+} // namespace OpenTherm
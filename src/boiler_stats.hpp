@@ -0,0 +1,111 @@
+// Windowed statistics of the boiler signals, published as aggregate sensors
+//
+// Every boiler read of flow (boiler) and return temperature, modulation,
+// flame and the CH/DHW mode bits is fed in as it happens. At the end of each
+// window (default 15 minutes, Config::KEY_STATS_WINDOW_S) close() hands back
+// one Summary and the next window starts:
+//
+//   flow temperature    min / max / mean
+//   delta-T             mean flow - return, and an EWMA that carries across windows
+//                       (one sample per flow/return read pair, see pairDeltaT())
+//   modulation          mean
+//   flame duty cycle    % of the window the flame was on
+//   CH / DHW time       seconds of the window spent in each mode
+//
+// Home Assistant gets a handful of values per window instead of having to
+// keep the raw readings, and everything fits a few hundred bytes.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef BOILER_STATS_HPP
+#define BOILER_STATS_HPP
+
+#include <cstdint>
+#include "mqtt_entities.hpp"
+#include "running_stats.hpp"
+
+namespace OpenTherm
+{
+    namespace Stats
+    {
+        struct Summary
+        {
+            uint32_t window_ms; // Length of the window that ended
+
+            bool has_flow;
+            float flow_min;
+            float flow_max;
+            float flow_mean;
+
+            bool has_delta_t;
+            float delta_t_mean;
+            float delta_t_ewma;
+
+            bool has_modulation;
+            float modulation_mean;
+
+            bool has_flame;
+            float flame_duty; // Percent of the window
+
+            bool has_modes;
+            uint32_t ch_s;
+            uint32_t dhw_s;
+        };
+
+        class BoilerStats
+        {
+        public:
+            static constexpr uint32_t DEFAULT_WINDOW_S = 900;
+            static constexpr uint32_t MIN_WINDOW_S = 60;
+            static constexpr uint32_t MAX_WINDOW_S = 86400;
+            static constexpr float DELTA_T_ALPHA = 0.1f; // EWMA weight per delta-T sample
+            // The scheduler phase-shifts the flow and return reads within their
+            // tier; readings further apart than this are not paired
+            static constexpr uint32_t DELTA_T_MAX_SKEW_MS = 60000;
+
+            BoilerStats();
+
+            // Takes effect from the next window; false outside MIN_WINDOW_S..MAX_WINDOW_S
+            bool setWindow(uint32_t seconds);
+            uint32_t window() const { return window_s_; }
+
+            // A boiler reading; ids that are not tracked are ignored. The first
+            // one starts the first window.
+            void add(Entities::Id id, float value, uint32_t now_ms);
+
+            // Milliseconds until close() is due; UINT32_MAX before the first reading
+            uint32_t msUntilDue(uint32_t now_ms) const;
+
+            // End the current window and start the next
+            Summary close(uint32_t now_ms);
+
+        private:
+            // Add a delta-T sample once both sides have an unpaired reading; each
+            // reading is used for one sample only
+            void pairDeltaT(uint32_t now_ms);
+
+            uint32_t window_s_;
+            uint32_t next_window_s_;
+            bool started_;
+            uint32_t window_start_ms_;
+
+            RunningStats<float> flow_;
+            RunningStats<float> delta_t_;
+            RunningStats<float> modulation_;
+            Ewma<float> delta_t_ewma_;
+            TimeShare flame_;
+            TimeShare ch_;
+            TimeShare dhw_;
+
+            // Latest flow and return reading not yet paired into a delta-T sample
+            float last_flow_;
+            float last_return_;
+            uint32_t flow_ms_;
+            uint32_t return_ms_;
+            bool flow_pending_;
+            bool return_pending_;
+        };
+
+    } // namespace Stats
+} // namespace OpenTherm
+
+#endif // BOILER_STATS_HPP
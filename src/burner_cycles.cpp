@@ -0,0 +1,92 @@
+#include "burner_cycles.hpp"
+
+namespace OpenTherm
+{
+    namespace Stats
+    {
+        BurnerCycles::BurnerCycles()
+            : started_(false), flame_(false), last_read_ms_(0), period_start_ms_(0), on_known_(false),
+              off_known_(false), on_ms_(0), off_ms_(0), starts_(0), short_cycles_(0), alarm_(false)
+        {
+        }
+
+        BurnerCycles::Edge BurnerCycles::sample(bool flame, uint32_t now_ms)
+        {
+            if (!started_)
+            {
+                started_ = true;
+                flame_ = flame;
+                last_read_ms_ = now_ms;
+                period_start_ms_ = now_ms;
+                return Edge::NONE;
+            }
+
+            Edge edge = Edge::NONE;
+            if (flame != flame_)
+            {
+                uint32_t edge_ms = last_read_ms_ + (now_ms - last_read_ms_) / 2;
+                if (flame)
+                {
+                    edge = Edge::ON;
+                    starts_++;
+                    if (off_known_)
+                        pauses_.add((edge_ms - off_ms_ + 500) / 1000);
+                    on_ms_ = edge_ms;
+                    on_known_ = true;
+                }
+                else
+                {
+                    edge = Edge::OFF;
+                    if (on_known_)
+                    {
+                        uint32_t burn_s = (edge_ms - on_ms_ + 500) / 1000;
+                        burns_.add(burn_s);
+                        if (burn_s < SHORT_BURN_S)
+                            short_cycles_++;
+                    }
+                    off_ms_ = edge_ms;
+                    off_known_ = true;
+                }
+                flame_ = flame;
+            }
+            last_read_ms_ = now_ms;
+            return edge;
+        }
+
+        uint32_t BurnerCycles::msUntilDue(uint32_t now_ms) const
+        {
+            if (!started_)
+                return UINT32_MAX;
+            uint32_t elapsed = now_ms - period_start_ms_;
+            return elapsed < PERIOD_MS ? PERIOD_MS - elapsed : 0;
+        }
+
+        CycleSummary BurnerCycles::close(uint32_t now_ms)
+        {
+            CycleSummary s = {};
+            s.period_ms = now_ms - period_start_ms_;
+            s.starts = starts_;
+            s.short_cycles = short_cycles_;
+
+            s.has_burns = burns_.count() > 0;
+            s.burn_min_s = burns_.min();
+            s.burn_max_s = burns_.max();
+            s.burn_mean_s = burns_.mean();
+
+            s.has_pauses = pauses_.count() > 0;
+            s.off_mean_s = pauses_.mean();
+
+            alarm_ = short_cycles_ >= ALARM_SHORT_CYCLES;
+            s.short_cycling = alarm_;
+
+            // The next period; a burn or pause in progress is counted when it ends
+            starts_ = 0;
+            short_cycles_ = 0;
+            burns_.reset();
+            pauses_.reset();
+            period_start_ms_ = now_ms;
+            return s;
+        }
+
+    } // namespace Stats
+} // namespace OpenTherm
@@ -0,0 +1,94 @@
+// Burner cycle analytics from the flame bit of the status reads
+//
+// The STATUS poll item reads the flame bit once a second (the FAST tier).
+// sample() turns those reads into flame on/off edges, each stamped halfway
+// between the last read that saw the old state and the first that saw the
+// new one (so at 1 Hz an edge is within half a second). From the edges it
+// keeps, per hour:
+//
+//   starts              flame-on edges
+//   burn time           min / mean / max of each burn that ended
+//   off time            mean of each pause between two burns
+//   short cycles        burns shorter than SHORT_BURN_S
+//
+// and raises the short-cycle alarm as soon as an hour collects
+// ALARM_SHORT_CYCLES of them. The alarm holds until a whole hour ends below
+// that, so it does not flap at every hour boundary. A burn already running
+// at the first read has no known start and is not counted.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef BURNER_CYCLES_HPP
+#define BURNER_CYCLES_HPP
+
+#include <cstdint>
+#include "running_stats.hpp"
+
+namespace OpenTherm
+{
+    namespace Stats
+    {
+        struct CycleSummary
+        {
+            uint32_t period_ms; // Length of the period that ended
+            uint32_t starts;
+            uint32_t short_cycles;
+            bool short_cycling; // Alarm state after this period
+
+            bool has_burns; // At least one burn ended in the period
+            uint32_t burn_min_s;
+            uint32_t burn_max_s;
+            float burn_mean_s;
+
+            bool has_pauses; // At least one pause between burns ended in the period
+            float off_mean_s;
+        };
+
+        class BurnerCycles
+        {
+        public:
+            static constexpr uint32_t PERIOD_MS = 3600000;   // One summary per hour
+            static constexpr uint32_t SHORT_BURN_S = 300;    // A burn under 5 minutes is a short cycle
+            static constexpr uint32_t ALARM_SHORT_CYCLES = 3; // Short cycles in an hour that raise the alarm
+
+            enum class Edge : uint8_t
+            {
+                NONE,
+                ON,
+                OFF
+            };
+
+            BurnerCycles();
+
+            // One status read of the flame bit; the first starts the first period
+            Edge sample(bool flame, uint32_t now_ms);
+
+            bool alarm() const { return alarm_ || short_cycles_ >= ALARM_SHORT_CYCLES; }
+
+            // Milliseconds until close() is due; UINT32_MAX before the first read
+            uint32_t msUntilDue(uint32_t now_ms) const;
+
+            // End the current period and start the next
+            CycleSummary close(uint32_t now_ms);
+
+        private:
+            bool started_;
+            bool flame_;
+            uint32_t last_read_ms_; // Last read, which saw flame_
+            uint32_t period_start_ms_;
+
+            bool on_known_;  // on_ms_ is a real flame-on edge
+            bool off_known_; // off_ms_ is a real flame-off edge
+            uint32_t on_ms_;
+            uint32_t off_ms_;
+
+            uint32_t starts_;
+            uint32_t short_cycles_;
+            bool alarm_; // Set by the last period that closed
+            RunningStats<uint32_t> burns_;  // Seconds
+            RunningStats<uint32_t> pauses_; // Seconds
+        };
+
+    } // namespace Stats
+} // namespace OpenTherm
+
+#endif // BURNER_CYCLES_HPP
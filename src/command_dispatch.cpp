@@ -0,0 +1,107 @@
+#include "command_dispatch.hpp"
+#include <cstring>
+
+namespace OpenTherm
+{
+    namespace Commands
+    {
+        static bool isDigit(char c)
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        bool lookup(const char *suffix, Id *out)
+        {
+            if (suffix == nullptr)
+                return false;
+            uint8_t i = SLOT_TABLE.command[slotOf(suffix, SEED)];
+            if (i == NO_COMMAND || strcmp(TABLE[i].suffix, suffix) != 0)
+                return false;
+            *out = TABLE[i].id;
+            return true;
+        }
+
+        bool parseOnOff(const char *payload, bool *out)
+        {
+            if (payload == nullptr)
+                return false;
+            if (strcmp(payload, "ON") == 0)
+                *out = true;
+            else if (strcmp(payload, "OFF") == 0)
+                *out = false;
+            else
+                return false;
+            return true;
+        }
+
+        bool parseDecimal(const char *payload, float *out)
+        {
+            if (payload == nullptr)
+                return false;
+
+            const char *p = payload;
+            bool negative = false;
+            if (*p == '-' || *p == '+')
+                negative = (*p++ == '-');
+
+            // Integer and fraction digits go into one scaled integer
+            int64_t mantissa = 0;
+            int32_t scale = 1;
+            int digits = 0;
+            for (; isDigit(*p); p++)
+            {
+                if (++digits > 9)
+                    return false;
+                mantissa = mantissa * 10 + (*p - '0');
+            }
+
+            int fraction = 0;
+            if (*p == '.')
+            {
+                p++;
+                for (; isDigit(*p); p++, fraction++)
+                {
+                    if (fraction < 6)
+                    {
+                        mantissa = mantissa * 10 + (*p - '0');
+                        scale *= 10;
+                    }
+                }
+            }
+
+            if (*p != '\0' || digits + fraction == 0)
+                return false;
+
+            float value = (float)((double)mantissa / scale);
+            *out = negative ? -value : value;
+            return true;
+        }
+
+        bool parseUnsigned(const char *payload, uint32_t *out)
+        {
+            if (payload == nullptr || !isDigit(*payload))
+                return false;
+
+            uint64_t value = 0;
+            const char *p = payload;
+            for (; isDigit(*p); p++)
+            {
+                value = value * 10 + (uint64_t)(*p - '0');
+                if (value > 0xFFFFFFFFu)
+                    return false;
+            }
+            if (*p == '.')
+            {
+                for (p++; *p == '0'; p++)
+                {
+                }
+            }
+            if (*p != '\0')
+                return false;
+
+            *out = (uint32_t)value;
+            return true;
+        }
+
+    } // namespace Commands
+} // namespace OpenTherm
@@ -0,0 +1,204 @@
+// Command table for Home Assistant command topics
+//
+// The gateway subscribes once to "<topic_base>/<device_id>/<command_topic_base>/#"
+// and looks the topic suffix up here. Every command has a fixed Commands::Id;
+// lookup() hashes the suffix into a slot table whose seed is searched at
+// compile time so no two commands share a slot (a perfect hash), then
+// confirms with one strcmp. Adding a command means adding an Id and a TABLE
+// row; the static_asserts below catch a table out of order or a seed search
+// that failed. Payloads are parsed by hand - strictly, nothing past the
+// number is accepted - without atof or heap strings.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef COMMAND_DISPATCH_HPP
+#define COMMAND_DISPATCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "mqtt_topics.hpp"
+
+namespace OpenTherm
+{
+    namespace Commands
+    {
+        enum class Id : uint8_t
+        {
+            // Switches
+            CH_ENABLE,
+            DHW_ENABLE,
+
+            // Setpoints
+            CONTROL_SETPOINT,
+            ROOM_SETPOINT,
+            DHW_SETPOINT,
+            MAX_CH_SETPOINT,
+
+            // Device configuration
+            DEVICE_NAME,
+            DEVICE_ID,
+            OPENTHERM_TX_PIN,
+            OPENTHERM_RX_PIN,
+            UPDATE_INTERVAL,
+            FILTER,
+            POLL_TIERS,
+            STATS_WINDOW,
+
+            // Buttons
+            SYNC_TIME,
+            RESTART,
+            REPUBLISH_DISCOVERY,
+            REPUBLISH_STATE,
+            FORCE_REPUBLISH_STATE,
+
+            // Queries
+            TIME_SERIES,
+
+            COUNT
+        };
+
+        constexpr size_t COUNT = static_cast<size_t>(Id::COUNT);
+
+        struct Descriptor
+        {
+            Id id;
+            const char *suffix; // Command topic suffix (MQTTTopics constant)
+        };
+
+        constexpr Descriptor TABLE[COUNT] = {
+            {Id::CH_ENABLE, MQTTTopics::CH_ENABLE},
+            {Id::DHW_ENABLE, MQTTTopics::DHW_ENABLE},
+
+            {Id::CONTROL_SETPOINT, MQTTTopics::CONTROL_SETPOINT},
+            {Id::ROOM_SETPOINT, MQTTTopics::ROOM_SETPOINT},
+            {Id::DHW_SETPOINT, MQTTTopics::DHW_SETPOINT},
+            {Id::MAX_CH_SETPOINT, MQTTTopics::MAX_CH_SETPOINT},
+
+            {Id::DEVICE_NAME, MQTTTopics::DEVICE_NAME},
+            {Id::DEVICE_ID, MQTTTopics::DEVICE_ID},
+            {Id::OPENTHERM_TX_PIN, MQTTTopics::OPENTHERM_TX_PIN},
+            {Id::OPENTHERM_RX_PIN, MQTTTopics::OPENTHERM_RX_PIN},
+            {Id::UPDATE_INTERVAL, MQTTTopics::UPDATE_INTERVAL},
+            {Id::FILTER, MQTTTopics::FILTER},
+            {Id::POLL_TIERS, MQTTTopics::POLL_TIERS},
+            {Id::STATS_WINDOW, MQTTTopics::STATS_WINDOW},
+
+            {Id::SYNC_TIME, MQTTTopics::SYNC_TIME},
+            {Id::RESTART, MQTTTopics::RESTART},
+            {Id::REPUBLISH_DISCOVERY, MQTTTopics::REPUBLISH_DISCOVERY},
+            {Id::REPUBLISH_STATE, MQTTTopics::REPUBLISH_STATE},
+            {Id::FORCE_REPUBLISH_STATE, MQTTTopics::FORCE_REPUBLISH_STATE},
+
+            {Id::TIME_SERIES, MQTTTopics::TIME_SERIES},
+        };
+
+        constexpr size_t index(Id id)
+        {
+            return static_cast<size_t>(id);
+        }
+
+        // Table rows must appear in enum order so handlers can be indexed by Id
+        constexpr bool tableMatchesEnum()
+        {
+            for (size_t i = 0; i < COUNT; i++)
+            {
+                if (index(TABLE[i].id) != i || TABLE[i].suffix == nullptr)
+                    return false;
+            }
+            return true;
+        }
+        static_assert(tableMatchesEnum(), "Commands::TABLE must list every Id in enum order");
+
+        // ====================================================================
+        // Perfect hash over the suffixes
+        // ====================================================================
+
+        constexpr size_t SLOTS = 64; // Power of two, a few times COUNT so a seed is quick to find
+        constexpr uint8_t NO_COMMAND = 0xFF;
+        constexpr uint32_t NO_SEED = 0xFFFFFFFFu;
+        static_assert(COUNT < NO_COMMAND && SLOTS >= COUNT, "Command slot table too small");
+
+        // FNV-1a with the seed spread over the offset basis
+        constexpr uint32_t hashSuffix(const char *suffix, uint32_t seed)
+        {
+            uint32_t h = 2166136261u ^ (seed * 2654435761u);
+            for (const char *p = suffix; *p; p++)
+            {
+                h ^= (uint8_t)*p;
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+        // FNV's low bits only depend on the low bits of its input, so fold the high half in
+        constexpr size_t slotOf(const char *suffix, uint32_t seed)
+        {
+            uint32_t h = hashSuffix(suffix, seed);
+            return (h ^ (h >> 16)) & (SLOTS - 1);
+        }
+
+        constexpr bool seedIsPerfect(uint32_t seed)
+        {
+            bool used[SLOTS] = {};
+            for (size_t i = 0; i < COUNT; i++)
+            {
+                size_t slot = slotOf(TABLE[i].suffix, seed);
+                if (used[slot])
+                    return false;
+                used[slot] = true;
+            }
+            return true;
+        }
+
+        constexpr uint32_t findSeed()
+        {
+            for (uint32_t seed = 0; seed < 4096; seed++)
+            {
+                if (seedIsPerfect(seed))
+                    return seed;
+            }
+            return NO_SEED;
+        }
+
+        constexpr uint32_t SEED = findSeed();
+        static_assert(SEED != NO_SEED, "No collision-free seed for the command suffixes - raise SLOTS");
+
+        struct SlotTable
+        {
+            uint8_t command[SLOTS];
+        };
+
+        constexpr SlotTable buildSlots()
+        {
+            SlotTable table = {};
+            for (size_t i = 0; i < SLOTS; i++)
+                table.command[i] = NO_COMMAND;
+            for (size_t i = 0; i < COUNT; i++)
+                table.command[slotOf(TABLE[i].suffix, SEED)] = (uint8_t)i;
+            return table;
+        }
+
+        constexpr SlotTable SLOT_TABLE = buildSlots();
+
+        // Find the command for a topic suffix; false if there is none
+        bool lookup(const char *suffix, Id *out);
+
+        // ====================================================================
+        // Payload parsing
+        // ====================================================================
+
+        // "ON" / "OFF" (Home Assistant switch payloads)
+        bool parseOnOff(const char *payload, bool *out);
+
+        // Optional sign, up to 9 integer digits, optional '.' and fraction digits
+        // ("21", "-3.5", "45."; digits past the 6th decimal are ignored); no
+        // exponent, no whitespace
+        bool parseDecimal(const char *payload, float *out);
+
+        // Digits, optionally followed by a '.' and only zeros ("60000", "60000.0"),
+        // as Home Assistant number entities may send; fails above UINT32_MAX
+        bool parseUnsigned(const char *payload, uint32_t *out);
+
+    } // namespace Commands
+} // namespace OpenTherm
+
+#endif // COMMAND_DISPATCH_HPP
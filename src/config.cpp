@@ -247,6 +247,134 @@ namespace Config
         return kvs_set(KEY_UPDATE_INTERVAL_MS, buffer, strlen(buffer) + 1) == KVSTORE_SUCCESS;
     }
 
+    bool getMQTTStateJson()
+    {
+        char buffer[8];
+        int rc = kvs_get_str(KEY_MQTT_STATE_JSON, buffer, sizeof(buffer));
+        if (rc == KVSTORE_SUCCESS)
+        {
+            return atoi(buffer) != 0;
+        }
+
+        return DEFAULT_MQTT_STATE_JSON;
+    }
+
+    bool setMQTTStateJson(bool enabled)
+    {
+        const char *value = enabled ? "1" : "0";
+        return kvs_set(KEY_MQTT_STATE_JSON, value, strlen(value) + 1) == KVSTORE_SUCCESS;
+    }
+
+    bool getMQTTDeviceDiscovery()
+    {
+        char buffer[8];
+        int rc = kvs_get_str(KEY_MQTT_DEVICE_DISCOVERY, buffer, sizeof(buffer));
+        if (rc == KVSTORE_SUCCESS)
+        {
+            return atoi(buffer) != 0;
+        }
+
+        return DEFAULT_MQTT_DEVICE_DISCOVERY;
+    }
+
+    bool setMQTTDeviceDiscovery(bool enabled)
+    {
+        const char *value = enabled ? "1" : "0";
+        return kvs_set(KEY_MQTT_DEVICE_DISCOVERY, value, strlen(value) + 1) == KVSTORE_SUCCESS;
+    }
+
+    bool getMQTTCompactDiscovery()
+    {
+        char buffer[8];
+        int rc = kvs_get_str(KEY_MQTT_COMPACT_DISCOVERY, buffer, sizeof(buffer));
+        if (rc == KVSTORE_SUCCESS)
+        {
+            return atoi(buffer) != 0;
+        }
+
+        return DEFAULT_MQTT_COMPACT_DISCOVERY;
+    }
+
+    bool setMQTTCompactDiscovery(bool enabled)
+    {
+        const char *value = enabled ? "1" : "0";
+        return kvs_set(KEY_MQTT_COMPACT_DISCOVERY, value, strlen(value) + 1) == KVSTORE_SUCCESS;
+    }
+
+    uint32_t getStatsWindowS()
+    {
+        char buffer[16];
+        int rc = kvs_get_str(KEY_STATS_WINDOW_S, buffer, sizeof(buffer));
+        if (rc == KVSTORE_SUCCESS)
+        {
+            uint32_t seconds = (uint32_t)atoi(buffer);
+            // Validate range: 1 minute to 24 hours
+            if (seconds >= 60 && seconds <= 86400)
+            {
+                return seconds;
+            }
+        }
+
+        return DEFAULT_STATS_WINDOW_S;
+    }
+
+    bool setStatsWindowS(uint32_t seconds)
+    {
+        // Validate range: 1 minute to 24 hours
+        if (seconds < 60 || seconds > 86400)
+        {
+            return false;
+        }
+
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%u", (unsigned int)seconds);
+        return kvs_set(KEY_STATS_WINDOW_S, buffer, strlen(buffer) + 1) == KVSTORE_SUCCESS;
+    }
+
+    bool getPublishFilters(char *buffer, size_t buffer_size)
+    {
+        int rc = kvs_get_str(KEY_PUBLISH_FILTERS, buffer, buffer_size);
+        if (rc == KVSTORE_SUCCESS)
+        {
+            return true;
+        }
+
+        buffer[0] = '\0';
+        return false;
+    }
+
+    bool setPublishFilters(const char *filters)
+    {
+        return kvs_set(KEY_PUBLISH_FILTERS, filters, strlen(filters) + 1) == KVSTORE_SUCCESS;
+    }
+
+    bool getPollTiers(char *buffer, size_t buffer_size)
+    {
+        int rc = kvs_get_str(KEY_POLL_TIERS, buffer, buffer_size);
+        if (rc == KVSTORE_SUCCESS)
+        {
+            return true;
+        }
+
+        buffer[0] = '\0';
+        return false;
+    }
+
+    bool setPollTiers(const char *tiers)
+    {
+        return kvs_set(KEY_POLL_TIERS, tiers, strlen(tiers) + 1) == KVSTORE_SUCCESS;
+    }
+
+    bool getStateSnapshot(uint8_t *buffer, size_t buffer_size, size_t *length)
+    {
+        return kvs_get(KEY_STATE_SNAPSHOT, buffer, buffer_size, length) == KVSTORE_SUCCESS;
+    }
+
+    bool setStateSnapshot(const uint8_t *data, size_t length)
+    {
+        return kvs_set(KEY_STATE_SNAPSHOT, data, length) == KVSTORE_SUCCESS;
+    }
+
     bool resetToDefaults()
     {
         printf("Resetting configuration to defaults...\n");
@@ -319,6 +447,42 @@ namespace Config
             return false;
         }
 
+        if (!setMQTTStateJson(DEFAULT_MQTT_STATE_JSON))
+        {
+            printf("  ERROR: Failed to set MQTT state format\n");
+            return false;
+        }
+
+        if (!setMQTTDeviceDiscovery(DEFAULT_MQTT_DEVICE_DISCOVERY))
+        {
+            printf("  ERROR: Failed to set MQTT discovery format\n");
+            return false;
+        }
+
+        if (!setMQTTCompactDiscovery(DEFAULT_MQTT_COMPACT_DISCOVERY))
+        {
+            printf("  ERROR: Failed to set MQTT discovery keys\n");
+            return false;
+        }
+
+        if (!setStatsWindowS(DEFAULT_STATS_WINDOW_S))
+        {
+            printf("  ERROR: Failed to set statistics window\n");
+            return false;
+        }
+
+        if (!setPublishFilters(""))
+        {
+            printf("  ERROR: Failed to reset publish filters\n");
+            return false;
+        }
+
+        if (!setPollTiers(""))
+        {
+            printf("  ERROR: Failed to reset poll tiers\n");
+            return false;
+        }
+
         printf("Configuration reset complete\n");
         return true;
     }
@@ -341,6 +505,9 @@ namespace Config
         printf("  Server Port: %u\n", getMQTTServerPort());
         getMQTTClientID(buffer, sizeof(buffer));
         printf("  Client ID: %s\n", buffer);
+        printf("  State Format: %s\n", getMQTTStateJson() ? "JSON document" : "topic per value");
+        printf("  Discovery Format: %s\n", getMQTTDeviceDiscovery() ? "single device config" : "config per entity");
+        printf("  Discovery Keys: %s\n", getMQTTCompactDiscovery() ? "abbreviated" : "full");
 
         printf("Device:\n");
         getDeviceName(buffer, sizeof(buffer));
@@ -354,6 +521,7 @@ namespace Config
 
         printf("Update:\n");
         printf("  Interval: %u ms (%.1f seconds)\n", getUpdateIntervalMs(), getUpdateIntervalMs() / 1000.0f);
+        printf("  Statistics Window: %u s\n", getStatsWindowS());
 
         printf("===========================\n\n");
     }
@@ -16,6 +16,13 @@ namespace Config
     constexpr const char *KEY_OPENTHERM_TX_PIN = "opentherm.tx_pin";
     constexpr const char *KEY_OPENTHERM_RX_PIN = "opentherm.rx_pin";
     constexpr const char *KEY_UPDATE_INTERVAL_MS = "update.interval_ms";
+    constexpr const char *KEY_MQTT_STATE_JSON = "mqtt.state_json";
+    constexpr const char *KEY_MQTT_DEVICE_DISCOVERY = "mqtt.device_discovery";
+    constexpr const char *KEY_MQTT_COMPACT_DISCOVERY = "mqtt.compact_discovery";
+    constexpr const char *KEY_STATE_SNAPSHOT = "state.snapshot"; // Binary, see Publish::saveSnapshot()
+    constexpr const char *KEY_STATS_WINDOW_S = "stats.window_s";
+    constexpr const char *KEY_PUBLISH_FILTERS = "publish.filters"; // Text, see Publish::formatFilterOverrides()
+    constexpr const char *KEY_POLL_TIERS = "poll.tiers";           // Text, see Polling::formatTierOverrides()
 
     // Default values
     constexpr const char *DEFAULT_WIFI_SSID = "your_wifi_ssid";
@@ -28,6 +35,10 @@ namespace Config
     constexpr uint8_t DEFAULT_OPENTHERM_TX_PIN = 16;
     constexpr uint8_t DEFAULT_OPENTHERM_RX_PIN = 17;
     constexpr uint32_t DEFAULT_UPDATE_INTERVAL_MS = 10000; // 10 seconds
+    constexpr bool DEFAULT_MQTT_STATE_JSON = false;        // One topic per value
+    constexpr bool DEFAULT_MQTT_DEVICE_DISCOVERY = false;  // One discovery config per entity
+    constexpr bool DEFAULT_MQTT_COMPACT_DISCOVERY = true;  // Abbreviated discovery keys
+    constexpr uint32_t DEFAULT_STATS_WINDOW_S = 900;       // 15 minute statistics windows
 
     // Initialize configuration system
     bool init();
@@ -62,6 +73,37 @@ namespace Config
     uint32_t getUpdateIntervalMs();
     bool setUpdateIntervalMs(uint32_t interval_ms);
 
+    // State format: one JSON document on the state topic instead of a topic per value
+    bool getMQTTStateJson();
+    bool setMQTTStateJson(bool enabled);
+
+    // Discovery format: one device-based config instead of one config per entity
+    bool getMQTTDeviceDiscovery();
+    bool setMQTTDeviceDiscovery(bool enabled);
+
+    // Discovery payloads: abbreviated keys and a shared device block instead of full keys
+    bool getMQTTCompactDiscovery();
+    bool setMQTTCompactDiscovery(bool enabled);
+
+    // Boiler statistics window (60 seconds to 24 hours)
+    uint32_t getStatsWindowS();
+    bool setStatsWindowS(uint32_t seconds);
+
+    // Publish filter overrides, one filter command per line ("" = built-in defaults).
+    // getPublishFilters() writes "" and returns false if none are stored.
+    bool getPublishFilters(char *buffer, size_t buffer_size);
+    bool setPublishFilters(const char *filters);
+
+    // Poll tier overrides, one tier command per line ("" = built-in tiers).
+    // getPollTiers() writes "" and returns false if none are stored.
+    bool getPollTiers(char *buffer, size_t buffer_size);
+    bool setPollTiers(const char *tiers);
+
+    // Last published state values, saved for a hot start after a reboot.
+    // getStateSnapshot() returns false if none is stored or it does not fit `buffer`.
+    bool getStateSnapshot(uint8_t *buffer, size_t buffer_size, size_t *length);
+    bool setStateSnapshot(const uint8_t *data, size_t length);
+
     // Reset to defaults
     bool resetToDefaults();
 
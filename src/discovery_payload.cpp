@@ -0,0 +1,518 @@
+#include "discovery_payload.hpp"
+#include "mqtt_entities.hpp"
+#include "mqtt_topics.hpp"
+#include "opentherm_ha.hpp"
+#include "state_document.hpp"
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace OpenTherm
+{
+    namespace Discovery
+    {
+        using namespace OpenTherm::MQTTTopics;
+        using namespace OpenTherm::MQTTDiscovery;
+
+        const Component COMPONENTS[] = {
+            // Binary Sensors
+            {COMPONENT_BINARY_SENSOR, FAULT, NAME_FAULT, DEVICE_CLASS_PROBLEM, nullptr, ICON_ALERT_CIRCLE, false},
+            {COMPONENT_BINARY_SENSOR, CH_MODE, NAME_CH_MODE, DEVICE_CLASS_HEAT, nullptr, ICON_RADIATOR, false},
+            {COMPONENT_BINARY_SENSOR, DHW_MODE, NAME_DHW_MODE, DEVICE_CLASS_HEAT, nullptr, ICON_WATER_BOILER, false},
+            {COMPONENT_BINARY_SENSOR, FLAME, NAME_FLAME, DEVICE_CLASS_HEAT, nullptr, ICON_FIRE, false},
+            {COMPONENT_BINARY_SENSOR, COOLING, NAME_COOLING, DEVICE_CLASS_COLD, nullptr, ICON_SNOWFLAKE, false},
+            {COMPONENT_BINARY_SENSOR, DIAGNOSTIC, NAME_DIAGNOSTIC, nullptr, nullptr, ICON_WRENCH, false},
+
+            // Switches
+            {COMPONENT_SWITCH, CH_ENABLE, NAME_CH_ENABLE, DEVICE_CLASS_SWITCH, nullptr, ICON_RADIATOR, true},
+            {COMPONENT_SWITCH, DHW_ENABLE, NAME_DHW_ENABLE, DEVICE_CLASS_SWITCH, nullptr, ICON_WATER_BOILER, true},
+
+            // Temperature sensors
+            {COMPONENT_SENSOR, BOILER_TEMP, NAME_BOILER_TEMP, DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER, false},
+            {COMPONENT_SENSOR, DHW_TEMP, NAME_DHW_TEMP, DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER, false},
+            {COMPONENT_SENSOR, RETURN_TEMP, NAME_RETURN_TEMP, DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER, false},
+            {COMPONENT_SENSOR, OUTSIDE_TEMP, NAME_OUTSIDE_TEMP, DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER, false},
+            {COMPONENT_SENSOR, ROOM_TEMP, NAME_ROOM_TEMP, DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_HOME_THERMOMETER, false},
+            {COMPONENT_SENSOR, EXHAUST_TEMP, NAME_EXHAUST_TEMP, DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER, false},
+
+            // Numbers (setpoints)
+            {COMPONENT_NUMBER, CONTROL_SETPOINT, NAME_CONTROL_SETPOINT, nullptr, UNIT_CELSIUS, ICON_THERMOMETER_LINES, true, 0.0f, 100.0f, 0.5f},
+            {COMPONENT_NUMBER, ROOM_SETPOINT, NAME_ROOM_SETPOINT, nullptr, UNIT_CELSIUS, ICON_HOME_THERMOMETER_OUTLINE, true, 5.0f, 30.0f, 0.5f},
+            {COMPONENT_NUMBER, DHW_SETPOINT, NAME_DHW_SETPOINT, nullptr, UNIT_CELSIUS, ICON_WATER_THERMOMETER_OUTLINE, true, 30.0f, 90.0f, 1.0f},
+            {COMPONENT_NUMBER, MAX_CH_SETPOINT, NAME_MAX_CH_SETPOINT, nullptr, UNIT_CELSIUS, ICON_THERMOMETER_HIGH, true, 30.0f, 90.0f, 1.0f},
+
+            // Modulation sensors
+            {COMPONENT_SENSOR, MODULATION, NAME_MODULATION, nullptr, UNIT_PERCENT, ICON_PERCENT, false},
+            {COMPONENT_SENSOR, MAX_MODULATION, NAME_MAX_MODULATION, nullptr, UNIT_PERCENT, ICON_PERCENT, false},
+
+            // Pressure & flow
+            {COMPONENT_SENSOR, PRESSURE, NAME_PRESSURE, DEVICE_CLASS_PRESSURE, UNIT_BAR, ICON_GAUGE, false},
+            {COMPONENT_SENSOR, DHW_FLOW, NAME_DHW_FLOW, nullptr, UNIT_LITERS_PER_MIN, ICON_WATER_PUMP, false},
+
+            // Counters
+            {COMPONENT_SENSOR, BURNER_STARTS, NAME_BURNER_STARTS, nullptr, UNIT_STARTS, ICON_COUNTER, false},
+            {COMPONENT_SENSOR, CH_PUMP_STARTS, NAME_CH_PUMP_STARTS, nullptr, UNIT_STARTS, ICON_COUNTER, false},
+            {COMPONENT_SENSOR, DHW_PUMP_STARTS, NAME_DHW_PUMP_STARTS, nullptr, UNIT_STARTS, ICON_COUNTER, false},
+            {COMPONENT_SENSOR, BURNER_HOURS, NAME_BURNER_HOURS, DEVICE_CLASS_DURATION, UNIT_HOURS, ICON_CLOCK_OUTLINE, false},
+            {COMPONENT_SENSOR, CH_PUMP_HOURS, NAME_CH_PUMP_HOURS, DEVICE_CLASS_DURATION, UNIT_HOURS, ICON_CLOCK_OUTLINE, false},
+            {COMPONENT_SENSOR, DHW_PUMP_HOURS, NAME_DHW_PUMP_HOURS, DEVICE_CLASS_DURATION, UNIT_HOURS, ICON_CLOCK_OUTLINE, false},
+
+            // Faults and config
+            {COMPONENT_SENSOR, FAULT_CODE, NAME_FAULT_CODE, nullptr, nullptr, ICON_ALERT_OCTAGON, false},
+
+            // Diagnostic code
+            {COMPONENT_SENSOR, DIAGNOSTIC_CODE, NAME_DIAGNOSTIC_CODE, nullptr, nullptr, ICON_ALERT_CIRCLE, false},
+
+            {COMPONENT_BINARY_SENSOR, DHW_PRESENT, NAME_DHW_PRESENT, nullptr, nullptr, ICON_WATER_BOILER, false},
+            {COMPONENT_BINARY_SENSOR, COOLING_SUPPORTED, NAME_COOLING_SUPPORTED, nullptr, nullptr, ICON_SNOWFLAKE, false},
+            {COMPONENT_BINARY_SENSOR, CH2_PRESENT, NAME_CH2_PRESENT, nullptr, nullptr, ICON_RADIATOR, false},
+
+            {COMPONENT_SENSOR, OPENTHERM_VERSION, NAME_OPENTHERM_VERSION, nullptr, nullptr, ICON_INFORMATION, false},
+
+            // Text / device config
+            {COMPONENT_TEXT, DEVICE_NAME, NAME_DEVICE_NAME, nullptr, nullptr, ICON_TAG_TEXT, true},
+            {COMPONENT_TEXT, DEVICE_ID, NAME_DEVICE_ID, nullptr, nullptr, ICON_IDENTIFIER, true},
+
+            // GPIO numbers
+            {COMPONENT_NUMBER, OPENTHERM_TX_PIN, NAME_OPENTHERM_TX_PIN, nullptr, nullptr, ICON_PIN, true, 0.0f, 28.0f, 1.0f},
+            {COMPONENT_NUMBER, OPENTHERM_RX_PIN, NAME_OPENTHERM_RX_PIN, nullptr, nullptr, ICON_PIN, true, 0.0f, 28.0f, 1.0f},
+            {COMPONENT_NUMBER, UPDATE_INTERVAL, NAME_UPDATE_INTERVAL, nullptr, UNIT_MS, ICON_TIMER, true, 1000.0f, 300000.0f, 1000.0f},
+            {COMPONENT_TEXT, FILTER, NAME_FILTER, nullptr, nullptr, ICON_FILTER, true},
+            {COMPONENT_TEXT, POLL_TIERS, NAME_POLL_TIERS, nullptr, nullptr, ICON_TIMER, true},
+            {COMPONENT_NUMBER, STATS_WINDOW, NAME_STATS_WINDOW, nullptr, UNIT_SECONDS, ICON_TIMER, true, 60.0f, 86400.0f, 60.0f},
+
+            // Time/Date sensors (read-only from boiler)
+            {COMPONENT_SENSOR, DAY_OF_WEEK, NAME_DAY_OF_WEEK, nullptr, nullptr, ICON_CALENDAR, false},
+            {COMPONENT_SENSOR, TIME_OF_DAY, NAME_TIME_OF_DAY, nullptr, nullptr, ICON_CLOCK_OUTLINE, false},
+            {COMPONENT_SENSOR, DATE, NAME_DATE, nullptr, nullptr, ICON_CALENDAR_TODAY, false},
+            {COMPONENT_SENSOR, YEAR, NAME_YEAR, nullptr, nullptr, ICON_CALENDAR, false},
+
+            // Time sync button - pressing this will sync time from HA to boiler
+            {COMPONENT_BUTTON, SYNC_TIME, NAME_SYNC_TIME, nullptr, nullptr, ICON_CLOCK_SYNC, true},
+
+            // Restart button - pressing this will restart the gateway
+            {COMPONENT_BUTTON, RESTART, NAME_RESTART, nullptr, nullptr, ICON_RESTART, true},
+
+            // Republish discovery button - pressing this will re-publish all discovery configs
+            {COMPONENT_BUTTON, REPUBLISH_DISCOVERY, NAME_REPUBLISH_DISCOVERY, nullptr, nullptr, "mdi:refresh", true},
+
+            // Republish state button - pressing this will re-publish cached values without reading from boiler
+            {COMPONENT_BUTTON, REPUBLISH_STATE, NAME_REPUBLISH_STATE, nullptr, nullptr, "mdi:upload", true},
+
+            // Force republish state button - pressing this will read from boiler and re-publish all values
+            {COMPONENT_BUTTON, FORCE_REPUBLISH_STATE, NAME_FORCE_REPUBLISH_STATE, nullptr, nullptr, "mdi:upload-multiple", true},
+
+            // Temperature bounds (read-only from boiler)
+            {COMPONENT_SENSOR, DHW_SETPOINT_MIN, NAME_DHW_SETPOINT_MIN, DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER_LOW, false},
+            {COMPONENT_SENSOR, DHW_SETPOINT_MAX, NAME_DHW_SETPOINT_MAX, DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER_HIGH, false},
+            {COMPONENT_SENSOR, CH_SETPOINT_MIN, NAME_CH_SETPOINT_MIN, DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER_LOW, false},
+            {COMPONENT_SENSOR, CH_SETPOINT_MAX, NAME_CH_SETPOINT_MAX, DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER_HIGH, false},
+
+            // WiFi statistics
+            {COMPONENT_SENSOR, WIFI_RSSI, NAME_WIFI_RSSI, DEVICE_CLASS_SIGNAL_STRENGTH, UNIT_DBM, ICON_WIFI, false},
+            {COMPONENT_SENSOR, WIFI_LINK_STATUS, NAME_WIFI_LINK_STATUS, nullptr, nullptr, ICON_WIFI_CHECK, false},
+            {COMPONENT_SENSOR, IP_ADDRESS, NAME_IP_ADDRESS, nullptr, nullptr, ICON_IP_NETWORK, false},
+            {COMPONENT_SENSOR, WIFI_SSID, NAME_WIFI_SSID, nullptr, nullptr, ICON_WIFI_MARKER, false},
+            {COMPONENT_SENSOR, UPTIME, NAME_UPTIME, DEVICE_CLASS_DURATION, UNIT_SECONDS, ICON_CLOCK_START, false},
+            {COMPONENT_SENSOR, FREE_HEAP, NAME_FREE_HEAP, DEVICE_CLASS_DATA_SIZE, UNIT_BYTES, ICON_MEMORY, false},
+
+            // MQTT statistics for long-term monitoring
+            {COMPONENT_SENSOR, MQTT_PUBLISH_ATTEMPTS, NAME_MQTT_PUBLISH_ATTEMPTS, nullptr, nullptr, ICON_COUNTER, false},
+            {COMPONENT_SENSOR, MQTT_PUBLISH_FAILURES, NAME_MQTT_PUBLISH_FAILURES, nullptr, nullptr, ICON_ALERT_CIRCLE, false},
+            {COMPONENT_SENSOR, MQTT_RECONNECT_COUNT, NAME_MQTT_RECONNECT_COUNT, nullptr, nullptr, ICON_WIFI, false},
+            {COMPONENT_SENSOR, MQTT_PUBLISH_RATE, NAME_MQTT_PUBLISH_RATE, nullptr, UNIT_MESSAGES_PER_MINUTE, ICON_COUNTER, false},
+            {COMPONENT_SENSOR, MQTT_QUEUE_DEPTH, NAME_MQTT_QUEUE_DEPTH, nullptr, nullptr, ICON_COUNTER, false},
+            {COMPONENT_SENSOR, MQTT_QUEUE_DROPS, NAME_MQTT_QUEUE_DROPS, nullptr, nullptr, ICON_ALERT_CIRCLE, false},
+            {COMPONENT_SENSOR, MQTT_PRIORITY_STATS, NAME_MQTT_PRIORITY_STATS, nullptr, nullptr, ICON_COUNTER, false},
+
+            // OpenTherm operation metrics for diagnostics
+            {COMPONENT_SENSOR, OT_TOTAL_REQUESTS, NAME_OT_TOTAL_REQUESTS, nullptr, nullptr, ICON_COUNTER, false},
+            {COMPONENT_SENSOR, OT_FAILED_REQUESTS, NAME_OT_FAILED_REQUESTS, nullptr, nullptr, ICON_ALERT_CIRCLE, false},
+            {COMPONENT_SENSOR, OT_SUCCESS_RATE, NAME_OT_SUCCESS_RATE, nullptr, "%", ICON_PERCENT, false},
+            {COMPONENT_SENSOR, OT_LAST_ERROR_ENTITY, NAME_OT_LAST_ERROR_ENTITY, nullptr, nullptr, ICON_ALERT_CIRCLE, false},
+            {COMPONENT_SENSOR, OT_TIME_SINCE_ERROR, NAME_OT_TIME_SINCE_ERROR, DEVICE_CLASS_DURATION, UNIT_SECONDS, ICON_CLOCK_OUTLINE, false},
+            {COMPONENT_SENSOR, OT_FRAMES_PER_MINUTE, NAME_OT_FRAMES_PER_MINUTE, nullptr, UNIT_FRAMES_PER_MINUTE, ICON_COUNTER, false},
+            {COMPONENT_SENSOR, OT_WRITES_SAVED, NAME_OT_WRITES_SAVED, nullptr, nullptr, ICON_COUNTER, false},
+
+            // Main loop responsiveness
+            {COMPONENT_SENSOR, LOOP_WAKEUPS, NAME_LOOP_WAKEUPS, nullptr, UNIT_WAKEUPS_PER_SECOND, ICON_COUNTER, false},
+            {COMPONENT_SENSOR, COMMAND_LATENCY, NAME_COMMAND_LATENCY, DEVICE_CLASS_DURATION, UNIT_MS, ICON_CLOCK_OUTLINE, false},
+
+            // Boiler statistics, one value per statistics window
+            {COMPONENT_SENSOR, BOILER_TEMP_MEAN, NAME_BOILER_TEMP_MEAN, DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER, false},
+            {COMPONENT_SENSOR, BOILER_TEMP_MIN, NAME_BOILER_TEMP_MIN, DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER_LOW, false},
+            {COMPONENT_SENSOR, BOILER_TEMP_MAX, NAME_BOILER_TEMP_MAX, DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER_HIGH, false},
+            {COMPONENT_SENSOR, DELTA_T_MEAN, NAME_DELTA_T_MEAN, nullptr, UNIT_CELSIUS, ICON_THERMOMETER_LINES, false},
+            {COMPONENT_SENSOR, DELTA_T_EWMA, NAME_DELTA_T_EWMA, nullptr, UNIT_CELSIUS, ICON_THERMOMETER_LINES, false},
+            {COMPONENT_SENSOR, MODULATION_MEAN, NAME_MODULATION_MEAN, nullptr, UNIT_PERCENT, ICON_PERCENT, false},
+            {COMPONENT_SENSOR, FLAME_DUTY, NAME_FLAME_DUTY, nullptr, UNIT_PERCENT, ICON_FIRE, false},
+            {COMPONENT_SENSOR, CH_TIME, NAME_CH_TIME, DEVICE_CLASS_DURATION, UNIT_SECONDS, ICON_RADIATOR, false},
+            {COMPONENT_SENSOR, DHW_TIME, NAME_DHW_TIME, DEVICE_CLASS_DURATION, UNIT_SECONDS, ICON_WATER_BOILER, false},
+
+            // Burner cycles, one value per hour
+            {COMPONENT_SENSOR, STARTS_PER_HOUR, NAME_STARTS_PER_HOUR, nullptr, UNIT_STARTS_PER_HOUR, ICON_FIRE, false},
+            {COMPONENT_SENSOR, BURN_TIME_MIN, NAME_BURN_TIME_MIN, DEVICE_CLASS_DURATION, UNIT_SECONDS, ICON_CLOCK_OUTLINE, false},
+            {COMPONENT_SENSOR, BURN_TIME_MEAN, NAME_BURN_TIME_MEAN, DEVICE_CLASS_DURATION, UNIT_SECONDS, ICON_CLOCK_OUTLINE, false},
+            {COMPONENT_SENSOR, BURN_TIME_MAX, NAME_BURN_TIME_MAX, DEVICE_CLASS_DURATION, UNIT_SECONDS, ICON_CLOCK_OUTLINE, false},
+            {COMPONENT_SENSOR, OFF_TIME_MEAN, NAME_OFF_TIME_MEAN, DEVICE_CLASS_DURATION, UNIT_SECONDS, ICON_CLOCK_OUTLINE, false},
+            {COMPONENT_SENSOR, SHORT_CYCLES, NAME_SHORT_CYCLES, nullptr, nullptr, ICON_COUNTER, false},
+            {COMPONENT_BINARY_SENSOR, SHORT_CYCLING, NAME_SHORT_CYCLING, DEVICE_CLASS_PROBLEM, nullptr, ICON_FIRE_ALERT, false},
+        };
+
+        static_assert(sizeof(COMPONENTS) / sizeof(COMPONENTS[0]) == COMPONENT_COUNT,
+                      "COMPONENT_COUNT must match the COMPONENTS table");
+
+        // Bounded appender: keeps counting past the end so callers can detect truncation
+        class JsonOut
+        {
+        public:
+            JsonOut(char *buf, size_t len) : buf_(buf), len_(len), used_(0)
+            {
+                if (len_ > 0)
+                    buf_[0] = '\0';
+            }
+
+            void add(const char *fmt, ...)
+            {
+                va_list args;
+                va_start(args, fmt);
+                int n = vsnprintf(used_ < len_ ? buf_ + used_ : nullptr, used_ < len_ ? len_ - used_ : 0, fmt, args);
+                va_end(args);
+                if (n > 0)
+                    used_ += (size_t)n;
+            }
+
+            size_t used() const { return used_; }
+
+        private:
+            char *buf_;
+            size_t len_;
+            size_t used_;
+        };
+
+        // JSON keys of one payload style
+        struct Keys
+        {
+            const char *unique_id;
+            const char *default_entity_id;
+            const char *state_topic;
+            const char *command_topic;
+            const char *device_class;
+            const char *unit;
+            const char *icon;
+            const char *value_template;
+            const char *device;
+            const char *identifiers;
+            const char *model;
+            const char *manufacturer;
+            const char *platform;
+            const char *origin;
+            const char *components;
+        };
+
+        static const Keys FULL_KEYS = {
+            JSON_UNIQUE_ID, JSON_DEFAULT_ENTITY_ID, JSON_STATE_TOPIC, JSON_COMMAND_TOPIC,
+            JSON_DEVICE_CLASS, JSON_UNIT_OF_MEASUREMENT, JSON_ICON, JSON_VALUE_TEMPLATE,
+            JSON_DEVICE, JSON_IDENTIFIERS, JSON_MODEL, JSON_MANUFACTURER,
+            JSON_PLATFORM, JSON_ORIGIN, JSON_COMPONENTS};
+
+        static const Keys ABBR_KEYS = {
+            ABBR_UNIQUE_ID, ABBR_DEFAULT_ENTITY_ID, ABBR_STATE_TOPIC, ABBR_COMMAND_TOPIC,
+            ABBR_DEVICE_CLASS, ABBR_UNIT_OF_MEASUREMENT, ABBR_ICON, ABBR_VALUE_TEMPLATE,
+            ABBR_DEVICE, ABBR_IDENTIFIERS, ABBR_MODEL, ABBR_MANUFACTURER,
+            ABBR_PLATFORM, ABBR_ORIGIN, ABBR_COMPONENTS};
+
+        static const Keys &keysFor(const HomeAssistant::Config &cfg)
+        {
+            return cfg.compact_discovery ? ABBR_KEYS : FULL_KEYS;
+        }
+
+        // "~":"<topic_base>/<device_id>" - compact payloads write topics relative to it
+        static void addBaseTopic(JsonOut &out, const HomeAssistant::Config &cfg)
+        {
+            out.add(",\"%s\":\"%s/%s\"", JSON_BASE_TOPIC, cfg.topic_base, cfg.device_id);
+        }
+
+        // Fields shared by both modes, each with a leading comma; the caller writes
+        // the opening brace, the name and (compact) the "~" base topic
+        static void addComponentFields(JsonOut &out, const HomeAssistant::Config &cfg, const Component &c)
+        {
+            const Keys &k = keysFor(cfg);
+            const char *base = cfg.compact_discovery ? JSON_BASE_TOPIC : nullptr;
+
+            out.add(",\"%s\":\"%s.%s_%s\"", k.default_entity_id, c.component, cfg.device_id, c.object_id);
+            out.add(",\"%s\":\"%s_%s\"", k.unique_id, cfg.device_id, c.object_id);
+
+            // opentherm/opentherm_gw/state/<object_id>, or "~/state/<object_id>"
+            out.add(",\"%s\":\"", k.state_topic);
+            if (base)
+                out.add("%s", base);
+            else
+                out.add("%s/%s", cfg.topic_base, cfg.device_id);
+
+            // Aggregated state: entities read their value out of the shared JSON document
+            Entities::Id entity;
+            bool from_document = cfg.aggregate_state && Entities::findBySuffix(c.object_id, &entity);
+            if (from_document)
+                out.add("/%s\"", cfg.state_topic_base);
+            else
+                out.add("/%s/%s\"", cfg.state_topic_base, c.object_id);
+
+            if (c.command)
+            {
+                if (base)
+                    out.add(",\"%s\":\"%s/%s/%s\"", k.command_topic, base, cfg.command_topic_base, c.object_id);
+                else
+                    out.add(",\"%s\":\"%s/%s/%s/%s\"", k.command_topic,
+                            cfg.topic_base, cfg.device_id, cfg.command_topic_base, c.object_id);
+            }
+            if (c.device_class)
+                out.add(",\"%s\":\"%s\"", k.device_class, c.device_class);
+            if (c.unit)
+                out.add(",\"%s\":\"%s\"", k.unit, c.unit);
+            if (c.icon)
+                out.add(",\"%s\":\"%s\"", k.icon, c.icon);
+            if (from_document)
+            {
+                char value_template[64];
+                Publish::formatValueTemplate(entity, value_template, sizeof(value_template));
+                out.add(",\"%s\":\"%s\"", k.value_template, value_template);
+            }
+
+            if (strcmp(c.component, COMPONENT_NUMBER) == 0)
+            {
+                out.add(",\"%s\":%.1f", JSON_MIN, c.min_value);
+                out.add(",\"%s\":%.1f", JSON_MAX, c.max_value);
+                out.add(",\"%s\":%.1f", JSON_STEP, c.step);
+                out.add(",\"%s\":\"%s\"", JSON_MODE, MODE_BOX);
+            }
+        }
+
+        // Full device block, or just its identifiers once another config has
+        // described the device (Home Assistant merges them by identifier)
+        static void addDeviceBlock(JsonOut &out, const HomeAssistant::Config &cfg, bool full)
+        {
+            const Keys &k = keysFor(cfg);
+            out.add("\"%s\":{", k.device);
+            out.add("\"%s\":[\"%s\"]", k.identifiers, cfg.device_id);
+            if (full)
+            {
+                out.add(",\"%s\":\"%s\"", JSON_NAME, cfg.device_name);
+                out.add(",\"%s\":\"%s\"", k.model, DEVICE_MODEL);
+                out.add(",\"%s\":\"%s\"", k.manufacturer, DEVICE_MANUFACTURER);
+            }
+            out.add("}");
+        }
+
+        size_t formatComponentConfig(const HomeAssistant::Config &cfg, const Component &c, bool first,
+                                     char *buf, size_t len)
+        {
+            JsonOut out(buf, len);
+            out.add("{\"%s\":\"%s\"", JSON_NAME, c.name);
+            if (cfg.compact_discovery)
+                addBaseTopic(out, cfg);
+            addComponentFields(out, cfg, c);
+            out.add(",");
+            addDeviceBlock(out, cfg, first || !cfg.compact_discovery);
+            out.add("}");
+            return out.used();
+        }
+
+        size_t formatDeviceDiscoveryTopic(const HomeAssistant::Config &cfg, char *buf, size_t len)
+        {
+            int n = snprintf(buf, len, "%s/%s/%s%s", cfg.mqtt_prefix, COMPONENT_DEVICE, cfg.device_id, CONFIG_SUFFIX);
+            return n < 0 ? 0 : (size_t)n;
+        }
+
+        // Hand one rendered piece to the sink; false if it did not fit or the sink failed
+        static bool emit(const JsonOut &out, const char *chunk, size_t chunk_len, ChunkSink sink, size_t *total)
+        {
+            if (out.used() >= chunk_len)
+            {
+                printf("ERROR: Device discovery piece too large (%zu bytes, buffer %zu)\n", out.used(), chunk_len);
+                return false;
+            }
+            *total += out.used();
+            return sink == nullptr || sink(chunk, out.used());
+        }
+
+        size_t streamDeviceConfig(const HomeAssistant::Config &cfg, char *chunk, size_t chunk_len, ChunkSink sink)
+        {
+            size_t total = 0;
+
+            // {"device":{...},"origin":{...},"components":{
+            {
+                const Keys &k = keysFor(cfg);
+                JsonOut out(chunk, chunk_len);
+                out.add("{");
+                addDeviceBlock(out, cfg, true);
+                if (cfg.compact_discovery)
+                    addBaseTopic(out, cfg); // Shared by every component
+                out.add(",\"%s\":{\"%s\":\"%s\"},", k.origin, JSON_NAME, DEVICE_MANUFACTURER);
+                out.add("\"%s\":{", k.components);
+                if (!emit(out, chunk, chunk_len, sink, &total))
+                    return 0;
+            }
+
+            // "<object_id>":{"platform":"<component>","name":...}
+            for (size_t i = 0; i < COMPONENT_COUNT; i++)
+            {
+                const Component &c = COMPONENTS[i];
+                JsonOut out(chunk, chunk_len);
+                out.add("%s\"%s\":{\"%s\":\"%s\",\"%s\":\"%s\"", i == 0 ? "" : ",",
+                        c.object_id, keysFor(cfg).platform, c.component, JSON_NAME, c.name);
+                addComponentFields(out, cfg, c);
+                out.add("}");
+                if (!emit(out, chunk, chunk_len, sink, &total))
+                    return 0;
+            }
+
+            {
+                JsonOut out(chunk, chunk_len);
+                out.add("}}");
+                if (!emit(out, chunk, chunk_len, sink, &total))
+                    return 0;
+            }
+            return total;
+        }
+
+        // FNV-1a over everything discovery would publish
+        static constexpr uint32_t FNV_OFFSET = 2166136261u;
+        static constexpr uint32_t FNV_PRIME = 16777619u;
+        static uint32_t g_hash = FNV_OFFSET;
+
+        static void hashBytes(const char *data, size_t len)
+        {
+            for (size_t i = 0; i < len; i++)
+            {
+                g_hash ^= (uint8_t)data[i];
+                g_hash *= FNV_PRIME;
+            }
+        }
+
+        static bool hashSink(const char *data, size_t len)
+        {
+            hashBytes(data, len);
+            return true;
+        }
+
+        uint32_t discoveryHash(const HomeAssistant::Config &cfg)
+        {
+            static char buf[COMPONENT_CONFIG_LEN];
+            g_hash = FNV_OFFSET;
+
+            if (cfg.device_discovery)
+            {
+                size_t n = formatDeviceDiscoveryTopic(cfg, buf, sizeof(buf));
+                hashBytes(buf, n < sizeof(buf) ? n : 0);
+                streamDeviceConfig(cfg, buf, sizeof(buf), hashSink);
+                return g_hash;
+            }
+
+            for (size_t i = 0; i < COMPONENT_COUNT; i++)
+            {
+                const Component &c = COMPONENTS[i];
+                int n = snprintf(buf, sizeof(buf), "%s/%s/%s/%s%s", cfg.mqtt_prefix, c.component,
+                                 cfg.device_id, c.object_id, CONFIG_SUFFIX);
+                hashBytes(buf, n > 0 && (size_t)n < sizeof(buf) ? (size_t)n : 0);
+                size_t len = formatComponentConfig(cfg, c, i == 0, buf, sizeof(buf));
+                hashBytes(buf, len < sizeof(buf) ? len : 0);
+            }
+            return g_hash;
+        }
+
+        size_t formatDiscoveryHash(uint32_t hash, char *buf, size_t len)
+        {
+            int n = snprintf(buf, len, "%08lx", (unsigned long)hash);
+            return n < 0 ? 0 : (size_t)n;
+        }
+
+        size_t formatDiscoveryHashTopic(const HomeAssistant::Config &cfg, char *buf, size_t len)
+        {
+            int n = snprintf(buf, len, "%s/%s/%s", cfg.topic_base, cfg.device_id, MQTTTopics::DISCOVERY_HASH);
+            return n < 0 ? 0 : (size_t)n;
+        }
+
+        size_t formatBirthTopic(const HomeAssistant::Config &cfg, char *buf, size_t len)
+        {
+            int n = snprintf(buf, len, "%s/%s", cfg.mqtt_prefix, BIRTH_TOPIC_SUFFIX);
+            return n < 0 ? 0 : (size_t)n;
+        }
+
+        void DiscoverySync::begin(uint32_t hash, uint32_t now_ms)
+        {
+            hash_ = hash;
+            state_ = State::AWAITING_MARKER;
+            deadline_ms_ = now_ms + MARKER_WAIT_MS;
+            retry_ms_ = RETRY_MIN_MS;
+        }
+
+        void DiscoverySync::onMarker(const char *payload)
+        {
+            char *end = nullptr;
+            unsigned long value = strtoul(payload, &end, 16);
+            bool valid = end != payload && *end == '\0';
+            retained_ = (uint32_t)value;
+            retained_valid_ = valid;
+
+            if (state_ == State::AWAITING_MARKER || state_ == State::IDLE)
+                state_ = valid && retained_ == hash_ ? State::IDLE : State::PUBLISH_DUE;
+        }
+
+        void DiscoverySync::onBirth(const char *payload)
+        {
+            if (strcmp(payload, BIRTH_ONLINE) == 0 && state_ != State::DISABLED)
+                state_ = State::PUBLISH_DUE;
+        }
+
+        void DiscoverySync::requestPublish()
+        {
+            if (state_ != State::DISABLED)
+                state_ = State::PUBLISH_DUE;
+        }
+
+        DiscoverySync::Action DiscoverySync::poll(uint32_t now_ms) const
+        {
+            switch (state_)
+            {
+            case State::AWAITING_MARKER:
+                // No retained marker in time: the broker has none, so neither
+                // are the configs it describes
+                return (int32_t)(now_ms - deadline_ms_) >= 0 ? Action::PUBLISH : Action::WAIT;
+            case State::PUBLISH_DUE:
+                return Action::PUBLISH;
+            case State::RETRY_WAIT:
+                return (int32_t)(now_ms - deadline_ms_) >= 0 ? Action::PUBLISH : Action::WAIT;
+            default:
+                return Action::NONE;
+            }
+        }
+
+        uint32_t DiscoverySync::msUntilTimeout(uint32_t now_ms) const
+        {
+            if (state_ != State::AWAITING_MARKER && state_ != State::RETRY_WAIT)
+                return UINT32_MAX;
+            int32_t left = (int32_t)(deadline_ms_ - now_ms);
+            return left > 0 ? (uint32_t)left : 0;
+        }
+
+        void DiscoverySync::published()
+        {
+            state_ = State::IDLE;
+            retained_ = hash_;
+            retained_valid_ = true;
+            retry_ms_ = RETRY_MIN_MS;
+        }
+
+        void DiscoverySync::failed(uint32_t now_ms)
+        {
+            if (state_ == State::DISABLED)
+                return;
+            state_ = State::RETRY_WAIT;
+            deadline_ms_ = now_ms + retry_ms_;
+            retry_ms_ = retry_ms_ < RETRY_MAX_MS / 2 ? retry_ms_ * 2 : RETRY_MAX_MS;
+        }
+
+    } // namespace Discovery
+} // namespace OpenTherm
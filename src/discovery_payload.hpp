@@ -0,0 +1,150 @@
+// Home Assistant discovery payloads
+//
+// Every entity the gateway announces is one row of COMPONENTS. Both discovery
+// modes render from that table:
+//  - per-entity: one retained config per component on
+//    <prefix>/<component>/<device_id>/<object_id>/config
+//  - device-based: a single retained config on <prefix>/device/<device_id>/config
+//    holding the device block once and every component under "components"
+//    (Home Assistant 2024.11 and later)
+// With cfg.compact_discovery both use Home Assistant's abbreviated keys
+// ("stat_t", "uniq_id", ...), topics relative to a "~" base topic, and in
+// per-entity mode only the first config carries the full device block.
+// The device payload is far larger than lwIP's output ring, so it is rendered
+// one piece at a time (header, each component, trailer) into a small buffer
+// and handed to a sink that streams it to the connection.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef DISCOVERY_PAYLOAD_HPP
+#define DISCOVERY_PAYLOAD_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace OpenTherm
+{
+    namespace HomeAssistant
+    {
+        struct Config;
+    }
+
+    namespace Discovery
+    {
+        struct Component
+        {
+            const char *component;    // MQTTDiscovery::COMPONENT_*
+            const char *object_id;    // Also the state/command topic suffix
+            const char *name;
+            const char *device_class; // nullptr to omit
+            const char *unit;         // nullptr to omit
+            const char *icon;         // nullptr to omit
+            bool command;             // Has a command topic
+            float min_value = 0.0f;   // COMPONENT_NUMBER only
+            float max_value = 100.0f;
+            float step = 1.0f;
+        };
+
+        // Buffer for one per-entity config; the longest (full keys with an
+        // aggregated state template) is a little over 512 bytes
+        constexpr size_t COMPONENT_CONFIG_LEN = 640;
+
+        // Compile-time so per-component tables (see topic_arena.hpp) can be sized by it
+        constexpr size_t COMPONENT_COUNT = 93;
+
+        extern const Component COMPONENTS[];
+
+        // Per-entity config payload; returns its length (>= len if it was truncated).
+        // `first` marks the config that describes the device in full (compact mode).
+        size_t formatComponentConfig(const HomeAssistant::Config &cfg, const Component &c, bool first,
+                                     char *buf, size_t len);
+
+        // "<prefix>/device/<device_id>/config"; returns its length
+        size_t formatDeviceDiscoveryTopic(const HomeAssistant::Config &cfg, char *buf, size_t len);
+
+        // Receives the device payload piece by piece; return false to abort
+        typedef bool (*ChunkSink)(const char *data, size_t len);
+
+        // Render the device-based payload into `chunk` one piece at a time and pass
+        // each piece to `sink` (nullptr only measures). Returns the total length,
+        // or 0 if a piece did not fit `chunk` or the sink failed.
+        size_t streamDeviceConfig(const HomeAssistant::Config &cfg, char *chunk, size_t chunk_len, ChunkSink sink);
+
+        // FNV-1a hash of every topic and payload the configured discovery mode
+        // publishes, so any change to the config or the component table changes it
+        uint32_t discoveryHash(const HomeAssistant::Config &cfg);
+
+        // Retained marker recording the hash of the discovery on the broker:
+        // "<topic_base>/<device_id>/discovery_hash" = "%08lx"
+        size_t formatDiscoveryHash(uint32_t hash, char *buf, size_t len);
+        size_t formatDiscoveryHashTopic(const HomeAssistant::Config &cfg, char *buf, size_t len);
+
+        // Home Assistant's birth/last-will topic: "<prefix>/status"
+        size_t formatBirthTopic(const HomeAssistant::Config &cfg, char *buf, size_t len);
+
+        // Decides when discovery has to be (re)published. After (re)connecting the
+        // gateway subscribes to its retained marker and calls begin(); the broker
+        // delivers the marker right after the SUBACK. A matching marker means the
+        // retained configs are current and nothing is published. A different or
+        // missing marker (none within MARKER_WAIT_MS), or Home Assistant coming
+        // online, means they are published again. A publish that fails is retried
+        // after RETRY_MIN_MS, doubling up to RETRY_MAX_MS, rather than on every
+        // update().
+        class DiscoverySync
+        {
+        public:
+            static constexpr uint32_t MARKER_WAIT_MS = 500;
+            static constexpr uint32_t RETRY_MIN_MS = 5000;
+            static constexpr uint32_t RETRY_MAX_MS = 300000;
+
+            enum class Action
+            {
+                NONE,    // Discovery on the broker is current
+                WAIT,    // Still waiting for the retained marker or a retry; hold state publishes
+                PUBLISH, // Publish discovery, then the marker, then call published() or failed()
+            };
+
+            DiscoverySync()
+                : state_(State::DISABLED), hash_(0), retained_(0), retained_valid_(false), deadline_ms_(0),
+                  retry_ms_(RETRY_MIN_MS)
+            {
+            }
+
+            void begin(uint32_t hash, uint32_t now_ms);
+            void onMarker(const char *payload);
+            void onBirth(const char *payload);
+            void requestPublish();
+
+            Action poll(uint32_t now_ms) const;
+
+            // Milliseconds until poll() stops answering WAIT on its own (the marker
+            // timeout or the next retry), or UINT32_MAX if it is not waiting
+            uint32_t msUntilTimeout(uint32_t now_ms) const;
+            void published();
+            void failed(uint32_t now_ms);
+
+            uint32_t hash() const { return hash_; }
+            bool retainedValid() const { return retained_valid_; }
+            uint32_t retained() const { return retained_; }
+
+        private:
+            enum class State
+            {
+                DISABLED, // begin() not called yet (auto discovery off)
+                AWAITING_MARKER,
+                PUBLISH_DUE,
+                RETRY_WAIT, // The last publish failed; the next is due at deadline_ms_
+                IDLE,
+            };
+
+            State state_;
+            uint32_t hash_;
+            uint32_t retained_;
+            bool retained_valid_;
+            uint32_t deadline_ms_;
+            uint32_t retry_ms_; // Wait after the next failure
+        };
+
+    } // namespace Discovery
+} // namespace OpenTherm
+
+#endif // DISCOVERY_PAYLOAD_HPP
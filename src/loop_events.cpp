@@ -0,0 +1,85 @@
+#include "loop_events.hpp"
+
+namespace OpenTherm
+{
+    namespace Common
+    {
+        LoopEvents::LoopEvents(NotifyFn notify)
+            : notify_(notify), window_start_ms_(0), window_started_(false), wakeups_(0), dispatched_(0),
+              latency_sum_us_(0), latency_max_us_(0)
+        {
+            for (size_t i = 0; i < WAKE_SOURCE_COUNT; i++)
+            {
+                signalled_[i].store(0, std::memory_order_relaxed);
+                taken_[i] = 0;
+            }
+        }
+
+        void LoopEvents::signal(WakeSource source)
+        {
+            // Single writer per source: a plain load and store. Release so whatever
+            // the producer published before signalling is visible once take() sees it.
+            std::atomic<uint32_t> &counter = signalled_[static_cast<size_t>(source)];
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            if (notify_)
+                notify_();
+        }
+
+        bool LoopEvents::pending() const
+        {
+            for (size_t i = 0; i < WAKE_SOURCE_COUNT; i++)
+            {
+                if (signalled_[i].load(std::memory_order_acquire) != taken_[i])
+                    return true;
+            }
+            return false;
+        }
+
+        uint32_t LoopEvents::take()
+        {
+            uint32_t mask = 0;
+            for (size_t i = 0; i < WAKE_SOURCE_COUNT; i++)
+            {
+                uint32_t seen = signalled_[i].load(std::memory_order_acquire);
+                if (seen != taken_[i])
+                {
+                    taken_[i] = seen;
+                    mask |= 1u << i;
+                }
+            }
+            return mask;
+        }
+
+        void LoopEvents::noteWakeup()
+        {
+            wakeups_++;
+        }
+
+        void LoopEvents::noteDispatch(uint32_t latency_us)
+        {
+            dispatched_++;
+            latency_sum_us_ += latency_us;
+            if (latency_us > latency_max_us_)
+                latency_max_us_ = latency_us;
+        }
+
+        LoopMetrics LoopEvents::takeMetrics(uint32_t now_ms)
+        {
+            LoopMetrics m;
+            m.elapsed_ms = window_started_ ? now_ms - window_start_ms_ : 0;
+            m.wakeups = wakeups_;
+            m.dispatched = dispatched_;
+            m.latency_avg_us = dispatched_ > 0 ? (uint32_t)(latency_sum_us_ / dispatched_) : 0;
+            m.latency_max_us = latency_max_us_;
+
+            window_start_ms_ = now_ms;
+            window_started_ = true;
+            wakeups_ = 0;
+            dispatched_ = 0;
+            latency_sum_us_ = 0;
+            latency_max_us_ = 0;
+            return m;
+        }
+
+    } // namespace Common
+} // namespace OpenTherm
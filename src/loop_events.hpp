@@ -0,0 +1,98 @@
+// Wakeup events for the main loop
+//
+// The main loop on core 0 sleeps (WFE on the Pico) until there is work: an
+// incoming MQTT message, a completed network request, a change of connection
+// state, or one of its own deadlines (the next poll item, the discovery marker
+// timeout, the state document's rate limit, the periodic connection check).
+// Whatever produces work calls signal() for its source; after waking, the
+// main loop calls take() to see which sources fired.
+//
+// Each source has its own counter with exactly one writer - the lwIP
+// callbacks for MQTT_MESSAGE and CONNECTION, the network actor for
+// NET_COMPLETION - so signalling is a plain load and store published with
+// release ordering, as in MessageRing; no locks and no read-modify-write
+// atomics. After the store signal() calls the notify hook: __sev() on the
+// Pico, which wakes a core sleeping in WFE or makes its next WFE return at
+// once, so a signal landing between pending() and the WFE is not lost.
+//
+// The main loop also counts its wakeups and how long each incoming command
+// waited between arriving and being dispatched; takeMetrics() hands over the
+// totals since the previous call for the diagnostics sensors.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef LOOP_EVENTS_HPP
+#define LOOP_EVENTS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace OpenTherm
+{
+    namespace Common
+    {
+        enum class WakeSource : uint8_t
+        {
+            MQTT_MESSAGE,   // A message was committed to the incoming ring
+            NET_COMPLETION, // The network actor posted completions (credits came back)
+            CONNECTION,     // MQTT connected or lost the connection
+        };
+
+        constexpr size_t WAKE_SOURCE_COUNT = 3;
+
+        constexpr uint32_t wakeBit(WakeSource source)
+        {
+            return 1u << static_cast<uint32_t>(source);
+        }
+
+        struct LoopMetrics
+        {
+            uint32_t elapsed_ms;     // Since the previous takeMetrics(); 0 on the first call
+            uint32_t wakeups;        // Main loop passes
+            uint32_t dispatched;     // Incoming messages handed to the command handlers
+            uint32_t latency_avg_us; // Arrival to dispatch, averaged over `dispatched`
+            uint32_t latency_max_us;
+        };
+
+        class LoopEvents
+        {
+        public:
+            typedef void (*NotifyFn)();
+
+            explicit LoopEvents(NotifyFn notify = nullptr);
+
+            // ---- Producers (one context per source) ----
+
+            void signal(WakeSource source);
+
+            // ---- Consumer (main loop) ----
+
+            // True if any source fired since the last take(); cheap enough to
+            // check before every WFE
+            bool pending() const;
+
+            // Mask of wakeBit()s for the sources that fired since the last call
+            uint32_t take();
+
+            void noteWakeup();
+            void noteDispatch(uint32_t latency_us);
+            LoopMetrics takeMetrics(uint32_t now_ms);
+
+        private:
+            std::atomic<uint32_t> signalled_[WAKE_SOURCE_COUNT]; // Written by the source's producer
+            uint32_t taken_[WAKE_SOURCE_COUNT];                  // Consumer only
+            NotifyFn notify_;
+
+            // Consumer only
+            uint32_t window_start_ms_;
+            bool window_started_;
+            uint32_t wakeups_;
+            uint32_t dispatched_;
+            uint64_t latency_sum_us_;
+            uint32_t latency_max_us_;
+        };
+
+    } // namespace Common
+} // namespace OpenTherm
+
+#endif // LOOP_EVENTS_HPP
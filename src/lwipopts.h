@@ -55,7 +55,7 @@
 
 // MQTT settings
 #define LWIP_MQTT 1
-#define MQTT_OUTPUT_RINGBUF_SIZE 2048  // Increased from 1024 to handle burst publishing better
+#define MQTT_OUTPUT_RINGBUF_SIZE 2560  // Holds the whole aggregated state document (StateDocument::DOCUMENT_LEN)
 #define MQTT_REQ_MAX_IN_FLIGHT 8       // Increased from 4 to allow more pending publishes
 #define MQTT_VAR_HEADER_BUFFER_LEN 256 // Increased from 128 for longer topic names
 
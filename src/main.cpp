@@ -7,7 +7,6 @@
 #include "mqtt_common.hpp"
 #include "mqtt_discovery.hpp"
 #include "led_blink.hpp"
-#include <string>
 
 // Conditional compilation: use simulator or hardware interface
 #ifdef USE_SIMULATOR
@@ -33,34 +32,23 @@ static uint8_t opentherm_rx_pin;
 static OpenTherm::HomeAssistant::HAInterface *ha_interface = nullptr;
 
 // Core 1: Dedicated network processor
-// Runs continuously polling the WiFi/TCP stack to process packets and free buffers
-// This prevents TCP buffer exhaustion and improves MQTT throughput significantly
+// The only core that calls into lwIP: it polls the WiFi/TCP stack and, between
+// polls, hands the publish/subscribe requests core 0 has queued to the MQTT client
 volatile bool core1_should_run = true;
 
 void core1_network_processor()
 {
     printf("Core 1: Network processor started\n");
 
-    // Tight loop continuously polling network stack
-    // This ensures TCP ACKs are processed immediately and buffers are freed ASAP
     while (core1_should_run)
     {
-        cyw43_arch_poll();
+        OpenTherm::Common::network_actor_poll();
         tight_loop_contents(); // Minimal overhead hint to compiler
     }
 
     printf("Core 1: Network processor stopped\n");
 }
 
-// Callback for reconnection - republish discovery
-static void on_reconnect()
-{
-    if (ha_interface)
-    {
-        ha_interface->publishDiscoveryConfigs();
-    }
-}
-
 int main()
 {
     stdio_init_all();
@@ -175,6 +163,10 @@ int main()
 
     // Load update interval from configuration
     uint32_t update_interval_ms = Config::getUpdateIntervalMs();
+    bool aggregate_state = Config::getMQTTStateJson();
+    bool device_discovery = Config::getMQTTDeviceDiscovery();
+    bool compact_discovery = Config::getMQTTCompactDiscovery();
+    uint32_t stats_window_s = Config::getStatsWindowS();
 
     // Configure Home Assistant interface using loaded configuration
     OpenTherm::HomeAssistant::Config ha_config = {
@@ -185,7 +177,11 @@ int main()
         .state_topic_base = "state",
         .command_topic_base = "cmd",
         .auto_discovery = true,
-        .update_interval_ms = update_interval_ms
+        .update_interval_ms = update_interval_ms,
+        .aggregate_state = aggregate_state,
+        .device_discovery = device_discovery,
+        .compact_discovery = compact_discovery,
+        .stats_window_s = stats_window_s
     };
 
     OpenTherm::HomeAssistant::HAInterface ha(ot, ha_config);
@@ -204,27 +200,35 @@ int main()
 
     uint32_t last_connection_check = 0;
 
-    // Main loop
+    // Main loop: runs as soon as there is work and sleeps (WFE) otherwise. The
+    // network core signals incoming messages, completed requests and connection
+    // changes; everything else the loop does has a deadline it sleeps until.
     while (true)
     {
-        // Check connections periodically
+        uint32_t woken_by = OpenTherm::Common::g_loop_events.take();
+        OpenTherm::Common::g_loop_events.noteWakeup();
+
+        // Check connections periodically, and straight away when the connection state changed
         uint32_t now = to_ms_since_boot(get_absolute_time());
 
-        if (now - last_connection_check >= OpenTherm::Common::CONNECTION_CHECK_DELAY_MS)
+        if (now - last_connection_check >= OpenTherm::Common::CONNECTION_CHECK_DELAY_MS ||
+            (woken_by & OpenTherm::Common::wakeBit(OpenTherm::Common::WakeSource::CONNECTION)))
         {
-            bool was_connected = OpenTherm::Common::g_mqtt_connected;
+            bool was_connected = OpenTherm::Common::mqtt_connected();
 
+            // No reconnect callback: the ha.begin() below checks the retained discovery
+            // marker and only republishes discovery if the broker's copy is missing or stale
             OpenTherm::Common::check_and_reconnect(wifi_ssid, wifi_password, mqtt_server_ip, mqtt_server_port,
-                                                   mqtt_client_id, on_reconnect);
+                                                   mqtt_client_id, nullptr);
 
             // Update LED pattern based on connection status
-            if (OpenTherm::Common::g_mqtt_connected && !was_connected)
+            if (OpenTherm::Common::mqtt_connected() && !was_connected)
             {
                 // Just reconnected - set to normal pattern
                 OpenTherm::LED::set_pattern(OpenTherm::LED::BLINK_NORMAL);
                 
                 // Resubscribe to command topics
-                printf("MQTT reconnected, publishing and resubscribing...\n");
+                printf("MQTT reconnected, resubscribing...\n");
                 ha.begin(mqtt_callbacks);
             }
 
@@ -237,22 +241,34 @@ int main()
 #endif
 
         // Update Home Assistant (reads sensors and publishes to MQTT)
-        // Only updates every configured interval
+        // Only does work when a poll item or publish is due
         ha.update();
 
-        // Process any pending MQTT messages
-        if (!OpenTherm::Common::g_pending_messages.empty())
+        // Account for publishes the network core has completed or failed
+        OpenTherm::Common::mqtt_process_completions();
+
+        // Process pending MQTT messages in arrival order
+        while (const OpenTherm::Common::IncomingMessage *msg = OpenTherm::Common::g_incoming_messages.front())
         {
-            for (auto &msg : OpenTherm::Common::g_pending_messages)
-            {
-                ha.handleMessage(msg.first.c_str(), msg.second.c_str());
-            }
-            // Force full deallocation of map to prevent capacity retention
-            std::map<std::string, std::string>().swap(OpenTherm::Common::g_pending_messages);
+            OpenTherm::Common::g_loop_events.noteDispatch(time_us_32() - msg->received_us);
+            printf("Received: %s = %s\n", msg->topic, msg->payload);
+            ha.handleMessage(msg->topic, msg->payload);
+            OpenTherm::Common::g_incoming_messages.pop();
         }
 
-        // Small delay
-        sleep_ms(100);
+        // Sleep until the next thing is due, or the network core has something for us
+        now = to_ms_since_boot(get_absolute_time());
+        uint32_t idle_ms = ha.msUntilWork(now);
+        uint32_t since_check = now - last_connection_check;
+        uint32_t until_check = since_check < OpenTherm::Common::CONNECTION_CHECK_DELAY_MS
+                                   ? OpenTherm::Common::CONNECTION_CHECK_DELAY_MS - since_check
+                                   : 0;
+        if (until_check < idle_ms)
+            idle_ms = until_check;
+        if (idle_ms > OpenTherm::Common::MAIN_LOOP_MAX_IDLE_MS)
+            idle_ms = OpenTherm::Common::MAIN_LOOP_MAX_IDLE_MS;
+        if (idle_ms > 0)
+            OpenTherm::Common::wait_for_work(idle_ms);
     }
 
     return 0;
@@ -0,0 +1,129 @@
+#include "message_ring.hpp"
+#include <cstring>
+
+namespace OpenTherm
+{
+    namespace Common
+    {
+        MessageRing::MessageRing()
+            : head_(0), tail_(0), writing_(nullptr), expected_(0), dropping_(false),
+              received_(0), dropped_full_(0), dropped_oversize_(0), high_water_(0)
+        {
+        }
+
+        void MessageRing::bump(std::atomic<uint32_t> &counter)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        bool MessageRing::begin(const char *topic, uint32_t total_len)
+        {
+            writing_ = nullptr;
+            dropping_ = true;
+
+            size_t topic_len = strnlen(topic, IncomingMessage::TOPIC_LEN);
+            if (topic_len >= IncomingMessage::TOPIC_LEN || total_len >= IncomingMessage::PAYLOAD_LEN)
+            {
+                bump(dropped_oversize_);
+                return false;
+            }
+
+            // The consumer frees slots by advancing tail_; acquire so its reads of a slot
+            // are finished before that slot is overwritten
+            uint32_t head = head_.load(std::memory_order_relaxed);
+            if (head - tail_.load(std::memory_order_acquire) >= SLOTS)
+            {
+                bump(dropped_full_);
+                return false;
+            }
+
+            writing_ = &slots_[head & (SLOTS - 1)];
+            memcpy(writing_->topic, topic, topic_len + 1);
+            writing_->payload_len = 0;
+            expected_ = total_len;
+            dropping_ = false;
+            return true;
+        }
+
+        void MessageRing::append(const uint8_t *data, size_t len)
+        {
+            if (dropping_ || writing_ == nullptr)
+                return;
+
+            // lwIP announced the total length up front; anything past it is a protocol error
+            if (writing_->payload_len + len > expected_)
+            {
+                writing_ = nullptr;
+                dropping_ = true;
+                bump(dropped_oversize_);
+                return;
+            }
+
+            memcpy(writing_->payload + writing_->payload_len, data, len);
+            writing_->payload_len += (uint16_t)len;
+        }
+
+        bool MessageRing::commit(uint32_t received_us)
+        {
+            if (dropping_ || writing_ == nullptr)
+                return false;
+
+            writing_->payload[writing_->payload_len] = '\0';
+            writing_->received_us = received_us;
+            writing_ = nullptr;
+
+            // Release publishes the slot contents together with the new head
+            uint32_t head = head_.load(std::memory_order_relaxed) + 1;
+            head_.store(head, std::memory_order_release);
+            bump(received_);
+
+            uint32_t waiting = head - tail_.load(std::memory_order_relaxed);
+            if (waiting > high_water_.load(std::memory_order_relaxed))
+                high_water_.store(waiting, std::memory_order_relaxed);
+            return true;
+        }
+
+        const IncomingMessage *MessageRing::front() const
+        {
+            uint32_t tail = tail_.load(std::memory_order_relaxed);
+            if (head_.load(std::memory_order_acquire) == tail)
+                return nullptr;
+            return &slots_[tail & (SLOTS - 1)];
+        }
+
+        void MessageRing::pop()
+        {
+            uint32_t tail = tail_.load(std::memory_order_relaxed);
+            if (head_.load(std::memory_order_acquire) == tail)
+                return;
+            tail_.store(tail + 1, std::memory_order_release);
+        }
+
+        size_t MessageRing::discard()
+        {
+            uint32_t tail = tail_.load(std::memory_order_relaxed);
+            uint32_t head = head_.load(std::memory_order_acquire);
+            tail_.store(head, std::memory_order_release);
+            return head - tail;
+        }
+
+        size_t MessageRing::size() const
+        {
+            // Tail first: the head can only move further ahead of it
+            uint32_t tail = tail_.load(std::memory_order_acquire);
+            uint32_t head = head_.load(std::memory_order_acquire);
+            return head - tail;
+        }
+
+        MessageRingStats MessageRing::stats() const
+        {
+            MessageRingStats s;
+            s.received = received_.load(std::memory_order_relaxed);
+            s.dropped_full = dropped_full_.load(std::memory_order_relaxed);
+            s.dropped_oversize = dropped_oversize_.load(std::memory_order_relaxed);
+            s.high_water = high_water_.load(std::memory_order_relaxed);
+            return s;
+        }
+
+    } // namespace Common
+} // namespace OpenTherm
@@ -0,0 +1,108 @@
+// Incoming MQTT message ring between the network core and the main loop
+//
+// lwIP delivers subscribed messages from core 1's cyw43_arch_poll() context
+// (the producer); core 0's main loop hands them to HAInterface::handleMessage
+// (the consumer). MessageRing is a fixed-slot single-producer/single-consumer
+// ring: every slot holds the topic and payload inline, so nothing touches the
+// heap, messages come out in arrival order, and the two sides share nothing
+// but the head and tail indices. Each index is written by one side only and
+// published with release/acquire ordering, so no lock is needed and no
+// read-modify-write atomics either (the Cortex-M0+ has none).
+//
+// When every slot is taken the new message is dropped - the producer cannot
+// evict a slot the consumer may be reading - and counted, as are messages
+// too large for a slot.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef MESSAGE_RING_HPP
+#define MESSAGE_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace OpenTherm
+{
+    namespace Common
+    {
+        struct IncomingMessage
+        {
+            static constexpr size_t TOPIC_LEN = 128;   // Longest topic (incl. terminator)
+            static constexpr size_t PAYLOAD_LEN = 256; // Home Assistant text entities allow 255 characters
+
+            char topic[TOPIC_LEN];
+            char payload[PAYLOAD_LEN];
+            uint16_t payload_len;
+            uint32_t received_us; // Producer's clock at commit(), for dispatch latency
+        };
+
+        struct MessageRingStats
+        {
+            uint32_t received;         // Messages handed to the consumer
+            uint32_t dropped_full;     // Messages dropped because every slot was taken
+            uint32_t dropped_oversize; // Messages whose topic or payload did not fit a slot
+            uint32_t high_water;       // Most messages waiting at once
+        };
+
+        class MessageRing
+        {
+        public:
+            static constexpr size_t SLOTS = 8; // Power of two
+
+            MessageRing();
+
+            // ---- Producer (lwIP callbacks) ----
+
+            // Start a message of `total_len` payload bytes; false if it will be dropped.
+            // A begin() without commit() is abandoned by the next begin().
+            bool begin(const char *topic, uint32_t total_len);
+
+            // Append payload bytes to the message being received
+            void append(const uint8_t *data, size_t len);
+
+            // Hand the message to the consumer, stamped with the time it arrived;
+            // false if it was dropped
+            bool commit(uint32_t received_us = 0);
+
+            // ---- Consumer (main loop) ----
+
+            // Oldest waiting message, or nullptr; valid until pop()
+            const IncomingMessage *front() const;
+            void pop();
+
+            // Drop everything waiting (e.g. before reconnecting); returns how many
+            size_t discard();
+
+            size_t size() const;
+
+            // Safe to call from either side
+            MessageRingStats stats() const;
+
+        private:
+            static_assert((SLOTS & (SLOTS - 1)) == 0, "MessageRing::SLOTS must be a power of two");
+
+            // Single-writer counter bump: a plain load and store, no atomic RMW
+            static void bump(std::atomic<uint32_t> &counter);
+
+            IncomingMessage slots_[SLOTS];
+
+            // Free-running indices; head_ written by the producer, tail_ by the consumer
+            std::atomic<uint32_t> head_;
+            std::atomic<uint32_t> tail_;
+
+            // Producer-only state for the message being received
+            IncomingMessage *writing_;
+            uint32_t expected_;
+            bool dropping_;
+
+            // Written by the producer only
+            std::atomic<uint32_t> received_;
+            std::atomic<uint32_t> dropped_full_;
+            std::atomic<uint32_t> dropped_oversize_;
+            std::atomic<uint32_t> high_water_;
+        };
+
+    } // namespace Common
+} // namespace OpenTherm
+
+#endif // MESSAGE_RING_HPP
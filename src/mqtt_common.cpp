@@ -2,16 +2,24 @@
 #include "led_blink.hpp"
 #include "lwip/altcp.h"
 #include "lwip/apps/mqtt_priv.h"
+#include "hardware/sync.h"
 #include <cstdio>
+#include <cstring>
 
 namespace OpenTherm
 {
     namespace Common
     {
         // Global MQTT state
-        mqtt_client_t *g_mqtt_client = nullptr;
-        bool g_mqtt_connected = false;
-        std::map<std::string, std::string> g_pending_messages;
+        MessageRing g_incoming_messages;
+
+        // Sets the event flag of both cores, so a main loop in (or about to enter) WFE wakes up
+        static void wake_main_loop()
+        {
+            __sev();
+        }
+
+        LoopEvents g_loop_events(wake_main_loop);
 
         // Track consecutive publish failures for LED indication
         // Note: Static lifetime is intentional - failure counter persists across
@@ -24,6 +32,12 @@ namespace OpenTherm
         uint32_t g_total_publish_failures = 0;
         uint32_t g_mqtt_reconnect_count = 0;
 
+        // Publish flow control: credits mirror lwIP's request list and output ring
+        PublishCredits g_publish_credits(MQTT_REQ_MAX_IN_FLIGHT, MQTT_OUTPUT_RINGBUF_SIZE);
+        static_assert(DEFAULT_BYTE_CREDITS == MQTT_OUTPUT_RINGBUF_SIZE, "mqtt_flow.hpp defaults must match lwipopts.h");
+        static_assert(DEFAULT_REQUEST_CREDITS == MQTT_REQ_MAX_IN_FLIGHT, "mqtt_flow.hpp defaults must match lwipopts.h");
+        uint32_t g_publish_credit_waits = 0;
+
         // Network polling helper to prevent TCP buffer exhaustion
         // Note: With Core 1 dedicated to network polling, this is now much lighter
         // Core 1 continuously polls cyw43_arch_poll(), so we only need brief yields
@@ -38,274 +52,876 @@ namespace OpenTherm
             }
         }
 
-        // MQTT callbacks
-        void mqtt_connection_cb(mqtt_client_t *client, void *arg, mqtt_connection_status_t status)
+        static uint32_t now_ms()
         {
-            if (status == MQTT_CONNECT_ACCEPTED)
-            {
-                printf("MQTT connected!\n");
-                g_mqtt_connected = true;
-                consecutive_publish_failures = 0; // Reset failure counter on successful connection
-            }
-            else
+            return to_ms_since_boot(get_absolute_time());
+        }
+
+        static const char *err_string(int err)
+        {
+            switch (err)
             {
-                printf("MQTT connection failed: %d\n", status);
-                g_mqtt_connected = false;
+            case ERR_MEM:
+                return "out of memory (ERR_MEM)";
+            case ERR_BUF:
+                return "buffer error (ERR_BUF)";
+            case ERR_TIMEOUT:
+                return "timeout (ERR_TIMEOUT)";
+            case ERR_RTE:
+                return "routing problem (ERR_RTE)";
+            case ERR_CONN:
+                return "not connected (ERR_CONN)";
+            case ERR_CLSD:
+                return "connection closed (ERR_CLSD)";
+            case ERR_ABRT:
+                return "aborted (ERR_ABRT)";
+            case ERR_VAL:
+                return "illegal value (ERR_VAL)";
+            default:
+                return "unknown";
             }
         }
 
-        // Static variables to track incoming MQTT message state
-        // Note: These are reset with empty string assignment to prevent capacity leak
-        static std::string current_topic;
-        static std::string current_payload;
+        // ====================================================================
+        // Network actor (core 1)
+        //
+        // Everything below up to the application side runs on core 1 and is
+        // the only code that calls into lwIP. Requests are taken off
+        // g_net_requests between polls; one that lwIP cannot take yet (request
+        // list full, TCP send buffer full, output ring not drained) stays at
+        // the head and is retried after the next poll, and fails once it has
+        // made no progress for CREDIT_WAIT_TIMEOUT_MS.
+        // ====================================================================
 
-        // Maximum pending messages to prevent unbounded memory growth
-        constexpr size_t MAX_PENDING_MESSAGES = 10;
+        static NetRequestQueue g_net_requests;
+        static NetCompletionQueue g_net_completions;
 
-        void mqtt_incoming_publish_cb(void *arg, const char *topic, u32_t tot_len)
+        constexpr int ACTOR_BATCH = 8; // Requests handled between two polls at most
+
+        static mqtt_client_t *s_client = nullptr;
+
+        // Whether the broker accepted the connection. Only core 1 stores it
+        // (with release ordering); core 0 reads it through mqtt_connected().
+        static std::atomic<bool> s_mqtt_connected(false);
+
+        static void actor_set_connected(bool connected)
         {
-            printf("Incoming publish at topic %s with total length %u\n", topic, (unsigned int)tot_len);
-            // Store the topic for the incoming data callback
-            current_topic = topic;
-            // Force deallocation by replacing with empty string to prevent capacity leak
-            current_payload = std::string();
-            current_payload.reserve(tot_len); // Pre-allocate exact size needed
+            if (s_mqtt_connected.load(std::memory_order_relaxed) == connected)
+                return;
+            s_mqtt_connected.store(connected, std::memory_order_release);
+            g_loop_events.signal(WakeSource::CONNECTION);
         }
 
-        void mqtt_incoming_data_cb(void *arg, const u8_t *data, u16_t len, u8_t flags)
+        // Streamed publish: payload bytes still expected by the open PUBLISH
+        static bool s_stream_open = false;
+        static uint32_t s_stream_remaining = 0;
+
+        // Progress on the request at the head of the queue
+        static bool s_head_started = false;
+        static bool s_head_waiting = false;
+        static uint32_t s_head_progress_ms = 0;
+        static size_t s_head_offset = 0; // Bytes of its data already written to TCP
+
+        // One per publish lwIP holds, passed as its callback argument. lwIP
+        // drops its requests without calling back when the connection closes,
+        // so the slots still in use when the client is freed are lost publishes.
+        struct PublishSlot
+        {
+            uint32_t token;
+            uint32_t credits;
+            bool used;
+        };
+        static PublishSlot s_publish_slots[MQTT_REQ_MAX_IN_FLIGHT];
+
+        // Publishes that failed after their request completed, for core 0.
+        // Failures that did not fit the queue are counted; core 1 is the only
+        // writer, so a plain load and store, as in LoopEvents::signal().
+        static NetCompletionQueue g_publish_failures;
+        static std::atomic<uint32_t> g_publish_failures_lost(0);
+
+        static void report_lost_publish(uint32_t token, err_t err)
         {
-            current_payload.append((const char *)data, len);
+            NetCompletion failure = {token, NetOp::PUBLISH, (int8_t)err};
+            if (!g_publish_failures.push(failure))
+                g_publish_failures_lost.store(g_publish_failures_lost.load(std::memory_order_relaxed) + 1,
+                                              std::memory_order_release);
+        }
 
-            if (flags & MQTT_DATA_FLAG_LAST)
+        static PublishSlot *take_publish_slot(uint32_t token, uint32_t credits)
+        {
+            for (PublishSlot &slot : s_publish_slots)
             {
-                printf("Received: %s = %s\n", current_topic.c_str(), current_payload.c_str());
-
-                // Check if pending messages queue is full (prevents unbounded growth)
-                if (g_pending_messages.size() >= MAX_PENDING_MESSAGES)
+                if (!slot.used)
                 {
-                    // Drop oldest message (FIFO)
-                    auto oldest = g_pending_messages.begin();
-                    printf("WARNING: Pending message queue full (%zu msgs), dropping oldest: %s\n",
-                           g_pending_messages.size(), oldest->first.c_str());
-                    g_pending_messages.erase(oldest);
+                    slot = {token, credits, true};
+                    return &slot;
                 }
+            }
+            return nullptr;
+        }
 
-                g_pending_messages[current_topic] = current_payload;
+        // Filled by WIFI_STATUS; core 0 copies it when it takes the completion,
+        // and posts the next WIFI_STATUS only after that
+        static WifiStatus s_wifi_status;
 
-                // Force deallocation to prevent capacity leak from large messages
-                current_payload = std::string();
-                current_topic = std::string();
-            }
+        // Runs in lwIP context once TCP has taken the message out of the ring,
+        // or with an error once lwIP gives up on it
+        static void mqtt_publish_complete_cb(void *arg, err_t result)
+        {
+            PublishSlot *slot = static_cast<PublishSlot *>(arg);
+            g_publish_credits.release(slot->credits);
+            if (result != ERR_OK)
+                report_lost_publish(slot->token, result);
+            slot->used = false;
         }
 
-        void mqtt_sub_request_cb(void *arg, err_t result)
+        static bool actor_client_connected()
         {
-            printf("Subscribe result: %d\n", result);
+            return s_client != nullptr && mqtt_client_is_connected(s_client);
         }
 
-        // MQTT wrapper functions
-        bool mqtt_publish_wrapper(const char *topic, const char *payload, bool retain)
+        static void actor_free_client()
         {
-            if (!g_mqtt_connected || !g_mqtt_client)
+            if (s_client)
             {
-                return false;
+                mqtt_disconnect(s_client);
+                mqtt_client_free(s_client);
+                s_client = nullptr;
             }
+            actor_set_connected(false);
 
-            // Check if MQTT client is actually ready to publish
-            if (!mqtt_client_is_connected(g_mqtt_client))
+            // Their credits are reset by connect_mqtt() on core 0
+            for (PublishSlot &slot : s_publish_slots)
             {
-                printf("MQTT publish failed: client not connected\n");
-                g_mqtt_connected = false;
-                return false;
+                if (slot.used)
+                {
+                    report_lost_publish(slot.token, ERR_CLSD);
+                    slot.used = false;
+                }
             }
+        }
 
-            u8_t qos = 0;
-            u8_t retain_flag = retain ? 1 : 0;
-
-            // Track publish attempt
-            g_total_publish_attempts++;
-
-            // Check TCP send buffer availability before publishing
-            // This prevents the pcb->snd_queuelen assertion failure by ensuring
-            // we don't overwhelm the TCP stack with too much pending data
-            size_t payload_len = strlen(payload);
-            // Add 50% safety margin to ensure we have plenty of buffer space
-            // This conservative approach prevents edge cases where exact size isn't enough
-            size_t estimated_size = (payload_len + strlen(topic) + 20) * 3 / 2;
+        static void stream_abort(const char *reason)
+        {
+            printf("MQTT stream aborted: %s (%lu payload bytes unsent) - dropping connection\n",
+                   reason, (unsigned long)s_stream_remaining);
+            s_stream_open = false;
+            if (s_client)
+                mqtt_disconnect(s_client);
+            actor_set_connected(false); // check_and_reconnect() takes it from here
+        }
 
-            // Wait for sufficient TCP buffer space to be available
-            // The MQTT library uses altcp (abstraction layer) which wraps TCP
-            if (g_mqtt_client && g_mqtt_client->conn)
+        // Write the rest of `data` to TCP as send buffer space allows; false
+        // while it has to wait for ACKs, true once written (or failed)
+        static bool stream_send(const uint8_t *data, size_t len, bool stalled, err_t *result)
+        {
+            if (!actor_client_connected())
             {
-                uint32_t wait_start = to_ms_since_boot(get_absolute_time());
-                const uint32_t max_wait_ms = 5000; // Wait up to 5 seconds for buffer space (increased from 2s)
+                stream_abort("connection lost");
+                *result = ERR_CLSD;
+                return true;
+            }
 
-                // Get available send buffer space from altcp connection
-                u16_t snd_buf = altcp_sndbuf(g_mqtt_client->conn);
+            struct altcp_pcb *conn = s_client->conn;
+            bool progressed = false;
+            while (s_head_offset < len)
+            {
+                size_t room = altcp_sndbuf(conn);
+                size_t left = len - s_head_offset;
+                size_t n = left < room ? left : room;
+                err_t err = ERR_MEM;
+                if (n > 0 && altcp_sndqueuelen(conn) < TCP_SND_QUEUELEN)
+                    err = altcp_write(conn, data + s_head_offset, (u16_t)n, TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE);
 
-                // Log when buffer is getting tight (less than 25% of typical send buffer)
-                if (snd_buf < 7300) // 25% of typical 29,200 byte buffer (20*TCP_MSS)
+                if (err == ERR_OK)
                 {
-                    printf("TCP buffer low: %u bytes available (need %zu)\n", snd_buf, estimated_size);
+                    s_head_offset += n;
+                    s_head_progress_ms = now_ms();
+                    progressed = true;
+                    continue;
+                }
+                if (err != ERR_MEM)
+                {
+                    stream_abort("TCP write failed");
+                    *result = err;
+                    return true;
                 }
 
-                while (snd_buf < estimated_size)
+                altcp_output(conn); // Push what is queued so ACKs free space
+                if (stalled && !progressed)
                 {
-                    uint32_t elapsed = to_ms_since_boot(get_absolute_time()) - wait_start;
-                    if (elapsed >= max_wait_ms)
-                    {
-                        printf("TCP send buffer timeout (%u < %zu bytes after %lums)\n",
-                               snd_buf, estimated_size, elapsed);
-                        break;
-                    }
-                    // Poll network to allow ACKs to return and free buffers
-                    aggressive_network_poll(50);
-                    snd_buf = altcp_sndbuf(g_mqtt_client->conn);
+                    stream_abort("TCP send buffer stalled");
+                    *result = ERR_TIMEOUT;
+                    return true;
                 }
+                return false;
             }
+            *result = ERR_OK;
+            return true;
+        }
 
-            // Retry logic for memory errors - TCP buffers may be temporarily full
-            const int max_retries = 3;
-            err_t err = ERR_OK;
-
-            for (int retry = 0; retry < max_retries; retry++)
+        // Handle the request at the head of the queue; false to retry it after the next poll
+        static bool actor_handle(const NetRequest &r, bool stalled, err_t *result)
+        {
+            *result = ERR_OK;
+            switch (r.op)
             {
-                err = mqtt_publish(g_mqtt_client, topic, payload, payload_len,
-                                   qos, retain_flag, nullptr, nullptr);
+            case NetOp::PUBLISH:
+            case NetOp::SUBSCRIBE:
+            {
+                // Anything else on the connection mid-stream would corrupt the open PUBLISH
+                if (s_stream_open)
+                    stream_abort("stream abandoned");
 
-                if (err == ERR_OK)
+                err_t err = ERR_CONN;
+                void *credits = reinterpret_cast<void *>(static_cast<uintptr_t>(r.arg));
+                if (actor_client_connected())
                 {
-                    break; // Success!
+                    if (r.op == NetOp::PUBLISH)
+                    {
+                        PublishSlot *slot = take_publish_slot(r.token, r.arg);
+                        err = slot ? mqtt_publish(s_client, r.topic, r.data, (u16_t)r.data_len, 0, r.retain ? 1 : 0,
+                                                  mqtt_publish_complete_cb, slot)
+                                   : ERR_MEM;
+                        if (slot && err != ERR_OK)
+                            slot->used = false;
+                    }
+                    else
+                        err = mqtt_subscribe(s_client, r.topic, 0, mqtt_sub_request_cb, credits);
                 }
+                else
+                {
+                    actor_set_connected(false); // Already so unless lwIP dropped the client unannounced
+                }
+                if (err == ERR_OK)
+                    return true;
+
+                // The request list is shared with subscriptions and keep-alive
+                // pings, so it can be full while the publisher holds credits
+                if ((err == ERR_MEM || err == ERR_BUF) && !stalled)
+                    return false;
 
-                // If memory error, wait for TCP buffers to clear and retry
-                if (err == ERR_MEM || err == ERR_BUF)
+                // lwIP kept nothing, so no callback will return these credits
+                g_publish_credits.release(r.arg);
+                printf("MQTT %s failed: %s (%d) - topic: %s\n", netOpName(r.op), err_string(err), err, r.topic);
+                *result = err;
+                return true;
+            }
+
+            case NetOp::STREAM_BEGIN:
+                if (!s_head_started)
                 {
-                    // Get current buffer stats for diagnosis
-                    u16_t current_snd_buf = 0;
-                    if (g_mqtt_client && g_mqtt_client->conn)
+                    if (s_stream_open)
+                        stream_abort("stream abandoned");
+                    if (!actor_client_connected())
+                    {
+                        *result = ERR_CONN;
+                        return true;
+                    }
+                    // Our bytes must not interleave with a packet lwIP is still
+                    // sending from its output ring (keep-alive and subscribe
+                    // traffic also pass through it)
+                    if (s_client->output.put != s_client->output.get)
                     {
-                        current_snd_buf = altcp_sndbuf(g_mqtt_client->conn);
+                        if (stalled)
+                        {
+                            *result = ERR_TIMEOUT;
+                            return true;
+                        }
+                        return false;
                     }
+                    s_stream_open = true;
+                    s_stream_remaining = r.arg;
+                    s_head_started = true;
+                }
+                return stream_send(r.data, r.data_len, stalled, result);
 
-                    if (retry < max_retries - 1)
+            case NetOp::STREAM_DATA:
+                if (!s_head_started)
+                {
+                    if (!s_stream_open)
                     {
-                        // Wait progressively longer: 200ms, 400ms, 600ms
-                        // Longer waits allow more time for TCP ACKs to free buffers
-                        // Increased from 100/200/300ms due to TCP buffer exhaustion at 90s
-                        uint32_t wait_ms = 200 * (retry + 1);
-                        printf("MQTT publish ERR_MEM (TCP snd_buf=%u, need=%zu), waiting %lums before retry %d/%d...\n",
-                               current_snd_buf, estimated_size, wait_ms, retry + 1, max_retries);
-                        aggressive_network_poll(wait_ms);
-                        continue;
+                        *result = ERR_CLSD; // Already aborted
+                        return true;
                     }
-                    else
+                    if (r.data_len > s_stream_remaining)
                     {
-                        // Final retry failed - log detailed info
-                        printf("MQTT publish ERR_MEM FAILED after %d retries (TCP snd_buf=%u, need=%zu, topic=%s, payload_len=%zu)\n",
-                               max_retries, current_snd_buf, estimated_size, topic, payload_len);
+                        // More than announced would corrupt every packet after this one
+                        stream_abort("payload longer than announced");
+                        *result = ERR_VAL;
+                        return true;
                     }
+                    s_stream_remaining -= (uint32_t)r.data_len;
+                    s_head_started = true;
+                }
+                return stream_send(r.data, r.data_len, stalled, result);
+
+            case NetOp::STREAM_END:
+                if (!s_stream_open)
+                {
+                    *result = ERR_CLSD;
+                    return true;
+                }
+                if (s_stream_remaining != 0)
+                {
+                    stream_abort("payload shorter than announced");
+                    *result = ERR_VAL;
+                    return true;
+                }
+                s_stream_open = false;
+                *result = actor_client_connected() ? altcp_output(s_client->conn) : ERR_CLSD;
+                return true;
+
+            case NetOp::CONNECT:
+            {
+                actor_free_client();
+                s_stream_open = false;
+
+                ip_addr_t server;
+                if (!ipaddr_aton(reinterpret_cast<const char *>(r.data), &server))
+                {
+                    printf("Invalid MQTT server IP\n");
+                    *result = ERR_ARG;
+                    return true;
+                }
+
+                s_client = mqtt_client_new();
+                if (!s_client)
+                {
+                    printf("Failed to create MQTT client\n");
+                    *result = ERR_MEM;
+                    return true;
+                }
+
+                struct mqtt_connect_client_info_t ci = {0};
+                ci.client_id = r.topic;
+                ci.keep_alive = 60;
+                mqtt_set_inpub_callback(s_client, mqtt_incoming_publish_cb, mqtt_incoming_data_cb, nullptr);
+
+                *result = mqtt_client_connect(s_client, &server, (u16_t)r.arg, mqtt_connection_cb, nullptr, &ci);
+                if (*result != ERR_OK)
+                {
+                    mqtt_client_free(s_client);
+                    s_client = nullptr;
                 }
+                return true;
+            }
+
+            case NetOp::DISCONNECT:
+                actor_free_client();
+                s_stream_open = false;
+                return true;
+
+            case NetOp::WIFI_CONNECT:
+            {
+                int rc = cyw43_arch_wifi_connect_timeout_ms(r.topic, reinterpret_cast<const char *>(r.data),
+                                                            CYW43_AUTH_WPA2_AES_PSK, r.arg);
+                if (rc != 0)
+                    printf("WiFi connect failed: %d\n", rc);
+                *result = rc == 0 ? ERR_OK : ERR_CONN;
+                return true;
+            }
+
+            case NetOp::WIFI_STATUS:
+            {
+                s_wifi_status.link_status = cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA);
+                s_wifi_status.has_rssi = cyw43_wifi_get_rssi(&cyw43_state, &s_wifi_status.rssi) == 0;
+                s_wifi_status.has_ip = netif_list && netif_is_up(netif_list) &&
+                                       !ip4_addr_isany_val(*netif_ip4_addr(netif_list));
+                if (s_wifi_status.has_ip)
+                    ip4addr_ntoa_r(netif_ip4_addr(netif_list), s_wifi_status.ip, sizeof(s_wifi_status.ip));
                 else
+                    s_wifi_status.ip[0] = '\0';
+                return true;
+            }
+            }
+
+            *result = ERR_ARG;
+            return true;
+        }
+
+        void network_actor_poll()
+        {
+            cyw43_arch_poll();
+
+            NetRequest r;
+            int completed = 0;
+            for (int i = 0; i < ACTOR_BATCH && g_net_completions.hasRoom() && g_net_requests.front(&r); i++)
+            {
+                uint32_t now = now_ms();
+                if (!s_head_waiting)
+                    s_head_progress_ms = now;
+                bool stalled = s_head_waiting && now - s_head_progress_ms >= CREDIT_WAIT_TIMEOUT_MS;
+
+                // A WiFi join waits for the driver to make progress, so it cannot
+                // hold the lock the driver's background work needs
+                err_t result = ERR_OK;
+                bool locked = r.op != NetOp::WIFI_CONNECT;
+                if (locked)
+                    cyw43_arch_lwip_begin();
+                bool done = actor_handle(r, stalled, &result);
+                if (locked)
+                    cyw43_arch_lwip_end();
+
+                if (!done)
                 {
-                    // Non-memory error, don't retry
-                    break;
+                    s_head_waiting = true;
+                    break; // Let the next poll free buffers or request slots
                 }
+
+                NetCompletion completion = {r.token, r.op, (int8_t)result};
+                g_net_requests.pop();
+                g_net_completions.push(completion);
+                s_head_started = false;
+                s_head_waiting = false;
+                s_head_offset = 0;
+                completed++;
             }
 
-            if (err != ERR_OK)
+            // Once per batch: the main loop drains every completion when it wakes
+            if (completed > 0)
+                g_loop_events.signal(WakeSource::NET_COMPLETION);
+        }
+
+        // ====================================================================
+        // Application side (core 0)
+        // ====================================================================
+
+        static uint32_t g_next_token = 0;
+        static uint32_t g_completions_seen = 0;
+        static uint32_t g_publish_failures_lost_seen = 0; // Last g_publish_failures_lost core 0 handled
+
+        // The one request core 0 is blocked on, if any
+        static uint32_t g_wait_token = 0xFFFFFFFFu;
+        static bool g_wait_done = false;
+        static int8_t g_wait_err = ERR_OK;
+
+        // Token of the last publish mqtt_publish_wrapper() queued; none yet
+        static uint32_t g_last_publish_token = 0xFFFFFFFFu;
+        static PublishFailedHook g_publish_failed_hook = nullptr;
+
+        // Core 0's copy of s_wifi_status
+        static WifiStatus g_wifi_status;
+        static bool g_wifi_status_valid = false;
+        static bool g_wifi_status_pending = false;
+        static uint32_t g_wifi_status_token = 0;
+
+        // Streamed publish as seen from core 0
+        static bool g_stream_open = false;
+        static bool g_stream_failed = false;
+
+        // Whether the actor holds an MQTT client (after a successful CONNECT)
+        static bool g_client_created = false;
+
+        static void record_publish_failure()
+        {
+            g_total_publish_failures++;
+
+            // Track consecutive failures and update LED pattern
+            consecutive_publish_failures++;
+            if (consecutive_publish_failures >= PUBLISH_FAILURE_THRESHOLD)
             {
-                // Track failure
-                g_total_publish_failures++;
+                printf("Multiple consecutive publish failures detected - setting MQTT error LED\n");
+                OpenTherm::LED::set_pattern(OpenTherm::LED::BLINK_MQTT_ERROR);
+            }
+        }
 
-                const char *err_str = "unknown";
-                switch (err)
+        void mqtt_process_completions()
+        {
+            NetCompletion c;
+            while (g_net_completions.pop(&c))
+            {
+                g_completions_seen++;
+                switch (c.op)
                 {
-                case ERR_MEM:
-                    err_str = "out of memory (ERR_MEM)";
-                    break;
-                case ERR_BUF:
-                    err_str = "buffer error (ERR_BUF)";
-                    break;
-                case ERR_TIMEOUT:
-                    err_str = "timeout (ERR_TIMEOUT)";
-                    break;
-                case ERR_RTE:
-                    err_str = "routing problem (ERR_RTE)";
+                case NetOp::PUBLISH:
+                    if (c.err == ERR_OK)
+                    {
+                        consecutive_publish_failures = 0;
+                    }
+                    else
+                    {
+                        record_publish_failure();
+                        if (g_publish_failed_hook)
+                            g_publish_failed_hook(c.token, false);
+                    }
                     break;
-                case ERR_CONN:
-                    err_str = "not connected (ERR_CONN)";
-                    g_mqtt_connected = false;
+                case NetOp::STREAM_BEGIN:
+                case NetOp::STREAM_DATA:
+                case NetOp::STREAM_END:
+                    if (c.err != ERR_OK && !g_stream_failed)
+                    {
+                        g_stream_failed = true;
+                        record_publish_failure();
+                    }
                     break;
-                case ERR_CLSD:
-                    err_str = "connection closed (ERR_CLSD)";
-                    g_mqtt_connected = false;
+                case NetOp::WIFI_STATUS:
+                    g_wifi_status = s_wifi_status;
+                    g_wifi_status_valid = true;
+                    g_wifi_status_pending = false;
                     break;
                 default:
-                    break;
+                    break; // Subscribe and connection results are logged by the actor or waited for
                 }
-                printf("MQTT publish failed after %d attempts: %s (%d) - topic: %s\n",
-                       max_retries, err_str, err, topic);
 
-                // Track consecutive failures and update LED pattern
-                consecutive_publish_failures++;
-                if (consecutive_publish_failures >= PUBLISH_FAILURE_THRESHOLD)
+                if (c.token == g_wait_token)
                 {
-                    printf("Multiple consecutive publish failures detected - setting MQTT error LED\n");
-                    OpenTherm::LED::set_pattern(OpenTherm::LED::BLINK_MQTT_ERROR);
+                    g_wait_done = true;
+                    g_wait_err = c.err;
                 }
+            }
+
+            // Publishes lwIP accepted but never sent. Only counted: a dropped
+            // connection is already being handled, and must not be declared
+            // down again once the reconnect has succeeded.
+            while (g_publish_failures.pop(&c))
+            {
+                g_total_publish_failures++;
+                if (g_publish_failed_hook)
+                    g_publish_failed_hook(c.token, false);
+            }
+            uint32_t lost = g_publish_failures_lost.load(std::memory_order_acquire);
+            if (lost != g_publish_failures_lost_seen)
+            {
+                g_total_publish_failures += lost - g_publish_failures_lost_seen;
+                g_publish_failures_lost_seen = lost;
+                if (g_publish_failed_hook)
+                    g_publish_failed_hook(0, true);
+            }
+        }
+
+        void mqtt_set_publish_failed_hook(PublishFailedHook hook)
+        {
+            g_publish_failed_hook = hook;
+        }
+
+        bool mqtt_connected()
+        {
+            return s_mqtt_connected.load(std::memory_order_acquire);
+        }
 
-                // Add delay on error to prevent flooding
-                aggressive_network_poll(100);
+        uint32_t mqtt_last_publish_token()
+        {
+            return g_last_publish_token;
+        }
+
+        void wait_for_work(uint32_t timeout_ms)
+        {
+            absolute_time_t deadline = make_timeout_time_ms(timeout_ms);
+            // A signal between pending() and the WFE leaves the event flag set,
+            // so the WFE returns at once instead of sleeping through it
+            while (!g_loop_events.pending())
+            {
+                if (best_effort_wfe_or_timeout(deadline))
+                    return;
+            }
+        }
+
+        // Hand a request to the actor, waiting while its queue is full
+        static bool post_request(NetOp op, uint32_t arg, bool retain, const char *topic, const void *data,
+                                 size_t len, uint32_t *token = nullptr)
+        {
+            size_t topic_len = topic ? strlen(topic) : 0;
+            if (NetRequestQueue::recordSize(topic_len, len) > NetRequestQueue::MAX_RECORD)
+            {
+                printf("MQTT %s: %zu bytes too large for the network queue - topic: %s\n", netOpName(op), len,
+                       topic ? topic : "");
+                return false;
+            }
+
+            uint32_t start = now_ms();
+            while (!g_net_requests.push(op, g_next_token, arg, retain, topic, data, len))
+            {
+                mqtt_process_completions();
+                if (now_ms() - start >= CREDIT_WAIT_TIMEOUT_MS)
+                {
+                    printf("MQTT %s: network core not taking requests (%zu bytes queued)\n", netOpName(op),
+                           g_net_requests.used());
+                    return false;
+                }
+                sleep_us(CREDIT_POLL_US);
+            }
+            if (token)
+                *token = g_next_token;
+            g_next_token++;
+            return true;
+        }
+
+        // Wait for the completion of `token`; gives up once the actor has
+        // completed nothing for `timeout_ms`
+        static bool wait_request(uint32_t token, uint32_t timeout_ms, int8_t *err)
+        {
+            g_wait_token = token;
+            g_wait_done = false;
+            uint32_t seen = g_completions_seen;
+            uint32_t start = now_ms();
+            for (;;)
+            {
+                mqtt_process_completions();
+                if (g_wait_done)
+                    break;
+                if (g_completions_seen != seen)
+                {
+                    seen = g_completions_seen;
+                    start = now_ms();
+                }
+                if (now_ms() - start >= timeout_ms)
+                    break;
+                sleep_us(CREDIT_POLL_US);
+            }
+            g_wait_token = 0xFFFFFFFFu;
+            *err = g_wait_err;
+            return g_wait_done;
+        }
+
+        // Take credits for `bytes`, waiting for completions only if they are exhausted
+        static bool acquire_credits(uint32_t bytes, uint32_t timeout_ms)
+        {
+            if (g_publish_credits.tryAcquire(bytes))
+                return true;
+
+            g_publish_credit_waits++;
+            uint32_t start = now_ms();
+            while (!g_publish_credits.tryAcquire(bytes))
+            {
+                if (!mqtt_connected() || now_ms() - start >= timeout_ms)
+                    return false;
+                mqtt_process_completions();
+                sleep_us(CREDIT_POLL_US); // Core 1 runs lwIP; just yield until a callback lands
+            }
+            return true;
+        }
+
+        bool mqtt_publish_ready(uint32_t bytes)
+        {
+            return mqtt_connected() && g_publish_credits.available(bytes);
+        }
+
+        bool mqtt_wait_idle(uint32_t timeout_ms)
+        {
+            uint32_t start = now_ms();
+            while (!g_publish_credits.idle())
+            {
+                if (!mqtt_connected() || now_ms() - start >= timeout_ms)
+                    return false;
+                mqtt_process_completions();
+                sleep_us(CREDIT_POLL_US);
+            }
+            mqtt_process_completions();
+            return true;
+        }
+
+        bool mqtt_stream_begin(const char *topic, uint32_t payload_len, bool retain)
+        {
+            if (!mqtt_connected() || g_stream_open)
+                return false;
+
+            uint8_t header[MQTT_VAR_HEADER_BUFFER_LEN];
+            size_t header_len = encodePublishHeader(topic, payload_len, retain, header, sizeof(header));
+            if (header_len == 0)
+            {
+                printf("MQTT stream: topic too long - %s\n", topic);
+                return false;
+            }
+
+            // The actor holds this back until lwIP's output ring has drained
+            g_total_publish_attempts++;
+            g_stream_failed = false;
+            if (!post_request(NetOp::STREAM_BEGIN, payload_len, retain, nullptr, header, header_len))
                 return false;
+            g_stream_open = true;
+            return true;
+        }
+
+        bool mqtt_stream_write(const char *data, size_t len)
+        {
+            if (!g_stream_open)
+                return false;
+
+            while (len > 0)
+            {
+                mqtt_process_completions();
+                if (g_stream_failed || !mqtt_connected())
+                {
+                    g_stream_open = false;
+                    return false;
+                }
+                size_t n = len < NetRequestQueue::maxData() ? len : NetRequestQueue::maxData();
+                if (!post_request(NetOp::STREAM_DATA, 0, false, nullptr, data, n))
+                {
+                    // The actor aborts the stream when the next request is not part of it
+                    g_stream_open = false;
+                    return false;
+                }
+                data += n;
+                len -= n;
             }
+            return true;
+        }
+
+        bool mqtt_stream_end()
+        {
+            if (!g_stream_open)
+                return false;
+            g_stream_open = false;
 
-            // Successful publish - reset failure counter
+            uint32_t token;
+            int8_t err;
+            if (!post_request(NetOp::STREAM_END, 0, false, nullptr, nullptr, 0, &token) ||
+                !wait_request(token, CREDIT_WAIT_TIMEOUT_MS, &err))
+            {
+                printf("MQTT stream: network core did not finish the stream\n");
+                return false;
+            }
+            if (err != ERR_OK || g_stream_failed)
+                return false;
             consecutive_publish_failures = 0;
+            return true;
+        }
+
+        void log_throughput(const char *label, const Throughput &t)
+        {
+            printf("%s: %lu messages, %lu bytes in %lums (%lu msg/s, %lu B/s, %lu credit waits)\n",
+                   label, (unsigned long)t.messages, (unsigned long)t.bytes, (unsigned long)t.elapsed_ms,
+                   (unsigned long)t.messagesPerSecond(), (unsigned long)t.bytesPerSecond(),
+                   (unsigned long)g_publish_credit_waits);
+        }
+
+        // MQTT callbacks (lwIP context)
+        void mqtt_connection_cb(mqtt_client_t *client, void *arg, mqtt_connection_status_t status)
+        {
+            if (status == MQTT_CONNECT_ACCEPTED)
+            {
+                printf("MQTT connected!\n");
+                actor_set_connected(true);
+            }
+            else
+            {
+                printf("MQTT connection failed: %d\n", status);
+                actor_set_connected(false);
+            }
+        }
+
+        void mqtt_incoming_publish_cb(void *arg, const char *topic, u32_t tot_len)
+        {
+            printf("Incoming publish at topic %s with total length %u\n", topic, (unsigned int)tot_len);
+            if (!g_incoming_messages.begin(topic, tot_len))
+            {
+                MessageRingStats stats = g_incoming_messages.stats();
+                printf("WARNING: Dropping incoming message on %s (ring full: %u, too large: %u dropped so far)\n",
+                       topic, (unsigned int)stats.dropped_full, (unsigned int)stats.dropped_oversize);
+            }
+        }
+
+        void mqtt_incoming_data_cb(void *arg, const u8_t *data, u16_t len, u8_t flags)
+        {
+            g_incoming_messages.append(data, len);
+
+            if (flags & MQTT_DATA_FLAG_LAST)
+            {
+                if (g_incoming_messages.commit(time_us_32()))
+                    g_loop_events.signal(WakeSource::MQTT_MESSAGE);
+            }
+        }
+
+        void mqtt_sub_request_cb(void *arg, err_t result)
+        {
+            g_publish_credits.release(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(arg)));
+            printf("Subscribe result: %d\n", result);
+        }
+
+        // MQTT wrapper functions
+        bool mqtt_publish_wrapper(const char *topic, const char *payload, bool retain)
+        {
+            if (!mqtt_connected())
+            {
+                return false;
+            }
+
+            // Track publish attempt
+            g_total_publish_attempts++;
+
+            size_t payload_len = strlen(payload);
+            uint32_t wire_size = publishWireSize(strlen(topic), payload_len, 0);
+
+            // Only wait when lwIP's request list or output ring is full; the
+            // completion callback hands credits back as TCP drains the ring.
+            // The actor retries a publish lwIP refuses, so this is the only wait.
+            if (!acquire_credits(wire_size, CREDIT_WAIT_TIMEOUT_MS))
+            {
+                printf("MQTT publish: no credits after %lums (%lu in flight, %lu bytes) - topic: %s\n",
+                       (unsigned long)CREDIT_WAIT_TIMEOUT_MS, (unsigned long)g_publish_credits.inFlight(),
+                       (unsigned long)g_publish_credits.bytesInFlight(), topic);
+                int err = mqtt_connected() ? ERR_MEM : ERR_CONN;
+                printf("MQTT publish failed: %s (%d) - topic: %s\n", err_string(err), err, topic);
+                record_publish_failure();
+                return false;
+            }
 
-            // Delay to allow TCP ACKs to return and free PBUFs
-            // Even with TCP buffer space available, PBUFs must be freed by ACKs.
-            // Increased to 100ms to prevent TCP buffer exhaustion during burst publishing.
-            // This is critical when multiple publish functions are called in sequence.
-            aggressive_network_poll(100); // 100ms - prevents buffer saturation during bursts
+            uint32_t token;
+            if (!post_request(NetOp::PUBLISH, wire_size, retain, topic, payload, payload_len, &token))
+            {
+                g_publish_credits.cancel(wire_size);
+                record_publish_failure();
+                return false;
+            }
+            g_last_publish_token = token;
+
+            // lwIP's verdict arrives as a completion; failures are counted there
+            mqtt_process_completions();
             return true;
         }
 
         bool mqtt_subscribe_wrapper(const char *topic)
         {
-            if (!g_mqtt_connected || !g_mqtt_client)
+            if (!mqtt_connected())
             {
                 printf("MQTT subscribe failed: not connected\n");
                 return false;
             }
 
-            err_t err = mqtt_subscribe(g_mqtt_client, topic, 0, mqtt_sub_request_cb, nullptr);
+            // A subscription holds a request slot until its SUBACK, same as a publish
+            uint32_t wire_size = publishWireSize(strlen(topic), 1, 1);
+            if (!acquire_credits(wire_size, CREDIT_WAIT_TIMEOUT_MS))
+            {
+                printf("MQTT subscribe failed: no credits - topic: %s\n", topic);
+                return false;
+            }
 
-            if (err != ERR_OK)
+            if (!post_request(NetOp::SUBSCRIBE, wire_size, false, topic, nullptr, 0))
             {
-                const char *err_str = "unknown";
-                switch (err)
-                {
-                case ERR_MEM:
-                    err_str = "out of memory (ERR_MEM)";
-                    break;
-                case ERR_BUF:
-                    err_str = "buffer error (ERR_BUF)";
-                    break;
-                case ERR_CONN:
-                    err_str = "not connected (ERR_CONN)";
-                    break;
-                default:
-                    break;
-                }
-                printf("MQTT subscribe failed: %s (%d) - topic: %s\n", err_str, err, topic);
+                g_publish_credits.cancel(wire_size);
                 return false;
             }
 
-            printf("Subscribed to: %s\n", topic);
+            printf("Subscribing to: %s\n", topic);
+            return true;
+        }
+
+        void wifi_request_status()
+        {
+            if (g_wifi_status_pending)
+                return;
+            if (post_request(NetOp::WIFI_STATUS, 0, false, nullptr, nullptr, 0, &g_wifi_status_token))
+                g_wifi_status_pending = true;
+        }
+
+        bool wifi_status(WifiStatus *out)
+        {
+            if (!g_wifi_status_valid)
+                return false;
+            *out = g_wifi_status;
+            return true;
+        }
 
-            // Brief delay to allow subscription to be processed
-            aggressive_network_poll(10);
+        // Ask for a WifiStatus and wait for it; for the connection paths, which block anyway
+        static bool wifi_wait_status(WifiStatus *out)
+        {
+            wifi_request_status();
+            int8_t err;
+            if (!g_wifi_status_pending || !wait_request(g_wifi_status_token, CREDIT_WAIT_TIMEOUT_MS, &err))
+                return false;
+            *out = g_wifi_status;
             return true;
         }
 
@@ -314,100 +930,90 @@ namespace OpenTherm
         {
             printf("Connecting to WiFi...\n");
 
-            if (cyw43_arch_wifi_connect_timeout_ms(ssid, password,
-                                                   CYW43_AUTH_WPA2_AES_PSK, WIFI_CONNECT_TIMEOUT_MS))
+            // The join runs on the network core; it answers within the timeout either way
+            uint32_t token;
+            int8_t err;
+            if (!post_request(NetOp::WIFI_CONNECT, WIFI_CONNECT_TIMEOUT_MS, false, ssid, password, strlen(password),
+                              &token) ||
+                !wait_request(token, WIFI_CONNECT_TIMEOUT_MS + CREDIT_WAIT_TIMEOUT_MS, &err) || err != ERR_OK)
             {
                 printf("Failed to connect to WiFi\n");
                 return false;
             }
 
             printf("Connected to WiFi!\n");
-            printf("IP Address: %s\n", ip4addr_ntoa(netif_ip4_addr(netif_list)));
+            WifiStatus status;
+            if (wifi_wait_status(&status) && status.has_ip)
+                printf("IP Address: %s\n", status.ip);
             return true;
         }
 
+        // Ask the actor to drop the client; requests queued before it are handled first
+        static void disconnect_client()
+        {
+            uint32_t token;
+            int8_t err;
+            if (post_request(NetOp::DISCONNECT, 0, false, nullptr, nullptr, 0, &token))
+                wait_request(token, CREDIT_WAIT_TIMEOUT_MS, &err);
+            g_client_created = false;
+            g_stream_open = false;
+        }
+
         bool connect_mqtt(const char *server_ip, uint16_t port, const char *client_id)
         {
             printf("Connecting to MQTT broker...\n");
 
             // Clean up any existing client first
-            if (g_mqtt_client)
+            if (g_client_created)
             {
                 printf("Cleaning up existing MQTT client...\n");
                 g_mqtt_reconnect_count++; // Track reconnection
-                mqtt_disconnect(g_mqtt_client);
+                disconnect_client();
 
                 // Clear pending messages before cleanup to prevent stale messages
-                if (!g_pending_messages.empty())
+                size_t stale = g_incoming_messages.discard();
+                if (stale > 0)
                 {
-                    printf("Clearing %zu pending messages before reconnect\n", g_pending_messages.size());
-                    g_pending_messages.clear();
+                    printf("Clearing %zu pending messages before reconnect\n", stale);
                 }
 
-                mqtt_client_free(g_mqtt_client);
-                g_mqtt_client = nullptr;
-                g_mqtt_connected = false;
-
-                // Increased delay for lwIP cleanup (was 100ms, now 500ms)
-                // Allows lwIP to properly clean up TCP buffers and timers
-                sleep_ms(500);
+                // The old client's requests were dropped without completion callbacks
+                g_publish_credits.reset();
             }
 
-            g_mqtt_client = mqtt_client_new();
-            if (!g_mqtt_client)
+            // The actor creates the client and starts connecting; CONNACK arrives in mqtt_connection_cb
+            uint32_t token;
+            int8_t err;
+            if (!post_request(NetOp::CONNECT, port, false, client_id, server_ip, strlen(server_ip), &token) ||
+                !wait_request(token, CREDIT_WAIT_TIMEOUT_MS, &err))
             {
-                printf("Failed to create MQTT client\n");
+                printf("MQTT connect: network core did not respond\n");
                 return false;
             }
-
-            struct mqtt_connect_client_info_t ci = {0};
-            ci.client_id = client_id;
-            ci.keep_alive = 60;
-
-            mqtt_set_inpub_callback(g_mqtt_client, mqtt_incoming_publish_cb,
-                                    mqtt_incoming_data_cb, nullptr);
-
-            ip_addr_t mqtt_server;
-            if (!ipaddr_aton(server_ip, &mqtt_server))
-            {
-                printf("Invalid MQTT server IP\n");
-                mqtt_client_free(g_mqtt_client);
-                g_mqtt_client = nullptr;
-                return false;
-            }
-
-            err_t err = mqtt_client_connect(g_mqtt_client, &mqtt_server, port,
-                                            mqtt_connection_cb, nullptr, &ci);
-
             if (err != ERR_OK)
             {
                 printf("MQTT connect failed: %d\n", err);
-                mqtt_client_free(g_mqtt_client);
-                g_mqtt_client = nullptr;
                 return false;
             }
+            g_client_created = true;
 
             // Wait for connection
-            for (int i = 0; i < 50 && !g_mqtt_connected; i++)
+            for (int i = 0; i < 50 && !mqtt_connected(); i++)
             {
                 sleep_ms(100);
             }
 
-            if (!g_mqtt_connected)
+            if (!mqtt_connected())
             {
                 printf("MQTT connection timeout\n");
-                mqtt_disconnect(g_mqtt_client);
-                mqtt_client_free(g_mqtt_client);
-                g_mqtt_client = nullptr;
+                disconnect_client();
             }
             else
             {
-                // Give MQTT client time to stabilize before publishing
-                printf("MQTT connection established, waiting for client to stabilize...\n");
-                sleep_ms(500);
+                consecutive_publish_failures = 0; // Reset failure counter on successful connection
             }
 
-            return g_mqtt_connected;
+            return mqtt_connected();
         }
 
         bool connect_with_retry(const char *ssid, const char *password,
@@ -435,8 +1041,6 @@ namespace OpenTherm
             }
 
             // Connect to MQTT
-            g_mqtt_connected = false;
-
             int mqtt_attempt = 1;
             while (true)
             {
@@ -465,21 +1069,19 @@ namespace OpenTherm
             // Check MQTT connection first (more reliable than WiFi link status)
             // Note: WiFi link status can be momentarily down during normal operation,
             // so we only check WiFi if MQTT is actually failing.
-            if (!g_mqtt_connected)
+            if (!mqtt_connected())
             {
                 printf("MQTT connection lost! Reconnecting...\n");
                 OpenTherm::LED::set_pattern(OpenTherm::LED::BLINK_MQTT_ERROR);
 
-                g_mqtt_connected = false;
-
                 int mqtt_attempt = 1;
                 while (true)
                 {
                     printf("MQTT reconnection attempt %d\n", mqtt_attempt);
 
-                    // Check WiFi before attempting MQTT reconnect
-                    int link_status = cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA);
-                    if (link_status != CYW43_LINK_UP)
+                    // Check WiFi before attempting MQTT reconnect; no answer counts as down
+                    WifiStatus status;
+                    if (!wifi_wait_status(&status) || status.link_status != CYW43_LINK_UP)
                     {
                         printf("WiFi connection lost during MQTT reconnect! Reconnecting WiFi...\n");
                         OpenTherm::LED::set_pattern(OpenTherm::LED::BLINK_WIFI_ERROR);
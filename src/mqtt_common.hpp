@@ -4,8 +4,10 @@
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h"
 #include "lwip/apps/mqtt.h"
-#include <string>
-#include <map>
+#include "mqtt_flow.hpp"
+#include "loop_events.hpp"
+#include "message_ring.hpp"
+#include "net_queue.hpp"
 
 namespace OpenTherm
 {
@@ -17,17 +19,47 @@ namespace OpenTherm
         constexpr uint32_t MQTT_RETRY_DELAY_MS = 3000;
         constexpr uint32_t CONNECTION_CHECK_DELAY_MS = 5000;
 
+        // Longest the main loop sleeps without an event or a deadline of its own
+        constexpr uint32_t MAIN_LOOP_MAX_IDLE_MS = 1000;
+
+        // Publish flow control
+        constexpr uint32_t CREDIT_WAIT_TIMEOUT_MS = 5000; // Give up on a publish after this long without credits
+        constexpr uint32_t CREDIT_POLL_US = 250;
+
         // Global MQTT state
-        extern mqtt_client_t *g_mqtt_client;
-        extern bool g_mqtt_connected;
-        extern std::map<std::string, std::string> g_pending_messages;
+        extern MessageRing g_incoming_messages; // Filled on core 1, drained by the main loop
+        extern LoopEvents g_loop_events;        // Signalled on core 1, wakes the main loop
 
         // MQTT statistics for long-term monitoring
         extern uint32_t g_total_publish_attempts;
         extern uint32_t g_total_publish_failures;
         extern uint32_t g_mqtt_reconnect_count;
 
-        // MQTT callback functions
+        // In-flight publish/subscribe credits and how often a publisher had to wait for them
+        extern PublishCredits g_publish_credits;
+        extern uint32_t g_publish_credit_waits;
+
+        // Network actor: core 1 is the only core that calls into lwIP and the
+        // cyw43 WiFi driver. Its loop calls network_actor_poll(), which polls
+        // the stack and then hands queued publish/subscribe/connect requests to
+        // the MQTT client, and WiFi joins and link checks to the driver. The
+        // functions below run on core 0 and only post requests; completions
+        // come back through mqtt_process_completions(), which they also call.
+        // The exceptions are main()'s driver setup, which runs before core 1
+        // starts, and the status LED, a GPIO on the WiFi chip: led_blink.cpp
+        // drives it from core 0, through the threadsafe cyw43_arch lock.
+        void network_actor_poll();
+        void mqtt_process_completions();
+
+        // Whether the broker accepted the connection. Only the network core
+        // changes it (CONNACK, a dropped link, or a DISCONNECT/CONNECT request);
+        // core 0 reconnects through connect_mqtt() instead of clearing it.
+        bool mqtt_connected();
+
+        // Main loop: sleep (WFE) until g_loop_events is signalled or `timeout_ms` passes
+        void wait_for_work(uint32_t timeout_ms);
+
+        // MQTT callback functions (registered by the actor, run in lwIP context)
         void mqtt_connection_cb(mqtt_client_t *client, void *arg, mqtt_connection_status_t status);
         void mqtt_incoming_publish_cb(void *arg, const char *topic, u32_t tot_len);
         void mqtt_incoming_data_cb(void *arg, const u8_t *data, u16_t len, u8_t flags);
@@ -36,10 +68,57 @@ namespace OpenTherm
         // Network polling helper to prevent TCP buffer exhaustion
         void aggressive_network_poll(int duration_ms = 50);
 
-        // MQTT wrapper functions
+        // MQTT wrapper functions. A publish returns true once it is queued for
+        // the network core; whether it reached the broker is only known later.
         bool mqtt_publish_wrapper(const char *topic, const char *payload, bool retain);
+
+        // Token of the last publish mqtt_publish_wrapper() queued
+        uint32_t mqtt_last_publish_token();
+
+        // Told about each queued publish that never reached the broker (lwIP
+        // refused it or gave up on it, or the connection dropped with it in
+        // flight), from mqtt_process_completions(). `all` means some failures
+        // could not be recorded: treat every recent publish as failed.
+        typedef void (*PublishFailedHook)(uint32_t token, bool all);
+        void mqtt_set_publish_failed_hook(PublishFailedHook hook);
         bool mqtt_subscribe_wrapper(const char *topic);
 
+        // True if a publish of up to `bytes` on the wire would go out without waiting
+        bool mqtt_publish_ready(uint32_t bytes);
+
+        // Wait until every publish/subscribe handed to lwIP has completed
+        bool mqtt_wait_idle(uint32_t timeout_ms);
+
+        // Publish one retained message too large for lwIP's output ring by writing
+        // it straight to the TCP connection: begin() waits for the MQTT client to
+        // go quiet and sends the PUBLISH header, write() appends payload pieces
+        // totalling exactly `payload_len`, end() flushes. Nothing else may publish
+        // in between. A write that stalls for CREDIT_WAIT_TIMEOUT_MS leaves a
+        // half-sent packet, so the connection is dropped and the caller should
+        // treat it like any other disconnect.
+        bool mqtt_stream_begin(const char *topic, uint32_t payload_len, bool retain);
+        bool mqtt_stream_write(const char *data, size_t len);
+        bool mqtt_stream_end();
+
+        // "<label>: N messages, B bytes in T ms (x msg/s, y B/s, z credit waits)"
+        void log_throughput(const char *label, const Throughput &t);
+
+        // The WiFi link as the network core last read it
+        struct WifiStatus
+        {
+            int link_status; // CYW43_LINK_*
+            bool has_rssi;
+            int32_t rssi; // dBm
+            bool has_ip;
+            char ip[16]; // Dotted quad
+        };
+
+        // Ask the network core for a fresh WifiStatus; does nothing while one is pending
+        void wifi_request_status();
+
+        // The last WifiStatus the network core reported; false before the first
+        bool wifi_status(WifiStatus *out);
+
         // Connection functions
         bool connect_wifi(const char *ssid, const char *password);
         bool connect_mqtt(const char *server_ip, uint16_t port, const char *client_id);
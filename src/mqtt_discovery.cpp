@@ -2,13 +2,13 @@
 #include "mqtt_common.hpp"
 #include "opentherm_ha.hpp"
 #include "mqtt_topics.hpp"
+#include "discovery_payload.hpp"
+#include "mqtt_publish.hpp"
+#include "topic_arena.hpp"
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h"
-#include "mqtt_publish.hpp"
 #include <cstdio>
 #include <cstring>
-#include <string>
-#include <unordered_map>
 
 namespace OpenTherm
 {
@@ -21,9 +21,7 @@ namespace OpenTherm
                 // Publish with retain flag so configs survive HA restarts
                 if (OpenTherm::Common::mqtt_publish_wrapper(topic, config, true))
                 {
-                    // Success - discovery messages are large (200-400 bytes), need extra time
-                    // Wait for TCP ACK before sending next large message
-                    OpenTherm::Common::aggressive_network_poll(75); // 75ms for large discovery messages
+                    // The publish wrapper paces on flow-control credits, no fixed gap needed
                     return true;
                 }
 
@@ -37,361 +35,86 @@ namespace OpenTherm
             return false;
         }
 
-        // Simulator-specific helper removed; merged into publishDiscoveryConfigs
-
-        std::string buildStateTopic(const OpenTherm::HomeAssistant::Config &cfg, const char *suffix)
-        {
-            // opentherm/opentherm_gw/state/boiler_temp
-            // Pre-allocate to reduce heap allocations during concatenation
-            std::string topic;
-            topic.reserve(strlen(cfg.topic_base) + strlen(cfg.device_id) +
-                         strlen(cfg.state_topic_base) + strlen(suffix) + 3);
-            topic = std::string(cfg.topic_base) + "/" + cfg.device_id + "/" + cfg.state_topic_base + "/" + suffix;
-            return topic;
-        }
-
-        std::string buildCommandTopic(const OpenTherm::HomeAssistant::Config &cfg, const char *suffix)
-        {
-            // opentherm/opentherm_gw/cmd/ch_enable
-            // Pre-allocate to reduce heap allocations during concatenation
-            std::string topic;
-            topic.reserve(strlen(cfg.topic_base) + strlen(cfg.device_id) +
-                         strlen(cfg.command_topic_base) + strlen(suffix) + 3);
-            topic = std::string(cfg.topic_base) + "/" + cfg.device_id + "/" + cfg.command_topic_base + "/" + suffix;
-            return topic;
-        }
-
-        std::string buildDiscoveryTopic(const OpenTherm::HomeAssistant::Config &cfg, const char *component, const char *object_id)
-        {
-            // Home Assistant MQTT discovery format: <discovery_prefix>/<component>/[<node_id>/]<object_id>/config
-            // Example: homeassistant/sensor/opentherm_gw/boiler_temp/config
-            // Pre-allocate to reduce heap allocations during concatenation
-            std::string topic;
-            topic.reserve(strlen(cfg.mqtt_prefix) + strlen(component) + strlen(cfg.device_id) +
-                         strlen(object_id) + strlen(OpenTherm::MQTTDiscovery::CONFIG_SUFFIX) + 4);
-            topic = std::string(cfg.mqtt_prefix) + "/" + component + "/" + cfg.device_id + "/" + object_id + OpenTherm::MQTTDiscovery::CONFIG_SUFFIX;
-            return topic;
-        }
-
-        bool publishDiscoveryConfig(const OpenTherm::HomeAssistant::Config &cfg,
-                                    const char *component, const char *object_id,
-                                    const char *name, const char *state_topic,
-                                    const char *device_class, const char *unit,
-                                    const char *icon, const char *command_topic,
-                                    const char *value_template,
-                                    float min_value, float max_value, float step)
+        bool publishComponentConfig(const OpenTherm::HomeAssistant::Config &cfg, size_t index)
         {
-            using namespace OpenTherm::MQTTDiscovery;
-
-            // Static buffer to avoid heap allocations - discovery messages are ~300-400 bytes
-            static char payload[512];
-            int len = 0;
-
-            // Start JSON object
-            len += snprintf(payload + len, sizeof(payload) - len, "{");
-            len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":\"%s\",", JSON_NAME, name);
-            len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":\"%s.%s_%s\",",
-                           JSON_DEFAULT_ENTITY_ID, component, cfg.device_id, object_id);
-            len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":\"%s_%s\",",
-                           JSON_UNIQUE_ID, cfg.device_id, object_id);
-            len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":\"%s\",", JSON_STATE_TOPIC, state_topic);
-
-            if (command_topic)
-            {
-                len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":\"%s\",",
-                               JSON_COMMAND_TOPIC, command_topic);
-            }
-
-            if (device_class)
-            {
-                len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":\"%s\",",
-                               JSON_DEVICE_CLASS, device_class);
-            }
+            // Static buffer to avoid heap allocations - discovery messages are ~250-520 bytes
+            static char payload[COMPONENT_CONFIG_LEN];
+            const Component &component = COMPONENTS[index];
+            size_t len = formatComponentConfig(cfg, component, index == 0, payload, sizeof(payload));
 
-            if (unit)
-            {
-                len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":\"%s\",",
-                               JSON_UNIT_OF_MEASUREMENT, unit);
-            }
-
-            if (icon)
-            {
-                len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":\"%s\",", JSON_ICON, icon);
-            }
-
-            if (value_template)
+            // Safety check
+            if (len >= sizeof(payload))
             {
-                len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":\"%s\",",
-                               JSON_VALUE_TEMPLATE, value_template);
+                printf("ERROR: Discovery payload too large (%zu bytes) for %s/%s\n",
+                       len, component.component, component.object_id);
+                return false;
             }
 
-            if (strcmp(component, COMPONENT_NUMBER) == 0)
+            if (!publishWithRetry(OpenTherm::Publish::topics().discovery(index), payload))
             {
-                len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":%.1f,", JSON_MIN, min_value);
-                len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":%.1f,", JSON_MAX, max_value);
-                len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":%.1f,", JSON_STEP, step);
-                len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":\"%s\",", JSON_MODE, MODE_BOX);
+                printf("WARNING: Failed to publish discovery config for %s/%s\n", component.component, component.object_id);
+                return false;
             }
+            return true;
+        }
 
-            // Device information
-            len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":{", JSON_DEVICE);
-            len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":[\"%s\"],",
-                           JSON_IDENTIFIERS, cfg.device_id);
-            len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":\"%s\",", JSON_NAME, cfg.device_name);
-            len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":\"%s\",", JSON_MODEL, DEVICE_MODEL);
-            len += snprintf(payload + len, sizeof(payload) - len, "\"%s\":\"%s\"",
-                           JSON_MANUFACTURER, DEVICE_MANUFACTURER);
-            len += snprintf(payload + len, sizeof(payload) - len, "}");
-
-            // Close JSON object
-            len += snprintf(payload + len, sizeof(payload) - len, "}");
-
-            // Safety check
-            if (len >= sizeof(payload))
+        bool publishDeviceConfig(const OpenTherm::HomeAssistant::Config &cfg)
+        {
+            // Each piece is one component (~250 bytes), so this is all the RAM the
+            // 17-21 KB payload needs; the pieces go straight to the TCP connection
+            static char chunk[512];
+            size_t total = streamDeviceConfig(cfg, chunk, sizeof(chunk), nullptr);
+            if (total == 0)
             {
-                printf("ERROR: Discovery payload too large (%d bytes) for %s/%s\n", len, component, object_id);
+                printf("ERROR: Device discovery payload could not be rendered\n");
                 return false;
             }
 
-            std::string topic = buildDiscoveryTopic(cfg, component, object_id);
-            if (!publishWithRetry(topic.c_str(), payload))
+            const char *topic = OpenTherm::Publish::topics().deviceDiscovery();
+            printf("Streaming device discovery: %zu components, %zu bytes to %s\n", COMPONENT_COUNT, total, topic);
+            if (!OpenTherm::Common::mqtt_stream_begin(topic, (uint32_t)total, true))
+                return false;
+            size_t streamed = streamDeviceConfig(cfg, chunk, sizeof(chunk), &OpenTherm::Common::mqtt_stream_write);
+            if (streamed != total)
             {
-                printf("WARNING: Failed to publish discovery config for %s/%s\n", component, object_id);
+                // Only possible if the sink failed; mqtt_stream_write already dropped the connection
+                printf("ERROR: Device discovery stream aborted\n");
                 return false;
             }
-            return true;
+            return OpenTherm::Common::mqtt_stream_end();
         }
 
         bool publishDiscoveryConfigs(const OpenTherm::HomeAssistant::Config &cfg)
         {
-            // Wait for MQTT client to be ready for large discovery messages
-            printf("Waiting for MQTT client to be ready for discovery (2 seconds)...\n");
-            OpenTherm::Common::aggressive_network_poll(2000); // Reduced from 5s with dual-core
+            // Start from an empty pipeline so the throughput figure covers discovery only
+            OpenTherm::Common::mqtt_wait_idle(2000);
 
-            printf("Publishing Home Assistant MQTT discovery configs...\n");
-
-            using namespace OpenTherm::MQTTTopics;
-            using namespace OpenTherm::MQTTDiscovery;
-
-            // Binary Sensors
-            publishDiscoveryConfig(cfg, COMPONENT_BINARY_SENSOR, FAULT, NAME_FAULT,
-                                   buildStateTopic(cfg, FAULT).c_str(), DEVICE_CLASS_PROBLEM, nullptr, ICON_ALERT_CIRCLE);
-            publishDiscoveryConfig(cfg, COMPONENT_BINARY_SENSOR, CH_MODE, NAME_CH_MODE,
-                                   buildStateTopic(cfg, CH_MODE).c_str(), DEVICE_CLASS_HEAT, nullptr, ICON_RADIATOR);
-            publishDiscoveryConfig(cfg, COMPONENT_BINARY_SENSOR, DHW_MODE, NAME_DHW_MODE,
-                                   buildStateTopic(cfg, DHW_MODE).c_str(), DEVICE_CLASS_HEAT, nullptr, ICON_WATER_BOILER);
-            publishDiscoveryConfig(cfg, COMPONENT_BINARY_SENSOR, FLAME, NAME_FLAME,
-                                   buildStateTopic(cfg, FLAME).c_str(), DEVICE_CLASS_HEAT, nullptr, ICON_FIRE);
-            publishDiscoveryConfig(cfg, COMPONENT_BINARY_SENSOR, COOLING, NAME_COOLING,
-                                   buildStateTopic(cfg, COOLING).c_str(), DEVICE_CLASS_COLD, nullptr, ICON_SNOWFLAKE);
-            publishDiscoveryConfig(cfg, COMPONENT_BINARY_SENSOR, DIAGNOSTIC, NAME_DIAGNOSTIC,
-                                   buildStateTopic(cfg, DIAGNOSTIC).c_str(), nullptr, nullptr, ICON_WRENCH);
-
-            // Switches
-            publishDiscoveryConfig(cfg, COMPONENT_SWITCH, CH_ENABLE, NAME_CH_ENABLE,
-                                   buildStateTopic(cfg, CH_ENABLE).c_str(), DEVICE_CLASS_SWITCH, nullptr, ICON_RADIATOR,
-                                   buildCommandTopic(cfg, CH_ENABLE).c_str());
-            publishDiscoveryConfig(cfg, COMPONENT_SWITCH, DHW_ENABLE, NAME_DHW_ENABLE,
-                                   buildStateTopic(cfg, DHW_ENABLE).c_str(), DEVICE_CLASS_SWITCH, nullptr, ICON_WATER_BOILER,
-                                   buildCommandTopic(cfg, DHW_ENABLE).c_str());
-
-            // Temperature sensors
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, BOILER_TEMP, NAME_BOILER_TEMP,
-                                   buildStateTopic(cfg, BOILER_TEMP).c_str(), DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, DHW_TEMP, NAME_DHW_TEMP,
-                                   buildStateTopic(cfg, DHW_TEMP).c_str(), DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, RETURN_TEMP, NAME_RETURN_TEMP,
-                                   buildStateTopic(cfg, RETURN_TEMP).c_str(), DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, OUTSIDE_TEMP, NAME_OUTSIDE_TEMP,
-                                   buildStateTopic(cfg, OUTSIDE_TEMP).c_str(), DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, ROOM_TEMP, NAME_ROOM_TEMP,
-                                   buildStateTopic(cfg, ROOM_TEMP).c_str(), DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_HOME_THERMOMETER);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, EXHAUST_TEMP, NAME_EXHAUST_TEMP,
-                                   buildStateTopic(cfg, EXHAUST_TEMP).c_str(), DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER);
-
-            // Numbers (setpoints)
-            publishDiscoveryConfig(cfg, COMPONENT_NUMBER, CONTROL_SETPOINT, NAME_CONTROL_SETPOINT,
-                                   buildStateTopic(cfg, CONTROL_SETPOINT).c_str(), nullptr, UNIT_CELSIUS, ICON_THERMOMETER_LINES,
-                                   buildCommandTopic(cfg, CONTROL_SETPOINT).c_str(), nullptr, 0.0f, 100.0f, 0.5f);
-            publishDiscoveryConfig(cfg, COMPONENT_NUMBER, ROOM_SETPOINT, NAME_ROOM_SETPOINT,
-                                   buildStateTopic(cfg, ROOM_SETPOINT).c_str(), nullptr, UNIT_CELSIUS, ICON_HOME_THERMOMETER_OUTLINE,
-                                   buildCommandTopic(cfg, ROOM_SETPOINT).c_str(), nullptr, 5.0f, 30.0f, 0.5f);
-            publishDiscoveryConfig(cfg, COMPONENT_NUMBER, DHW_SETPOINT, NAME_DHW_SETPOINT,
-                                   buildStateTopic(cfg, DHW_SETPOINT).c_str(), nullptr, UNIT_CELSIUS, ICON_WATER_THERMOMETER_OUTLINE,
-                                   buildCommandTopic(cfg, DHW_SETPOINT).c_str(), nullptr, 30.0f, 90.0f, 1.0f);
-            publishDiscoveryConfig(cfg, COMPONENT_NUMBER, MAX_CH_SETPOINT, NAME_MAX_CH_SETPOINT,
-                                   buildStateTopic(cfg, MAX_CH_SETPOINT).c_str(), nullptr, UNIT_CELSIUS, ICON_THERMOMETER_HIGH,
-                                   buildCommandTopic(cfg, MAX_CH_SETPOINT).c_str(), nullptr, 30.0f, 90.0f, 1.0f);
-
-            // Modulation sensors
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, MODULATION, NAME_MODULATION,
-                                   buildStateTopic(cfg, MODULATION).c_str(), nullptr, UNIT_PERCENT, ICON_PERCENT);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, MAX_MODULATION, NAME_MAX_MODULATION,
-                                   buildStateTopic(cfg, MAX_MODULATION).c_str(), nullptr, UNIT_PERCENT, ICON_PERCENT);
-
-            // Pressure & flow
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, PRESSURE, NAME_PRESSURE,
-                                   buildStateTopic(cfg, PRESSURE).c_str(), DEVICE_CLASS_PRESSURE, UNIT_BAR, ICON_GAUGE);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, DHW_FLOW, NAME_DHW_FLOW,
-                                   buildStateTopic(cfg, DHW_FLOW).c_str(), nullptr, UNIT_LITERS_PER_MIN, ICON_WATER_PUMP);
-
-            // Counters
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, BURNER_STARTS, NAME_BURNER_STARTS,
-                                   buildStateTopic(cfg, BURNER_STARTS).c_str(), nullptr, UNIT_STARTS, ICON_COUNTER);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, CH_PUMP_STARTS, NAME_CH_PUMP_STARTS,
-                                   buildStateTopic(cfg, CH_PUMP_STARTS).c_str(), nullptr, UNIT_STARTS, ICON_COUNTER);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, DHW_PUMP_STARTS, NAME_DHW_PUMP_STARTS,
-                                   buildStateTopic(cfg, DHW_PUMP_STARTS).c_str(), nullptr, UNIT_STARTS, ICON_COUNTER);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, BURNER_HOURS, NAME_BURNER_HOURS,
-                                   buildStateTopic(cfg, BURNER_HOURS).c_str(), DEVICE_CLASS_DURATION, UNIT_HOURS, ICON_CLOCK_OUTLINE);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, CH_PUMP_HOURS, NAME_CH_PUMP_HOURS,
-                                   buildStateTopic(cfg, CH_PUMP_HOURS).c_str(), DEVICE_CLASS_DURATION, UNIT_HOURS, ICON_CLOCK_OUTLINE);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, DHW_PUMP_HOURS, NAME_DHW_PUMP_HOURS,
-                                   buildStateTopic(cfg, DHW_PUMP_HOURS).c_str(), DEVICE_CLASS_DURATION, UNIT_HOURS, ICON_CLOCK_OUTLINE);
-
-            // Faults and config
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, FAULT_CODE, NAME_FAULT_CODE,
-                                   buildStateTopic(cfg, FAULT_CODE).c_str(), nullptr, nullptr, ICON_ALERT_OCTAGON);
-
-            // Diagnostic code
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, DIAGNOSTIC_CODE, NAME_DIAGNOSTIC_CODE,
-                                   buildStateTopic(cfg, DIAGNOSTIC_CODE).c_str(), nullptr, nullptr, ICON_ALERT_CIRCLE);
-
-            publishDiscoveryConfig(cfg, COMPONENT_BINARY_SENSOR, DHW_PRESENT, NAME_DHW_PRESENT,
-                                   buildStateTopic(cfg, DHW_PRESENT).c_str(), nullptr, nullptr, ICON_WATER_BOILER);
-            publishDiscoveryConfig(cfg, COMPONENT_BINARY_SENSOR, COOLING_SUPPORTED, NAME_COOLING_SUPPORTED,
-                                   buildStateTopic(cfg, COOLING_SUPPORTED).c_str(), nullptr, nullptr, ICON_SNOWFLAKE);
-            publishDiscoveryConfig(cfg, COMPONENT_BINARY_SENSOR, CH2_PRESENT, NAME_CH2_PRESENT,
-                                   buildStateTopic(cfg, CH2_PRESENT).c_str(), nullptr, nullptr, ICON_RADIATOR);
-
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, OPENTHERM_VERSION, NAME_OPENTHERM_VERSION,
-                                   buildStateTopic(cfg, OPENTHERM_VERSION).c_str(), nullptr, nullptr, ICON_INFORMATION);
-
-            // Text / device config
-            publishDiscoveryConfig(cfg, COMPONENT_TEXT, DEVICE_NAME, NAME_DEVICE_NAME,
-                                   buildStateTopic(cfg, DEVICE_NAME).c_str(), nullptr, nullptr, ICON_TAG_TEXT,
-                                   buildCommandTopic(cfg, DEVICE_NAME).c_str());
-            publishDiscoveryConfig(cfg, COMPONENT_TEXT, DEVICE_ID, NAME_DEVICE_ID,
-                                   buildStateTopic(cfg, DEVICE_ID).c_str(), nullptr, nullptr, ICON_IDENTIFIER,
-                                   buildCommandTopic(cfg, DEVICE_ID).c_str());
-
-            // GPIO numbers
-            publishDiscoveryConfig(cfg, COMPONENT_NUMBER, OPENTHERM_TX_PIN, NAME_OPENTHERM_TX_PIN,
-                                   buildStateTopic(cfg, OPENTHERM_TX_PIN).c_str(), nullptr, nullptr, ICON_PIN,
-                                   buildCommandTopic(cfg, OPENTHERM_TX_PIN).c_str(), nullptr, 0.0f, 28.0f, 1.0f);
-            publishDiscoveryConfig(cfg, COMPONENT_NUMBER, OPENTHERM_RX_PIN, NAME_OPENTHERM_RX_PIN,
-                                   buildStateTopic(cfg, OPENTHERM_RX_PIN).c_str(), nullptr, nullptr, ICON_PIN,
-                                   buildCommandTopic(cfg, OPENTHERM_RX_PIN).c_str(), nullptr, 0.0f, 28.0f, 1.0f);
-            publishDiscoveryConfig(cfg, COMPONENT_NUMBER, UPDATE_INTERVAL, NAME_UPDATE_INTERVAL,
-                                   buildStateTopic(cfg, UPDATE_INTERVAL).c_str(), nullptr, UNIT_MS, ICON_TIMER,
-                                   buildCommandTopic(cfg, UPDATE_INTERVAL).c_str(), nullptr, 1000.0f, 300000.0f, 1000.0f);
-
-            // Time/Date sensors (read-only from boiler)
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, DAY_OF_WEEK, NAME_DAY_OF_WEEK,
-                                   buildStateTopic(cfg, DAY_OF_WEEK).c_str(), nullptr, nullptr, ICON_CALENDAR);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, TIME_OF_DAY, NAME_TIME_OF_DAY,
-                                   buildStateTopic(cfg, TIME_OF_DAY).c_str(), nullptr, nullptr, ICON_CLOCK_OUTLINE);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, DATE, NAME_DATE,
-                                   buildStateTopic(cfg, DATE).c_str(), nullptr, nullptr, ICON_CALENDAR_TODAY);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, YEAR, NAME_YEAR,
-                                   buildStateTopic(cfg, YEAR).c_str(), nullptr, nullptr, ICON_CALENDAR);
-
-            // Time sync button - pressing this will sync time from HA to boiler
-            publishDiscoveryConfig(cfg, COMPONENT_BUTTON, SYNC_TIME, NAME_SYNC_TIME,
-                                   buildStateTopic(cfg, SYNC_TIME).c_str(), nullptr, nullptr, ICON_CLOCK_SYNC,
-                                   buildCommandTopic(cfg, SYNC_TIME).c_str());
-
-            // Restart button - pressing this will restart the gateway
-            publishDiscoveryConfig(cfg, COMPONENT_BUTTON, RESTART, NAME_RESTART,
-                                   buildStateTopic(cfg, RESTART).c_str(), nullptr, nullptr, ICON_RESTART,
-                                   buildCommandTopic(cfg, RESTART).c_str());
-
-            // Republish discovery button - pressing this will re-publish all discovery configs
-            publishDiscoveryConfig(cfg, COMPONENT_BUTTON, REPUBLISH_DISCOVERY, NAME_REPUBLISH_DISCOVERY,
-                                   buildStateTopic(cfg, REPUBLISH_DISCOVERY).c_str(), nullptr, nullptr, "mdi:refresh",
-                                   buildCommandTopic(cfg, REPUBLISH_DISCOVERY).c_str());
-
-            // Republish state button - pressing this will re-publish cached values without reading from boiler
-            publishDiscoveryConfig(cfg, COMPONENT_BUTTON, REPUBLISH_STATE, NAME_REPUBLISH_STATE,
-                                   buildStateTopic(cfg, REPUBLISH_STATE).c_str(), nullptr, nullptr, "mdi:upload",
-                                   buildCommandTopic(cfg, REPUBLISH_STATE).c_str());
-
-            // Force republish state button - pressing this will read from boiler and re-publish all values
-            publishDiscoveryConfig(cfg, COMPONENT_BUTTON, FORCE_REPUBLISH_STATE, NAME_FORCE_REPUBLISH_STATE,
-                                   buildStateTopic(cfg, FORCE_REPUBLISH_STATE).c_str(), nullptr, nullptr, "mdi:upload-multiple",
-                                   buildCommandTopic(cfg, FORCE_REPUBLISH_STATE).c_str());
-
-            // Temperature bounds (read-only from boiler)
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, DHW_SETPOINT_MIN, NAME_DHW_SETPOINT_MIN,
-                                   buildStateTopic(cfg, DHW_SETPOINT_MIN).c_str(), DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER_LOW);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, DHW_SETPOINT_MAX, NAME_DHW_SETPOINT_MAX,
-                                   buildStateTopic(cfg, DHW_SETPOINT_MAX).c_str(), DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER_HIGH);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, CH_SETPOINT_MIN, NAME_CH_SETPOINT_MIN,
-                                   buildStateTopic(cfg, CH_SETPOINT_MIN).c_str(), DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER_LOW);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, CH_SETPOINT_MAX, NAME_CH_SETPOINT_MAX,
-                                   buildStateTopic(cfg, CH_SETPOINT_MAX).c_str(), DEVICE_CLASS_TEMPERATURE, UNIT_CELSIUS, ICON_THERMOMETER_HIGH);
-
-            // WiFi statistics
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, WIFI_RSSI, NAME_WIFI_RSSI,
-                                   buildStateTopic(cfg, WIFI_RSSI).c_str(), DEVICE_CLASS_SIGNAL_STRENGTH, UNIT_DBM, ICON_WIFI);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, WIFI_LINK_STATUS, NAME_WIFI_LINK_STATUS,
-                                   buildStateTopic(cfg, WIFI_LINK_STATUS).c_str(), nullptr, nullptr, ICON_WIFI_CHECK);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, IP_ADDRESS, NAME_IP_ADDRESS,
-                                   buildStateTopic(cfg, IP_ADDRESS).c_str(), nullptr, nullptr, ICON_IP_NETWORK);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, WIFI_SSID, NAME_WIFI_SSID,
-                                   buildStateTopic(cfg, WIFI_SSID).c_str(), nullptr, nullptr, ICON_WIFI_MARKER);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, UPTIME, NAME_UPTIME,
-                                   buildStateTopic(cfg, UPTIME).c_str(), DEVICE_CLASS_DURATION, UNIT_SECONDS, ICON_CLOCK_START);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, FREE_HEAP, NAME_FREE_HEAP,
-                                   buildStateTopic(cfg, FREE_HEAP).c_str(), DEVICE_CLASS_DATA_SIZE, UNIT_BYTES, ICON_MEMORY);
+            uint32_t start_ms = to_ms_since_boot(get_absolute_time());
+            if (cfg.device_discovery)
+            {
+                bool ok = publishDeviceConfig(cfg);
+                printf("Device discovery %s in %lu ms\n", ok ? "published" : "FAILED",
+                       (unsigned long)(to_ms_since_boot(get_absolute_time()) - start_ms));
+                // A failed stream drops the connection and the reconnect republishes,
+                // just as failed per-entity configs do not stop the others
+                return true;
+            }
 
-            // MQTT statistics for long-term monitoring
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, MQTT_PUBLISH_ATTEMPTS, NAME_MQTT_PUBLISH_ATTEMPTS,
-                                   buildStateTopic(cfg, MQTT_PUBLISH_ATTEMPTS).c_str(), nullptr, nullptr, ICON_COUNTER);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, MQTT_PUBLISH_FAILURES, NAME_MQTT_PUBLISH_FAILURES,
-                                   buildStateTopic(cfg, MQTT_PUBLISH_FAILURES).c_str(), nullptr, nullptr, ICON_ALERT_CIRCLE);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, MQTT_RECONNECT_COUNT, NAME_MQTT_RECONNECT_COUNT,
-                                   buildStateTopic(cfg, MQTT_RECONNECT_COUNT).c_str(), nullptr, nullptr, ICON_WIFI);
+            printf("Publishing Home Assistant MQTT discovery configs...\n");
+            OpenTherm::Common::ThroughputMeter meter;
+            meter.start(OpenTherm::Common::g_publish_credits, start_ms);
 
-            // OpenTherm operation metrics for diagnostics
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, OT_TOTAL_REQUESTS, NAME_OT_TOTAL_REQUESTS,
-                                   buildStateTopic(cfg, OT_TOTAL_REQUESTS).c_str(), nullptr, nullptr, ICON_COUNTER);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, OT_FAILED_REQUESTS, NAME_OT_FAILED_REQUESTS,
-                                   buildStateTopic(cfg, OT_FAILED_REQUESTS).c_str(), nullptr, nullptr, ICON_ALERT_CIRCLE);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, OT_SUCCESS_RATE, NAME_OT_SUCCESS_RATE,
-                                   buildStateTopic(cfg, OT_SUCCESS_RATE).c_str(), nullptr, "%", ICON_PERCENT);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, OT_LAST_ERROR_ENTITY, NAME_OT_LAST_ERROR_ENTITY,
-                                   buildStateTopic(cfg, OT_LAST_ERROR_ENTITY).c_str(), nullptr, nullptr, ICON_ALERT_CIRCLE);
-            publishDiscoveryConfig(cfg, COMPONENT_SENSOR, OT_TIME_SINCE_ERROR, NAME_OT_TIME_SINCE_ERROR,
-                                   buildStateTopic(cfg, OT_TIME_SINCE_ERROR).c_str(), DEVICE_CLASS_DURATION, UNIT_SECONDS, ICON_CLOCK_OUTLINE);
+            for (size_t i = 0; i < COMPONENT_COUNT; i++)
+            {
+                publishComponentConfig(cfg, i);
+            }
 
-            printf("Discovery configs published!\n");
+            OpenTherm::Common::mqtt_wait_idle(OpenTherm::Common::CREDIT_WAIT_TIMEOUT_MS);
+            OpenTherm::Common::log_throughput("Discovery configs published",
+                                              meter.read(OpenTherm::Common::g_publish_credits,
+                                                         to_ms_since_boot(get_absolute_time())));
             return true;
         }
 
-        void publishSensor(const OpenTherm::HomeAssistant::Config &cfg, const char *topic_suffix, float value)
-        {
-            std::string topic = buildStateTopic(cfg, topic_suffix);
-            OpenTherm::Publish::publishFloatIfChanged(topic, value, 2, false);
-        }
-
-        void publishSensor(const OpenTherm::HomeAssistant::Config &cfg, const char *topic_suffix, int value)
-        {
-            std::string topic = buildStateTopic(cfg, topic_suffix);
-            OpenTherm::Publish::publishIntIfChanged(topic, value, false);
-        }
-
-        void publishSensor(const OpenTherm::HomeAssistant::Config &cfg, const char *topic_suffix, const char *value)
-        {
-            std::string topic = buildStateTopic(cfg, topic_suffix);
-            OpenTherm::Publish::publishStringIfChanged(topic, value ? std::string(value) : std::string(), false);
-        }
-
-        void publishBinarySensor(const OpenTherm::HomeAssistant::Config &cfg, const char *topic_suffix, bool value)
-        {
-            std::string topic = buildStateTopic(cfg, topic_suffix);
-            OpenTherm::Publish::publishBinaryIfChanged(topic, value, false);
-        }
-
     } // namespace Discovery
 } // namespace OpenTherm
@@ -2,7 +2,7 @@
 #define MQTT_DISCOVERY_HPP
 
 #include <cstdio>
-#include <string>
+#include "discovery_payload.hpp"
 
 // Forward declaration to avoid header dependency
 namespace OpenTherm
@@ -18,33 +18,18 @@ namespace OpenTherm
     namespace Discovery
     {
         // NOTE: simulator-specific discovery helper removed — use publishDiscoveryConfigs
+        // Topics come from the shared topic arena (Publish::topics()), built for the same `cfg`
 
-        // Build topics based on Home Assistant config
-        std::string buildStateTopic(const OpenTherm::HomeAssistant::Config &cfg, const char *suffix);
-        std::string buildCommandTopic(const OpenTherm::HomeAssistant::Config &cfg, const char *suffix);
-        std::string buildDiscoveryTopic(const OpenTherm::HomeAssistant::Config &cfg, const char *component, const char *object_id);
-
-        // Publish a single discovery config (uses publishWithRetry)
-        bool publishDiscoveryConfig(const OpenTherm::HomeAssistant::Config &cfg,
-                        const char *component, const char *object_id,
-                        const char *name, const char *state_topic,
-                        const char *device_class = nullptr,
-                        const char *unit = nullptr,
-                        const char *icon = nullptr,
-                        const char *command_topic = nullptr,
-                        const char *value_template = nullptr,
-                        float min_value = 0.0f,
-                        float max_value = 100.0f,
-                        float step = 1.0f);
-
-        // Publish all discovery configs for a Home Assistant `Config`
-        bool publishDiscoveryConfigs(const OpenTherm::HomeAssistant::Config &cfg);
+        // Publish the per-entity discovery config of COMPONENTS[index] (uses publishWithRetry);
+        // the first one carries the full device block in compact mode
+        bool publishComponentConfig(const OpenTherm::HomeAssistant::Config &cfg, size_t index);
+
+        // Publish the single device-based discovery config, streamed past lwIP's output ring
+        bool publishDeviceConfig(const OpenTherm::HomeAssistant::Config &cfg);
 
-        // Simple publish helpers that use the shared MQTT wrapper
-        void publishSensor(const OpenTherm::HomeAssistant::Config &cfg, const char *topic_suffix, float value);
-        void publishSensor(const OpenTherm::HomeAssistant::Config &cfg, const char *topic_suffix, int value);
-        void publishSensor(const OpenTherm::HomeAssistant::Config &cfg, const char *topic_suffix, const char *value);
-        void publishBinarySensor(const OpenTherm::HomeAssistant::Config &cfg, const char *topic_suffix, bool value);
+        // Publish all discovery configs for a Home Assistant `Config`, per entity or
+        // as one device config depending on cfg.device_discovery
+        bool publishDiscoveryConfigs(const OpenTherm::HomeAssistant::Config &cfg);
 
         /**
          * Publish a single discovery message with retry logic and exponential backoff
@@ -0,0 +1,333 @@
+// Entity table for Home Assistant state publishing
+//
+// Every state value the gateway publishes has a fixed slot here. Per-entity
+// state (publish cache, topics, ...) is stored in plain arrays indexed by
+// Entities::Id, so the publish path needs no maps and no heap.
+#ifndef MQTT_ENTITIES_HPP
+#define MQTT_ENTITIES_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "mqtt_topics.hpp"
+
+namespace OpenTherm
+{
+    namespace Entities
+    {
+        enum class Id : uint8_t
+        {
+            // Binary / status
+            FAULT,
+            CH_MODE,
+            DHW_MODE,
+            FLAME,
+            COOLING,
+            DIAGNOSTIC,
+
+            // Switches
+            CH_ENABLE,
+            DHW_ENABLE,
+
+            // Temperatures
+            BOILER_TEMP,
+            DHW_TEMP,
+            RETURN_TEMP,
+            OUTSIDE_TEMP,
+            ROOM_TEMP,
+            EXHAUST_TEMP,
+
+            // Setpoints / numbers
+            CONTROL_SETPOINT,
+            ROOM_SETPOINT,
+            DHW_SETPOINT,
+            MAX_CH_SETPOINT,
+
+            // Modulation / pressure
+            MODULATION,
+            MAX_MODULATION,
+            PRESSURE,
+            DHW_FLOW,
+
+            // Counters / stats
+            BURNER_STARTS,
+            CH_PUMP_STARTS,
+            DHW_PUMP_STARTS,
+            BURNER_HOURS,
+            CH_PUMP_HOURS,
+            DHW_PUMP_HOURS,
+
+            // Fault / diagnostic codes
+            FAULT_CODE,
+            DIAGNOSTIC_CODE,
+
+            // Presence / features
+            DHW_PRESENT,
+            COOLING_SUPPORTED,
+            CH2_PRESENT,
+
+            // Meta / config
+            OPENTHERM_VERSION,
+            DEVICE_NAME,
+            DEVICE_ID,
+            OPENTHERM_TX_PIN,
+            OPENTHERM_RX_PIN,
+            UPDATE_INTERVAL,
+            FILTER,
+            POLL_TIERS,
+            STATS_WINDOW,
+
+            // Time/Date
+            DAY_OF_WEEK,
+            TIME_OF_DAY,
+            DATE,
+            YEAR,
+
+            // Temperature bounds
+            DHW_SETPOINT_MIN,
+            DHW_SETPOINT_MAX,
+            CH_SETPOINT_MIN,
+            CH_SETPOINT_MAX,
+
+            // WiFi statistics
+            WIFI_RSSI,
+            WIFI_LINK_STATUS,
+            IP_ADDRESS,
+            WIFI_SSID,
+            UPTIME,
+            FREE_HEAP,
+
+            // MQTT statistics
+            MQTT_PUBLISH_ATTEMPTS,
+            MQTT_PUBLISH_FAILURES,
+            MQTT_RECONNECT_COUNT,
+            MQTT_PUBLISH_RATE,
+            MQTT_QUEUE_DEPTH,
+            MQTT_QUEUE_DROPS,
+            MQTT_PRIORITY_STATS,
+
+            // OpenTherm operation metrics
+            OT_TOTAL_REQUESTS,
+            OT_FAILED_REQUESTS,
+            OT_SUCCESS_RATE,
+            OT_LAST_ERROR_ENTITY,
+            OT_TIME_SINCE_ERROR,
+            OT_FRAMES_PER_MINUTE,
+            OT_WRITES_SAVED,
+
+            // Main loop metrics
+            LOOP_WAKEUPS,
+            COMMAND_LATENCY,
+
+            // Boiler statistics, one value per window (see boiler_stats.hpp)
+            BOILER_TEMP_MEAN,
+            BOILER_TEMP_MIN,
+            BOILER_TEMP_MAX,
+            DELTA_T_MEAN,
+            DELTA_T_EWMA,
+            MODULATION_MEAN,
+            FLAME_DUTY,
+            CH_TIME,
+            DHW_TIME,
+
+            // Burner cycles, one value per hour (see burner_cycles.hpp)
+            STARTS_PER_HOUR,
+            BURN_TIME_MIN,
+            BURN_TIME_MEAN,
+            BURN_TIME_MAX,
+            OFF_TIME_MEAN,
+            SHORT_CYCLES,
+            SHORT_CYCLING,
+
+            COUNT
+        };
+
+        constexpr size_t COUNT = static_cast<size_t>(Id::COUNT);
+
+        // How the value is represented in the publish cache and on the wire
+        enum class ValueKind : uint8_t
+        {
+            BINARY, // "ON"/"OFF"
+            INT,    // "%d"
+            FLOAT,  // "%.<precision>f", cached as a scaled integer
+            TEXT    // free-form string, cached in a fixed text slot
+        };
+
+        struct Descriptor
+        {
+            Id id;
+            const char *suffix; // State topic suffix (MQTTTopics constant)
+            ValueKind kind;
+        };
+
+        constexpr Descriptor TABLE[COUNT] = {
+            {Id::FAULT, MQTTTopics::FAULT, ValueKind::BINARY},
+            {Id::CH_MODE, MQTTTopics::CH_MODE, ValueKind::BINARY},
+            {Id::DHW_MODE, MQTTTopics::DHW_MODE, ValueKind::BINARY},
+            {Id::FLAME, MQTTTopics::FLAME, ValueKind::BINARY},
+            {Id::COOLING, MQTTTopics::COOLING, ValueKind::BINARY},
+            {Id::DIAGNOSTIC, MQTTTopics::DIAGNOSTIC, ValueKind::BINARY},
+
+            {Id::CH_ENABLE, MQTTTopics::CH_ENABLE, ValueKind::BINARY},
+            {Id::DHW_ENABLE, MQTTTopics::DHW_ENABLE, ValueKind::BINARY},
+
+            {Id::BOILER_TEMP, MQTTTopics::BOILER_TEMP, ValueKind::FLOAT},
+            {Id::DHW_TEMP, MQTTTopics::DHW_TEMP, ValueKind::FLOAT},
+            {Id::RETURN_TEMP, MQTTTopics::RETURN_TEMP, ValueKind::FLOAT},
+            {Id::OUTSIDE_TEMP, MQTTTopics::OUTSIDE_TEMP, ValueKind::FLOAT},
+            {Id::ROOM_TEMP, MQTTTopics::ROOM_TEMP, ValueKind::FLOAT},
+            {Id::EXHAUST_TEMP, MQTTTopics::EXHAUST_TEMP, ValueKind::INT},
+
+            {Id::CONTROL_SETPOINT, MQTTTopics::CONTROL_SETPOINT, ValueKind::FLOAT},
+            {Id::ROOM_SETPOINT, MQTTTopics::ROOM_SETPOINT, ValueKind::FLOAT},
+            {Id::DHW_SETPOINT, MQTTTopics::DHW_SETPOINT, ValueKind::FLOAT},
+            {Id::MAX_CH_SETPOINT, MQTTTopics::MAX_CH_SETPOINT, ValueKind::FLOAT},
+
+            {Id::MODULATION, MQTTTopics::MODULATION, ValueKind::FLOAT},
+            {Id::MAX_MODULATION, MQTTTopics::MAX_MODULATION, ValueKind::FLOAT},
+            {Id::PRESSURE, MQTTTopics::PRESSURE, ValueKind::FLOAT},
+            {Id::DHW_FLOW, MQTTTopics::DHW_FLOW, ValueKind::FLOAT},
+
+            {Id::BURNER_STARTS, MQTTTopics::BURNER_STARTS, ValueKind::INT},
+            {Id::CH_PUMP_STARTS, MQTTTopics::CH_PUMP_STARTS, ValueKind::INT},
+            {Id::DHW_PUMP_STARTS, MQTTTopics::DHW_PUMP_STARTS, ValueKind::INT},
+            {Id::BURNER_HOURS, MQTTTopics::BURNER_HOURS, ValueKind::INT},
+            {Id::CH_PUMP_HOURS, MQTTTopics::CH_PUMP_HOURS, ValueKind::INT},
+            {Id::DHW_PUMP_HOURS, MQTTTopics::DHW_PUMP_HOURS, ValueKind::INT},
+
+            {Id::FAULT_CODE, MQTTTopics::FAULT_CODE, ValueKind::INT},
+            {Id::DIAGNOSTIC_CODE, MQTTTopics::DIAGNOSTIC_CODE, ValueKind::INT},
+
+            {Id::DHW_PRESENT, MQTTTopics::DHW_PRESENT, ValueKind::BINARY},
+            {Id::COOLING_SUPPORTED, MQTTTopics::COOLING_SUPPORTED, ValueKind::BINARY},
+            {Id::CH2_PRESENT, MQTTTopics::CH2_PRESENT, ValueKind::BINARY},
+
+            {Id::OPENTHERM_VERSION, MQTTTopics::OPENTHERM_VERSION, ValueKind::FLOAT},
+            {Id::DEVICE_NAME, MQTTTopics::DEVICE_NAME, ValueKind::TEXT},
+            {Id::DEVICE_ID, MQTTTopics::DEVICE_ID, ValueKind::TEXT},
+            {Id::OPENTHERM_TX_PIN, MQTTTopics::OPENTHERM_TX_PIN, ValueKind::INT},
+            {Id::OPENTHERM_RX_PIN, MQTTTopics::OPENTHERM_RX_PIN, ValueKind::INT},
+            {Id::UPDATE_INTERVAL, MQTTTopics::UPDATE_INTERVAL, ValueKind::INT},
+            {Id::FILTER, MQTTTopics::FILTER, ValueKind::TEXT},
+            {Id::POLL_TIERS, MQTTTopics::POLL_TIERS, ValueKind::TEXT},
+            {Id::STATS_WINDOW, MQTTTopics::STATS_WINDOW, ValueKind::INT},
+
+            {Id::DAY_OF_WEEK, MQTTTopics::DAY_OF_WEEK, ValueKind::TEXT},
+            {Id::TIME_OF_DAY, MQTTTopics::TIME_OF_DAY, ValueKind::TEXT},
+            {Id::DATE, MQTTTopics::DATE, ValueKind::TEXT},
+            {Id::YEAR, MQTTTopics::YEAR, ValueKind::INT},
+
+            {Id::DHW_SETPOINT_MIN, MQTTTopics::DHW_SETPOINT_MIN, ValueKind::INT},
+            {Id::DHW_SETPOINT_MAX, MQTTTopics::DHW_SETPOINT_MAX, ValueKind::INT},
+            {Id::CH_SETPOINT_MIN, MQTTTopics::CH_SETPOINT_MIN, ValueKind::INT},
+            {Id::CH_SETPOINT_MAX, MQTTTopics::CH_SETPOINT_MAX, ValueKind::INT},
+
+            {Id::WIFI_RSSI, MQTTTopics::WIFI_RSSI, ValueKind::INT},
+            {Id::WIFI_LINK_STATUS, MQTTTopics::WIFI_LINK_STATUS, ValueKind::TEXT},
+            {Id::IP_ADDRESS, MQTTTopics::IP_ADDRESS, ValueKind::TEXT},
+            {Id::WIFI_SSID, MQTTTopics::WIFI_SSID, ValueKind::TEXT},
+            {Id::UPTIME, MQTTTopics::UPTIME, ValueKind::INT},
+            {Id::FREE_HEAP, MQTTTopics::FREE_HEAP, ValueKind::INT},
+
+            {Id::MQTT_PUBLISH_ATTEMPTS, MQTTTopics::MQTT_PUBLISH_ATTEMPTS, ValueKind::INT},
+            {Id::MQTT_PUBLISH_FAILURES, MQTTTopics::MQTT_PUBLISH_FAILURES, ValueKind::INT},
+            {Id::MQTT_RECONNECT_COUNT, MQTTTopics::MQTT_RECONNECT_COUNT, ValueKind::INT},
+            {Id::MQTT_PUBLISH_RATE, MQTTTopics::MQTT_PUBLISH_RATE, ValueKind::INT},
+            {Id::MQTT_QUEUE_DEPTH, MQTTTopics::MQTT_QUEUE_DEPTH, ValueKind::INT},
+            {Id::MQTT_QUEUE_DROPS, MQTTTopics::MQTT_QUEUE_DROPS, ValueKind::INT},
+            {Id::MQTT_PRIORITY_STATS, MQTTTopics::MQTT_PRIORITY_STATS, ValueKind::TEXT},
+
+            {Id::OT_TOTAL_REQUESTS, MQTTTopics::OT_TOTAL_REQUESTS, ValueKind::INT},
+            {Id::OT_FAILED_REQUESTS, MQTTTopics::OT_FAILED_REQUESTS, ValueKind::INT},
+            {Id::OT_SUCCESS_RATE, MQTTTopics::OT_SUCCESS_RATE, ValueKind::FLOAT},
+            {Id::OT_LAST_ERROR_ENTITY, MQTTTopics::OT_LAST_ERROR_ENTITY, ValueKind::TEXT},
+            {Id::OT_TIME_SINCE_ERROR, MQTTTopics::OT_TIME_SINCE_ERROR, ValueKind::INT},
+            {Id::OT_FRAMES_PER_MINUTE, MQTTTopics::OT_FRAMES_PER_MINUTE, ValueKind::INT},
+            {Id::OT_WRITES_SAVED, MQTTTopics::OT_WRITES_SAVED, ValueKind::INT},
+
+            {Id::LOOP_WAKEUPS, MQTTTopics::LOOP_WAKEUPS, ValueKind::FLOAT},
+            {Id::COMMAND_LATENCY, MQTTTopics::COMMAND_LATENCY, ValueKind::FLOAT},
+
+            {Id::BOILER_TEMP_MEAN, MQTTTopics::BOILER_TEMP_MEAN, ValueKind::FLOAT},
+            {Id::BOILER_TEMP_MIN, MQTTTopics::BOILER_TEMP_MIN, ValueKind::FLOAT},
+            {Id::BOILER_TEMP_MAX, MQTTTopics::BOILER_TEMP_MAX, ValueKind::FLOAT},
+            {Id::DELTA_T_MEAN, MQTTTopics::DELTA_T_MEAN, ValueKind::FLOAT},
+            {Id::DELTA_T_EWMA, MQTTTopics::DELTA_T_EWMA, ValueKind::FLOAT},
+            {Id::MODULATION_MEAN, MQTTTopics::MODULATION_MEAN, ValueKind::FLOAT},
+            {Id::FLAME_DUTY, MQTTTopics::FLAME_DUTY, ValueKind::FLOAT},
+            {Id::CH_TIME, MQTTTopics::CH_TIME, ValueKind::INT},
+            {Id::DHW_TIME, MQTTTopics::DHW_TIME, ValueKind::INT},
+
+            {Id::STARTS_PER_HOUR, MQTTTopics::STARTS_PER_HOUR, ValueKind::INT},
+            {Id::BURN_TIME_MIN, MQTTTopics::BURN_TIME_MIN, ValueKind::INT},
+            {Id::BURN_TIME_MEAN, MQTTTopics::BURN_TIME_MEAN, ValueKind::INT},
+            {Id::BURN_TIME_MAX, MQTTTopics::BURN_TIME_MAX, ValueKind::INT},
+            {Id::OFF_TIME_MEAN, MQTTTopics::OFF_TIME_MEAN, ValueKind::INT},
+            {Id::SHORT_CYCLES, MQTTTopics::SHORT_CYCLES, ValueKind::INT},
+            {Id::SHORT_CYCLING, MQTTTopics::SHORT_CYCLING, ValueKind::BINARY},
+        };
+
+        constexpr size_t index(Id id)
+        {
+            return static_cast<size_t>(id);
+        }
+
+        constexpr const Descriptor &descriptor(Id id)
+        {
+            return TABLE[index(id)];
+        }
+
+        // Table rows must appear in enum order so descriptor() can index directly
+        constexpr bool tableMatchesEnum()
+        {
+            for (size_t i = 0; i < COUNT; i++)
+            {
+                if (index(TABLE[i].id) != i || TABLE[i].suffix == nullptr)
+                    return false;
+            }
+            return true;
+        }
+        static_assert(tableMatchesEnum(), "Entities::TABLE must list every Id in enum order");
+
+        // Number of TEXT entities (each needs a fixed text slot in the publish cache)
+        constexpr size_t textEntityCount()
+        {
+            size_t count = 0;
+            for (size_t i = 0; i < COUNT; i++)
+            {
+                if (TABLE[i].kind == ValueKind::TEXT)
+                    count++;
+            }
+            return count;
+        }
+
+        // Position of a TEXT entity among all TEXT entities (0-based)
+        constexpr size_t textSlot(Id id)
+        {
+            size_t slot = 0;
+            for (size_t i = 0; i < index(id); i++)
+            {
+                if (TABLE[i].kind == ValueKind::TEXT)
+                    slot++;
+            }
+            return slot;
+        }
+
+        // Look up an entity by its state topic suffix
+        inline bool findBySuffix(const char *suffix, Id *id)
+        {
+            for (size_t i = 0; i < COUNT; i++)
+            {
+                if (strcmp(TABLE[i].suffix, suffix) == 0)
+                {
+                    *id = TABLE[i].id;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    } // namespace Entities
+} // namespace OpenTherm
+
+#endif // MQTT_ENTITIES_HPP
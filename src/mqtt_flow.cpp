@@ -0,0 +1,144 @@
+#include "mqtt_flow.hpp"
+#include <cstring>
+
+namespace OpenTherm
+{
+    namespace Common
+    {
+        size_t encodePublishHeader(const char *topic, size_t payload_len, bool retain, uint8_t *buf, size_t len)
+        {
+            size_t topic_len = strlen(topic);
+            size_t remaining = 2 + topic_len + payload_len;
+            if (topic_len > 0xFFFF || remaining > 268435455) // MQTT limits
+                return 0;
+
+            uint8_t header[5];
+            size_t used = 0;
+            header[used++] = (uint8_t)(0x30 | (retain ? 0x01 : 0x00)); // PUBLISH, QoS 0
+            do
+            {
+                uint8_t byte = remaining & 0x7F;
+                remaining >>= 7;
+                header[used++] = (uint8_t)(byte | (remaining > 0 ? 0x80 : 0x00));
+            } while (remaining > 0);
+
+            if (used + 2 + topic_len > len)
+                return 0;
+            memcpy(buf, header, used);
+            buf[used++] = (uint8_t)(topic_len >> 8);
+            buf[used++] = (uint8_t)(topic_len & 0xFF);
+            memcpy(buf + used, topic, topic_len);
+            return used + topic_len;
+        }
+
+        PublishCredits::PublishCredits(uint32_t request_credits, uint32_t byte_credits)
+            : request_credits_(request_credits), byte_credits_(byte_credits),
+              acquired_msgs_(0), acquired_bytes_(0), released_msgs_(0), released_bytes_(0),
+              reset_msgs_(0), reset_bytes_(0)
+        {
+        }
+
+        uint32_t PublishCredits::inFlight() const
+        {
+            uint32_t n = acquired_msgs_.load(std::memory_order_relaxed) -
+                         released_msgs_.load(std::memory_order_acquire) - reset_msgs_;
+            return (int32_t)n < 0 ? 0 : n;
+        }
+
+        uint32_t PublishCredits::bytesInFlight() const
+        {
+            uint32_t n = acquired_bytes_.load(std::memory_order_relaxed) -
+                         released_bytes_.load(std::memory_order_acquire) - reset_bytes_;
+            return (int32_t)n < 0 ? 0 : n;
+        }
+
+        uint32_t PublishCredits::headroomPercent() const
+        {
+            uint32_t msgs = inFlight();
+            uint32_t bytes = bytesInFlight();
+            uint32_t free_msgs = msgs >= request_credits_ ? 0 : (request_credits_ - msgs) * 100 / request_credits_;
+            uint32_t free_bytes = bytes >= byte_credits_ ? 0 : (byte_credits_ - bytes) * 100 / byte_credits_;
+            return free_msgs < free_bytes ? free_msgs : free_bytes;
+        }
+
+        bool PublishCredits::available(uint32_t bytes) const
+        {
+            uint32_t msgs = inFlight();
+            bool fits = msgs < request_credits_ && bytesInFlight() + bytes <= byte_credits_;
+            return fits || (msgs == 0 && bytes > byte_credits_);
+        }
+
+        bool PublishCredits::tryAcquire(uint32_t bytes)
+        {
+            if (!available(bytes))
+                return false;
+
+            acquired_bytes_.store(acquired_bytes_.load(std::memory_order_relaxed) + bytes,
+                                  std::memory_order_relaxed);
+            acquired_msgs_.store(acquired_msgs_.load(std::memory_order_relaxed) + 1,
+                                 std::memory_order_release);
+            return true;
+        }
+
+        void PublishCredits::cancel(uint32_t bytes)
+        {
+            acquired_bytes_.store(acquired_bytes_.load(std::memory_order_relaxed) - bytes,
+                                  std::memory_order_relaxed);
+            acquired_msgs_.store(acquired_msgs_.load(std::memory_order_relaxed) - 1,
+                                 std::memory_order_release);
+        }
+
+        void PublishCredits::release(uint32_t bytes)
+        {
+            released_bytes_.store(released_bytes_.load(std::memory_order_relaxed) + bytes,
+                                  std::memory_order_relaxed);
+            released_msgs_.store(released_msgs_.load(std::memory_order_relaxed) + 1,
+                                 std::memory_order_release);
+        }
+
+        void PublishCredits::reset()
+        {
+            reset_msgs_ = acquired_msgs_.load(std::memory_order_relaxed) -
+                          released_msgs_.load(std::memory_order_acquire);
+            reset_bytes_ = acquired_bytes_.load(std::memory_order_relaxed) -
+                           released_bytes_.load(std::memory_order_acquire);
+        }
+
+        uint32_t PublishCredits::completedMessages() const
+        {
+            return released_msgs_.load(std::memory_order_acquire);
+        }
+
+        uint32_t PublishCredits::completedBytes() const
+        {
+            return released_bytes_.load(std::memory_order_acquire);
+        }
+
+        uint32_t Throughput::messagesPerSecond() const
+        {
+            return elapsed_ms == 0 ? 0 : (uint32_t)((uint64_t)messages * 1000 / elapsed_ms);
+        }
+
+        uint32_t Throughput::bytesPerSecond() const
+        {
+            return elapsed_ms == 0 ? 0 : (uint32_t)((uint64_t)bytes * 1000 / elapsed_ms);
+        }
+
+        void ThroughputMeter::start(const PublishCredits &credits, uint32_t now_ms)
+        {
+            messages_ = credits.completedMessages();
+            bytes_ = credits.completedBytes();
+            start_ms_ = now_ms;
+        }
+
+        Throughput ThroughputMeter::read(const PublishCredits &credits, uint32_t now_ms) const
+        {
+            Throughput t;
+            t.messages = credits.completedMessages() - messages_;
+            t.bytes = credits.completedBytes() - bytes_;
+            t.elapsed_ms = now_ms - start_ms_;
+            return t;
+        }
+
+    } // namespace Common
+} // namespace OpenTherm
@@ -0,0 +1,126 @@
+// Credit-based flow control for MQTT publishes
+//
+// lwIP's MQTT client holds every publish in its request list (at most
+// MQTT_REQ_MAX_IN_FLIGHT entries) and its output ring buffer
+// (MQTT_OUTPUT_RINGBUF_SIZE bytes) until TCP has sent it, then fires the
+// request callback. Each publish takes one request credit plus its wire size
+// in byte credits; the completion callback hands them back. Publishers only
+// wait when credits run out instead of sleeping after every message.
+//
+// The publisher (core 0) only writes the acquired_* counters and the lwIP
+// callback (core 1) only writes the released_* counters, so plain atomic
+// loads/stores are enough - no read-modify-write, which the M0+ lacks.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef MQTT_FLOW_HPP
+#define MQTT_FLOW_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace OpenTherm
+{
+    namespace Common
+    {
+        // Defaults matching lwipopts.h
+        constexpr uint32_t DEFAULT_REQUEST_CREDITS = 8;  // MQTT_REQ_MAX_IN_FLIGHT
+        constexpr uint32_t DEFAULT_BYTE_CREDITS = 2560;  // MQTT_OUTPUT_RINGBUF_SIZE
+
+        // Size of a PUBLISH packet on the wire: fixed header, remaining-length
+        // varint, topic length + topic, packet id (QoS > 0) and payload
+        constexpr uint32_t publishWireSize(size_t topic_len, size_t payload_len, uint8_t qos)
+        {
+            uint32_t remaining = (uint32_t)(2 + topic_len + payload_len + (qos > 0 ? 2 : 0));
+
+            uint32_t length_bytes = 1;
+            for (uint32_t n = remaining; n >= 128; n >>= 7)
+                length_bytes++;
+
+            return 1 + length_bytes + remaining;
+        }
+
+        // Encode the part of a QoS 0 PUBLISH that precedes the payload (fixed
+        // header, remaining length, topic) for messages written straight to the
+        // connection; returns its length, or 0 if it does not fit `len`
+        size_t encodePublishHeader(const char *topic, size_t payload_len, bool retain, uint8_t *buf, size_t len);
+
+        class PublishCredits
+        {
+        public:
+            PublishCredits(uint32_t request_credits = DEFAULT_REQUEST_CREDITS,
+                           uint32_t byte_credits = DEFAULT_BYTE_CREDITS);
+
+            // Publisher side: take one request and `bytes` byte credits, or return
+            // false if either is exhausted. A message larger than the whole ring
+            // is let through when nothing is in flight so lwIP can reject it
+            // rather than stalling forever.
+            bool tryAcquire(uint32_t bytes);
+
+            // Would tryAcquire(bytes) succeed right now?
+            bool available(uint32_t bytes) const;
+
+            // Publisher side: undo tryAcquire() when lwIP refused the message
+            void cancel(uint32_t bytes);
+
+            // Completion side: hand back credits taken by tryAcquire()
+            void release(uint32_t bytes);
+
+            // Connection dropped: lwIP frees its requests without calling back
+            void reset();
+
+            uint32_t inFlight() const;
+            uint32_t bytesInFlight() const;
+
+            // Free share of the scarcer credit (requests or bytes), 0-100
+            uint32_t headroomPercent() const;
+            bool idle() const { return inFlight() == 0; }
+
+            uint32_t requestCredits() const { return request_credits_; }
+            uint32_t byteCredits() const { return byte_credits_; }
+
+            // Monotonic totals of completed publishes (for throughput)
+            uint32_t completedMessages() const;
+            uint32_t completedBytes() const;
+
+        private:
+            uint32_t request_credits_;
+            uint32_t byte_credits_;
+            std::atomic<uint32_t> acquired_msgs_;
+            std::atomic<uint32_t> acquired_bytes_;
+            std::atomic<uint32_t> released_msgs_;
+            std::atomic<uint32_t> released_bytes_;
+            uint32_t reset_msgs_;  // Released-equivalent offset after reset()
+            uint32_t reset_bytes_;
+        };
+
+        struct Throughput
+        {
+            uint32_t messages;
+            uint32_t bytes;
+            uint32_t elapsed_ms;
+
+            uint32_t messagesPerSecond() const;
+            uint32_t bytesPerSecond() const;
+        };
+
+        // Measures completed publishes between two points in time, e.g. across
+        // the discovery burst or over a reporting window
+        class ThroughputMeter
+        {
+        public:
+            ThroughputMeter() : messages_(0), bytes_(0), start_ms_(0) {}
+
+            void start(const PublishCredits &credits, uint32_t now_ms);
+            Throughput read(const PublishCredits &credits, uint32_t now_ms) const;
+
+        private:
+            uint32_t messages_;
+            uint32_t bytes_;
+            uint32_t start_ms_;
+        };
+
+    } // namespace Common
+} // namespace OpenTherm
+
+#endif // MQTT_FLOW_HPP
@@ -1,120 +1,565 @@
 #include "mqtt_publish.hpp"
+#include "config.hpp"
 #include "mqtt_common.hpp"
-#include <unordered_map>
-#include <string>
+#include "offline_buffer.hpp"
+#include "publish_cache.hpp"
+#include "publish_filter.hpp"
+#include "publish_queue.hpp"
+#include "state_document.hpp"
+#include "time_series.hpp"
+#include "topic_arena.hpp"
 #include <cstdio>
+#include <cstring>
 #include "pico/time.h"
 
 namespace OpenTherm
 {
     namespace Publish
     {
-        static std::unordered_map<std::string, std::string> g_last_published;
-        static uint32_t last_cache_clear = 0;
-        constexpr uint32_t CACHE_CLEAR_INTERVAL_MS = 86400000; // 24 hours
+        static MQTTTopics::TopicArena g_topics;
+        static StateCache g_state_cache(&OpenTherm::Common::mqtt_publish_wrapper);
+        static FilterBank g_filters;
+        static char g_filter_overrides[FILTER_OVERRIDES_LEN]; // Saved form of g_filters
+        static PublishQueue g_queue;
 
-        // Check if cache needs clearing (called periodically from publish functions)
-        static void checkCacheClear()
+        // Cached values whose publish may still fail on the network core
+        static SentLog g_sent;
+        static_assert(SentLog::SLOTS >= Common::DEFAULT_REQUEST_CREDITS,
+                      "SentLog must cover every publish that can be in flight");
+
+        // Refresh after Home Assistant's birth message: cached values are re-sent a
+        // batch at a time, behind the queue, so the refresh never bursts
+        static uint32_t g_last_refresh_ms = 0;
+        constexpr size_t REFRESH_BATCH = 8;
+        constexpr uint32_t REFRESH_INTERVAL_MS = 100; // Every entity in about a second
+
+        // Changes recorded while MQTT is down, replayed on the history topic after
+        // reconnecting, a batch at a time behind the live state
+        static OfflineBuffer g_offline;
+        static char g_history_payload[1024]; // Also holds time-series chunks
+        static uint32_t g_last_history_ms = 0;
+        constexpr uint32_t HISTORY_INTERVAL_MS = 100;
+
+        // Once-a-second history of the cycling signals; a requested window goes
+        // out in chunks on the time-series topic, paced like the offline replay
+        static TimeSeries g_series;
+        static bool g_series_requested = false;
+        static uint32_t g_series_from_s = 0;
+        static uint32_t g_series_to_s = 0;
+        static uint32_t g_last_series_ms = 0;
+
+        // Hot start snapshot of g_state_cache; the buffer is static, it is too big for the stack
+        static uint8_t g_snapshot[StateCache::SNAPSHOT_LEN];
+        static bool g_snapshot_restore_tried = false;
+        static uint32_t g_snapshot_changes = 0; // g_state_cache.changes() at the last save or restore
+        static uint32_t g_last_snapshot_ms = 0;
+
+        // Aggregated mode: every value goes into one JSON document instead of the queue
+        static StateDocument g_document;
+        static bool g_aggregate_state = false;
+        static char g_document_payload[StateDocument::DOCUMENT_LEN];
+
+        // Whatever build() renders goes out as one publish, so the largest
+        // document must fit both a network-queue record and lwIP's output ring
+        static_assert(Common::NetRequestQueue::recordSize(StateDocument::TOPIC_LEN, StateDocument::DOCUMENT_LEN) <=
+                          Common::NetRequestQueue::MAX_RECORD,
+                      "State document does not fit a network-queue record");
+        static_assert(Common::publishWireSize(StateDocument::TOPIC_LEN, StateDocument::DOCUMENT_LEN, 0) <=
+                          Common::DEFAULT_BYTE_CREDITS,
+                      "State document does not fit lwIP's MQTT output ring");
+        static uint32_t g_last_document_ms = 0;
+        static uint32_t g_document_token = 0;
+        static bool g_document_in_flight = false; // g_document_token may still fail
+        constexpr uint32_t STATE_DOCUMENT_INTERVAL_MS = 1000; // A poll pass collapses into one message
+
+        // The cache and the filters recorded the value when it was queued; forget
+        // it so the next reading of the entity goes out again
+        static void forgetValue(Entities::Id id)
         {
-            uint32_t now = to_ms_since_boot(get_absolute_time());
-            if (now - last_cache_clear >= CACHE_CLEAR_INTERVAL_MS)
+            g_state_cache.invalidate(id);
+            g_filters.forgetPublished(id);
+        }
+
+        static void onPublishFailed(uint32_t token, bool all)
+        {
+            Entities::Id id;
+            if (all)
             {
-                printf("Clearing last published cache (%zu entries)\n", g_last_published.size());
-                g_last_published.clear();
-                last_cache_clear = now;
+                while (g_sent.takeAny(&id))
+                    forgetValue(id);
+                if (g_document_in_flight)
+                    g_document.markDirty();
+                g_document_in_flight = false;
+                return;
+            }
+            if (g_sent.take(token, &id))
+            {
+                forgetValue(id);
+            }
+            else if (g_document_in_flight && token == g_document_token)
+            {
+                g_document.markDirty();
+                g_document_in_flight = false;
             }
         }
 
-        static void formatFloat(char *buf, size_t len, float value, int precision)
+        bool buildTopics(const HomeAssistant::Config &cfg)
         {
-            char fmt[8];
-            snprintf(fmt, sizeof(fmt), "%%.%df", precision);
-            snprintf(buf, len, fmt, value);
+            OpenTherm::Common::mqtt_set_publish_failed_hook(&onPublishFailed);
+
+            uint32_t builds = g_topics.builds();
+            if (!g_topics.build(cfg))
+                return false;
+            if (g_topics.builds() != builds)
+                printf("MQTT topics rendered: %zu of %zu arena bytes\n", g_topics.used(), MQTTTopics::TopicArena::ARENA_LEN);
+            g_state_cache.setTopics(&g_topics);
+            return true;
         }
 
-        bool publishFloatIfChanged(const std::string &topic, float value, int precision, bool retain)
+        const MQTTTopics::TopicArena &topics()
         {
-            checkCacheClear();
-            char payload[32];
-            formatFloat(payload, sizeof(payload), value, precision);
-            auto it = g_last_published.find(topic);
-            if (it != g_last_published.end() && it->second == payload)
-                return true; // nothing to do
-            if (OpenTherm::Common::mqtt_publish_wrapper(topic.c_str(), payload, retain))
+            return g_topics;
+        }
+
+        void setAggregatedState(bool enabled)
+        {
+            g_aggregate_state = enabled;
+            if (enabled)
+                printf("State format: one JSON document on %s\n", g_topics.stateDocument());
+        }
+
+        // Control state and temperatures get a history while offline; counters,
+        // diagnostics and text do not
+        static bool keepsHistory(Entities::Id id)
+        {
+            return !OpenTherm::Common::mqtt_connected() && priorityOf(id) < Priority::COUNTER;
+        }
+
+        static uint32_t uptimeSeconds()
+        {
+            return to_ms_since_boot(get_absolute_time()) / 1000;
+        }
+
+        bool publishFloatIfChanged(Entities::Id id, float value, int precision, bool retain)
+        {
+            uint32_t now = to_ms_since_boot(get_absolute_time());
+            g_series.set(id, value); // Unfiltered: the history is for diagnosis
+            float filtered;
+            FilterDecision decision = g_filters.process(id, value, now, &filtered);
+            if (decision == FilterDecision::HOLD)
+                return true; // Inside the deadband
+            if (keepsHistory(id))
+                g_offline.recordFloat(id, filtered, precision, now / 1000);
+
+            if (g_aggregate_state)
             {
-                g_last_published[topic] = payload;
+                if (decision == FilterDecision::REFRESH)
+                    g_document.markDirty();
+                g_document.setFloat(id, filtered, precision);
+                g_filters.published(id, filtered, now);
                 return true;
             }
-            return false;
+
+            if (decision == FilterDecision::REFRESH)
+                g_state_cache.invalidate(id); // Max silence expired - publish even if unchanged
+
+            if (!g_queue.pushFloat(id, filtered, precision, retain))
+                return false;
+            g_filters.published(id, filtered, now);
+            return true;
         }
 
-        bool publishIntIfChanged(const std::string &topic, int value, bool retain)
+        bool publishIntIfChanged(Entities::Id id, int32_t value, bool retain)
         {
-            checkCacheClear();
-            char payload[32];
-            snprintf(payload, sizeof(payload), "%d", value);
-            auto it = g_last_published.find(topic);
-            if (it != g_last_published.end() && it->second == payload)
-                return true;
-            if (OpenTherm::Common::mqtt_publish_wrapper(topic.c_str(), payload, retain))
+            if (keepsHistory(id))
+                g_offline.recordInt(id, value, uptimeSeconds());
+            if (g_aggregate_state)
             {
-                g_last_published[topic] = payload;
+                g_document.setInt(id, value);
                 return true;
             }
-            return false;
+            return g_queue.pushInt(id, value, retain);
         }
 
-        bool publishStringIfChanged(const std::string &topic, const std::string &value, bool retain)
+        bool publishStringIfChanged(Entities::Id id, const char *value, bool retain)
         {
-            checkCacheClear();
-            auto it = g_last_published.find(topic);
-            if (it != g_last_published.end() && it->second == value)
-                return true;
-            if (OpenTherm::Common::mqtt_publish_wrapper(topic.c_str(), value.c_str(), retain))
+            if (g_aggregate_state)
             {
-                g_last_published[topic] = value;
+                if (!g_document.setText(id, value))
+                {
+                    printf("WARNING: %s does not fit the state document\n", Entities::descriptor(id).suffix);
+                    return false;
+                }
                 return true;
             }
-            return false;
+            if (PublishQueue::canQueueText(id, value))
+                return g_queue.pushText(id, value, retain);
+            // Too long to queue - publish it straight away, uncached
+            return g_state_cache.publishText(id, value, retain);
         }
 
-        bool publishBinaryIfChanged(const std::string &topic, bool value, bool retain)
+        bool publishBinaryIfChanged(Entities::Id id, bool value, bool retain)
         {
-            checkCacheClear();
-            const char *payload = value ? "ON" : "OFF";
-            auto it = g_last_published.find(topic);
-            if (it != g_last_published.end() && it->second == payload)
-                return true;
-            if (OpenTherm::Common::mqtt_publish_wrapper(topic.c_str(), payload, retain))
+            g_series.set(id, value ? 1.0f : 0.0f);
+            if (keepsHistory(id))
+                g_offline.recordBinary(id, value, uptimeSeconds());
+            if (g_aggregate_state)
             {
-                g_last_published[topic] = payload;
+                g_document.setBinary(id, value);
                 return true;
             }
-            return false;
+            return g_queue.pushBinary(id, value, retain);
+        }
+
+        // Worst-case wire size of one state message, so a drained record never waits on credits
+        static const uint32_t MAX_STATE_MESSAGE =
+            OpenTherm::Common::publishWireSize(StateCache::TOPIC_LEN, StateCache::TEXT_LEN, 0);
+
+        static bool publishQueued(Entities::Id id, const QueuedValue &value)
+        {
+            if (!OpenTherm::Common::mqtt_publish_ready(MAX_STATE_MESSAGE))
+                return false;
+
+            // A failed publish is not retried from here: the cache keeps no copy of it,
+            // so the next poll of the entity publishes it again. One that fails after
+            // it was queued is forgotten by onPublishFailed() for the same effect.
+            uint32_t token = OpenTherm::Common::mqtt_last_publish_token();
+            switch (value.kind)
+            {
+            case Entities::ValueKind::BINARY:
+                g_state_cache.publishBinary(id, value.binary, value.retain);
+                break;
+            case Entities::ValueKind::INT:
+                g_state_cache.publishInt(id, value.integer, value.retain);
+                break;
+            case Entities::ValueKind::FLOAT:
+                g_state_cache.publishFloat(id, value.real, value.precision, value.retain);
+                break;
+            case Entities::ValueKind::TEXT:
+                g_state_cache.publishText(id, value.text, value.retain);
+                break;
+            }
+            if (OpenTherm::Common::mqtt_last_publish_token() != token)
+                g_sent.sent(OpenTherm::Common::mqtt_last_publish_token(), id);
+            return true;
+        }
+
+        static uint32_t creditHeadroom()
+        {
+            return OpenTherm::Common::g_publish_credits.headroomPercent();
+        }
+
+        // Send the document if it changed; `force` skips the rate limit. Like the
+        // queue drain it never waits for credits.
+        static bool publishDocument(bool force)
+        {
+            uint32_t now = to_ms_since_boot(get_absolute_time());
+            if (!g_document.dirty() || (!force && now - g_last_document_ms < STATE_DOCUMENT_INTERVAL_MS))
+                return false;
+
+            size_t len = g_document.build(g_document_payload, sizeof(g_document_payload));
+            if (len == 0)
+            {
+                printf("ERROR: State document does not fit %zu bytes\n", sizeof(g_document_payload));
+                g_document.markSent(); // Wait for the next change rather than retrying every call
+                return false;
+            }
+
+            uint32_t wire_size = OpenTherm::Common::publishWireSize(strlen(g_topics.stateDocument()), len, 0);
+            if (!OpenTherm::Common::mqtt_publish_ready(wire_size))
+                return false;
+
+            if (!OpenTherm::Common::mqtt_publish_wrapper(g_topics.stateDocument(), g_document_payload, true))
+                return false;
+            g_document_token = OpenTherm::Common::mqtt_last_publish_token();
+            g_document_in_flight = true;
+            g_document.markSent();
+            g_last_document_ms = now;
+            return true;
+        }
+
+        // One batch of a refresh, once the queue is empty and the pacing interval is up
+        static size_t refreshBatch()
+        {
+            uint32_t now = to_ms_since_boot(get_absolute_time());
+            if (!g_state_cache.refreshing() || g_queue.depth() > 0 || now - g_last_refresh_ms < REFRESH_INTERVAL_MS)
+                return 0;
+
+            g_last_refresh_ms = now; // Even if credits cut the batch short, so msUntilDue() never spins
+            size_t sent = 0;
+            while (sent < REFRESH_BATCH && OpenTherm::Common::mqtt_publish_ready(MAX_STATE_MESSAGE) &&
+                   g_state_cache.refreshStep())
+            {
+                sent++;
+            }
+            if (!g_state_cache.refreshing())
+                printf("State refresh complete\n");
+            return sent;
+        }
+
+        // One batch of offline history, once the live state has gone out
+        static size_t replayHistory()
+        {
+            uint32_t now = to_ms_since_boot(get_absolute_time());
+            if (g_offline.size() == 0 || !OpenTherm::Common::mqtt_connected() || g_queue.depth() > 0 ||
+                now - g_last_history_ms < HISTORY_INTERVAL_MS)
+                return 0;
+            g_last_history_ms = now; // Also when credits are short, so msUntilDue() never spins
+
+            size_t records;
+            size_t len = g_offline.formatBatch(g_history_payload, sizeof(g_history_payload), now / 1000, &records);
+            if (len == 0)
+                return 0;
+            uint32_t wire_size = OpenTherm::Common::publishWireSize(strlen(g_topics.history()), len, 0);
+            if (!OpenTherm::Common::mqtt_publish_ready(wire_size))
+                return 0;
+            if (!OpenTherm::Common::mqtt_publish_wrapper(g_topics.history(), g_history_payload, false))
+                return 0; // Still in the ring; the next batch retries it
+
+            g_offline.consume(records);
+            printf("Replayed %zu offline values (%zu left, %lu dropped in total)\n", records, g_offline.size(),
+                   (unsigned long)g_offline.dropped());
+            if (g_offline.size() == 0)
+                g_offline.endOutage();
+            return 1;
+        }
+
+        void sampleTimeSeries(uint32_t now_ms)
+        {
+            g_series.sample(now_ms / 1000);
+        }
+
+        void requestTimeSeries(uint32_t from_s, uint32_t to_s)
+        {
+            if (g_series.empty() || from_s > g_series.newest())
+            {
+                printf("Time series: nothing recorded in %lu..%lu\n", (unsigned long)from_s, (unsigned long)to_s);
+                return;
+            }
+            // Stop at what is recorded now, so the reply never chases the live samples
+            if (to_s > g_series.newest())
+                to_s = g_series.newest();
+            g_series_from_s = from_s;
+            g_series_to_s = to_s;
+            g_series_requested = true;
+            printf("Time series: sending %lu..%lu (%zu bytes held from %lu)\n", (unsigned long)from_s,
+                   (unsigned long)to_s, g_series.bytesUsed(), (unsigned long)g_series.oldest());
+        }
+
+        // One chunk of a requested time-series window, once the live state and
+        // the offline history have gone out
+        static size_t sendTimeSeries()
+        {
+            uint32_t now = to_ms_since_boot(get_absolute_time());
+            if (!g_series_requested || !OpenTherm::Common::mqtt_connected() || g_queue.depth() > 0 ||
+                g_offline.size() > 0 || now - g_last_series_ms < HISTORY_INTERVAL_MS)
+                return 0;
+            g_last_series_ms = now; // Also when credits are short, so msUntilDue() never spins
+
+            uint32_t next_s;
+            size_t len = g_series.formatWindow(g_history_payload, sizeof(g_history_payload), g_series_from_s,
+                                               g_series_to_s, now / 1000, &next_s);
+            if (len == 0)
+            {
+                g_series_requested = false; // Evicted from the ring meanwhile
+                return 0;
+            }
+            uint32_t wire_size = OpenTherm::Common::publishWireSize(strlen(g_topics.timeSeries()), len, 0);
+            if (!OpenTherm::Common::mqtt_publish_ready(wire_size))
+                return 0;
+            if (!OpenTherm::Common::mqtt_publish_wrapper(g_topics.timeSeries(), g_history_payload, false))
+                return 0; // The next chunk retries it
+
+            g_series_from_s = next_s;
+            if (next_s > g_series_to_s)
+            {
+                g_series_requested = false;
+                printf("Time series: window sent\n");
+            }
+            return 1;
+        }
+
+        size_t drainQueue()
+        {
+            if (g_aggregate_state)
+                return (publishDocument(false) ? 1 : 0) + replayHistory() + sendTimeSeries();
+            size_t handled = g_queue.drain(&publishQueued, &creditHeadroom);
+            return handled + refreshBatch() + replayHistory() + sendTimeSeries();
+        }
+
+        uint32_t msUntilDue(uint32_t now_ms)
+        {
+            if (g_aggregate_state && g_document.dirty())
+            {
+                uint32_t since = now_ms - g_last_document_ms;
+                if (since < STATE_DOCUMENT_INTERVAL_MS)
+                    return STATE_DOCUMENT_INTERVAL_MS - since;
+            }
+            if (!g_aggregate_state && g_state_cache.refreshing())
+            {
+                uint32_t since = now_ms - g_last_refresh_ms;
+                return since < REFRESH_INTERVAL_MS ? REFRESH_INTERVAL_MS - since : 0;
+            }
+            if (g_offline.size() > 0 && OpenTherm::Common::mqtt_connected())
+            {
+                uint32_t since = now_ms - g_last_history_ms;
+                return since < HISTORY_INTERVAL_MS ? HISTORY_INTERVAL_MS - since : 0;
+            }
+            if (g_series_requested && OpenTherm::Common::mqtt_connected())
+            {
+                uint32_t since = now_ms - g_last_series_ms;
+                return since < HISTORY_INTERVAL_MS ? HISTORY_INTERVAL_MS - since : 0;
+            }
+            return UINT32_MAX;
+        }
+
+        void flushQueue(uint32_t timeout_ms)
+        {
+            uint32_t start = to_ms_since_boot(get_absolute_time());
+            while (g_aggregate_state && g_document.dirty() && OpenTherm::Common::mqtt_connected())
+            {
+                if (to_ms_since_boot(get_absolute_time()) - start >= timeout_ms)
+                {
+                    printf("State document flush timed out\n");
+                    return;
+                }
+                if (!publishDocument(true))
+                    sleep_us(OpenTherm::Common::CREDIT_POLL_US);
+            }
+            while (g_queue.depth() > 0 && OpenTherm::Common::mqtt_connected())
+            {
+                if (to_ms_since_boot(get_absolute_time()) - start >= timeout_ms)
+                {
+                    printf("Publish queue flush timed out with %zu records left\n", g_queue.depth());
+                    return;
+                }
+                if (g_queue.drain(&publishQueued) == 0)
+                    sleep_us(OpenTherm::Common::CREDIT_POLL_US);
+            }
+        }
+
+        QueueStats takeQueueStats()
+        {
+            QueueStats stats;
+            stats.depth = (uint32_t)g_queue.depth();
+            stats.high_water = (uint32_t)g_queue.takeHighWater();
+            stats.coalesced = g_queue.coalesced();
+            stats.dropped = g_queue.dropped();
+            return stats;
+        }
+
+        size_t formatQueuePriorityStats(char *buf, size_t len)
+        {
+            return formatPriorityStats(g_queue, buf, len);
         }
 
         void clearAllCaches()
         {
-            printf("Manually clearing all publish caches (%zu entries)\n", g_last_published.size());
-            g_last_published.clear();
-            last_cache_clear = to_ms_since_boot(get_absolute_time());
+            printf("Manually clearing all publish caches (%zu entries)\n", g_state_cache.entryCount());
+            g_state_cache.clear();
+            g_filters.forgetPublished();
+            g_document.markDirty();
+        }
+
+        void refreshState()
+        {
+            if (g_aggregate_state)
+            {
+                g_document.markDirty(); // Goes out at the next rate-limit tick
+                return;
+            }
+            printf("Refreshing %zu cached state values\n", g_state_cache.entryCount());
+            g_state_cache.beginRefresh();
         }
 
         void republishAllCached()
         {
-            printf("Republishing all cached values (%zu entries) without reading from boiler...\n", g_last_published.size());
+            if (g_aggregate_state)
+            {
+                printf("Republishing state document (%zu values) without reading from boiler...\n", g_document.entryCount());
+                g_document.markDirty();
+                flushQueue(OpenTherm::Common::CREDIT_WAIT_TIMEOUT_MS);
+                return;
+            }
+
+            printf("Republishing all cached values (%zu entries) without reading from boiler...\n", g_state_cache.entryCount());
+            size_t sent = g_state_cache.republishAll();
+            printf("Republished %zu cached values\n", sent);
+        }
+
+        bool restoreSnapshot()
+        {
+            if (g_snapshot_restore_tried)
+                return false;
+            g_snapshot_restore_tried = true;
+            g_last_snapshot_ms = to_ms_since_boot(get_absolute_time());
 
-            // Iterate through all cached values and republish them
-            for (const auto &entry : g_last_published)
+            size_t len = 0;
+            if (!Config::getStateSnapshot(g_snapshot, sizeof(g_snapshot), &len))
             {
-                const std::string &topic = entry.first;
-                const std::string &payload = entry.second;
+                printf("No state snapshot stored - first cycle publishes everything\n");
+                return false;
+            }
+            if (!g_state_cache.loadSnapshot(g_snapshot, len))
+            {
+                printf("State snapshot rejected (%zu bytes: version, topics or CRC mismatch)\n", len);
+                return false;
+            }
+            size_t tentative = g_state_cache.invalidateIf(&restoresTentatively);
+            g_snapshot_changes = g_state_cache.changes();
+            printf("State snapshot restored: %zu values from %zu bytes (%zu control values dropped)\n",
+                   g_state_cache.entryCount(), len, tentative);
+            return true;
+        }
+
+        void restoreFilters()
+        {
+            if (!Config::getPublishFilters(g_filter_overrides, sizeof(g_filter_overrides)))
+                return;
+            size_t applied = applyFilterOverrides(g_filter_overrides, g_filters);
+            if (applied > 0)
+                printf("Publish filters restored: %zu changed from the defaults\n", applied);
+        }
 
-                // Republish without updating cache (since it's already the same value)
-                OpenTherm::Common::mqtt_publish_wrapper(topic.c_str(), payload.c_str(), false);
+        bool saveSnapshot(bool now)
+        {
+            uint32_t ms = to_ms_since_boot(get_absolute_time());
+            if (g_state_cache.changes() == g_snapshot_changes)
+                return false; // Flash already holds this
+            if (!now && ms - g_last_snapshot_ms < SNAPSHOT_INTERVAL_MS)
+                return false;
+            g_last_snapshot_ms = ms; // Also after a failure, so a broken store is not retried every pass
+
+            size_t len = g_state_cache.saveSnapshot(g_snapshot, sizeof(g_snapshot));
+            if (len == 0 || !Config::setStateSnapshot(g_snapshot, len))
+            {
+                printf("ERROR: Failed to save state snapshot (%zu bytes)\n", len);
+                return false;
             }
+            g_snapshot_changes = g_state_cache.changes();
+            printf("State snapshot saved: %zu values in %zu bytes\n", g_state_cache.entryCount(), len);
+            return true;
+        }
 
-            printf("Republished %zu cached values\n", g_last_published.size());
+        bool configureFilter(const char *command, char *applied, size_t applied_len)
+        {
+            Entities::Id id;
+            FilterConfig config;
+            if (!parseFilterCommand(command, g_filters, &id, &config))
+                return false;
+
+            FilterConfig previous = g_filters.config(id);
+            g_filters.setConfig(id, config);
+            if (!formatFilterOverrides(g_filters, g_filter_overrides, sizeof(g_filter_overrides)) ||
+                !Config::setPublishFilters(g_filter_overrides))
+            {
+                printf("ERROR: Failed to save publish filters - keeping the previous filter\n");
+                g_filters.setConfig(id, previous);
+                return false;
+            }
+            formatFilterConfig(id, g_filters.config(id), applied, applied_len);
+            printf("Publish filter updated: %s\n", applied);
+            return true;
         }
     }
 }
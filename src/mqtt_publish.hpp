@@ -1,18 +1,105 @@
 #ifndef MQTT_PUBLISH_HPP
 #define MQTT_PUBLISH_HPP
 
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include "mqtt_entities.hpp"
 
 namespace OpenTherm
 {
+    namespace HomeAssistant
+    {
+        struct Config;
+    }
+
+    namespace MQTTTopics
+    {
+        class TopicArena;
+    }
+
     namespace Publish
     {
-        bool publishFloatIfChanged(const std::string &topic, float value, int precision = 2, bool retain = false);
-        bool publishIntIfChanged(const std::string &topic, int value, bool retain = false);
-        bool publishStringIfChanged(const std::string &topic, const std::string &value, bool retain = false);
-        bool publishBinaryIfChanged(const std::string &topic, bool value, bool retain = false);
+        // Render every MQTT topic for `cfg` into the shared topic arena (see
+        // topic_arena.hpp); a no-op unless the device id or a prefix changed
+        bool buildTopics(const HomeAssistant::Config &cfg);
+
+        // The shared topic arena: state, command and discovery topics
+        const MQTTTopics::TopicArena &topics();
+
+        // Aggregated mode: collect values into one JSON document (see state_document.hpp)
+        // published on "<topic_base>/<device_id>/<state_topic_base>" at most once a second,
+        // instead of a message per value
+        void setAggregatedState(bool enabled);
+
+        // Queue a state value for publishing; returns immediately. Values go out
+        // (if changed) when drainQueue() finds MQTT flow-control credits.
+        bool publishFloatIfChanged(Entities::Id id, float value, int precision = 2, bool retain = false);
+        bool publishIntIfChanged(Entities::Id id, int32_t value, bool retain = false);
+        bool publishStringIfChanged(Entities::Id id, const char *value, bool retain = false);
+        bool publishBinaryIfChanged(Entities::Id id, bool value, bool retain = false);
+
+        // Publish queued values, control state first, while credits last and without
+        // waiting; lower priority classes keep a credit reserve free. Returns the number handled.
+        size_t drainQueue();
+
+        // Milliseconds until drainQueue() has work that no network event will
+        // announce: the state document's rate limit running out. Records waiting
+        // for credits are not counted - the credits come back with a completion,
+        // which wakes the main loop. UINT32_MAX if nothing is due.
+        uint32_t msUntilDue(uint32_t now_ms);
+
+        // On-device history of flow/return temperature, modulation, flame and the
+        // control setpoint (see time_series.hpp). sampleTimeSeries() records the
+        // current second; the main loop wakes at least every MAIN_LOOP_MAX_IDLE_MS.
+        void sampleTimeSeries(uint32_t now_ms);
+
+        // Send a window of the history (uptime seconds) on
+        // "<topic_base>/<device_id>/timeseries", a chunk at a time from drainQueue()
+        // once the queue is empty. Replaces a window still being sent.
+        void requestTimeSeries(uint32_t from_s, uint32_t to_s);
+
+        // Publish everything queued (or the pending state document), waiting for credits
+        // (e.g. before a restart)
+        void flushQueue(uint32_t timeout_ms);
+
+        struct QueueStats
+        {
+            uint32_t depth;      // Records waiting now
+            uint32_t high_water; // Deepest since the previous takeQueueStats()
+            uint32_t coalesced;  // Values replaced by a newer one before they were sent
+            uint32_t dropped;    // Values shed because the queue was full
+        };
+        QueueStats takeQueueStats();
+
+        // Deferred/shed counts per priority class (see publish_queue.hpp)
+        size_t formatQueuePriorityStats(char *buf, size_t len);
+
         void clearAllCaches(); // Clear cache to force republish of all values on next update
         void republishAllCached(); // Republish all currently cached values without reading from boiler
+
+        // Re-send every cached value, paced by drainQueue() behind the queue, e.g.
+        // after Home Assistant announced a restart. States are retained, so this is
+        // only needed when the broker lost them too.
+        void refreshState();
+
+        // Hot start: the publish cache is saved to flash (Config::KEY_STATE_SNAPSHOT)
+        // and restored after a reboot, so the first poll cycle only publishes values
+        // that changed meanwhile. restoreSnapshot() acts once per boot and needs
+        // buildTopics() first. saveSnapshot() writes only if the cache changed, and
+        // at most every SNAPSHOT_INTERVAL_MS unless `now` is set (before a restart).
+        constexpr uint32_t SNAPSHOT_INTERVAL_MS = 1800000; // 30 minutes: ~48 flash writes a day
+        bool restoreSnapshot();
+        bool saveSnapshot(bool now);
+
+        // Apply a filter command from Home Assistant (see publish_filter.hpp for the syntax).
+        // On success the resulting config is written to `applied` for echoing back.
+        // Configs that differ from the defaults are saved to flash
+        // (Config::KEY_PUBLISH_FILTERS); a command whose result cannot be saved is undone.
+        constexpr size_t FILTER_OVERRIDES_LEN = 1024;
+        bool configureFilter(const char *command, char *applied, size_t applied_len);
+
+        // Apply the filter configs saved by configureFilter(); called once at startup
+        void restoreFilters();
     }
 }
 
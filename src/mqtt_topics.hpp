@@ -91,6 +91,10 @@ namespace OpenTherm
         constexpr const char *MQTT_PUBLISH_ATTEMPTS = "mqtt_publish_attempts";
         constexpr const char *MQTT_PUBLISH_FAILURES = "mqtt_publish_failures";
         constexpr const char *MQTT_RECONNECT_COUNT = "mqtt_reconnect_count";
+        constexpr const char *MQTT_PUBLISH_RATE = "mqtt_publish_rate";
+        constexpr const char *MQTT_QUEUE_DEPTH = "mqtt_queue_depth";
+        constexpr const char *MQTT_QUEUE_DROPS = "mqtt_queue_drops";
+        constexpr const char *MQTT_PRIORITY_STATS = "mqtt_priority_stats";
 
         // OpenTherm operation metrics
         constexpr const char *OT_TOTAL_REQUESTS = "ot_total_requests";
@@ -98,9 +102,48 @@ namespace OpenTherm
         constexpr const char *OT_SUCCESS_RATE = "ot_success_rate";
         constexpr const char *OT_LAST_ERROR_ENTITY = "ot_last_error_entity";
         constexpr const char *OT_TIME_SINCE_ERROR = "ot_time_since_error";
+        constexpr const char *OT_FRAMES_PER_MINUTE = "ot_frames_per_minute";
+        constexpr const char *OT_WRITES_SAVED = "ot_writes_saved";
+
+        // Main loop metrics
+        constexpr const char *LOOP_WAKEUPS = "loop_wakeups";
+        constexpr const char *COMMAND_LATENCY = "command_latency";
+
+        // Boiler statistics (one value per statistics window)
+        constexpr const char *BOILER_TEMP_MEAN = "boiler_temp_mean";
+        constexpr const char *BOILER_TEMP_MIN = "boiler_temp_min";
+        constexpr const char *BOILER_TEMP_MAX = "boiler_temp_max";
+        constexpr const char *DELTA_T_MEAN = "delta_t_mean";
+        constexpr const char *DELTA_T_EWMA = "delta_t_ewma";
+        constexpr const char *MODULATION_MEAN = "modulation_mean";
+        constexpr const char *FLAME_DUTY = "flame_duty";
+        constexpr const char *CH_TIME = "ch_time";
+        constexpr const char *DHW_TIME = "dhw_time";
+
+        // Burner cycles (one value per hour)
+        constexpr const char *STARTS_PER_HOUR = "starts_per_hour";
+        constexpr const char *BURN_TIME_MIN = "burn_time_min";
+        constexpr const char *BURN_TIME_MEAN = "burn_time_mean";
+        constexpr const char *BURN_TIME_MAX = "burn_time_max";
+        constexpr const char *OFF_TIME_MEAN = "off_time_mean";
+        constexpr const char *SHORT_CYCLES = "short_cycles";
+        constexpr const char *SHORT_CYCLING = "short_cycling";
 
         // Configuration / Settings
         constexpr const char *UPDATE_INTERVAL = "update_interval";
+        constexpr const char *FILTER = "filter"; // Per-entity publish filter ("<entity> deadband=0.1 ...")
+        constexpr const char *POLL_TIERS = "poll_tiers"; // Polling tiers ("<tier> <seconds>" or "<item> <tier>")
+        constexpr const char *STATS_WINDOW = "stats_window"; // Boiler statistics window in seconds
+
+        // Retained hash of the published discovery (not an entity)
+        constexpr const char *DISCOVERY_HASH = "discovery_hash";
+
+        // Changes recorded while MQTT was down, replayed after reconnecting (not an entity)
+        constexpr const char *HISTORY = "history";
+
+        // Command topic requesting a window of the on-device time series, and the
+        // topic the chunks are published on (not an entity)
+        constexpr const char *TIME_SERIES = "timeseries";
     }
 
     namespace MQTTDiscovery
@@ -124,6 +167,27 @@ namespace OpenTherm
         constexpr const char *JSON_IDENTIFIERS = "identifiers";
         constexpr const char *JSON_MODEL = "model";
         constexpr const char *JSON_MANUFACTURER = "manufacturer";
+        constexpr const char *JSON_PLATFORM = "platform";     // Device-based discovery: component type
+        constexpr const char *JSON_ORIGIN = "origin";         // Device-based discovery: required origin block
+        constexpr const char *JSON_COMPONENTS = "components"; // Device-based discovery: object_id -> config
+
+        // Abbreviated JSON keys (Home Assistant expands these on receipt)
+        constexpr const char *JSON_BASE_TOPIC = "~"; // Topics starting with "~" are relative to this
+        constexpr const char *ABBR_UNIQUE_ID = "uniq_id";
+        constexpr const char *ABBR_DEFAULT_ENTITY_ID = "def_ent_id";
+        constexpr const char *ABBR_STATE_TOPIC = "stat_t";
+        constexpr const char *ABBR_COMMAND_TOPIC = "cmd_t";
+        constexpr const char *ABBR_DEVICE_CLASS = "dev_cla";
+        constexpr const char *ABBR_UNIT_OF_MEASUREMENT = "unit_of_meas";
+        constexpr const char *ABBR_ICON = "ic";
+        constexpr const char *ABBR_VALUE_TEMPLATE = "val_tpl";
+        constexpr const char *ABBR_DEVICE = "dev";
+        constexpr const char *ABBR_IDENTIFIERS = "ids";
+        constexpr const char *ABBR_MODEL = "mdl";
+        constexpr const char *ABBR_MANUFACTURER = "mf";
+        constexpr const char *ABBR_PLATFORM = "p";
+        constexpr const char *ABBR_ORIGIN = "o";
+        constexpr const char *ABBR_COMPONENTS = "cmps";
 
         // Component types
         constexpr const char *COMPONENT_BINARY_SENSOR = "binary_sensor";
@@ -132,6 +196,7 @@ namespace OpenTherm
         constexpr const char *COMPONENT_NUMBER = "number";
         constexpr const char *COMPONENT_TEXT = "text";
         constexpr const char *COMPONENT_BUTTON = "button";
+        constexpr const char *COMPONENT_DEVICE = "device"; // Device-based discovery topic
 
         // Device classes
         constexpr const char *DEVICE_CLASS_PROBLEM = "problem";
@@ -155,12 +220,17 @@ namespace OpenTherm
         constexpr const char *UNIT_SECONDS = "s";
         constexpr const char *UNIT_BYTES = "B";
         constexpr const char *UNIT_MS = "ms";
+        constexpr const char *UNIT_FRAMES_PER_MINUTE = "frames/min";
+        constexpr const char *UNIT_MESSAGES_PER_MINUTE = "msg/min";
+        constexpr const char *UNIT_WAKEUPS_PER_SECOND = "wakeups/s";
+        constexpr const char *UNIT_STARTS_PER_HOUR = "starts/h";
 
         // Icons
         constexpr const char *ICON_ALERT_CIRCLE = "mdi:alert-circle";
         constexpr const char *ICON_RADIATOR = "mdi:radiator";
         constexpr const char *ICON_WATER_BOILER = "mdi:water-boiler";
         constexpr const char *ICON_FIRE = "mdi:fire";
+        constexpr const char *ICON_FIRE_ALERT = "mdi:fire-alert";
         constexpr const char *ICON_SNOWFLAKE = "mdi:snowflake";
         constexpr const char *ICON_WRENCH = "mdi:wrench";
         constexpr const char *ICON_THERMOMETER = "mdi:thermometer";
@@ -191,6 +261,7 @@ namespace OpenTherm
         constexpr const char *ICON_WIFI_MARKER = "mdi:wifi-marker";
         constexpr const char *ICON_CLOCK_START = "mdi:clock-start";
         constexpr const char *ICON_MEMORY = "mdi:memory";
+        constexpr const char *ICON_FILTER = "mdi:filter-cog";
 
         // Display names
         constexpr const char *NAME_FAULT = "Fault";
@@ -232,6 +303,9 @@ namespace OpenTherm
         constexpr const char *NAME_OPENTHERM_TX_PIN = "OpenTherm TX Pin";
         constexpr const char *NAME_OPENTHERM_RX_PIN = "OpenTherm RX Pin";
         constexpr const char *NAME_UPDATE_INTERVAL = "Update Interval";
+        constexpr const char *NAME_FILTER = "Publish Filter";
+        constexpr const char *NAME_POLL_TIERS = "Polling Tiers";
+        constexpr const char *NAME_STATS_WINDOW = "Statistics Window";
         constexpr const char *NAME_DAY_OF_WEEK = "Day of Week";
         constexpr const char *NAME_TIME_OF_DAY = "Time of Day";
         constexpr const char *NAME_DATE = "Date";
@@ -254,11 +328,35 @@ namespace OpenTherm
         constexpr const char *NAME_MQTT_PUBLISH_ATTEMPTS = "MQTT Publish Attempts";
         constexpr const char *NAME_MQTT_PUBLISH_FAILURES = "MQTT Publish Failures";
         constexpr const char *NAME_MQTT_RECONNECT_COUNT = "MQTT Reconnections";
+        constexpr const char *NAME_MQTT_PUBLISH_RATE = "MQTT Publish Rate";
+        constexpr const char *NAME_MQTT_QUEUE_DEPTH = "MQTT Queue Depth";
+        constexpr const char *NAME_MQTT_QUEUE_DROPS = "MQTT Queue Drops";
+        constexpr const char *NAME_MQTT_PRIORITY_STATS = "MQTT Deferred/Shed by Priority";
         constexpr const char *NAME_OT_TOTAL_REQUESTS = "OpenTherm Total Requests";
         constexpr const char *NAME_OT_FAILED_REQUESTS = "OpenTherm Failed Requests";
         constexpr const char *NAME_OT_SUCCESS_RATE = "OpenTherm Success Rate";
         constexpr const char *NAME_OT_LAST_ERROR_ENTITY = "OpenTherm Last Error Entity";
         constexpr const char *NAME_OT_TIME_SINCE_ERROR = "OpenTherm Time Since Error";
+        constexpr const char *NAME_OT_FRAMES_PER_MINUTE = "OpenTherm Frames per Minute";
+        constexpr const char *NAME_OT_WRITES_SAVED = "OpenTherm Writes Saved";
+        constexpr const char *NAME_LOOP_WAKEUPS = "Main Loop Wakeups";
+        constexpr const char *NAME_COMMAND_LATENCY = "Command Latency";
+        constexpr const char *NAME_BOILER_TEMP_MEAN = "Boiler Temperature Mean";
+        constexpr const char *NAME_BOILER_TEMP_MIN = "Boiler Temperature Min";
+        constexpr const char *NAME_BOILER_TEMP_MAX = "Boiler Temperature Max";
+        constexpr const char *NAME_DELTA_T_MEAN = "Flow-Return Delta-T Mean";
+        constexpr const char *NAME_DELTA_T_EWMA = "Flow-Return Delta-T Trend";
+        constexpr const char *NAME_MODULATION_MEAN = "Modulation Mean";
+        constexpr const char *NAME_FLAME_DUTY = "Flame Duty Cycle";
+        constexpr const char *NAME_CH_TIME = "CH Active Time";
+        constexpr const char *NAME_DHW_TIME = "DHW Active Time";
+        constexpr const char *NAME_STARTS_PER_HOUR = "Burner Starts per Hour";
+        constexpr const char *NAME_BURN_TIME_MIN = "Burn Time Min";
+        constexpr const char *NAME_BURN_TIME_MEAN = "Burn Time Mean";
+        constexpr const char *NAME_BURN_TIME_MAX = "Burn Time Max";
+        constexpr const char *NAME_OFF_TIME_MEAN = "Off Time Mean";
+        constexpr const char *NAME_SHORT_CYCLES = "Short Cycles";
+        constexpr const char *NAME_SHORT_CYCLING = "Short Cycling";
 
         // Device information
         constexpr const char *DEVICE_MODEL = "OpenTherm Gateway";
@@ -267,6 +365,8 @@ namespace OpenTherm
         // Other constants
         constexpr const char *MODE_BOX = "box";
         constexpr const char *CONFIG_SUFFIX = "/config";
+        constexpr const char *BIRTH_TOPIC_SUFFIX = "status"; // <prefix>/status
+        constexpr const char *BIRTH_ONLINE = "online";
     }
 }
 
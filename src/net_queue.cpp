@@ -0,0 +1,188 @@
+#include "net_queue.hpp"
+#include <cstring>
+
+namespace OpenTherm
+{
+    namespace Common
+    {
+        const char *netOpName(NetOp op)
+        {
+            switch (op)
+            {
+            case NetOp::PUBLISH:
+                return "publish";
+            case NetOp::SUBSCRIBE:
+                return "subscribe";
+            case NetOp::STREAM_BEGIN:
+                return "stream begin";
+            case NetOp::STREAM_DATA:
+                return "stream data";
+            case NetOp::STREAM_END:
+                return "stream end";
+            case NetOp::CONNECT:
+                return "connect";
+            case NetOp::DISCONNECT:
+                return "disconnect";
+            case NetOp::WIFI_CONNECT:
+                return "wifi connect";
+            case NetOp::WIFI_STATUS:
+                return "wifi status";
+            }
+            return "unknown";
+        }
+
+        // ====================================================================
+        // NetRequestQueue
+        // ====================================================================
+
+        NetRequestQueue::NetRequestQueue()
+            : head_(0), tail_(0), front_size_(0)
+        {
+        }
+
+        size_t NetRequestQueue::maxData()
+        {
+            return MAX_RECORD - sizeof(Header) - 2;
+        }
+
+        bool NetRequestQueue::push(NetOp op, uint32_t token, uint32_t arg, bool retain, const char *topic,
+                                   const void *data, size_t data_len)
+        {
+            size_t topic_len = topic ? strlen(topic) : 0;
+            size_t size = recordSize(topic_len, data_len);
+            if (size > MAX_RECORD)
+                return false;
+
+            // Acquire so the consumer is done with the bytes we are about to reuse
+            uint32_t head = head_.load(std::memory_order_relaxed);
+            uint32_t room = BYTES - (head - tail_.load(std::memory_order_acquire));
+            size_t pos = head & (BYTES - 1);
+            size_t contiguous = BYTES - pos;
+            size_t skip = contiguous < size ? contiguous : 0;
+            if (skip + size > room)
+                return false;
+
+            if (skip > 0)
+            {
+                // Too little room left to even hold a header is skipped implicitly
+                if (skip >= sizeof(Header))
+                {
+                    Header pad = {};
+                    pad.size = (uint16_t)skip;
+                    pad.op = PAD;
+                    memcpy(buf_ + pos, &pad, sizeof(pad));
+                }
+                pos = 0;
+            }
+
+            Header h = {};
+            h.size = (uint16_t)size;
+            h.op = (uint8_t)op;
+            h.retain = retain ? 1 : 0;
+            h.topic_len = (uint16_t)topic_len;
+            h.token = token;
+            h.arg = arg;
+            h.data_len = (uint32_t)data_len;
+
+            uint8_t *p = buf_ + pos;
+            memcpy(p, &h, sizeof(h));
+            p += sizeof(h);
+            if (topic_len > 0)
+                memcpy(p, topic, topic_len);
+            p[topic_len] = '\0';
+            p += topic_len + 1;
+            if (data_len > 0)
+                memcpy(p, data, data_len);
+            p[data_len] = '\0';
+
+            // Release publishes the record together with the new head
+            head_.store(head + (uint32_t)(skip + size), std::memory_order_release);
+            return true;
+        }
+
+        bool NetRequestQueue::front(NetRequest *out)
+        {
+            uint32_t tail = tail_.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                if (head_.load(std::memory_order_acquire) == tail)
+                    return false;
+
+                size_t pos = tail & (BYTES - 1);
+                size_t contiguous = BYTES - pos;
+                Header h;
+                if (contiguous >= sizeof(Header))
+                    memcpy(&h, buf_ + pos, sizeof(h));
+                if (contiguous < sizeof(Header) || h.op == PAD)
+                {
+                    // Padding before a record that starts again at offset 0
+                    tail += (uint32_t)contiguous;
+                    tail_.store(tail, std::memory_order_release);
+                    continue;
+                }
+
+                const uint8_t *p = buf_ + pos + sizeof(Header);
+                out->op = (NetOp)h.op;
+                out->retain = h.retain != 0;
+                out->token = h.token;
+                out->arg = h.arg;
+                out->topic = reinterpret_cast<const char *>(p);
+                out->topic_len = h.topic_len;
+                out->data = p + h.topic_len + 1;
+                out->data_len = h.data_len;
+                front_size_ = h.size;
+                return true;
+            }
+        }
+
+        void NetRequestQueue::pop()
+        {
+            if (front_size_ == 0)
+                return;
+            tail_.store(tail_.load(std::memory_order_relaxed) + front_size_, std::memory_order_release);
+            front_size_ = 0;
+        }
+
+        size_t NetRequestQueue::used() const
+        {
+            uint32_t tail = tail_.load(std::memory_order_acquire);
+            return head_.load(std::memory_order_acquire) - tail;
+        }
+
+        // ====================================================================
+        // NetCompletionQueue
+        // ====================================================================
+
+        NetCompletionQueue::NetCompletionQueue()
+            : head_(0), tail_(0)
+        {
+            memset(slots_, 0, sizeof(slots_));
+        }
+
+        bool NetCompletionQueue::hasRoom() const
+        {
+            return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_acquire) < SLOTS;
+        }
+
+        bool NetCompletionQueue::push(const NetCompletion &completion)
+        {
+            if (!hasRoom())
+                return false;
+            uint32_t head = head_.load(std::memory_order_relaxed);
+            slots_[head & (SLOTS - 1)] = completion;
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool NetCompletionQueue::pop(NetCompletion *out)
+        {
+            uint32_t tail = tail_.load(std::memory_order_relaxed);
+            if (head_.load(std::memory_order_acquire) == tail)
+                return false;
+            *out = slots_[tail & (SLOTS - 1)];
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+    } // namespace Common
+} // namespace OpenTherm
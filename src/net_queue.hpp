@@ -0,0 +1,161 @@
+// Request and completion queues between the application core and the network actor
+//
+// Core 1 is the only core that calls into lwIP and the WiFi driver. Core 0
+// posts what it wants done - publish, subscribe, connect, a piece of a
+// streamed publish, a WiFi join or link check - to a NetRequestQueue; core 1
+// takes requests off between polls, hands them to the MQTT client or the
+// driver and posts one NetCompletion per request back, in order.
+//
+// NetRequestQueue is a single-producer/single-consumer byte ring holding
+// variable-length records (header, topic, data), so a 30-byte state publish
+// takes 60 bytes rather than a slot sized for the 2.3 KB state document. A
+// record that does not fit before the end of the ring is preceded by padding
+// and starts again at offset 0, so every record is contiguous and the
+// consumer hands out pointers into the ring instead of copying. As in
+// MessageRing, each index has one writer and is published with
+// release/acquire ordering; no locks and no read-modify-write atomics.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef NET_QUEUE_HPP
+#define NET_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "state_document.hpp"
+
+namespace OpenTherm
+{
+    namespace Common
+    {
+        // Bytes a request takes in a NetRequestQueue: header, both strings with
+        // their terminator (the actor passes them to lwIP as-is), 4-byte aligned
+        constexpr size_t NET_RECORD_HEADER = 20;
+        constexpr size_t netRecordSize(size_t topic_len, size_t data_len)
+        {
+            return (NET_RECORD_HEADER + topic_len + 1 + data_len + 1 + 3) & ~(size_t)3;
+        }
+
+        enum class NetOp : uint8_t
+        {
+            PUBLISH,      // topic, data = payload, arg = wire size (credits to release), retain
+            SUBSCRIBE,    // topic, arg = credits to release
+            STREAM_BEGIN, // data = PUBLISH header, arg = payload bytes that follow
+            STREAM_DATA,  // data = payload piece
+            STREAM_END,   // flush; completes once the whole stream has been handed to TCP
+            CONNECT,      // topic = client id, data = broker IP, arg = port
+            DISCONNECT,   // disconnect and free the client
+            WIFI_CONNECT, // topic = SSID, data = password, arg = timeout in ms
+            WIFI_STATUS,  // read the link state, RSSI and IP address (see WifiStatus)
+        };
+
+        const char *netOpName(NetOp op);
+
+        // A request as seen by the actor; pointers stay valid until pop()
+        struct NetRequest
+        {
+            NetOp op;
+            bool retain;
+            uint32_t token; // Sequence number assigned by the poster, echoed in the completion
+            uint32_t arg;
+            const char *topic; // NUL-terminated, "" if none
+            size_t topic_len;
+            const uint8_t *data; // NUL-terminated as well, for payloads passed as strings
+            size_t data_len;
+        };
+
+        struct NetCompletion
+        {
+            uint32_t token;
+            NetOp op;
+            int8_t err; // lwIP err_t; 0 (ERR_OK) on success
+        };
+
+        class NetRequestQueue
+        {
+        public:
+            // The largest record is the aggregated state document on its topic.
+            // Records never wrap, so a ring of twice that always takes one once empty.
+            static constexpr size_t MAX_RECORD =
+                netRecordSize(Publish::StateDocument::TOPIC_LEN, Publish::StateDocument::DOCUMENT_LEN);
+            static constexpr size_t BYTES = 8192; // Power of two
+
+            NetRequestQueue();
+
+            // Bytes a request takes in the ring, including header and alignment
+            static constexpr size_t recordSize(size_t topic_len, size_t data_len)
+            {
+                return netRecordSize(topic_len, data_len);
+            }
+
+            // Largest `data_len` a request with no topic may carry
+            static size_t maxData();
+
+            // ---- Producer (core 0) ----
+
+            // Copy the request into the ring; false if it does not fit right now
+            // (or ever - see MAX_RECORD). `topic` may be nullptr.
+            bool push(NetOp op, uint32_t token, uint32_t arg, bool retain, const char *topic, const void *data,
+                      size_t data_len);
+
+            // ---- Consumer (core 1) ----
+
+            // Oldest request, if any
+            bool front(NetRequest *out);
+            void pop();
+
+            size_t used() const; // Bytes in use, padding included
+            bool empty() const { return used() == 0; }
+
+        private:
+            static_assert((BYTES & (BYTES - 1)) == 0, "NetRequestQueue::BYTES must be a power of two");
+            static_assert(2 * MAX_RECORD <= BYTES, "NetRequestQueue::BYTES must hold two of the largest records");
+
+            struct Header
+            {
+                uint16_t size; // Whole record, 4-byte aligned
+                uint8_t op;
+                uint8_t retain;
+                uint16_t topic_len;
+                uint16_t reserved;
+                uint32_t token;
+                uint32_t arg;
+                uint32_t data_len;
+            };
+            static_assert(sizeof(Header) == NET_RECORD_HEADER, "NET_RECORD_HEADER must match the record header");
+
+            static constexpr uint8_t PAD = 0xFF;
+
+            alignas(4) uint8_t buf_[BYTES];
+            std::atomic<uint32_t> head_; // Written by the producer
+            std::atomic<uint32_t> tail_; // Written by the consumer
+            uint32_t front_size_;        // Consumer only: size of the record front() returned
+        };
+
+        class NetCompletionQueue
+        {
+        public:
+            static constexpr size_t SLOTS = 16; // Power of two
+
+            NetCompletionQueue();
+
+            // Producer (core 1): check for room before taking a request, so a
+            // completion never has to be dropped
+            bool hasRoom() const;
+            bool push(const NetCompletion &completion);
+
+            // Consumer (core 0)
+            bool pop(NetCompletion *out);
+
+        private:
+            static_assert((SLOTS & (SLOTS - 1)) == 0, "NetCompletionQueue::SLOTS must be a power of two");
+
+            NetCompletion slots_[SLOTS];
+            std::atomic<uint32_t> head_;
+            std::atomic<uint32_t> tail_;
+        };
+
+    } // namespace Common
+} // namespace OpenTherm
+
+#endif // NET_QUEUE_HPP
@@ -0,0 +1,137 @@
+#include "offline_buffer.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace OpenTherm
+{
+    namespace Publish
+    {
+        using Entities::Id;
+        using Entities::ValueKind;
+
+        static const int32_t PRECISION_SCALE[OfflineBuffer::MAX_PRECISION + 1] = {1, 10, 100, 1000, 10000};
+
+        OfflineBuffer::OfflineBuffer()
+            : head_(0), count_(0), dropped_pending_(0), dropped_total_(0)
+        {
+            memset(records_, 0, sizeof(records_));
+            endOutage();
+        }
+
+        bool OfflineBuffer::record(Id id, ValueKind kind, int32_t value, uint8_t precision, uint32_t time_s)
+        {
+            size_t e = Entities::index(id);
+            if (last_valid_[e] && last_[e] == value && last_precision_[e] == precision)
+                return false;
+            last_[e] = value;
+            last_precision_[e] = precision;
+            last_valid_[e] = true;
+
+            if (count_ == CAPACITY)
+            {
+                // Full: the oldest record makes room
+                head_ = (head_ + 1) % CAPACITY;
+                count_--;
+                dropped_pending_++;
+                dropped_total_++;
+            }
+            Record &r = records_[(head_ + count_) % CAPACITY];
+            r.time_s = time_s;
+            r.value = value;
+            r.entity = (uint8_t)e;
+            r.kind = kind;
+            r.precision = precision;
+            count_++;
+            return true;
+        }
+
+        bool OfflineBuffer::recordBinary(Id id, bool value, uint32_t time_s)
+        {
+            return record(id, ValueKind::BINARY, value ? 1 : 0, 0, time_s);
+        }
+
+        bool OfflineBuffer::recordInt(Id id, int32_t value, uint32_t time_s)
+        {
+            return record(id, ValueKind::INT, value, 0, time_s);
+        }
+
+        bool OfflineBuffer::recordFloat(Id id, float value, int precision, uint32_t time_s)
+        {
+            if (precision < 0)
+                precision = 0;
+            if (precision > MAX_PRECISION)
+                precision = MAX_PRECISION;
+            double scaled = (double)value * PRECISION_SCALE[precision];
+            if (!std::isfinite(scaled) || std::fabs(scaled) >= 2147483647.0)
+                return false;
+            return record(id, ValueKind::FLOAT, (int32_t)std::lround(scaled), (uint8_t)precision, time_s);
+        }
+
+        size_t OfflineBuffer::formatBatch(char *buf, size_t len, uint32_t now_s, size_t *records) const
+        {
+            *records = 0;
+            if (count_ == 0)
+                return 0;
+
+            const Record &first = records_[head_];
+            int n = snprintf(buf, len, "{\"clock\":\"uptime\",\"now\":%lu,\"t0\":%lu,\"dropped\":%lu,\"v\":[",
+                             (unsigned long)now_s, (unsigned long)first.time_s, (unsigned long)dropped_pending_);
+            if (n < 0 || (size_t)n >= len)
+                return 0;
+            size_t used = (size_t)n;
+
+            uint32_t previous = first.time_s;
+            size_t taken = 0;
+            for (; taken < count_; taken++)
+            {
+                const Record &r = records_[(head_ + taken) % CAPACITY];
+                char value[24];
+                switch (r.kind)
+                {
+                case ValueKind::FLOAT:
+                {
+                    int32_t scale = PRECISION_SCALE[r.precision];
+                    snprintf(value, sizeof(value), "%.*f", (int)r.precision, (double)r.value / scale);
+                    break;
+                }
+                default:
+                    snprintf(value, sizeof(value), "%ld", (long)r.value);
+                    break;
+                }
+
+                // Keep room for the closing "]}"
+                n = snprintf(buf + used, len - used, "%s[%lu,\"%s\",%s]", taken > 0 ? "," : "",
+                             (unsigned long)(r.time_s - previous), Entities::TABLE[r.entity].suffix, value);
+                if (n < 0 || used + (size_t)n + 2 >= len)
+                    break;
+                used += (size_t)n;
+                previous = r.time_s;
+            }
+            if (taken == 0)
+                return 0;
+
+            buf[used++] = ']';
+            buf[used++] = '}';
+            buf[used] = '\0';
+            *records = taken;
+            return used;
+        }
+
+        void OfflineBuffer::consume(size_t records)
+        {
+            if (records > count_)
+                records = count_;
+            head_ = (head_ + records) % CAPACITY;
+            count_ -= records;
+            dropped_pending_ = 0;
+        }
+
+        void OfflineBuffer::endOutage()
+        {
+            for (size_t i = 0; i < Entities::COUNT; i++)
+                last_valid_[i] = false;
+        }
+
+    } // namespace Publish
+} // namespace OpenTherm
@@ -0,0 +1,92 @@
+// History of state changes recorded while MQTT is down
+//
+// While the broker is unreachable the publish queue only keeps the latest
+// value per entity, so everything in between would be missing from Home
+// Assistant's history. OfflineBuffer records those changes instead: one
+// fixed-size record per change (entity, seconds since boot, value in the
+// publish cache's scaled-integer form) in a ring of CAPACITY records. When
+// the ring is full the oldest record is overwritten and counted as dropped.
+// Repeats of the value last recorded for an entity are not recorded.
+//
+// After reconnecting the live state goes out first, through the queue; the
+// history is then replayed in batches on "<topic_base>/<device_id>/history".
+// A batch is a compact JSON document with delta-encoded timestamps:
+//
+//   {"clock":"uptime","now":5230,"t0":4410,"dropped":0,
+//    "v":[[0,"boiler_temp",45.5],[30,"flame",1],[12,"boiler_temp",47.0]]}
+//
+// "t0" is the first record's time and each entry's first field the seconds
+// since the previous entry, all on the gateway's uptime clock; "now" is that
+// clock when the batch was built, so a consumer can map entries to wall time
+// from the time it received the batch. Binary values are 1/0. "dropped"
+// counts records lost to overflow since the previous batch.
+//
+// Everything lives in fixed arrays - nothing touches the heap.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef OFFLINE_BUFFER_HPP
+#define OFFLINE_BUFFER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "mqtt_entities.hpp"
+
+namespace OpenTherm
+{
+    namespace Publish
+    {
+        class OfflineBuffer
+        {
+        public:
+            static constexpr size_t CAPACITY = 256; // Records; 12 bytes each
+            static constexpr int MAX_PRECISION = 4;
+
+            OfflineBuffer();
+
+            // Record a change; false if the value repeats the last one recorded for
+            // the entity (or a float is not representable). TEXT entities have no history.
+            bool recordBinary(Entities::Id id, bool value, uint32_t time_s);
+            bool recordInt(Entities::Id id, int32_t value, uint32_t time_s);
+            bool recordFloat(Entities::Id id, float value, int precision, uint32_t time_s);
+
+            size_t size() const { return count_; }
+            uint32_t dropped() const { return dropped_total_; } // Overwritten since construction
+
+            // Render the oldest records as one batch into `buf`; returns the
+            // length (0 if there is nothing to send or not even one record fits)
+            // and the number of records used in `records`. They stay in the ring
+            // until consume(), so a failed publish loses nothing.
+            size_t formatBatch(char *buf, size_t len, uint32_t now_s, size_t *records) const;
+            void consume(size_t records);
+
+            // Forget the last recorded values, so the next outage starts afresh
+            void endOutage();
+
+        private:
+            struct Record
+            {
+                uint32_t time_s;
+                int32_t value; // bool, int, or float scaled by 10^precision
+                uint8_t entity;
+                Entities::ValueKind kind;
+                uint8_t precision;
+            };
+
+            bool record(Entities::Id id, Entities::ValueKind kind, int32_t value, uint8_t precision, uint32_t time_s);
+
+            Record records_[CAPACITY];
+            size_t head_;  // Oldest record
+            size_t count_;
+            uint32_t dropped_pending_; // Not yet reported in a batch
+            uint32_t dropped_total_;
+
+            // Last value recorded per entity this outage, for change detection
+            int32_t last_[Entities::COUNT];
+            uint8_t last_precision_[Entities::COUNT];
+            bool last_valid_[Entities::COUNT];
+        };
+
+    } // namespace Publish
+} // namespace OpenTherm
+
+#endif // OFFLINE_BUFFER_HPP
@@ -594,32 +594,45 @@ namespace OpenTherm
     }
 
     // Write functions
-    bool Interface::writeControlSetpoint(float temperature)
+    bool Interface::writeF88(uint32_t request, float *acknowledged)
     {
-        uint32_t request = OpenTherm::Protocol::write_control_setpoint(temperature);
         uint32_t response;
-        return sendAndReceive(request, &response);
+        if (!sendAndReceive(request, &response))
+        {
+            return false;
+        }
+
+        // The WRITE-ACK echoes the value the boiler accepted
+        uint16_t accepted;
+        if (!OpenTherm::Protocol::parse_write_ack(request, response, &accepted))
+        {
+            return false;
+        }
+        if (acknowledged)
+        {
+            *acknowledged = OpenTherm::Protocol::f8_8_to_float(accepted);
+        }
+        return true;
     }
 
-    bool Interface::writeRoomSetpoint(float temperature)
+    bool Interface::writeControlSetpoint(float temperature, float *acknowledged)
     {
-        uint32_t request = OpenTherm::Protocol::write_room_setpoint(temperature);
-        uint32_t response;
-        return sendAndReceive(request, &response);
+        return writeF88(OpenTherm::Protocol::write_control_setpoint(temperature), acknowledged);
     }
 
-    bool Interface::writeDHWSetpoint(float temperature)
+    bool Interface::writeRoomSetpoint(float temperature, float *acknowledged)
     {
-        uint32_t request = OpenTherm::Protocol::write_dhw_setpoint(temperature);
-        uint32_t response;
-        return sendAndReceive(request, &response);
+        return writeF88(OpenTherm::Protocol::write_room_setpoint(temperature), acknowledged);
     }
 
-    bool Interface::writeMaxCHSetpoint(float temperature)
+    bool Interface::writeDHWSetpoint(float temperature, float *acknowledged)
     {
-        uint32_t request = OpenTherm::Protocol::write_max_ch_setpoint(temperature);
-        uint32_t response;
-        return sendAndReceive(request, &response);
+        return writeF88(OpenTherm::Protocol::write_dhw_setpoint(temperature), acknowledged);
+    }
+
+    bool Interface::writeMaxCHSetpoint(float temperature, float *acknowledged)
+    {
+        return writeF88(OpenTherm::Protocol::write_max_ch_setpoint(temperature), acknowledged);
     }
 
     bool Interface::writeCHEnable(bool enable)
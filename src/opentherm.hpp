@@ -90,10 +90,10 @@ namespace OpenTherm
         bool readCHBounds(uint8_t *min_temp, uint8_t *max_temp) override;
 
         // Write functions
-        bool writeControlSetpoint(float temperature) override;
-        bool writeRoomSetpoint(float temperature) override;
-        bool writeDHWSetpoint(float temperature) override;
-        bool writeMaxCHSetpoint(float temperature) override;
+        bool writeControlSetpoint(float temperature, float *acknowledged) override;
+        bool writeRoomSetpoint(float temperature, float *acknowledged) override;
+        bool writeDHWSetpoint(float temperature, float *acknowledged) override;
+        bool writeMaxCHSetpoint(float temperature, float *acknowledged) override;
         bool writeCHEnable(bool enable) override;
         bool writeDHWEnable(bool enable) override;
 
@@ -107,6 +107,9 @@ namespace OpenTherm
         bool sendAndReceive(uint32_t request, uint32_t *response);
 
     private:
+        // Send a WRITE-DATA request carrying an f8.8 value; true only if the
+        // boiler answers WRITE-ACK for the same data ID
+        bool writeF88(uint32_t request, float *acknowledged);
     };
 
 } // namespace OpenTherm
@@ -66,10 +66,12 @@ namespace OpenTherm
         virtual bool readCHBounds(uint8_t *min_temp, uint8_t *max_temp) = 0;
 
         // Write functions
-        virtual bool writeControlSetpoint(float temperature) = 0;
-        virtual bool writeRoomSetpoint(float temperature) = 0;
-        virtual bool writeDHWSetpoint(float temperature) = 0;
-        virtual bool writeMaxCHSetpoint(float temperature) = 0;
+        // Setpoint writes succeed only on a WRITE_ACK; `acknowledged` (may be nullptr)
+        // receives the value the boiler echoed back, which can differ from the one sent
+        virtual bool writeControlSetpoint(float temperature, float *acknowledged) = 0;
+        virtual bool writeRoomSetpoint(float temperature, float *acknowledged) = 0;
+        virtual bool writeDHWSetpoint(float temperature, float *acknowledged) = 0;
+        virtual bool writeMaxCHSetpoint(float temperature, float *acknowledged) = 0;
         virtual bool writeCHEnable(bool enable) = 0;
         virtual bool writeDHWEnable(bool enable) = 0;
 
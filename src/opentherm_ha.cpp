@@ -5,6 +5,7 @@
 #include "mqtt_topics.hpp"
 #include "mqtt_common.hpp"
 #include "mqtt_publish.hpp"
+#include "topic_arena.hpp"
 #include "pico/cyw43_arch.h"
 #include <cstdio>
 #include <cstring>
@@ -18,439 +19,716 @@ namespace OpenTherm
 {
     namespace HomeAssistant
     {
+        // Saved form of the poll tier overrides; too large for the main stack
+        static char g_tier_overrides[Polling::TIER_OVERRIDES_LEN];
 
         HAInterface::HAInterface(OpenTherm::BaseInterface &ot_interface, const Config &config)
-            : ot_(ot_interface), config_(config), last_update_(0), status_valid_(false)
+            : ot_(ot_interface), config_(config), ready_logged_(false), status_valid_(false)
         {
             memset(&last_status_, 0, sizeof(last_status_));
             memset(&ot_metrics_, 0, sizeof(ot_metrics_));
+            Publish::buildTopics(config_);
+            Publish::setAggregatedState(config_.aggregate_state);
+            Publish::restoreFilters();
+
+            // The configured update interval drives the NORMAL (temperature) tier
+            scheduler_.setTierPeriod(Polling::Tier::NORMAL, config_.update_interval_ms, 0);
+            if (::Config::getPollTiers(g_tier_overrides, sizeof(g_tier_overrides)))
+            {
+                size_t applied = Polling::applyTierOverrides(g_tier_overrides, scheduler_, 0);
+                if (applied > 0)
+                    printf("Poll tiers restored: %zu changed from the defaults\n", applied);
+            }
+            stats_.setWindow(config_.stats_window_s);
         }
 
         void HAInterface::begin(const MQTTCallbacks &callbacks)
         {
             mqtt_ = callbacks;
 
-            if (config_.auto_discovery)
-            {
-                if (!OpenTherm::Discovery::publishDiscoveryConfigs(config_))
-                {
-                    printf("FATAL ERROR: Failed to publish discovery configurations after all retries\n");
-                    printf("Cannot continue without Home Assistant discovery - halting execution\n");
-                    OpenTherm::LED::set_pattern(OpenTherm::LED::BLINK_CONFIG_ERROR);
-                    while (true)
-                    {
-                        sleep_ms(1000); // Halt execution
-                    }
-                }
-
-                // Wait after discovery before subscribing to allow TCP buffers to clear
-                printf("Waiting for TCP buffers to clear before subscribing...\n");
-                OpenTherm::Common::aggressive_network_poll(500);
-            }
+            // Topics only change with the device id or a prefix; otherwise this is a no-op
+            Publish::buildTopics(config_);
 
-            // Subscribe to command topics with delays between each subscription
-            // This prevents TCP buffer exhaustion during subscription burst
-            // Format: <topic_base>/<device_id>/<command_topic_base>/<suffix>
-            // Example: opentherm/opentherm_gw/cmd/ch_enable
-            using namespace OpenTherm::MQTTTopics;
-            std::string base_cmd = std::string(config_.topic_base) + "/" + std::string(config_.device_id) + "/" + std::string(config_.command_topic_base) + "/";
+            // First connect after boot: seed the publish cache with what was published
+            // before the reboot, so only values that changed meanwhile go out again
+            Publish::restoreSnapshot();
+            const MQTTTopics::TopicArena &topics = Publish::topics();
 
-            mqtt_.subscribe((base_cmd + CH_ENABLE).c_str());
-            OpenTherm::Common::aggressive_network_poll(50);
+            // One wildcard subscription covers every command topic; handleMessage()
+            // looks the suffix up in Commands::TABLE
+            // Format: <topic_base>/<device_id>/<command_topic_base>/#
+            // Example: opentherm/opentherm_gw/cmd/#
+            mqtt_.subscribe(topics.commandWildcard());
 
-            mqtt_.subscribe((base_cmd + DHW_ENABLE).c_str());
-            OpenTherm::Common::aggressive_network_poll(50);
-
-            mqtt_.subscribe((base_cmd + CONTROL_SETPOINT).c_str());
-            OpenTherm::Common::aggressive_network_poll(50);
-
-            mqtt_.subscribe((base_cmd + ROOM_SETPOINT).c_str());
-            OpenTherm::Common::aggressive_network_poll(50);
+            // Discovery is only republished when the retained marker on the broker
+            // does not match (see Discovery::DiscoverySync), or when Home
+            // Assistant restarts and announces itself on its birth topic. The
+            // birth message also triggers a paced refresh of the (retained) states.
+            if (config_.auto_discovery)
+                mqtt_.subscribe(topics.discoveryHash());
+            mqtt_.subscribe(topics.birth());
 
-            mqtt_.subscribe((base_cmd + DHW_SETPOINT).c_str());
-            OpenTherm::Common::aggressive_network_poll(50);
+            // Let the subscriptions complete so commands work before the first state publish
+            OpenTherm::Common::mqtt_wait_idle(3000);
 
-            mqtt_.subscribe((base_cmd + MAX_CH_SETPOINT).c_str());
-            OpenTherm::Common::aggressive_network_poll(50);
+            if (config_.auto_discovery)
+            {
+                uint32_t hash_start = to_ms_since_boot(get_absolute_time());
+                discovery_sync_.begin(Discovery::discoveryHash(config_), hash_start);
+                printf("Discovery hash %08lx (%lu ms), waiting up to %lu ms for the retained marker\n",
+                       (unsigned long)discovery_sync_.hash(),
+                       (unsigned long)(to_ms_since_boot(get_absolute_time()) - hash_start),
+                       (unsigned long)Discovery::DiscoverySync::MARKER_WAIT_MS);
+            }
+            ready_logged_ = false;
+
+            // Arm the poll scheduler; the first pass of every tier is spread over a few
+            // seconds so the initial state publish is not one burst
+            scheduler_.start(to_ms_since_boot(get_absolute_time()));
+            publish_meter_.start(Common::g_publish_credits, to_ms_since_boot(get_absolute_time()));
+            printf("Polling tiers: fast=%lums normal=%lums slow=%lums (~%lu frames/min)\n",
+                   (unsigned long)scheduler_.tierPeriod(Polling::Tier::FAST),
+                   (unsigned long)scheduler_.tierPeriod(Polling::Tier::NORMAL),
+                   (unsigned long)scheduler_.tierPeriod(Polling::Tier::SLOW),
+                   (unsigned long)scheduler_.plannedFramesPerMinute());
+        }
 
-            mqtt_.subscribe((base_cmd + SYNC_TIME).c_str());
-            OpenTherm::Common::aggressive_network_poll(50);
+        void HAInterface::publishDiscoveryConfigs()
+        {
+            // Delegate to Discovery namespace implementation
+            bool ok = Discovery::publishDiscoveryConfigs(config_);
 
-            mqtt_.subscribe((base_cmd + RESTART).c_str());
-            OpenTherm::Common::aggressive_network_poll(50);
+            if (!config_.auto_discovery)
+                return;
 
-            mqtt_.subscribe((base_cmd + REPUBLISH_DISCOVERY).c_str());
-            OpenTherm::Common::aggressive_network_poll(50);
+            // Record what is now retained so the next reconnect can skip it
+            char hash[16];
+            Discovery::formatDiscoveryHash(discovery_sync_.hash(), hash, sizeof(hash));
+            if (ok && mqtt_.publish && mqtt_.publish(Publish::topics().discoveryHash(), hash, true))
+            {
+                discovery_sync_.published();
+                return;
+            }
 
-            mqtt_.subscribe((base_cmd + REPUBLISH_STATE).c_str());
-            OpenTherm::Common::aggressive_network_poll(50);
+            // Try again after a backoff instead of sending the whole burst every update()
+            uint32_t now = to_ms_since_boot(get_absolute_time());
+            discovery_sync_.failed(now);
+            printf("Discovery publish failed - retrying in %lu ms\n",
+                   (unsigned long)discovery_sync_.msUntilTimeout(now));
+        }
 
-            mqtt_.subscribe((base_cmd + FORCE_REPUBLISH_STATE).c_str());
-            OpenTherm::Common::aggressive_network_poll(50);
+        bool HAInterface::syncDiscovery(uint32_t now)
+        {
+            Discovery::DiscoverySync::Action action = discovery_sync_.poll(now);
+            if (action == Discovery::DiscoverySync::Action::WAIT)
+                return false;
 
-            mqtt_.subscribe((base_cmd + UPDATE_INTERVAL).c_str());
-            OpenTherm::Common::aggressive_network_poll(50);
+            uint32_t discovery_ms = 0;
+            if (action == Discovery::DiscoverySync::Action::PUBLISH)
+            {
+                if (discovery_sync_.retainedValid())
+                    printf("Discovery changed (retained %08lx, now %08lx) - republishing\n",
+                           (unsigned long)discovery_sync_.retained(), (unsigned long)discovery_sync_.hash());
+                else
+                    printf("No retained discovery marker - publishing discovery\n");
+                uint32_t start = to_ms_since_boot(get_absolute_time());
+                publishDiscoveryConfigs();
+                discovery_ms = to_ms_since_boot(get_absolute_time()) - start;
+            }
 
-            // Wait for TCP buffers from discovery to fully clear before first state publish
-            // Discovery published ~72 messages, subscriptions added more packets
-            // Allow 3 seconds for all ACKs to return and buffers to clear
-            printf("Waiting for all TCP buffers to clear before first state publish (3s)...\n");
-            OpenTherm::Common::aggressive_network_poll(3000);
+            if (!ready_logged_)
+            {
+                // Boot/reconnect-to-ready figure for comparing the discovery modes on hardware
+                const char *discovery = !config_.auto_discovery ? "disabled"
+                                        : action == Discovery::DiscoverySync::Action::PUBLISH ? "published"
+                                                                                              : "current, skipped";
+                printf("Ready for normal operation (%lu ms since boot, discovery %s in %lu ms, %s)\n",
+                       (unsigned long)to_ms_since_boot(get_absolute_time()), discovery,
+                       (unsigned long)discovery_ms,
+                       config_.device_discovery ? "device config" : "per-entity configs");
+                ready_logged_ = true;
+            }
+            return true;
+        }
 
-            // Set last_update_ to current time so first update() won't trigger immediately
-            // This prevents another burst of publishes right after startup
-            last_update_ = to_ms_since_boot(get_absolute_time());
-            printf("Ready for normal operation\n");
+        bool HAInterface::writeSetpoint(uint8_t data_id, float temperature)
+        {
+            switch (data_id)
+            {
+            case OT_DATA_ID_CONTROL_SETPOINT:
+                return setControlSetpoint(temperature);
+            case OT_DATA_ID_ROOM_SETPOINT:
+                return setRoomSetpoint(temperature);
+            case OT_DATA_ID_DHW_SETPOINT:
+                return setDHWSetpoint(temperature);
+            case OT_DATA_ID_MAX_CH_SETPOINT:
+                return setMaxCHSetpoint(temperature);
+            default:
+                return false;
+            }
         }
 
-        void HAInterface::publishDiscoveryConfigs()
+        void HAInterface::queueSetpoint(uint8_t data_id, float temperature)
         {
-            // Delegate to Discovery namespace implementation
-            Discovery::publishDiscoveryConfigs(config_);
+            uint32_t now = to_ms_since_boot(get_absolute_time());
+            if (!setpoint_writes_.submit(data_id, OpenTherm::Protocol::f8_8_from_float(temperature), now))
+                writeSetpoint(data_id, temperature); // No free slot: write straight away as before
         }
 
-        void HAInterface::publishSensor(const char *topic_suffix, float value)
+        void HAInterface::writeDueSetpoints(uint32_t now)
         {
-            Discovery::publishSensor(config_, topic_suffix, value);
-            // mqtt_publish_wrapper handles delays internally (25ms + retry logic)
+            uint8_t data_id;
+            uint16_t value;
+            while (setpoint_writes_.nextDue(now, &data_id, &value))
+            {
+                float temperature = OpenTherm::Protocol::f8_8_to_float(value);
+                if (!writeSetpoint(data_id, temperature))
+                    printf("Setpoint write for data ID %u (%.2f) failed\n", (unsigned)data_id, temperature);
+            }
         }
 
-        void HAInterface::publishSensor(const char *topic_suffix, int value)
+        // Values are recorded into the snapshot's back buffer; publishSnapshot()
+        // hands them to the publish queue when the pass ends
+        void HAInterface::publishSensor(Entities::Id id, float value)
         {
-            Discovery::publishSensor(config_, topic_suffix, value);
-            // mqtt_publish_wrapper handles delays internally (25ms + retry logic)
+            snapshot_.setFloat(id, value, 2, true);
+            stats_.add(id, value, to_ms_since_boot(get_absolute_time()));
         }
 
-        void HAInterface::publishSensor(const char *topic_suffix, const char *value)
+        void HAInterface::publishSensor(Entities::Id id, int value)
         {
-            Discovery::publishSensor(config_, topic_suffix, value);
-            // mqtt_publish_wrapper handles delays internally (25ms + retry logic)
+            snapshot_.setInt(id, value, true);
         }
 
-        void HAInterface::publishBinarySensor(const char *topic_suffix, bool value)
+        void HAInterface::publishSensor(Entities::Id id, const char *value)
         {
-            Discovery::publishBinarySensor(config_, topic_suffix, value);
-            // mqtt_publish_wrapper handles delays internally (25ms + retry logic)
+            // Too long for the snapshot: straight to the publish path
+            if (!snapshot_.setText(id, value, true))
+                Publish::publishStringIfChanged(id, value, true);
         }
 
-        void HAInterface::publishStatus()
+        void HAInterface::publishBinarySensor(Entities::Id id, bool value)
         {
-            opentherm_status_t status;
-            bool success = ot_.readStatus(&status);
-            trackOTOperation("status", success);
+            snapshot_.setBinary(id, value, true);
+            stats_.add(id, value ? 1.0f : 0.0f, to_ms_since_boot(get_absolute_time()));
+        }
 
-            if (success)
+        // Stage two: queue one snapshot value; update() drains the queue as MQTT credits allow
+        static void queueSnapshotValue(Entities::Id id, const Publish::QueuedValue &value)
+        {
+            switch (value.kind)
             {
-                last_status_ = status;
-                status_valid_ = true;
-
-                using namespace OpenTherm::MQTTTopics;
-                // Binary sensors
-                Discovery::publishBinarySensor(config_, FAULT, status.fault);
-                Discovery::publishBinarySensor(config_, CH_MODE, status.ch_mode);
-                Discovery::publishBinarySensor(config_, DHW_MODE, status.dhw_mode);
-                Discovery::publishBinarySensor(config_, FLAME, status.flame);
-                Discovery::publishBinarySensor(config_, COOLING, status.cooling);
-                Discovery::publishBinarySensor(config_, CH2_PRESENT, status.ch2_mode);
-                Discovery::publishBinarySensor(config_, DIAGNOSTIC, status.diagnostic);
-
-                // Switches (current state)
-                Discovery::publishBinarySensor(config_, CH_ENABLE, status.ch_enable);
-                Discovery::publishBinarySensor(config_, DHW_ENABLE, status.dhw_enable);
+            case Entities::ValueKind::BINARY:
+                Publish::publishBinaryIfChanged(id, value.binary, value.retain);
+                break;
+            case Entities::ValueKind::INT:
+                Publish::publishIntIfChanged(id, value.integer, value.retain);
+                break;
+            case Entities::ValueKind::FLOAT:
+                Publish::publishFloatIfChanged(id, value.real, value.precision, value.retain);
+                break;
+            case Entities::ValueKind::TEXT:
+                Publish::publishStringIfChanged(id, value.text, value.retain);
+                break;
             }
         }
 
-        void HAInterface::publishTemperatures()
+        void HAInterface::publishSnapshot()
         {
-            float temp;
-            bool success;
+            if (snapshot_.swap() > 0)
+                snapshot_.forEachSwapped(&queueSnapshotValue);
+        }
 
-            success = ot_.readBoilerTemperature(&temp);
-            trackOTOperation("boiler_temp", success);
-            if (success)
+        // Only the aggregates the window had data for are recorded; the others
+        // keep their previous (retained) value
+        void HAInterface::publishStatistics(uint32_t now)
+        {
+            Stats::Summary s = stats_.close(now);
+            if (s.has_flow)
             {
-                Discovery::publishSensor(config_, MQTTTopics::BOILER_TEMP, temp);
+                publishSensor(Entities::Id::BOILER_TEMP_MEAN, s.flow_mean);
+                publishSensor(Entities::Id::BOILER_TEMP_MIN, s.flow_min);
+                publishSensor(Entities::Id::BOILER_TEMP_MAX, s.flow_max);
             }
-
-            success = ot_.readDHWTemperature(&temp);
-            trackOTOperation("dhw_temp", success);
-            if (success)
+            if (s.has_delta_t)
             {
-                Discovery::publishSensor(config_, MQTTTopics::DHW_TEMP, temp);
+                publishSensor(Entities::Id::DELTA_T_MEAN, s.delta_t_mean);
+                publishSensor(Entities::Id::DELTA_T_EWMA, s.delta_t_ewma);
             }
-
-            success = ot_.readReturnWaterTemperature(&temp);
-            trackOTOperation("return_temp", success);
-            if (success)
+            if (s.has_modulation)
+                publishSensor(Entities::Id::MODULATION_MEAN, s.modulation_mean);
+            if (s.has_flame)
+                publishSensor(Entities::Id::FLAME_DUTY, s.flame_duty);
+            if (s.has_modes)
             {
-                Discovery::publishSensor(config_, MQTTTopics::RETURN_TEMP, temp);
+                publishSensor(Entities::Id::CH_TIME, (int)s.ch_s);
+                publishSensor(Entities::Id::DHW_TIME, (int)s.dhw_s);
             }
+        }
 
-            success = ot_.readOutsideTemperature(&temp);
-            trackOTOperation("outside_temp", success);
-            if (success)
-            {
-                Discovery::publishSensor(config_, MQTTTopics::OUTSIDE_TEMP, temp);
-            }
+        void HAInterface::publishCycles(uint32_t now)
+        {
+            Stats::CycleSummary s = cycles_.close(now);
+            publishSensor(Entities::Id::STARTS_PER_HOUR, (int)s.starts);
+            publishSensor(Entities::Id::SHORT_CYCLES, (int)s.short_cycles);
+            publishBinarySensor(Entities::Id::SHORT_CYCLING, s.short_cycling);
+            if (s.has_burns)
+            {
+                publishSensor(Entities::Id::BURN_TIME_MIN, (int)s.burn_min_s);
+                publishSensor(Entities::Id::BURN_TIME_MEAN, (int)(s.burn_mean_s + 0.5f));
+                publishSensor(Entities::Id::BURN_TIME_MAX, (int)s.burn_max_s);
+            }
+            if (s.has_pauses)
+                publishSensor(Entities::Id::OFF_TIME_MEAN, (int)(s.off_mean_s + 0.5f));
+        }
 
-            success = ot_.readRoomTemperature(&temp);
-            trackOTOperation("room_temp", success);
-            if (success)
-            {
-                Discovery::publishSensor(config_, MQTTTopics::ROOM_TEMP, temp);
-            }
+        void HAInterface::pollItem(Polling::Item item)
+        {
+            using Polling::Item;
+            bool success;
+            float temp;
+            uint16_t count;
 
-            int16_t exhaust_temp;
-            success = ot_.readExhaustTemperature(&exhaust_temp);
-            trackOTOperation("exhaust_temp", success);
-            if (success)
-            {
-                Discovery::publishSensor(config_, MQTTTopics::EXHAUST_TEMP, (int)exhaust_temp);
-            }
+            scheduler_.noteFrames(Polling::ITEMS[static_cast<size_t>(item)].frames);
 
-            // Read setpoints
-            success = ot_.readControlSetpoint(&temp);
-            trackOTOperation("control_setpoint", success);
-            if (success)
+            switch (item)
             {
-                Discovery::publishSensor(config_, MQTTTopics::CONTROL_SETPOINT, temp);
-            }
-
-            if (ot_.readDHWSetpoint(&temp))
+            case Item::STATUS:
             {
-                Discovery::publishSensor(config_, MQTTTopics::DHW_SETPOINT, temp);
-            }
+                opentherm_status_t status;
+                success = ot_.readStatus(&status);
+                trackOTOperation("status", success);
 
-            if (ot_.readMaxCHSetpoint(&temp))
-            {
-                Discovery::publishSensor(config_, MQTTTopics::MAX_CH_SETPOINT, temp);
+                if (success)
+                {
+                    last_status_ = status;
+                    status_valid_ = true;
+
+                    // Binary sensors
+                    publishBinarySensor(Entities::Id::FAULT, status.fault);
+                    publishBinarySensor(Entities::Id::CH_MODE, status.ch_mode);
+                    publishBinarySensor(Entities::Id::DHW_MODE, status.dhw_mode);
+                    publishBinarySensor(Entities::Id::FLAME, status.flame);
+                    publishBinarySensor(Entities::Id::COOLING, status.cooling);
+                    publishBinarySensor(Entities::Id::CH2_PRESENT, status.ch2_mode);
+                    publishBinarySensor(Entities::Id::DIAGNOSTIC, status.diagnostic);
+
+                    // Switches (current state)
+                    publishBinarySensor(Entities::Id::CH_ENABLE, status.ch_enable);
+                    publishBinarySensor(Entities::Id::DHW_ENABLE, status.dhw_enable);
+
+                    // Every burn that ends may raise the short-cycle alarm; it goes
+                    // out straight away rather than with the hourly summary
+                    uint32_t now = to_ms_since_boot(get_absolute_time());
+                    if (cycles_.sample(status.flame, now) == Stats::BurnerCycles::Edge::OFF)
+                        publishBinarySensor(Entities::Id::SHORT_CYCLING, cycles_.alarm());
+                }
+                break;
             }
-        }
 
-        void HAInterface::publishPressureFlow()
-        {
-            float value;
+            case Item::BOILER_TEMP:
+                success = ot_.readBoilerTemperature(&temp);
+                trackOTOperation("boiler_temp", success);
+                if (success)
+                {
+                    publishSensor(Entities::Id::BOILER_TEMP, temp);
+                }
+                break;
 
-            if (ot_.readCHWaterPressure(&value))
-            {
-                publishSensor(MQTTTopics::PRESSURE, value);
-            }
+            case Item::DHW_TEMP:
+                success = ot_.readDHWTemperature(&temp);
+                trackOTOperation("dhw_temp", success);
+                if (success)
+                {
+                    publishSensor(Entities::Id::DHW_TEMP, temp);
+                }
+                break;
 
-            if (ot_.readDHWFlowRate(&value))
-            {
-                publishSensor(MQTTTopics::DHW_FLOW, value);
-            }
-        }
+            case Item::RETURN_TEMP:
+                success = ot_.readReturnWaterTemperature(&temp);
+                trackOTOperation("return_temp", success);
+                if (success)
+                {
+                    publishSensor(Entities::Id::RETURN_TEMP, temp);
+                }
+                break;
 
-        void HAInterface::publishModulation()
-        {
-            float level;
+            case Item::OUTSIDE_TEMP:
+                success = ot_.readOutsideTemperature(&temp);
+                trackOTOperation("outside_temp", success);
+                if (success)
+                {
+                    publishSensor(Entities::Id::OUTSIDE_TEMP, temp);
+                }
+                break;
 
-            if (ot_.readModulationLevel(&level))
+            case Item::ROOM_TEMP:
+                success = ot_.readRoomTemperature(&temp);
+                trackOTOperation("room_temp", success);
+                if (success)
+                {
+                    publishSensor(Entities::Id::ROOM_TEMP, temp);
+                }
+                break;
+
+            case Item::EXHAUST_TEMP:
             {
-                publishSensor(MQTTTopics::MODULATION, level);
+                int16_t exhaust_temp;
+                success = ot_.readExhaustTemperature(&exhaust_temp);
+                trackOTOperation("exhaust_temp", success);
+                if (success)
+                {
+                    publishSensor(Entities::Id::EXHAUST_TEMP, (int)exhaust_temp);
+                }
+                break;
             }
 
-            // Read max modulation
-            float max_mod;
-            if (ot_.readMaxModulationLevel(&max_mod))
+            case Item::CONTROL_SETPOINT:
+                success = ot_.readControlSetpoint(&temp);
+                trackOTOperation("control_setpoint", success);
+                if (success)
+                {
+                    acknowledgeSetpoint(OT_DATA_ID_CONTROL_SETPOINT, Entities::Id::CONTROL_SETPOINT, temp);
+                }
+                break;
+
+            case Item::DHW_SETPOINT:
+                if (ot_.readDHWSetpoint(&temp))
+                {
+                    acknowledgeSetpoint(OT_DATA_ID_DHW_SETPOINT, Entities::Id::DHW_SETPOINT, temp);
+                }
+                break;
+
+            case Item::MAX_CH_SETPOINT:
+                if (ot_.readMaxCHSetpoint(&temp))
+                {
+                    acknowledgeSetpoint(OT_DATA_ID_MAX_CH_SETPOINT, Entities::Id::MAX_CH_SETPOINT, temp);
+                }
+                break;
+
+            case Item::PRESSURE:
+                if (ot_.readCHWaterPressure(&temp))
+                {
+                    publishSensor(Entities::Id::PRESSURE, temp);
+                }
+                break;
+
+            case Item::DHW_FLOW:
+                if (ot_.readDHWFlowRate(&temp))
+                {
+                    publishSensor(Entities::Id::DHW_FLOW, temp);
+                }
+                break;
+
+            case Item::MODULATION:
+                if (ot_.readModulationLevel(&temp))
+                {
+                    publishSensor(Entities::Id::MODULATION, temp);
+                }
+                break;
+
+            case Item::MAX_MODULATION:
+                if (ot_.readMaxModulationLevel(&temp))
+                {
+                    publishSensor(Entities::Id::MAX_MODULATION, temp);
+                }
+                break;
+
+            case Item::BURNER_STARTS:
+                if (ot_.readBurnerStarts(&count))
+                {
+                    publishSensor(Entities::Id::BURNER_STARTS, (int)count);
+                }
+                break;
+
+            case Item::CH_PUMP_STARTS:
+                if (ot_.readCHPumpStarts(&count))
+                {
+                    publishSensor(Entities::Id::CH_PUMP_STARTS, (int)count);
+                }
+                break;
+
+            case Item::DHW_PUMP_STARTS:
+                if (ot_.readDHWPumpStarts(&count))
+                {
+                    publishSensor(Entities::Id::DHW_PUMP_STARTS, (int)count);
+                }
+                break;
+
+            case Item::BURNER_HOURS:
+                if (ot_.readBurnerHours(&count))
+                {
+                    publishSensor(Entities::Id::BURNER_HOURS, (int)count);
+                }
+                break;
+
+            case Item::CH_PUMP_HOURS:
+                if (ot_.readCHPumpHours(&count))
+                {
+                    publishSensor(Entities::Id::CH_PUMP_HOURS, (int)count);
+                }
+                break;
+
+            case Item::DHW_PUMP_HOURS:
+                if (ot_.readDHWPumpHours(&count))
+                {
+                    publishSensor(Entities::Id::DHW_PUMP_HOURS, (int)count);
+                }
+                break;
+
+            case Item::SLAVE_CONFIG:
             {
-                publishSensor(MQTTTopics::MAX_MODULATION, max_mod);
+                opentherm_config_t config;
+                if (ot_.readSlaveConfig(&config))
+                {
+                    publishBinarySensor(Entities::Id::DHW_PRESENT, config.dhw_present);
+                    publishBinarySensor(Entities::Id::COOLING_SUPPORTED, config.cooling_config);
+                    publishBinarySensor(Entities::Id::CH2_PRESENT, config.ch2_present);
+                }
+                break;
             }
-        }
 
-        void HAInterface::publishCounters()
-        {
-            uint16_t count;
+            case Item::OPENTHERM_VERSION:
+                if (ot_.readOpenThermVersion(&temp))
+                {
+                    publishSensor(Entities::Id::OPENTHERM_VERSION, temp);
+                }
+                break;
 
-            if (ot_.readBurnerStarts(&count))
+            case Item::FAULT_FLAGS:
             {
-                publishSensor(MQTTTopics::BURNER_STARTS, (int)count);
+                opentherm_fault_t fault;
+                if (ot_.readFaultFlags(&fault))
+                {
+                    publishSensor(Entities::Id::FAULT_CODE, (int)fault.code);
+                }
+                break;
             }
 
-            if (ot_.readCHPumpStarts(&count))
+            case Item::DIAGNOSTIC_CODE:
+                if (ot_.readOemDiagnosticCode(&count))
+                {
+                    publishSensor(Entities::Id::DIAGNOSTIC_CODE, (int)count);
+                }
+                break;
+
+            case Item::DAY_TIME:
             {
-                publishSensor(MQTTTopics::CH_PUMP_STARTS, (int)count);
+                // Read time/date from boiler (if supported)
+                uint8_t day_of_week, hours, minutes;
+                if (ot_.readDayTime(&day_of_week, &hours, &minutes))
+                {
+                    // Day of week (1=Monday, 7=Sunday, 0=unknown)
+                    const char *day_names[] = {"Unknown", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday", "Sunday"};
+                    if (day_of_week <= 7)
+                    {
+                        publishSensor(Entities::Id::DAY_OF_WEEK, day_names[day_of_week]);
+                    }
+
+                    // Time of day (HH:MM format)
+                    char time_str[16];
+                    snprintf(time_str, sizeof(time_str), "%02u:%02u", hours, minutes);
+                    publishSensor(Entities::Id::TIME_OF_DAY, time_str);
+                }
+                break;
             }
 
-            if (ot_.readDHWPumpStarts(&count))
+            case Item::DATE:
             {
-                publishSensor(MQTTTopics::DHW_PUMP_STARTS, (int)count);
+                // Date (ID 21)
+                uint8_t month, day;
+                if (ot_.readDate(&month, &day))
+                {
+                    // Date (MM/DD format)
+                    char date_str[16];
+                    snprintf(date_str, sizeof(date_str), "%02u/%02u", month, day);
+                    publishSensor(Entities::Id::DATE, date_str);
+                }
+                break;
             }
 
-            if (ot_.readBurnerHours(&count))
+            case Item::YEAR:
+                // Year (ID 22)
+                if (ot_.readYear(&count))
+                {
+                    publishSensor(Entities::Id::YEAR, (int)count);
+                }
+                break;
+
+            case Item::DHW_BOUNDS:
             {
-                publishSensor(MQTTTopics::BURNER_HOURS, (int)count);
+                // DHW bounds (ID 48)
+                uint8_t dhw_min, dhw_max;
+                if (ot_.readDHWBounds(&dhw_min, &dhw_max))
+                {
+                    publishSensor(Entities::Id::DHW_SETPOINT_MIN, (int)dhw_min);
+                    publishSensor(Entities::Id::DHW_SETPOINT_MAX, (int)dhw_max);
+                }
+                break;
             }
 
-            if (ot_.readCHPumpHours(&count))
+            case Item::CH_BOUNDS:
             {
-                publishSensor(MQTTTopics::CH_PUMP_HOURS, (int)count);
+                // CH bounds (ID 49)
+                uint8_t ch_min, ch_max;
+                if (ot_.readCHBounds(&ch_min, &ch_max))
+                {
+                    publishSensor(Entities::Id::CH_SETPOINT_MIN, (int)ch_min);
+                    publishSensor(Entities::Id::CH_SETPOINT_MAX, (int)ch_max);
+                }
+                break;
             }
 
-            if (ot_.readDHWPumpHours(&count))
-            {
-                publishSensor(MQTTTopics::DHW_PUMP_HOURS, (int)count);
+            case Item::WIFI_STATS:
+                publishWiFiStats();
+                break;
+
+            case Item::DEVICE_CONFIG:
+                publishDeviceConfiguration();
+                break;
+
+            case Item::OT_METRICS:
+                publishOpenThermMetrics();
+                break;
+
+            case Item::COUNT:
+                break;
             }
         }
 
-        void HAInterface::publishConfiguration()
+        void HAInterface::publishStatus()
         {
-            opentherm_config_t config;
-            if (ot_.readSlaveConfig(&config))
-            {
-                publishBinarySensor("dhw_present", config.dhw_present);
-                publishBinarySensor("cooling_supported", config.cooling_config);
-                publishBinarySensor("ch2_present", config.ch2_present);
-            }
+            pollItem(Polling::Item::STATUS);
+        }
 
-            // Read OpenTherm version
-            float version;
-            if (ot_.readOpenThermVersion(&version))
-            {
-                publishSensor(MQTTTopics::OPENTHERM_VERSION, version);
-            }
+        void HAInterface::publishTemperatures()
+        {
+            using Polling::Item;
+            pollItem(Item::BOILER_TEMP);
+            pollItem(Item::DHW_TEMP);
+            pollItem(Item::RETURN_TEMP);
+            pollItem(Item::OUTSIDE_TEMP);
+            pollItem(Item::ROOM_TEMP);
+            pollItem(Item::EXHAUST_TEMP);
+
+            // Read setpoints
+            pollItem(Item::CONTROL_SETPOINT);
+            pollItem(Item::DHW_SETPOINT);
+            pollItem(Item::MAX_CH_SETPOINT);
         }
 
-        void HAInterface::publishFaults()
+        void HAInterface::publishPressureFlow()
         {
-            opentherm_fault_t fault;
-            if (ot_.readFaultFlags(&fault))
-            {
-                publishSensor(MQTTTopics::FAULT_CODE, (int)fault.code);
-            }
+            pollItem(Polling::Item::PRESSURE);
+            pollItem(Polling::Item::DHW_FLOW);
+        }
 
-            uint16_t diag_code;
-            if (ot_.readOemDiagnosticCode(&diag_code))
-            {
-                publishSensor(MQTTTopics::DIAGNOSTIC_CODE, (int)diag_code);
-            }
+        void HAInterface::publishModulation()
+        {
+            pollItem(Polling::Item::MODULATION);
+            pollItem(Polling::Item::MAX_MODULATION);
         }
 
-        void HAInterface::publishTimeDate()
+        void HAInterface::publishCounters()
         {
-            // Read time/date from boiler (if supported)
-            uint8_t day_of_week, hours, minutes;
-            if (ot_.readDayTime(&day_of_week, &hours, &minutes))
-            {
-                // Day of week (1=Monday, 7=Sunday, 0=unknown)
-                const char *day_names[] = {"Unknown", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday", "Sunday"};
-                if (day_of_week <= 7)
-                {
-                    publishSensor(MQTTTopics::DAY_OF_WEEK, day_names[day_of_week]);
-                }
+            using Polling::Item;
+            pollItem(Item::BURNER_STARTS);
+            pollItem(Item::CH_PUMP_STARTS);
+            pollItem(Item::DHW_PUMP_STARTS);
+            pollItem(Item::BURNER_HOURS);
+            pollItem(Item::CH_PUMP_HOURS);
+            pollItem(Item::DHW_PUMP_HOURS);
+        }
 
-                // Time of day (HH:MM format)
-                char time_str[16];
-                snprintf(time_str, sizeof(time_str), "%02u:%02u", hours, minutes);
-                publishSensor(MQTTTopics::TIME_OF_DAY, time_str);
-            }
+        void HAInterface::publishConfiguration()
+        {
+            pollItem(Polling::Item::SLAVE_CONFIG);
+            pollItem(Polling::Item::OPENTHERM_VERSION);
+        }
 
-            // Date (ID 21)
-            uint8_t month, day;
-            if (ot_.readDate(&month, &day))
-            {
-                // Date (MM/DD format)
-                char date_str[16];
-                snprintf(date_str, sizeof(date_str), "%02u/%02u", month, day);
-                publishSensor(MQTTTopics::DATE, date_str);
-            }
+        void HAInterface::publishFaults()
+        {
+            pollItem(Polling::Item::FAULT_FLAGS);
+            pollItem(Polling::Item::DIAGNOSTIC_CODE);
+        }
 
-            // Year (ID 22)
-            uint16_t year;
-            if (ot_.readYear(&year))
-            {
-                publishSensor(MQTTTopics::YEAR, (int)year);
-            }
+        void HAInterface::publishTimeDate()
+        {
+            pollItem(Polling::Item::DAY_TIME);
+            pollItem(Polling::Item::DATE);
+            pollItem(Polling::Item::YEAR);
         }
 
         void HAInterface::publishTemperatureBounds()
         {
-            // DHW bounds (ID 48)
-            uint8_t dhw_min, dhw_max;
-            if (ot_.readDHWBounds(&dhw_min, &dhw_max))
-            {
-                publishSensor(MQTTTopics::DHW_SETPOINT_MIN, (int)dhw_min);
-                publishSensor(MQTTTopics::DHW_SETPOINT_MAX, (int)dhw_max);
-            }
-
-            // CH bounds (ID 49)
-            uint8_t ch_min, ch_max;
-            if (ot_.readCHBounds(&ch_min, &ch_max))
-            {
-                publishSensor(MQTTTopics::CH_SETPOINT_MIN, (int)ch_min);
-                publishSensor(MQTTTopics::CH_SETPOINT_MAX, (int)ch_max);
-            }
+            pollItem(Polling::Item::DHW_BOUNDS);
+            pollItem(Polling::Item::CH_BOUNDS);
         }
 
         void HAInterface::publishWiFiStats()
         {
-            // WiFi RSSI (signal strength in dBm)
-            int32_t rssi = 0;
-            if (cyw43_wifi_get_rssi(&cyw43_state, &rssi) == 0)
-            {
-                publishSensor(MQTTTopics::WIFI_RSSI, (int)rssi);
-            }
-
-            // WiFi link status
-            int link_status = cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA);
-            const char *status_str = "unknown";
+            // The network core owns the WiFi driver: publish what it reported for
+            // the previous request (one NORMAL tier ago) and ask for a fresh read
+            Common::WifiStatus wifi;
+            bool known = Common::wifi_status(&wifi);
+            Common::wifi_request_status();
 
-            // Check if we have an IP address
-            bool has_ip = false;
-            const char *ip_addr = nullptr;
-            if (netif_list && netif_is_up(netif_list))
+            if (known)
             {
-                ip_addr = ip4addr_ntoa(netif_ip4_addr(netif_list));
-                // Check if IP is not 0.0.0.0
-                has_ip = (ip_addr && strcmp(ip_addr, "0.0.0.0") != 0);
-            }
+                // WiFi RSSI (signal strength in dBm)
+                if (wifi.has_rssi)
+                {
+                    publishSensor(Entities::Id::WIFI_RSSI, (int)wifi.rssi);
+                }
 
-            switch (link_status)
-            {
-            case CYW43_LINK_DOWN:
-                status_str = "down";
-                break;
-            case CYW43_LINK_JOIN:
-                // CYW43_LINK_JOIN = Connected to WiFi
-                // Override based on actual IP state since driver may not update to LINK_UP
-                status_str = has_ip ? "connected" : "joining";
-                break;
-            case CYW43_LINK_NOIP:
-                status_str = "no_ip";
-                break;
-            case CYW43_LINK_UP:
-                status_str = "connected";
-                break;
-            case CYW43_LINK_FAIL:
-                status_str = "failed";
-                break;
-            case CYW43_LINK_NONET:
-                status_str = "no_network";
-                break;
-            case CYW43_LINK_BADAUTH:
-                status_str = "bad_auth";
-                break;
-            }
-            publishSensor(MQTTTopics::WIFI_LINK_STATUS, status_str);
+                // WiFi link status
+                const char *status_str = "unknown";
+                switch (wifi.link_status)
+                {
+                case CYW43_LINK_DOWN:
+                    status_str = "down";
+                    break;
+                case CYW43_LINK_JOIN:
+                    // CYW43_LINK_JOIN = Connected to WiFi
+                    // Override based on actual IP state since driver may not update to LINK_UP
+                    status_str = wifi.has_ip ? "connected" : "joining";
+                    break;
+                case CYW43_LINK_NOIP:
+                    status_str = "no_ip";
+                    break;
+                case CYW43_LINK_UP:
+                    status_str = "connected";
+                    break;
+                case CYW43_LINK_FAIL:
+                    status_str = "failed";
+                    break;
+                case CYW43_LINK_NONET:
+                    status_str = "no_network";
+                    break;
+                case CYW43_LINK_BADAUTH:
+                    status_str = "bad_auth";
+                    break;
+                }
+                publishSensor(Entities::Id::WIFI_LINK_STATUS, status_str);
 
-            // IP address
-            if (ip_addr)
-            {
-                publishSensor(MQTTTopics::IP_ADDRESS, ip_addr);
+                // IP address
+                if (wifi.has_ip)
+                {
+                    publishSensor(Entities::Id::IP_ADDRESS, wifi.ip);
+                }
             }
 
             // WiFi SSID (from configuration)
             char ssid[64];
             if (::Config::getWiFiSSID(ssid, sizeof(ssid)))
             {
-                publishSensor(MQTTTopics::WIFI_SSID, ssid);
+                publishSensor(Entities::Id::WIFI_SSID, ssid);
             }
 
             // Uptime in seconds
             uint64_t uptime_us = time_us_64();
             uint32_t uptime_seconds = (uint32_t)(uptime_us / 1000000ULL);
-            publishSensor(MQTTTopics::UPTIME, (int)uptime_seconds);
+            publishSensor(Entities::Id::UPTIME, (int)uptime_seconds);
 
             // Free heap memory using mallinfo()
             // mallinfo() provides detailed heap statistics from the C allocator
@@ -463,12 +741,44 @@ namespace OpenTherm
             // Free heap = total - used = fordblks (simpler and more accurate)
             int free_heap_bytes = mi.fordblks;
 
-            publishSensor(MQTTTopics::FREE_HEAP, free_heap_bytes);
+            publishSensor(Entities::Id::FREE_HEAP, free_heap_bytes);
 
             // MQTT statistics for long-term monitoring
-            publishSensor(MQTTTopics::MQTT_PUBLISH_ATTEMPTS, (int)OpenTherm::Common::g_total_publish_attempts);
-            publishSensor(MQTTTopics::MQTT_PUBLISH_FAILURES, (int)OpenTherm::Common::g_total_publish_failures);
-            publishSensor(MQTTTopics::MQTT_RECONNECT_COUNT, (int)OpenTherm::Common::g_mqtt_reconnect_count);
+            publishSensor(Entities::Id::MQTT_PUBLISH_ATTEMPTS, (int)OpenTherm::Common::g_total_publish_attempts);
+            publishSensor(Entities::Id::MQTT_PUBLISH_FAILURES, (int)OpenTherm::Common::g_total_publish_failures);
+            publishSensor(Entities::Id::MQTT_RECONNECT_COUNT, (int)OpenTherm::Common::g_mqtt_reconnect_count);
+
+            Publish::QueueStats queue = Publish::takeQueueStats();
+            publishSensor(Entities::Id::MQTT_QUEUE_DEPTH, (int)queue.high_water);
+            publishSensor(Entities::Id::MQTT_QUEUE_DROPS, (int)queue.dropped);
+
+            char priority_stats[Publish::PublishQueue::TEXT_LEN];
+            Publish::formatQueuePriorityStats(priority_stats, sizeof(priority_stats));
+            publishSensor(Entities::Id::MQTT_PRIORITY_STATS, priority_stats);
+
+            // Messages actually handed to TCP per minute since the last report
+            uint32_t now = to_ms_since_boot(get_absolute_time());
+            Common::Throughput sent = publish_meter_.read(Common::g_publish_credits, now);
+            publish_meter_.start(Common::g_publish_credits, now);
+            if (sent.elapsed_ms > 0)
+            {
+                publishSensor(Entities::Id::MQTT_PUBLISH_RATE,
+                              (int)((uint64_t)sent.messages * 60000 / sent.elapsed_ms));
+            }
+
+            // Main loop wakeups and how long commands waited for it, since the last report
+            Common::LoopMetrics loop = Common::g_loop_events.takeMetrics(now);
+            if (loop.elapsed_ms > 0)
+            {
+                publishSensor(Entities::Id::LOOP_WAKEUPS, loop.wakeups * 1000.0f / loop.elapsed_ms);
+                if (loop.dispatched > 0)
+                {
+                    publishSensor(Entities::Id::COMMAND_LATENCY, loop.latency_avg_us / 1000.0f);
+                    printf("Commands: %lu dispatched, latency avg %lu us, max %lu us\n",
+                           (unsigned long)loop.dispatched, (unsigned long)loop.latency_avg_us,
+                           (unsigned long)loop.latency_max_us);
+                }
+            }
         }
 
         // Parse ISO 8601 datetime string (e.g., "2025-01-17T14:30:00Z" or "2025-01-17T14:30:00+00:00")
@@ -671,249 +981,443 @@ namespace OpenTherm
             // Publish device name
             if (::Config::getDeviceName(buffer, sizeof(buffer)))
             {
-                publishSensor(MQTTTopics::DEVICE_NAME, buffer);
+                publishSensor(Entities::Id::DEVICE_NAME, buffer);
             }
 
             // Publish device ID
             if (::Config::getDeviceID(buffer, sizeof(buffer)))
             {
-                publishSensor(MQTTTopics::DEVICE_ID, buffer);
+                publishSensor(Entities::Id::DEVICE_ID, buffer);
             }
 
             // Publish OpenTherm GPIO pins
-            publishSensor(MQTTTopics::OPENTHERM_TX_PIN, (int)::Config::getOpenThermTxPin());
-            publishSensor(MQTTTopics::OPENTHERM_RX_PIN, (int)::Config::getOpenThermRxPin());
+            publishSensor(Entities::Id::OPENTHERM_TX_PIN, (int)::Config::getOpenThermTxPin());
+            publishSensor(Entities::Id::OPENTHERM_RX_PIN, (int)::Config::getOpenThermRxPin());
 
             // Publish update interval
-            publishSensor(MQTTTopics::UPDATE_INTERVAL, (int)config_.update_interval_ms);
+            publishSensor(Entities::Id::UPDATE_INTERVAL, (int)config_.update_interval_ms);
+            publishPollTiers();
+            publishSensor(Entities::Id::STATS_WINDOW, (int)config_.stats_window_s);
         }
 
-        void HAInterface::update()
+        void HAInterface::publishPollTiers()
         {
-            uint32_t now = to_ms_since_boot(get_absolute_time());
-
-            if (now - last_update_ >= config_.update_interval_ms)
-            {
-                last_update_ = now;
-
-                // Update all sensors
-                // Pacing is handled by 100ms delay after each MQTT publish in mqtt_publish_wrapper()
-                publishStatus();
-                publishTemperatures();
-                publishPressureFlow();
-                publishModulation();
-                publishCounters();
-                publishConfiguration();
-                publishFaults();
-                publishTimeDate();
-                publishTemperatureBounds();
-                publishWiFiStats();
-                publishDeviceConfiguration();
-                publishOpenThermMetrics();
-            }
+            char summary[64];
+            Polling::formatTierSummary(scheduler_, summary, sizeof(summary));
+            publishSensor(Entities::Id::POLL_TIERS, summary);
         }
 
-        void HAInterface::handleMessage(const char *topic, const char *payload)
+        void HAInterface::update()
         {
-            // Build command topic base: <topic_base>/<device_id>/<command_topic_base>/
-            // Example: opentherm/opentherm_gw/cmd/
-            // Use stack buffer to avoid heap allocations entirely
-            char cmd_base[128];
-            int base_len = snprintf(cmd_base, sizeof(cmd_base), "%s/%s/%s/",
-                                   config_.topic_base, config_.device_id, config_.command_topic_base);
+            uint32_t now = to_ms_since_boot(get_absolute_time());
 
-            if (base_len < 0 || base_len >= sizeof(cmd_base))
-            {
-                printf("ERROR: Command base topic too long\n");
-                return;
-            }
+            // Once-a-second history; recorded whatever the state of MQTT
+            Publish::sampleTimeSeries(now);
 
-            // Check if topic starts with cmd_base
-            if (strncmp(topic, cmd_base, base_len) != 0)
-            {
-                return; // Not a command topic
-            }
+            // Setpoint commands whose coalescing window has run out go to the
+            // boiler first; they do not wait for discovery
+            writeDueSetpoints(now);
 
-            // Extract command suffix after the base
-            const char *cmd = topic + base_len;
+            // Values recorded since the last call (command echoes, WRITE-ACKs) join
+            // the queue now; draining them still waits for discovery below
+            publishSnapshot();
 
-            // CH Enable switch
-            if (strcmp(cmd, MQTTTopics::CH_ENABLE) == 0)
-            {
-                bool enable = (strcmp(payload, "ON") == 0);
-                setCHEnable(enable);
-            }
-            // DHW Enable switch
-            else if (strcmp(cmd, MQTTTopics::DHW_ENABLE) == 0)
-            {
-                bool enable = (strcmp(payload, "ON") == 0);
-                setDHWEnable(enable);
-            }
-            // Control setpoint
-            else if (strcmp(cmd, MQTTTopics::CONTROL_SETPOINT) == 0)
+            // Right after (re)connecting, state waits until it is known whether
+            // discovery has to go out first (at most MARKER_WAIT_MS), and after a
+            // failed discovery publish until the retry. The boiler is polled
+            // either way; its values wait in the queue.
+            bool drain = syncDiscovery(now);
+
+            // Each tier's reads are phase-spread by the scheduler, so this normally
+            // runs zero or one item per call rather than a burst of ~35 frames.
+            // Every item is a pass of its own: its values are swapped in and queued
+            // straight away, so the network core sends them while the bus reads the next.
+            Polling::Item item;
+            while (scheduler_.nextDue(now, &item))
             {
-                float temp = atof(payload);
-                setControlSetpoint(temp);
+                pollItem(item);
+                publishSnapshot();
+                if (drain)
+                    Publish::drainQueue();
             }
-            // Room setpoint
-            else if (strcmp(cmd, MQTTTopics::ROOM_SETPOINT) == 0)
+
+            uint32_t frames_per_minute;
+            if (scheduler_.takeFrameRate(now, &frames_per_minute))
             {
-                float temp = atof(payload);
-                setRoomSetpoint(temp);
+                publishSensor(Entities::Id::OT_FRAMES_PER_MINUTE, (int)frames_per_minute);
+                publishSnapshot();
             }
-            // DHW setpoint
-            else if (strcmp(cmd, MQTTTopics::DHW_SETPOINT) == 0)
+
+            if (stats_.msUntilDue(now) == 0)
             {
-                float temp = atof(payload);
-                setDHWSetpoint(temp);
+                publishStatistics(now);
+                publishSnapshot();
             }
-            // Max CH setpoint
-            else if (strcmp(cmd, MQTTTopics::MAX_CH_SETPOINT) == 0)
+
+            if (cycles_.msUntilDue(now) == 0)
             {
-                float temp = atof(payload);
-                setMaxCHSetpoint(temp);
+                publishCycles(now);
+                publishSnapshot();
             }
-            // Device name
-            else if (strcmp(cmd, MQTTTopics::DEVICE_NAME) == 0)
+
+            if (!drain)
+                return;
+
+            // Whatever did not fit the available credits waits for the next call;
+            // a slow broker never holds up the boiler reads above
+            Publish::drainQueue();
+
+            // Rate-limited hot start snapshot (see Publish::saveSnapshot)
+            Publish::saveSnapshot(false);
+        }
+
+        uint32_t HAInterface::msUntilWork(uint32_t now_ms) const
+        {
+            uint32_t wait = scheduler_.msUntilDue(now_ms);
+            uint32_t marker = discovery_sync_.msUntilTimeout(now_ms);
+            if (marker < wait)
+                wait = marker;
+            // Queued state is not sent while discovery holds it, so it is no reason to wake
+            uint32_t document = marker == UINT32_MAX ? Publish::msUntilDue(now_ms) : UINT32_MAX;
+            if (document < wait)
+                wait = document;
+            uint32_t setpoints = setpoint_writes_.msUntilDue(now_ms);
+            if (setpoints < wait)
+                wait = setpoints;
+            uint32_t stats = stats_.msUntilDue(now_ms);
+            if (stats < wait)
+                wait = stats;
+            uint32_t cycles = cycles_.msUntilDue(now_ms);
+            if (cycles < wait)
+                wait = cycles;
+            if (snapshot_.pending())
+                wait = 0; // Recorded outside update(), e.g. by a command handler
+            return wait;
+        }
+
+        // Indexed by Commands::Id, in enum order
+        const HAInterface::CommandHandler HAInterface::COMMAND_HANDLERS[] = {
+            &HAInterface::onCHEnable,
+            &HAInterface::onDHWEnable,
+            &HAInterface::onControlSetpoint,
+            &HAInterface::onRoomSetpoint,
+            &HAInterface::onDHWSetpoint,
+            &HAInterface::onMaxCHSetpoint,
+            &HAInterface::onDeviceName,
+            &HAInterface::onDeviceID,
+            &HAInterface::onOpenThermTxPin,
+            &HAInterface::onOpenThermRxPin,
+            &HAInterface::onUpdateInterval,
+            &HAInterface::onFilter,
+            &HAInterface::onPollTiers,
+            &HAInterface::onStatsWindow,
+            &HAInterface::onSyncTime,
+            &HAInterface::onRestart,
+            &HAInterface::onRepublishDiscovery,
+            &HAInterface::onRepublishState,
+            &HAInterface::onForceRepublishState,
+            &HAInterface::onTimeSeries,
+        };
+
+        void HAInterface::handleMessage(const char *topic, const char *payload)
+        {
+            // Command topic base: <topic_base>/<device_id>/<command_topic_base>/
+            // Example: opentherm/opentherm_gw/cmd/
+            const MQTTTopics::TopicArena &topics = Publish::topics();
+            if (!topics.ready())
+                return; // buildTopics() already reported why
+            const char *cmd_base = topics.commandBase();
+            size_t base_len = topics.commandBaseLen();
+
+            // Retained discovery marker and Home Assistant's birth message
+            if (config_.auto_discovery && strcmp(topic, topics.discoveryHash()) == 0)
             {
-                setDeviceName(payload);
+                discovery_sync_.onMarker(payload);
+                return;
             }
-            // Device ID
-            else if (strcmp(cmd, MQTTTopics::DEVICE_ID) == 0)
+            if (strcmp(topic, topics.birth()) == 0)
             {
-                setDeviceID(payload);
+                printf("Home Assistant status: %s\n", payload);
+                if (config_.auto_discovery)
+                    discovery_sync_.onBirth(payload);
+                if (strcmp(payload, MQTTDiscovery::BIRTH_ONLINE) == 0)
+                    Publish::refreshState();
+                return;
             }
-            // OpenTherm TX pin
-            else if (strcmp(cmd, MQTTTopics::OPENTHERM_TX_PIN) == 0)
+
+            // One subscription covers <cmd_base>#; anything else is not a command
+            if (strncmp(topic, cmd_base, base_len) != 0)
             {
-                uint8_t pin = (uint8_t)atoi(payload);
-                setOpenThermTxPin(pin);
+                return;
             }
-            // OpenTherm RX pin
-            else if (strcmp(cmd, MQTTTopics::OPENTHERM_RX_PIN) == 0)
+
+            const char *suffix = topic + base_len;
+            Commands::Id command;
+            if (!Commands::lookup(suffix, &command))
             {
-                uint8_t pin = (uint8_t)atoi(payload);
-                setOpenThermRxPin(pin);
+                printf("Unknown command topic: %s\n", topic);
+                return;
             }
-            // Time sync command
-            else if (strcmp(cmd, MQTTTopics::SYNC_TIME) == 0)
-            {
-                // Payload format can be:
-                // 1. ISO 8601: "2025-01-17T14:30:00Z"
-                // 2. Unix timestamp: "1737121800"
-                // 3. "PRESS" from HA button (we'll use current system time if available)
+            static_assert(sizeof(COMMAND_HANDLERS) / sizeof(COMMAND_HANDLERS[0]) == Commands::COUNT,
+                          "COMMAND_HANDLERS needs one handler per Commands::Id");
+            (this->*COMMAND_HANDLERS[Commands::index(command)])(payload);
+        }
 
-                if (payload && strlen(payload) > 0)
-                {
-                    // Check if it's a Unix timestamp (all digits)
-                    bool is_timestamp = true;
-                    for (size_t i = 0; i < strlen(payload); i++)
-                    {
-                        if (!isdigit(payload[i]))
-                        {
-                            is_timestamp = false;
-                            break;
-                        }
-                    }
+        static void rejectPayload(const char *command, const char *payload)
+        {
+            printf("WARNING: Ignoring %s command with invalid payload '%s'\n", command, payload);
+        }
 
-                    if (is_timestamp && strlen(payload) >= 10)
-                    {
-                        // Unix timestamp
-                        uint32_t timestamp = (uint32_t)strtoul(payload, NULL, 10);
-                        printf("Received time sync request with timestamp: %lu\n", timestamp);
-                        syncTimeToBoiler(timestamp);
-                    }
-                    else if (strchr(payload, 'T') != nullptr)
-                    {
-                        // ISO 8601 format
-                        printf("Received time sync request with ISO 8601: %s\n", payload);
-                        syncTimeToBoiler(payload);
-                    }
-                    else
-                    {
-                        printf("Time sync requested but format not recognized: %s\n", payload);
-                        printf("Expected ISO 8601 (YYYY-MM-DDTHH:MM:SS) or Unix timestamp\n");
-                    }
-                }
-            }
-            // Restart command
-            else if (strcmp(cmd, MQTTTopics::RESTART) == 0)
+        void HAInterface::onCHEnable(const char *payload)
+        {
+            bool enable;
+            if (!Commands::parseOnOff(payload, &enable))
+                return rejectPayload(MQTTTopics::CH_ENABLE, payload);
+            setCHEnable(enable);
+        }
+
+        void HAInterface::onDHWEnable(const char *payload)
+        {
+            bool enable;
+            if (!Commands::parseOnOff(payload, &enable))
+                return rejectPayload(MQTTTopics::DHW_ENABLE, payload);
+            setDHWEnable(enable);
+        }
+
+        void HAInterface::onControlSetpoint(const char *payload)
+        {
+            float temp;
+            if (!Commands::parseDecimal(payload, &temp))
+                return rejectPayload(MQTTTopics::CONTROL_SETPOINT, payload);
+            queueSetpoint(OT_DATA_ID_CONTROL_SETPOINT, temp);
+        }
+
+        void HAInterface::onRoomSetpoint(const char *payload)
+        {
+            float temp;
+            if (!Commands::parseDecimal(payload, &temp))
+                return rejectPayload(MQTTTopics::ROOM_SETPOINT, payload);
+            queueSetpoint(OT_DATA_ID_ROOM_SETPOINT, temp);
+        }
+
+        void HAInterface::onDHWSetpoint(const char *payload)
+        {
+            float temp;
+            if (!Commands::parseDecimal(payload, &temp))
+                return rejectPayload(MQTTTopics::DHW_SETPOINT, payload);
+            queueSetpoint(OT_DATA_ID_DHW_SETPOINT, temp);
+        }
+
+        void HAInterface::onMaxCHSetpoint(const char *payload)
+        {
+            float temp;
+            if (!Commands::parseDecimal(payload, &temp))
+                return rejectPayload(MQTTTopics::MAX_CH_SETPOINT, payload);
+            queueSetpoint(OT_DATA_ID_MAX_CH_SETPOINT, temp);
+        }
+
+        void HAInterface::onDeviceName(const char *payload)
+        {
+            setDeviceName(payload);
+        }
+
+        void HAInterface::onDeviceID(const char *payload)
+        {
+            setDeviceID(payload);
+        }
+
+        void HAInterface::onOpenThermTxPin(const char *payload)
+        {
+            // A bad pin reboots into a dead bus, so anything unparsable is refused here
+            uint32_t pin;
+            if (!Commands::parseUnsigned(payload, &pin) || pin > 0xFF)
+                return rejectPayload(MQTTTopics::OPENTHERM_TX_PIN, payload);
+            setOpenThermTxPin((uint8_t)pin);
+        }
+
+        void HAInterface::onOpenThermRxPin(const char *payload)
+        {
+            uint32_t pin;
+            if (!Commands::parseUnsigned(payload, &pin) || pin > 0xFF)
+                return rejectPayload(MQTTTopics::OPENTHERM_RX_PIN, payload);
+            setOpenThermRxPin((uint8_t)pin);
+        }
+
+        void HAInterface::onUpdateInterval(const char *payload)
+        {
+            uint32_t interval_ms;
+            if (!Commands::parseUnsigned(payload, &interval_ms))
+                return rejectPayload(MQTTTopics::UPDATE_INTERVAL, payload);
+            setUpdateInterval(interval_ms);
+        }
+
+        // Publish filter command, e.g. "boiler_temp deadband=0.2 median=1 ewma=0.3 max_silence=600"
+        void HAInterface::onFilter(const char *payload)
+        {
+            char applied[96];
+            if (OpenTherm::Publish::configureFilter(payload, applied, sizeof(applied)))
             {
-                printf("Restart requested via MQTT command\n");
-                printf("Restarting in 2 seconds...\n");
-                sleep_ms(2000); // Give time for the message to be logged and MQTT to ack
-                watchdog_reboot(0, 0, 0);
-                // watchdog_reboot will reset the system
+                publishSensor(Entities::Id::FILTER, applied);
             }
-            // Republish discovery command
-            else if (strcmp(cmd, MQTTTopics::REPUBLISH_DISCOVERY) == 0)
+        }
+
+        // Poll tier command, e.g. "slow 300" (tier period in seconds) or "dhw_flow fast"
+        void HAInterface::onPollTiers(const char *payload)
+        {
+            uint32_t now = to_ms_since_boot(get_absolute_time());
+            if (Polling::applyTierCommand(payload, scheduler_, now))
             {
-                printf("Republish discovery requested via MQTT command\n");
-                printf("Re-publishing all Home Assistant discovery configs...\n");
-                // Wait a bit to ensure MQTT publishes the button press acknowledgment
-                OpenTherm::Common::aggressive_network_poll(500);
-                // Re-publish all discovery configs
-                if (OpenTherm::Discovery::publishDiscoveryConfigs(config_))
+                // Keep the persisted update interval in sync with the NORMAL tier
+                uint32_t normal_ms = scheduler_.tierPeriod(Polling::Tier::NORMAL);
+                if (normal_ms != config_.update_interval_ms)
                 {
-                    printf("Discovery configs republished successfully!\n");
+                    setUpdateInterval(normal_ms);
                 }
-                else
+                if (!Polling::formatTierOverrides(scheduler_, g_tier_overrides, sizeof(g_tier_overrides)) ||
+                    !::Config::setPollTiers(g_tier_overrides))
                 {
-                    printf("Warning: Some discovery configs may have failed to publish\n");
+                    printf("ERROR: Failed to save poll tiers - they revert to the defaults after a restart\n");
                 }
+                publishPollTiers();
             }
-            // Republish state command - republish cached values without reading from boiler
-            else if (strcmp(cmd, MQTTTopics::REPUBLISH_STATE) == 0)
-            {
-                printf("Republish state requested via MQTT command\n");
-                printf("Republishing all cached values (without reading from boiler)...\n");
-                // Wait a bit to ensure MQTT publishes the button press acknowledgment
-                OpenTherm::Common::aggressive_network_poll(500);
+        }
+
+        void HAInterface::onStatsWindow(const char *payload)
+        {
+            uint32_t seconds;
+            if (!Commands::parseUnsigned(payload, &seconds) || !setStatsWindow(seconds))
+                return rejectPayload(MQTTTopics::STATS_WINDOW, payload);
+        }
 
-                // Republish all cached values directly to MQTT
-                OpenTherm::Publish::republishAllCached();
+        void HAInterface::onSyncTime(const char *payload)
+        {
+            // Payload format can be:
+            // 1. ISO 8601: "2025-01-17T14:30:00Z"
+            // 2. Unix timestamp: "1737121800"
+            // 3. "PRESS" from HA button (we'll use current system time if available)
+            if (payload == nullptr || payload[0] == '\0')
+                return;
 
-                printf("Cached state values republished!\n");
+            uint32_t timestamp;
+            if (Commands::parseUnsigned(payload, &timestamp) && strlen(payload) >= 10)
+            {
+                // Unix timestamp
+                printf("Received time sync request with timestamp: %lu\n", (unsigned long)timestamp);
+                syncTimeToBoiler(timestamp);
+            }
+            else if (strchr(payload, 'T') != nullptr)
+            {
+                // ISO 8601 format
+                printf("Received time sync request with ISO 8601: %s\n", payload);
+                syncTimeToBoiler(payload);
             }
-            // Force republish state command - clear cache, read from boiler, and publish everything
-            else if (strcmp(cmd, MQTTTopics::FORCE_REPUBLISH_STATE) == 0)
+            else
             {
-                printf("Force republish state requested via MQTT command\n");
-                printf("Force-publishing all current state values (reading from boiler)...\n");
-                // Wait a bit to ensure MQTT publishes the button press acknowledgment
-                OpenTherm::Common::aggressive_network_poll(500);
+                printf("Time sync requested but format not recognized: %s\n", payload);
+                printf("Expected ISO 8601 (YYYY-MM-DDTHH:MM:SS) or Unix timestamp\n");
+            }
+        }
 
-                // Clear all publish caches to force republish
-                OpenTherm::Publish::clearAllCaches();
+        void HAInterface::onRestart(const char *payload)
+        {
+            printf("Restart requested via MQTT command\n");
+            Publish::saveSnapshot(true);
+            printf("Restarting in 2 seconds...\n");
+            sleep_ms(2000); // Give time for the message to be logged and MQTT to ack
+            watchdog_reboot(0, 0, 0);
+            // watchdog_reboot will reset the system
+        }
 
-                // Re-read and publish all state values
-                publishStatus();
-                publishTemperatures();
-                publishPressureFlow();
-                publishModulation();
-                publishCounters();
-                publishConfiguration();
-                publishFaults();
-                publishTimeDate();
-                publishTemperatureBounds();
-                publishWiFiStats();
-                publishDeviceConfiguration();
+        void HAInterface::onRepublishDiscovery(const char *payload)
+        {
+            printf("Republish discovery requested via MQTT command\n");
+            printf("Re-publishing all Home Assistant discovery configs...\n");
+            // Let in-flight publishes (e.g. the button press acknowledgment) drain first
+            OpenTherm::Common::mqtt_wait_idle(500);
+            // Re-publish all discovery configs, even if the marker says they are current
+            publishDiscoveryConfigs();
+            printf("Discovery configs republished\n");
+        }
+
+        // Republish cached values without reading from the boiler
+        void HAInterface::onRepublishState(const char *payload)
+        {
+            printf("Republish state requested via MQTT command\n");
+            printf("Republishing all cached values (without reading from boiler)...\n");
+            // Let in-flight publishes (e.g. the button press acknowledgment) drain first
+            OpenTherm::Common::mqtt_wait_idle(500);
+
+            // Republish all cached values directly to MQTT
+            OpenTherm::Publish::republishAllCached();
+
+            printf("Cached state values republished!\n");
+        }
 
-                printf("All state values force-republished!\n");
+        // Clear the cache and publish every value again from the snapshot
+        void HAInterface::onForceRepublishState(const char *payload)
+        {
+            printf("Force republish state requested via MQTT command\n");
+            printf("Force-publishing all state values from the snapshot (no boiler reads)...\n");
+            // Let in-flight publishes (e.g. the button press acknowledgment) drain first
+            OpenTherm::Common::mqtt_wait_idle(500);
+
+            // Clear all publish caches to force republish
+            OpenTherm::Publish::clearAllCaches();
+
+            // Every entity's latest value is in the snapshot's front buffer; the
+            // queue sends them as credits allow
+            publishSnapshot();
+            size_t queued = snapshot_.forEach(&queueSnapshotValue);
+
+            printf("%zu state values queued for republishing\n", queued);
+        }
+
+        // Time-series window: "3600" for the last hour, or "<from>,<to>" in uptime
+        // seconds as reported in a previous reply's "now"
+        void HAInterface::onTimeSeries(const char *payload)
+        {
+            uint32_t now_s = to_ms_since_boot(get_absolute_time()) / 1000;
+            uint32_t from_s;
+            uint32_t to_s;
+            const char *comma = strchr(payload, ',');
+            if (comma == nullptr)
+            {
+                uint32_t seconds;
+                if (!Commands::parseUnsigned(payload, &seconds))
+                    return rejectPayload(MQTTTopics::TIME_SERIES, payload);
+                from_s = seconds < now_s ? now_s - seconds : 0;
+                to_s = now_s;
             }
-            // Update interval command
-            else if (strcmp(cmd, MQTTTopics::UPDATE_INTERVAL) == 0)
+            else
             {
-                uint32_t interval_ms = (uint32_t)atoi(payload);
-                setUpdateInterval(interval_ms);
-            }
+                char from[12];
+                size_t from_len = (size_t)(comma - payload);
+                if (from_len >= sizeof(from))
+                    return rejectPayload(MQTTTopics::TIME_SERIES, payload);
+                memcpy(from, payload, from_len);
+                from[from_len] = '\0';
+                if (!Commands::parseUnsigned(from, &from_s) || !Commands::parseUnsigned(comma + 1, &to_s) ||
+                    from_s > to_s)
+                    return rejectPayload(MQTTTopics::TIME_SERIES, payload);
+            }
+            Publish::requestTimeSeries(from_s, to_s);
+        }
+
+        void HAInterface::acknowledgeSetpoint(uint8_t data_id, Entities::Id id, float acknowledged)
+        {
+            // Called with a WRITE-ACK's value as well as a read's: the boiler's own
+            // value is published straight away and is what later writes compare with
+            setpoint_writes_.acknowledged(data_id, OpenTherm::Protocol::f8_8_from_float(acknowledged));
+            publishSensor(id, acknowledged);
         }
 
         bool HAInterface::setControlSetpoint(float temperature)
         {
-            if (ot_.writeControlSetpoint(temperature))
+            float acknowledged;
+            if (ot_.writeControlSetpoint(temperature, &acknowledged))
             {
-                publishSensor(MQTTTopics::CONTROL_SETPOINT, temperature);
+                acknowledgeSetpoint(OT_DATA_ID_CONTROL_SETPOINT, Entities::Id::CONTROL_SETPOINT, acknowledged);
+                scheduler_.skipNext(Polling::Item::CONTROL_SETPOINT);
                 return true;
             }
             return false;
@@ -921,9 +1425,11 @@ namespace OpenTherm
 
         bool HAInterface::setRoomSetpoint(float temperature)
         {
-            if (ot_.writeRoomSetpoint(temperature))
+            float acknowledged;
+            if (ot_.writeRoomSetpoint(temperature, &acknowledged))
             {
-                publishSensor(MQTTTopics::ROOM_SETPOINT, temperature);
+                // No poll item to skip: the room setpoint is only ever written
+                acknowledgeSetpoint(OT_DATA_ID_ROOM_SETPOINT, Entities::Id::ROOM_SETPOINT, acknowledged);
                 return true;
             }
             return false;
@@ -931,9 +1437,11 @@ namespace OpenTherm
 
         bool HAInterface::setDHWSetpoint(float temperature)
         {
-            if (ot_.writeDHWSetpoint(temperature))
+            float acknowledged;
+            if (ot_.writeDHWSetpoint(temperature, &acknowledged))
             {
-                publishSensor(MQTTTopics::DHW_SETPOINT, temperature);
+                acknowledgeSetpoint(OT_DATA_ID_DHW_SETPOINT, Entities::Id::DHW_SETPOINT, acknowledged);
+                scheduler_.skipNext(Polling::Item::DHW_SETPOINT);
                 return true;
             }
             return false;
@@ -941,9 +1449,11 @@ namespace OpenTherm
 
         bool HAInterface::setMaxCHSetpoint(float temperature)
         {
-            if (ot_.writeMaxCHSetpoint(temperature))
+            float acknowledged;
+            if (ot_.writeMaxCHSetpoint(temperature, &acknowledged))
             {
-                publishSensor(MQTTTopics::MAX_CH_SETPOINT, temperature);
+                acknowledgeSetpoint(OT_DATA_ID_MAX_CH_SETPOINT, Entities::Id::MAX_CH_SETPOINT, acknowledged);
+                scheduler_.skipNext(Polling::Item::MAX_CH_SETPOINT);
                 return true;
             }
             return false;
@@ -953,7 +1463,7 @@ namespace OpenTherm
         {
             if (ot_.writeCHEnable(enable))
             {
-                publishBinarySensor(MQTTTopics::CH_ENABLE, enable);
+                publishBinarySensor(Entities::Id::CH_ENABLE, enable);
                 return true;
             }
             return false;
@@ -963,7 +1473,7 @@ namespace OpenTherm
         {
             if (ot_.writeDHWEnable(enable))
             {
-                publishBinarySensor(MQTTTopics::DHW_ENABLE, enable);
+                publishBinarySensor(Entities::Id::DHW_ENABLE, enable);
                 return true;
             }
             return false;
@@ -973,8 +1483,11 @@ namespace OpenTherm
         {
             if (::Config::setDeviceName(name))
             {
-                publishSensor(MQTTTopics::DEVICE_NAME, name);
+                publishSensor(Entities::Id::DEVICE_NAME, name);
                 printf("Device name updated to: %s - restarting in 2 seconds...\n", name);
+                publishSnapshot();
+                Publish::flushQueue(2000);
+                Publish::saveSnapshot(true);
                 sleep_ms(2000);
                 watchdog_reboot(0, 0, 0);
                 return true;
@@ -986,8 +1499,11 @@ namespace OpenTherm
         {
             if (::Config::setDeviceID(id))
             {
-                publishSensor(MQTTTopics::DEVICE_ID, id);
+                publishSensor(Entities::Id::DEVICE_ID, id);
                 printf("Device ID updated to: %s - restarting in 2 seconds...\n", id);
+                publishSnapshot();
+                Publish::flushQueue(2000);
+                Publish::saveSnapshot(true);
                 sleep_ms(2000);
                 watchdog_reboot(0, 0, 0);
                 return true;
@@ -999,8 +1515,11 @@ namespace OpenTherm
         {
             if (::Config::setOpenThermTxPin(pin))
             {
-                publishSensor(MQTTTopics::OPENTHERM_TX_PIN, (int)pin);
+                publishSensor(Entities::Id::OPENTHERM_TX_PIN, (int)pin);
                 printf("OpenTherm TX pin updated to: GPIO%u - restarting in 2 seconds...\n", pin);
+                publishSnapshot();
+                Publish::flushQueue(2000);
+                Publish::saveSnapshot(true);
                 sleep_ms(2000);
                 watchdog_reboot(0, 0, 0);
                 return true;
@@ -1012,8 +1531,11 @@ namespace OpenTherm
         {
             if (::Config::setOpenThermRxPin(pin))
             {
-                publishSensor(MQTTTopics::OPENTHERM_RX_PIN, (int)pin);
+                publishSensor(Entities::Id::OPENTHERM_RX_PIN, (int)pin);
                 printf("OpenTherm RX pin updated to: GPIO%u - restarting in 2 seconds...\n", pin);
+                publishSnapshot();
+                Publish::flushQueue(2000);
+                Publish::saveSnapshot(true);
                 sleep_ms(2000);
                 watchdog_reboot(0, 0, 0);
                 return true;
@@ -1026,13 +1548,27 @@ namespace OpenTherm
             if (::Config::setUpdateIntervalMs(interval_ms))
             {
                 config_.update_interval_ms = interval_ms;
-                publishSensor(MQTTTopics::UPDATE_INTERVAL, (int)interval_ms);
+                scheduler_.setTierPeriod(Polling::Tier::NORMAL, interval_ms, to_ms_since_boot(get_absolute_time()));
+                publishSensor(Entities::Id::UPDATE_INTERVAL, (int)interval_ms);
+                publishPollTiers();
                 printf("Update interval changed to: %u ms (%.1f seconds)\n", interval_ms, interval_ms / 1000.0f);
                 return true;
             }
             return false;
         }
 
+        bool HAInterface::setStatsWindow(uint32_t seconds)
+        {
+            if (::Config::setStatsWindowS(seconds) && stats_.setWindow(seconds))
+            {
+                config_.stats_window_s = seconds;
+                publishSensor(Entities::Id::STATS_WINDOW, (int)seconds);
+                printf("Statistics window changed to: %u s (from the next window)\n", (unsigned)seconds);
+                return true;
+            }
+            return false;
+        }
+
         uint32_t HAInterface::getUpdateInterval() const
         {
             return config_.update_interval_ms;
@@ -1063,10 +1599,10 @@ namespace OpenTherm
             using namespace MQTTTopics;
 
             // Total requests
-            publishSensor(OT_TOTAL_REQUESTS, (int)ot_metrics_.total_requests);
+            publishSensor(Entities::Id::OT_TOTAL_REQUESTS, (int)ot_metrics_.total_requests);
 
             // Failed requests
-            publishSensor(OT_FAILED_REQUESTS, (int)ot_metrics_.failed_requests);
+            publishSensor(Entities::Id::OT_FAILED_REQUESTS, (int)ot_metrics_.failed_requests);
 
             // Calculate success rate
             float success_rate = 0.0f;
@@ -1074,12 +1610,12 @@ namespace OpenTherm
             {
                 success_rate = 100.0f * (ot_metrics_.total_requests - ot_metrics_.failed_requests) / ot_metrics_.total_requests;
             }
-            publishSensor(OT_SUCCESS_RATE, success_rate);
+            publishSensor(Entities::Id::OT_SUCCESS_RATE, success_rate);
 
             // Last error entity
             if (ot_metrics_.last_error_entity[0] != '\0')
             {
-                publishSensor(OT_LAST_ERROR_ENTITY, ot_metrics_.last_error_entity);
+                publishSensor(Entities::Id::OT_LAST_ERROR_ENTITY, ot_metrics_.last_error_entity);
             }
 
             // Time since last error (in seconds)
@@ -1087,8 +1623,11 @@ namespace OpenTherm
             {
                 uint32_t now = to_ms_since_boot(get_absolute_time());
                 uint32_t time_since_error = (now - ot_metrics_.last_error_time_ms) / 1000;
-                publishSensor(OT_TIME_SINCE_ERROR, (int)time_since_error);
+                publishSensor(Entities::Id::OT_TIME_SINCE_ERROR, (int)time_since_error);
             }
+
+            // Setpoint writes that never reached the bus
+            publishSensor(Entities::Id::OT_WRITES_SAVED, (int)setpoint_writes_.framesSaved());
         }
 
     } // namespace HomeAssistant
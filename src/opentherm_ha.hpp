@@ -2,6 +2,15 @@
 #define OPENTHERM_HA_HPP
 
 #include "opentherm_base.hpp"
+#include "mqtt_entities.hpp"
+#include "poll_scheduler.hpp"
+#include "mqtt_flow.hpp"
+#include "command_dispatch.hpp"
+#include "discovery_payload.hpp"
+#include "write_coalescer.hpp"
+#include "state_snapshot.hpp"
+#include "boiler_stats.hpp"
+#include "burner_cycles.hpp"
 #include <string>
 #include <functional>
 
@@ -26,7 +35,11 @@ namespace OpenTherm
             const char *state_topic_base;   // e.g., "state"
             const char *command_topic_base; // e.g., "cmd"
             bool auto_discovery;            // Enable MQTT auto-discovery
-            uint32_t update_interval_ms;    // How often to poll sensors (default: 60000ms)
+            uint32_t update_interval_ms;    // Poll period of the NORMAL tier (temperatures etc.)
+            bool aggregate_state;           // One JSON document on the state topic instead of a topic per value
+            bool device_discovery;          // One device-based discovery config instead of one per entity
+            bool compact_discovery;         // Abbreviated discovery keys and a shared device block
+            uint32_t stats_window_s;        // Boiler statistics window (see boiler_stats.hpp)
         };
 
         // Entity types
@@ -54,12 +67,17 @@ namespace OpenTherm
             // Initialize Home Assistant MQTT discovery
             void begin(const MQTTCallbacks &callbacks);
 
-            // Publish all MQTT discovery configs
+            // Publish all MQTT discovery configs and the retained hash marker
             void publishDiscoveryConfigs();
 
             // Main update loop - call periodically
             void update();
 
+            // Milliseconds until update() next has something to do on its own
+            // (a poll item, the discovery marker timeout, the state document);
+            // the main loop sleeps at most this long between calls
+            uint32_t msUntilWork(uint32_t now_ms) const;
+
             // Handle incoming MQTT messages
             void handleMessage(const char *topic, const char *payload);
 
@@ -94,7 +112,9 @@ namespace OpenTherm
             bool setOpenThermRxPin(uint8_t pin);
             bool setUpdateInterval(uint32_t interval_ms);
             uint32_t getUpdateInterval() const;
+            bool setStatsWindow(uint32_t seconds);
             void publishDeviceConfiguration();
+            void publishPollTiers();
 
             // Metrics functions
             void publishOpenThermMetrics();
@@ -103,7 +123,14 @@ namespace OpenTherm
             OpenTherm::BaseInterface &ot_;
             Config config_;
             MQTTCallbacks mqtt_;
-            uint32_t last_update_;
+            Polling::Scheduler scheduler_;
+            Common::ThroughputMeter publish_meter_; // Completed MQTT publishes since the last WiFi stats
+            Discovery::DiscoverySync discovery_sync_; // Whether the broker's retained discovery is current
+            bool ready_logged_;                       // "Ready for normal operation" printed for this connection
+            Commands::WriteCoalescer setpoint_writes_; // Setpoint commands waiting out their coalescing window
+            Publish::StateSnapshot snapshot_;          // Latest value of every entity; publishSensor() records into it
+            Stats::BoilerStats stats_;                 // Windowed aggregates of the boiler readings
+            Stats::BurnerCycles cycles_;               // Flame edges from the status reads, summarised hourly
 
             // State tracking
             opentherm_status_t last_status_;
@@ -122,13 +149,63 @@ namespace OpenTherm
             // Helper functions for MQTT discovery
             // Note: discovery helpers moved to OpenTherm::Discovery.
             // Local publish helpers (delegate to Discovery) remain as member functions
-            void publishSensor(const char *topic_suffix, float value);
-            void publishSensor(const char *topic_suffix, int value);
-            void publishSensor(const char *topic_suffix, const char *value);
-            void publishBinarySensor(const char *topic_suffix, bool value);
+            void publishSensor(Entities::Id id, float value);
+            void publishSensor(Entities::Id id, int value);
+            void publishSensor(Entities::Id id, const char *value);
+            void publishBinarySensor(Entities::Id id, bool value);
 
             // Track OpenTherm operation results for metrics
             void trackOTOperation(const char *entity_name, bool success);
+
+            // Read one poll item from the boiler (or local stats) and publish its entities
+            void pollItem(Polling::Item item);
+
+            // End the current acquisition pass: swap the snapshot and queue what it recorded
+            void publishSnapshot();
+
+            // Close the statistics window and record its aggregates
+            void publishStatistics(uint32_t now);
+
+            // Close the burner cycle period and record its summary
+            void publishCycles(uint32_t now);
+
+            // Act on discovery_sync_; false while state publishes must wait for it
+            bool syncDiscovery(uint32_t now);
+
+            // Setpoint commands go through setpoint_writes_: queue one, and write
+            // those whose window has expired
+            void queueSetpoint(uint8_t data_id, float temperature);
+            void writeDueSetpoints(uint32_t now);
+            bool writeSetpoint(uint8_t data_id, float temperature);
+
+            // Publish a setpoint the boiler reported (read or WRITE-ACK) and remember it for coalescing
+            void acknowledgeSetpoint(uint8_t data_id, Entities::Id id, float acknowledged);
+
+            // Command handlers, one per Commands::Id; handleMessage() dispatches
+            // through COMMAND_HANDLERS after a single hash lookup of the topic suffix
+            typedef void (HAInterface::*CommandHandler)(const char *payload);
+            static const CommandHandler COMMAND_HANDLERS[];
+
+            void onCHEnable(const char *payload);
+            void onDHWEnable(const char *payload);
+            void onControlSetpoint(const char *payload);
+            void onRoomSetpoint(const char *payload);
+            void onDHWSetpoint(const char *payload);
+            void onMaxCHSetpoint(const char *payload);
+            void onDeviceName(const char *payload);
+            void onDeviceID(const char *payload);
+            void onOpenThermTxPin(const char *payload);
+            void onOpenThermRxPin(const char *payload);
+            void onUpdateInterval(const char *payload);
+            void onFilter(const char *payload);
+            void onPollTiers(const char *payload);
+            void onStatsWindow(const char *payload);
+            void onSyncTime(const char *payload);
+            void onRestart(const char *payload);
+            void onRepublishDiscovery(const char *payload);
+            void onRepublishState(const char *payload);
+            void onForceRepublishState(const char *payload);
+            void onTimeSeries(const char *payload);
         };
 
     } // namespace HomeAssistant
@@ -89,6 +89,24 @@ namespace OpenTherm
             return pack_frame(&frame);
         }
 
+        // Check a response to a WRITE-DATA request
+        bool parse_write_ack(uint32_t request, uint32_t response, uint16_t *accepted)
+        {
+            opentherm_frame_t sent, ack;
+            unpack_frame(request, &sent);
+            unpack_frame(response, &ack);
+            // DATA-INVALID or UNKNOWN-DATAID means the write did not take
+            if (ack.msg_type != OT_MSGTYPE_WRITE_ACK || ack.data_id != sent.data_id)
+            {
+                return false;
+            }
+            if (accepted)
+            {
+                *accepted = ack.data_value;
+            }
+            return true;
+        }
+
         // Convert float temperature to f8.8 format
         uint16_t f8_8_from_float(float temp)
         {
@@ -644,5 +662,59 @@ namespace OpenTherm
             return true;
         }
 
+        // Batch decode, frame-at-a-time reference implementation
+        void decode_frames_scalar(const uint32_t *frames, size_t count, DecodedFrame *out)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                opentherm_frame_t frame;
+                unpack_frame(frames[i], &frame);
+                out->msg_type[i] = frame.msg_type;
+                out->spare[i] = frame.spare;
+                out->data_id[i] = frame.data_id;
+                out->data_value[i] = frame.data_value;
+                out->parity_ok[i] = verify_parity(frames[i]) ? 1 : 0;
+            }
+        }
+
+#if OPENTHERM_BATCH_DECODE_SIMD
+        // Branchless kernel written so GCC/Clang auto-vectorize it: every lane
+        // does the same shifts/masks, parity is an XOR fold instead of a bit loop,
+        // and the restrict-qualified outputs cannot alias the input trace.
+        static void decode_frames_simd(const uint32_t *__restrict frames, size_t count,
+                                       uint8_t *__restrict msg_type, uint8_t *__restrict spare,
+                                       uint8_t *__restrict data_id, uint16_t *__restrict data_value,
+                                       uint8_t *__restrict parity_ok)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                uint32_t f = frames[i];
+
+                // A valid frame (including the parity bit) has an even number of 1s
+                uint32_t p = f ^ (f >> 16);
+                p ^= p >> 8;
+                p ^= p >> 4;
+                p ^= p >> 2;
+                p ^= p >> 1;
+
+                msg_type[i] = static_cast<uint8_t>((f >> 28) & 0x07);
+                spare[i] = static_cast<uint8_t>((f >> 24) & 0x0F);
+                data_id[i] = static_cast<uint8_t>((f >> 16) & 0xFF);
+                data_value[i] = static_cast<uint16_t>(f & 0xFFFF);
+                parity_ok[i] = static_cast<uint8_t>((p & 1) ^ 1);
+            }
+        }
+#endif
+
+        void decode_frames(const uint32_t *frames, size_t count, DecodedFrame *out)
+        {
+#if OPENTHERM_BATCH_DECODE_SIMD
+            decode_frames_simd(frames, count, out->msg_type, out->spare, out->data_id,
+                               out->data_value, out->parity_ok);
+#else
+            decode_frames_scalar(frames, count, out);
+#endif
+        }
+
     } // namespace Protocol
 } // namespace OpenTherm
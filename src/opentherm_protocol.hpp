@@ -9,8 +9,18 @@
 #ifndef OPENTHERM_PROTOCOL_HPP
 #define OPENTHERM_PROTOCOL_HPP
 
+#include <cstddef>
 #include <cstdint>
 
+// Batch decoding uses an auto-vectorizable kernel on hosts with SIMD units
+// (SSE/AVX on x86, NEON on ARMv8). The RP2040's Cortex-M0+ has none, so the
+// firmware build falls back to the frame-at-a-time scalar decoder.
+#if defined(__SSE2__) || defined(__AVX2__) || defined(__ARM_NEON)
+#define OPENTHERM_BATCH_DECODE_SIMD 1
+#else
+#define OPENTHERM_BATCH_DECODE_SIMD 0
+#endif
+
 // OpenTherm message types
 enum class MessageType : uint8_t
 {
@@ -202,6 +212,10 @@ namespace OpenTherm
         // Create a WRITE-DATA request
         uint32_t build_write_request(uint8_t data_id, uint16_t data_value);
 
+        // Check a response to a WRITE-DATA request: true only for a WRITE-ACK for the
+        // same data ID, with the value the slave accepted (it may have clamped ours)
+        bool parse_write_ack(uint32_t request, uint32_t response, uint16_t *accepted);
+
         // Convert float temperature to f8.8 format
         uint16_t f8_8_from_float(float temp);
 
@@ -312,6 +326,26 @@ namespace OpenTherm
         // Manchester encoding/decoding
         bool manchester_decode(uint64_t raw_data, uint32_t *decoded_frame);
 
+        // Structure-of-arrays output for batch decoding of captured frame traces.
+        // Each pointer must reference an array of at least `count` elements.
+        // parity_ok[i] is 1 when frame i has valid even parity, 0 otherwise.
+        struct DecodedFrame
+        {
+            uint8_t *msg_type;
+            uint8_t *spare;
+            uint8_t *data_id;
+            uint16_t *data_value;
+            uint8_t *parity_ok;
+        };
+
+        // Decode `count` raw 32-bit frames into `out`. Uses the vectorizable
+        // kernel when OPENTHERM_BATCH_DECODE_SIMD is set, otherwise the scalar
+        // fallback. Results are identical for both implementations.
+        void decode_frames(const uint32_t *frames, size_t count, DecodedFrame *out);
+
+        // Reference implementation: unpack_frame() + verify_parity() per frame
+        void decode_frames_scalar(const uint32_t *frames, size_t count, DecodedFrame *out);
+
     } // namespace Protocol
 } // namespace OpenTherm
 
@@ -0,0 +1,379 @@
+#include "poll_scheduler.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace OpenTherm
+{
+    namespace Polling
+    {
+        static const char *const TIER_NAMES[TIER_COUNT] = {"fast", "normal", "slow", "boot"};
+
+        const char *tierName(Tier tier)
+        {
+            return TIER_NAMES[static_cast<size_t>(tier)];
+        }
+
+        bool findTier(const char *name, Tier *tier)
+        {
+            for (size_t i = 0; i < TIER_COUNT; i++)
+            {
+                if (strcmp(TIER_NAMES[i], name) == 0)
+                {
+                    *tier = static_cast<Tier>(i);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool findItem(const char *name, Item *item)
+        {
+            for (size_t i = 0; i < ITEM_COUNT; i++)
+            {
+                if (strcmp(ITEMS[i].name, name) == 0)
+                {
+                    *item = ITEMS[i].item;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Wrap-safe "a is at or after b" for millisecond timestamps
+        static inline bool reached(uint32_t now_ms, uint32_t due_ms)
+        {
+            return (int32_t)(now_ms - due_ms) >= 0;
+        }
+
+        Scheduler::Scheduler()
+            : window_start_ms_(0), window_frames_(0), window_started_(false)
+        {
+            periods_[static_cast<size_t>(Tier::FAST)] = DEFAULT_FAST_PERIOD_MS;
+            periods_[static_cast<size_t>(Tier::NORMAL)] = DEFAULT_NORMAL_PERIOD_MS;
+            periods_[static_cast<size_t>(Tier::SLOW)] = DEFAULT_SLOW_PERIOD_MS;
+            periods_[static_cast<size_t>(Tier::BOOT)] = 0;
+
+            for (size_t i = 0; i < ITEM_COUNT; i++)
+            {
+                tiers_[i] = ITEMS[i].default_tier;
+                due_[i] = 0;
+                steady_due_[i] = 0;
+                armed_[i] = false; // Nothing runs until start()
+                startup_pass_[i] = false;
+            }
+        }
+
+        void Scheduler::spread(Tier tier, uint32_t first_ms, uint32_t window_ms, bool startup)
+        {
+            size_t count = 0;
+            for (size_t i = 0; i < ITEM_COUNT; i++)
+            {
+                if (tiers_[i] == tier)
+                    count++;
+            }
+            if (count == 0)
+                return;
+
+            uint32_t period = periods_[static_cast<size_t>(tier)];
+            size_t k = 0;
+            for (size_t i = 0; i < ITEM_COUNT; i++)
+            {
+                if (tiers_[i] != tier)
+                    continue;
+
+                due_[i] = first_ms + (uint32_t)((uint64_t)window_ms * k / count);
+                steady_due_[i] = first_ms + period + (uint32_t)((uint64_t)period * k / count);
+                startup_pass_[i] = startup;
+                armed_[i] = startup || tier != Tier::BOOT;
+                k++;
+            }
+        }
+
+        void Scheduler::start(uint32_t now_ms)
+        {
+            for (size_t t = 0; t < TIER_COUNT; t++)
+            {
+                Tier tier = static_cast<Tier>(t);
+                uint32_t window = STARTUP_SPREAD_MS;
+                if (tier != Tier::BOOT && periods_[t] < window)
+                    window = periods_[t];
+                spread(tier, now_ms, window, true);
+            }
+
+            window_start_ms_ = now_ms;
+            window_frames_ = 0;
+            window_started_ = true;
+        }
+
+        bool Scheduler::nextDue(uint32_t now_ms, Item *item)
+        {
+            size_t best = ITEM_COUNT;
+            int32_t best_late = -1;
+            for (size_t i = 0; i < ITEM_COUNT; i++)
+            {
+                if (!armed_[i] || !reached(now_ms, due_[i]))
+                    continue;
+                int32_t late = (int32_t)(now_ms - due_[i]);
+                if (late > best_late)
+                {
+                    best_late = late;
+                    best = i;
+                }
+            }
+            if (best == ITEM_COUNT)
+                return false;
+
+            if (tiers_[best] == Tier::BOOT)
+            {
+                armed_[best] = false;
+            }
+            else
+            {
+                uint32_t period = periods_[static_cast<size_t>(tiers_[best])];
+                if (startup_pass_[best])
+                {
+                    due_[best] = steady_due_[best];
+                    startup_pass_[best] = false;
+                }
+                else
+                {
+                    due_[best] += period;
+                }
+
+                // Skip missed slots rather than bursting to catch up; keeps the phase
+                while (reached(now_ms, due_[best]))
+                    due_[best] += period;
+            }
+
+            *item = static_cast<Item>(best);
+            return true;
+        }
+
+        uint32_t Scheduler::msUntilDue(uint32_t now_ms) const
+        {
+            uint32_t soonest = MAX_PERIOD_MS;
+            for (size_t i = 0; i < ITEM_COUNT; i++)
+            {
+                if (!armed_[i])
+                    continue;
+                if (reached(now_ms, due_[i]))
+                    return 0;
+                uint32_t wait = due_[i] - now_ms;
+                if (wait < soonest)
+                    soonest = wait;
+            }
+            return soonest;
+        }
+
+        void Scheduler::skipNext(Item item)
+        {
+            size_t i = static_cast<size_t>(item);
+            // BOOT items poll once anyway; during the startup pass the first read still goes out
+            if (!armed_[i] || tiers_[i] == Tier::BOOT || startup_pass_[i])
+                return;
+            due_[i] += periods_[static_cast<size_t>(tiers_[i])];
+        }
+
+        void Scheduler::setTierPeriod(Tier tier, uint32_t period_ms, uint32_t now_ms)
+        {
+            if (tier == Tier::BOOT)
+                return;
+            if (period_ms < MIN_PERIOD_MS)
+                period_ms = MIN_PERIOD_MS;
+            if (period_ms > MAX_PERIOD_MS)
+                period_ms = MAX_PERIOD_MS;
+
+            periods_[static_cast<size_t>(tier)] = period_ms;
+            spread(tier, now_ms, period_ms, false);
+        }
+
+        uint32_t Scheduler::tierPeriod(Tier tier) const
+        {
+            return periods_[static_cast<size_t>(tier)];
+        }
+
+        void Scheduler::setItemTier(Item item, Tier tier, uint32_t now_ms)
+        {
+            size_t i = static_cast<size_t>(item);
+            Tier old = tiers_[i];
+            if (old == tier)
+                return;
+
+            tiers_[i] = tier;
+            if (tier == Tier::BOOT)
+            {
+                // Already read at boot - just stop polling it
+                armed_[i] = false;
+                startup_pass_[i] = false;
+            }
+            else
+            {
+                spread(tier, now_ms, periods_[static_cast<size_t>(tier)], false);
+            }
+
+            // Close the gap the item left behind
+            if (old != Tier::BOOT)
+                spread(old, now_ms, periods_[static_cast<size_t>(old)], false);
+        }
+
+        Tier Scheduler::itemTier(Item item) const
+        {
+            return tiers_[static_cast<size_t>(item)];
+        }
+
+        uint32_t Scheduler::plannedFramesPerMinute() const
+        {
+            double per_minute = 0.0;
+            for (size_t i = 0; i < ITEM_COUNT; i++)
+            {
+                if (tiers_[i] == Tier::BOOT)
+                    continue;
+                per_minute += ITEMS[i].frames * 60000.0 / periods_[static_cast<size_t>(tiers_[i])];
+            }
+            return (uint32_t)lround(per_minute);
+        }
+
+        void Scheduler::noteFrames(uint32_t frames)
+        {
+            window_frames_ += frames;
+        }
+
+        bool Scheduler::takeFrameRate(uint32_t now_ms, uint32_t *frames_per_minute)
+        {
+            if (!window_started_)
+            {
+                window_start_ms_ = now_ms;
+                window_frames_ = 0;
+                window_started_ = true;
+                return false;
+            }
+
+            uint32_t elapsed = now_ms - window_start_ms_;
+            if (elapsed < FRAME_RATE_WINDOW_MS)
+                return false;
+
+            *frames_per_minute = (uint32_t)((uint64_t)window_frames_ * 60000 / elapsed);
+            window_start_ms_ = now_ms;
+            window_frames_ = 0;
+            return true;
+        }
+
+        bool applyTierCommand(const char *payload, Scheduler &scheduler, uint32_t now_ms)
+        {
+            if (payload == nullptr)
+                return false;
+
+            char first[32];
+            char second[32];
+            char extra;
+            if (sscanf(payload, "%31s %31s %c", first, second, &extra) != 2)
+            {
+                printf("Poll tier command: expected '<tier> <seconds>' or '<item> <tier>'\n");
+                return false;
+            }
+
+            Tier tier;
+            Item item;
+            if (findTier(first, &tier))
+            {
+                char *end = nullptr;
+                float seconds = strtof(second, &end);
+                if (tier == Tier::BOOT || end == second || *end != '\0' || !std::isfinite(seconds) ||
+                    seconds * 1000.0f < MIN_PERIOD_MS || seconds * 1000.0f > MAX_PERIOD_MS)
+                {
+                    printf("Poll tier command: invalid period '%s' for tier %s\n", second, first);
+                    return false;
+                }
+                scheduler.setTierPeriod(tier, (uint32_t)lroundf(seconds * 1000.0f), now_ms);
+                return true;
+            }
+
+            if (findItem(first, &item))
+            {
+                if (!findTier(second, &tier))
+                {
+                    printf("Poll tier command: unknown tier '%s'\n", second);
+                    return false;
+                }
+                scheduler.setItemTier(item, tier, now_ms);
+                return true;
+            }
+
+            printf("Poll tier command: unknown tier or item '%s'\n", first);
+            return false;
+        }
+
+        size_t formatTierSummary(const Scheduler &scheduler, char *buf, size_t len)
+        {
+            int n = snprintf(buf, len, "fast=%gs normal=%gs slow=%gs",
+                             scheduler.tierPeriod(Tier::FAST) / 1000.0,
+                             scheduler.tierPeriod(Tier::NORMAL) / 1000.0,
+                             scheduler.tierPeriod(Tier::SLOW) / 1000.0);
+            return n < 0 ? 0 : (size_t)n;
+        }
+
+        // Append the line "<name> <value>" to `buf`; false if it does not fit
+        static bool appendLine(char *buf, size_t len, size_t *used, const char *name, const char *value)
+        {
+            int n = snprintf(buf + *used, len - *used, "%s%s %s", *used > 0 ? "\n" : "", name, value);
+            if (n < 0 || *used + (size_t)n >= len)
+                return false;
+            *used += (size_t)n;
+            return true;
+        }
+
+        bool formatTierOverrides(const Scheduler &scheduler, char *buf, size_t len)
+        {
+            if (len == 0)
+                return false;
+            size_t used = 0;
+            buf[0] = '\0';
+
+            const Tier periodic[] = {Tier::FAST, Tier::SLOW};
+            const uint32_t defaults[] = {DEFAULT_FAST_PERIOD_MS, DEFAULT_SLOW_PERIOD_MS};
+            for (size_t t = 0; t < sizeof(periodic) / sizeof(periodic[0]); t++)
+            {
+                if (scheduler.tierPeriod(periodic[t]) == defaults[t])
+                    continue;
+                char seconds[16];
+                snprintf(seconds, sizeof(seconds), "%g", scheduler.tierPeriod(periodic[t]) / 1000.0);
+                if (!appendLine(buf, len, &used, tierName(periodic[t]), seconds))
+                    return false;
+            }
+
+            for (size_t i = 0; i < ITEM_COUNT; i++)
+            {
+                Tier tier = scheduler.itemTier(ITEMS[i].item);
+                if (tier == ITEMS[i].default_tier)
+                    continue;
+                if (!appendLine(buf, len, &used, ITEMS[i].name, tierName(tier)))
+                    return false;
+            }
+            return true;
+        }
+
+        size_t applyTierOverrides(const char *text, Scheduler &scheduler, uint32_t now_ms)
+        {
+            size_t applied = 0;
+            while (text != nullptr && *text != '\0')
+            {
+                const char *end = strchr(text, '\n');
+                size_t n = end ? (size_t)(end - text) : strlen(text);
+
+                char line[64];
+                if (n > 0 && n < sizeof(line))
+                {
+                    memcpy(line, text, n);
+                    line[n] = '\0';
+                    if (applyTierCommand(line, scheduler, now_ms))
+                        applied++;
+                }
+                text = end ? end + 1 : text + n;
+            }
+            return applied;
+        }
+
+    } // namespace Polling
+} // namespace OpenTherm
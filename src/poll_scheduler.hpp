@@ -0,0 +1,203 @@
+// Tiered polling scheduler for OpenTherm reads
+//
+// Every boiler read (one OpenTherm frame, usually) is a poll item assigned
+// to a tier. FAST/NORMAL/SLOW tiers repeat at their period, BOOT items are
+// read once after start. Within a tier the items are phase-shifted by
+// period/N so reads are spread evenly instead of arriving as a burst.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef POLL_SCHEDULER_HPP
+#define POLL_SCHEDULER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace OpenTherm
+{
+    namespace Polling
+    {
+        enum class Tier : uint8_t
+        {
+            FAST,   // Status flags (default 1 s)
+            NORMAL, // Temperatures, setpoints, modulation (default 10 s, the configured update interval)
+            SLOW,   // Counters and other slowly-changing values (default 10 min)
+            BOOT,   // Version, slave config, bounds - read once after start
+            COUNT
+        };
+
+        constexpr size_t TIER_COUNT = static_cast<size_t>(Tier::COUNT);
+
+        enum class Item : uint8_t
+        {
+            STATUS,
+            BOILER_TEMP,
+            DHW_TEMP,
+            RETURN_TEMP,
+            OUTSIDE_TEMP,
+            ROOM_TEMP,
+            EXHAUST_TEMP,
+            CONTROL_SETPOINT,
+            DHW_SETPOINT,
+            MAX_CH_SETPOINT,
+            PRESSURE,
+            DHW_FLOW,
+            MODULATION,
+            MAX_MODULATION,
+            BURNER_STARTS,
+            CH_PUMP_STARTS,
+            DHW_PUMP_STARTS,
+            BURNER_HOURS,
+            CH_PUMP_HOURS,
+            DHW_PUMP_HOURS,
+            SLAVE_CONFIG,
+            OPENTHERM_VERSION,
+            FAULT_FLAGS,
+            DIAGNOSTIC_CODE,
+            DAY_TIME,
+            DATE,
+            YEAR,
+            DHW_BOUNDS,
+            CH_BOUNDS,
+            WIFI_STATS,    // Local only, no OpenTherm frame
+            DEVICE_CONFIG, // Local only
+            OT_METRICS,    // Local only
+            COUNT
+        };
+
+        constexpr size_t ITEM_COUNT = static_cast<size_t>(Item::COUNT);
+
+        struct ItemInfo
+        {
+            Item item;
+            const char *name;  // Used in MQTT tier commands
+            Tier default_tier;
+            uint8_t frames;    // OpenTherm frames per poll
+        };
+
+        constexpr ItemInfo ITEMS[ITEM_COUNT] = {
+            {Item::STATUS, "status", Tier::FAST, 1},
+            {Item::BOILER_TEMP, "boiler_temp", Tier::NORMAL, 1},
+            {Item::DHW_TEMP, "dhw_temp", Tier::NORMAL, 1},
+            {Item::RETURN_TEMP, "return_temp", Tier::NORMAL, 1},
+            {Item::OUTSIDE_TEMP, "outside_temp", Tier::NORMAL, 1},
+            {Item::ROOM_TEMP, "room_temp", Tier::NORMAL, 1},
+            {Item::EXHAUST_TEMP, "exhaust_temp", Tier::NORMAL, 1},
+            {Item::CONTROL_SETPOINT, "control_setpoint", Tier::NORMAL, 1},
+            {Item::DHW_SETPOINT, "dhw_setpoint", Tier::NORMAL, 1},
+            {Item::MAX_CH_SETPOINT, "max_ch_setpoint", Tier::NORMAL, 1},
+            {Item::PRESSURE, "pressure", Tier::NORMAL, 1},
+            {Item::DHW_FLOW, "dhw_flow", Tier::NORMAL, 1},
+            {Item::MODULATION, "modulation", Tier::NORMAL, 1},
+            {Item::MAX_MODULATION, "max_modulation", Tier::NORMAL, 1},
+            {Item::BURNER_STARTS, "burner_starts", Tier::SLOW, 1},
+            {Item::CH_PUMP_STARTS, "ch_pump_starts", Tier::SLOW, 1},
+            {Item::DHW_PUMP_STARTS, "dhw_pump_starts", Tier::SLOW, 1},
+            {Item::BURNER_HOURS, "burner_hours", Tier::SLOW, 1},
+            {Item::CH_PUMP_HOURS, "ch_pump_hours", Tier::SLOW, 1},
+            {Item::DHW_PUMP_HOURS, "dhw_pump_hours", Tier::SLOW, 1},
+            {Item::SLAVE_CONFIG, "slave_config", Tier::BOOT, 1},
+            {Item::OPENTHERM_VERSION, "opentherm_version", Tier::BOOT, 1},
+            {Item::FAULT_FLAGS, "fault_flags", Tier::NORMAL, 1},
+            {Item::DIAGNOSTIC_CODE, "diagnostic_code", Tier::NORMAL, 1},
+            {Item::DAY_TIME, "day_time", Tier::NORMAL, 1},
+            {Item::DATE, "date", Tier::SLOW, 1},
+            {Item::YEAR, "year", Tier::SLOW, 1},
+            {Item::DHW_BOUNDS, "dhw_bounds", Tier::BOOT, 1},
+            {Item::CH_BOUNDS, "ch_bounds", Tier::BOOT, 1},
+            {Item::WIFI_STATS, "wifi_stats", Tier::NORMAL, 0},
+            {Item::DEVICE_CONFIG, "device_config", Tier::BOOT, 0},
+            {Item::OT_METRICS, "ot_metrics", Tier::NORMAL, 0},
+        };
+
+        constexpr bool itemsMatchEnum()
+        {
+            for (size_t i = 0; i < ITEM_COUNT; i++)
+            {
+                if (static_cast<size_t>(ITEMS[i].item) != i)
+                    return false;
+            }
+            return true;
+        }
+        static_assert(itemsMatchEnum(), "Polling::ITEMS must list every Item in enum order");
+
+        constexpr uint32_t DEFAULT_FAST_PERIOD_MS = 1000;
+        constexpr uint32_t DEFAULT_NORMAL_PERIOD_MS = 10000;
+        constexpr uint32_t DEFAULT_SLOW_PERIOD_MS = 600000;
+        constexpr uint32_t MIN_PERIOD_MS = 100;
+        constexpr uint32_t MAX_PERIOD_MS = 86400000;
+        constexpr uint32_t STARTUP_SPREAD_MS = 5000;    // First pass of every tier completes within this
+        constexpr uint32_t FRAME_RATE_WINDOW_MS = 60000;
+
+        const char *tierName(Tier tier);
+        bool findTier(const char *name, Tier *tier);
+        bool findItem(const char *name, Item *item);
+
+        class Scheduler
+        {
+        public:
+            Scheduler();
+
+            // Arm every item: each tier's first pass is spread over STARTUP_SPREAD_MS
+            void start(uint32_t now_ms);
+
+            // Pop the most overdue item, if any, and schedule its next poll
+            bool nextDue(uint32_t now_ms, Item *item);
+
+            // Milliseconds until nextDue() will return an item: 0 if one is due now,
+            // MAX_PERIOD_MS if nothing is armed. Lets the main loop sleep until then.
+            uint32_t msUntilDue(uint32_t now_ms) const;
+
+            // The item's value just became known another way (e.g. a write's
+            // acknowledgement): skip its next poll, keeping its phase
+            void skipNext(Item item);
+
+            void setTierPeriod(Tier tier, uint32_t period_ms, uint32_t now_ms);
+            uint32_t tierPeriod(Tier tier) const;
+
+            void setItemTier(Item item, Tier tier, uint32_t now_ms);
+            Tier itemTier(Item item) const;
+
+            // Frames per minute implied by the current tier assignment (BOOT excluded)
+            uint32_t plannedFramesPerMinute() const;
+
+            // Account frames actually sent. Once per FRAME_RATE_WINDOW_MS, takeFrameRate()
+            // returns true with the measured rate of the window that just ended.
+            void noteFrames(uint32_t frames);
+            bool takeFrameRate(uint32_t now_ms, uint32_t *frames_per_minute);
+
+        private:
+            // Spread a tier's items evenly over `window_ms` starting at `first_ms`
+            void spread(Tier tier, uint32_t first_ms, uint32_t window_ms, bool startup);
+
+            Tier tiers_[ITEM_COUNT];
+            uint32_t due_[ITEM_COUNT];
+            uint32_t steady_due_[ITEM_COUNT]; // Due time after the startup pass (even spacing)
+            bool armed_[ITEM_COUNT];
+            bool startup_pass_[ITEM_COUNT];
+            uint32_t periods_[TIER_COUNT];
+            uint32_t window_start_ms_;
+            uint32_t window_frames_;
+            bool window_started_;
+        };
+
+        // Apply "<tier> <period_s>" (tier period) or "<item> <tier>" (reassign an item)
+        bool applyTierCommand(const char *payload, Scheduler &scheduler, uint32_t now_ms);
+
+        // "fast=1s normal=10s slow=600s"
+        size_t formatTierSummary(const Scheduler &scheduler, char *buf, size_t len);
+
+        // Tier periods and item tiers that differ from the defaults, as tier commands
+        // one per line ('\n' separated), for saving to flash. The NORMAL period is
+        // left out: it is the persisted update interval. Writes "" if there are
+        // none; false if they do not all fit `len`.
+        constexpr size_t TIER_OVERRIDES_LEN = 768; // Every override at once fits
+        bool formatTierOverrides(const Scheduler &scheduler, char *buf, size_t len);
+
+        // Apply text from formatTierOverrides(); lines that no longer parse (e.g. a
+        // removed item) are skipped. Returns the number of commands applied.
+        size_t applyTierOverrides(const char *text, Scheduler &scheduler, uint32_t now_ms);
+
+    } // namespace Polling
+} // namespace OpenTherm
+
+#endif // POLL_SCHEDULER_HPP
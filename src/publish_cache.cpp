@@ -0,0 +1,469 @@
+#include "publish_cache.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace OpenTherm
+{
+    namespace Publish
+    {
+        using Entities::Id;
+        using Entities::ValueKind;
+
+        static const int32_t PRECISION_SCALE[StateCache::MAX_PRECISION + 1] = {1, 10, 100, 1000, 10000};
+
+        StateCache::StateCache(PublishSink sink)
+            : sink_(sink), topics_(nullptr), refresh_next_(Entities::COUNT), changes_(0)
+        {
+            memset(text_, 0, sizeof(text_));
+            clear();
+        }
+
+        bool StateCache::send(Id id, const char *payload, bool retain)
+        {
+            if (topics_ == nullptr || !topics_->ready())
+            {
+                printf("ERROR: No state topic for %s\n", Entities::descriptor(id).suffix);
+                return false;
+            }
+            return sink_(topics_->state(id), payload, retain);
+        }
+
+        bool StateCache::unchanged(Id id, const Slot &next) const
+        {
+            const Slot &slot = slots_[Entities::index(id)];
+            return slot.valid && slot.kind == next.kind && slot.precision == next.precision && slot.value == next.value;
+        }
+
+        bool StateCache::store(Id id, const Slot &next, const char *payload, bool retain)
+        {
+            if (!send(id, payload, retain))
+                return false;
+
+            slots_[Entities::index(id)] = next;
+            changes_++;
+            return true;
+        }
+
+        bool StateCache::publishBinary(Id id, bool value, bool retain)
+        {
+            Slot next = {value ? 1 : 0, ValueKind::BINARY, 0, true, retain};
+            if (unchanged(id, next))
+                return true; // nothing to do
+            return store(id, next, value ? "ON" : "OFF", retain);
+        }
+
+        bool StateCache::publishInt(Id id, int32_t value, bool retain)
+        {
+            Slot next = {value, ValueKind::INT, 0, true, retain};
+            if (unchanged(id, next))
+                return true;
+
+            char payload[PAYLOAD_LEN];
+            snprintf(payload, sizeof(payload), "%ld", (long)value);
+            return store(id, next, payload, retain);
+        }
+
+        bool StateCache::publishFloat(Id id, float value, int precision, bool retain)
+        {
+            if (precision < 0)
+                precision = 0;
+            if (precision > MAX_PRECISION)
+                precision = MAX_PRECISION;
+
+            char payload[PAYLOAD_LEN];
+
+            // Compare at publish resolution: 21.004 and 21.001 both publish as "21.00"
+            double scaled = (double)value * PRECISION_SCALE[precision];
+            if (!std::isfinite(scaled) || std::fabs(scaled) >= 2147483647.0)
+            {
+                // Not representable as a scaled integer - publish uncached
+                slots_[Entities::index(id)].valid = false;
+                snprintf(payload, sizeof(payload), "%.*f", precision, (double)value);
+                return send(id, payload, retain);
+            }
+
+            Slot next = {(int32_t)std::lround(scaled), ValueKind::FLOAT, (uint8_t)precision, true, retain};
+            if (unchanged(id, next))
+                return true;
+
+            snprintf(payload, sizeof(payload), "%.*f", precision, (double)value);
+            return store(id, next, payload, retain);
+        }
+
+        bool StateCache::publishText(Id id, const char *value, bool retain)
+        {
+            if (value == nullptr)
+                value = "";
+
+            Slot &slot = slots_[Entities::index(id)];
+            size_t len = strnlen(value, TEXT_LEN);
+            if (Entities::descriptor(id).kind != ValueKind::TEXT || len >= TEXT_LEN)
+            {
+                // No text slot for this entity (or value too long to cache) - publish uncached
+                slot.valid = false;
+                return send(id, value, retain);
+            }
+
+            char *cached = text_[Entities::textSlot(id)];
+            if (slot.valid && slot.kind == ValueKind::TEXT && strcmp(cached, value) == 0)
+                return true;
+
+            if (!send(id, value, retain))
+                return false;
+
+            memcpy(cached, value, len + 1);
+            slot.value = (int32_t)len;
+            slot.kind = ValueKind::TEXT;
+            slot.precision = 0;
+            slot.valid = true;
+            slot.retain = retain;
+            changes_++;
+            return true;
+        }
+
+        void StateCache::clear()
+        {
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                slots_[i].valid = false;
+            }
+        }
+
+        void StateCache::invalidate(Id id)
+        {
+            slots_[Entities::index(id)].valid = false;
+        }
+
+        size_t StateCache::invalidateIf(bool (*pick)(Id id))
+        {
+            size_t count = 0;
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                if (slots_[i].valid && pick(static_cast<Id>(i)))
+                {
+                    slots_[i].valid = false;
+                    count++;
+                }
+            }
+            return count;
+        }
+
+        size_t StateCache::entryCount() const
+        {
+            size_t count = 0;
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                if (slots_[i].valid)
+                    count++;
+            }
+            return count;
+        }
+
+        void StateCache::formatPayload(Id id, const Slot &slot, char *buf, size_t len) const
+        {
+            switch (slot.kind)
+            {
+            case ValueKind::BINARY:
+                snprintf(buf, len, "%s", slot.value ? "ON" : "OFF");
+                break;
+            case ValueKind::INT:
+                snprintf(buf, len, "%ld", (long)slot.value);
+                break;
+            case ValueKind::FLOAT:
+                snprintf(buf, len, "%.*f", (int)slot.precision,
+                         (double)slot.value / PRECISION_SCALE[slot.precision]);
+                break;
+            case ValueKind::TEXT:
+                snprintf(buf, len, "%s", text_[Entities::textSlot(id)]);
+                break;
+            }
+        }
+
+        size_t StateCache::republishAll()
+        {
+            size_t sent = 0;
+            char payload[TEXT_LEN];
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                if (!slots_[i].valid)
+                    continue;
+
+                Id id = static_cast<Id>(i);
+                formatPayload(id, slots_[i], payload, sizeof(payload));
+                // Republish without updating cache (since it's already the same value)
+                if (send(id, payload, slots_[i].retain))
+                    sent++;
+            }
+            return sent;
+        }
+
+        void StateCache::beginRefresh()
+        {
+            refresh_next_ = 0;
+        }
+
+        bool StateCache::refreshStep()
+        {
+            while (refresh_next_ < Entities::COUNT)
+            {
+                size_t i = refresh_next_++;
+                if (!slots_[i].valid)
+                    continue;
+
+                Id id = static_cast<Id>(i);
+                char payload[TEXT_LEN];
+                formatPayload(id, slots_[i], payload, sizeof(payload));
+                send(id, payload, slots_[i].retain);
+                return true;
+            }
+            return false;
+        }
+
+        // ---- Hot start snapshot ----
+        //
+        // Header: version, 0, entity count (u16), layout hash (u32),
+        //         value count (u16), 0, 0
+        // Entry:  entity index, kind | precision << 2 | retain << 5, then the
+        //         value: 1 byte (BINARY), 4 bytes (INT, scaled FLOAT) or a
+        //         length byte and the text (TEXT)
+        // Trailer: CRC-32 of everything before it
+        // Multi-byte fields are little-endian.
+
+        static constexpr size_t SNAPSHOT_HEADER_LEN = 12;
+
+        static uint32_t crc32(const uint8_t *data, size_t len)
+        {
+            uint32_t crc = 0xFFFFFFFFu;
+            for (size_t i = 0; i < len; i++)
+            {
+                crc ^= data[i];
+                for (int bit = 0; bit < 8; bit++)
+                    crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+            }
+            return ~crc;
+        }
+
+        static uint32_t fnv1a(uint32_t hash, const char *text)
+        {
+            for (const char *c = text; *c; c++)
+                hash = (hash ^ (uint8_t)*c) * 16777619u;
+            return hash;
+        }
+
+        // FNV-1a over every entity's suffix and kind and the state topic prefix: a
+        // snapshot taken by firmware with a different entity table, or for another
+        // device id, is not restored
+        static uint32_t layoutHash(const MQTTTopics::TopicArena &topics)
+        {
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                hash = fnv1a(hash, Entities::TABLE[i].suffix);
+                hash = (hash ^ (uint8_t)Entities::TABLE[i].kind) * 16777619u;
+            }
+            return fnv1a(hash, topics.state(static_cast<Id>(0)));
+        }
+
+        static void put16(uint8_t *p, uint16_t v)
+        {
+            p[0] = (uint8_t)v;
+            p[1] = (uint8_t)(v >> 8);
+        }
+
+        static void put32(uint8_t *p, uint32_t v)
+        {
+            for (int i = 0; i < 4; i++)
+                p[i] = (uint8_t)(v >> (8 * i));
+        }
+
+        static uint16_t get16(const uint8_t *p)
+        {
+            return (uint16_t)(p[0] | (p[1] << 8));
+        }
+
+        static uint32_t get32(const uint8_t *p)
+        {
+            return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+        }
+
+        size_t StateCache::saveSnapshot(uint8_t *buf, size_t len) const
+        {
+            if (len < SNAPSHOT_HEADER_LEN + 4 || topics_ == nullptr || !topics_->ready())
+                return 0;
+
+            size_t used = SNAPSHOT_HEADER_LEN;
+            uint16_t values = 0;
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                const Slot &slot = slots_[i];
+                if (!slot.valid)
+                    continue;
+
+                size_t text_len = 0;
+                const char *text = nullptr;
+                size_t need = 2;
+                switch (slot.kind)
+                {
+                case ValueKind::BINARY:
+                    need += 1;
+                    break;
+                case ValueKind::INT:
+                case ValueKind::FLOAT:
+                    need += 4;
+                    break;
+                case ValueKind::TEXT:
+                    text = text_[Entities::textSlot(static_cast<Id>(i))];
+                    text_len = strlen(text);
+                    need += 1 + text_len;
+                    break;
+                }
+                if (used + need + 4 > len)
+                    return 0;
+
+                buf[used++] = (uint8_t)i;
+                buf[used++] = (uint8_t)((uint8_t)slot.kind | (slot.precision << 2) | ((slot.retain ? 1 : 0) << 5));
+                switch (slot.kind)
+                {
+                case ValueKind::BINARY:
+                    buf[used++] = slot.value ? 1 : 0;
+                    break;
+                case ValueKind::INT:
+                case ValueKind::FLOAT:
+                    put32(buf + used, (uint32_t)slot.value);
+                    used += 4;
+                    break;
+                case ValueKind::TEXT:
+                    buf[used++] = (uint8_t)text_len;
+                    memcpy(buf + used, text, text_len);
+                    used += text_len;
+                    break;
+                }
+                values++;
+            }
+
+            buf[0] = SNAPSHOT_VERSION;
+            buf[1] = 0;
+            put16(buf + 2, (uint16_t)Entities::COUNT);
+            put32(buf + 4, layoutHash(*topics_));
+            put16(buf + 8, values);
+            buf[10] = 0;
+            buf[11] = 0;
+            put32(buf + used, crc32(buf, used));
+            return used + 4;
+        }
+
+        bool StateCache::loadSnapshot(const uint8_t *buf, size_t len)
+        {
+            if (topics_ == nullptr || !topics_->ready())
+                return false;
+            if (len < SNAPSHOT_HEADER_LEN + 4 || get32(buf + len - 4) != crc32(buf, len - 4))
+                return false;
+            if (buf[0] != SNAPSHOT_VERSION || get16(buf + 2) != Entities::COUNT || get32(buf + 4) != layoutHash(*topics_))
+                return false;
+
+            // Two passes over the entries, the first only checking them, so a
+            // malformed snapshot leaves the cache untouched without a scratch copy
+            const size_t end = len - 4;
+            const uint16_t values = get16(buf + 8);
+            for (int apply = 0; apply < 2; apply++)
+            {
+                if (apply)
+                    clear();
+
+                size_t pos = SNAPSHOT_HEADER_LEN;
+                for (uint16_t n = 0; n < values; n++)
+                {
+                    if (pos + 2 > end)
+                        return false;
+                    size_t i = buf[pos++];
+                    uint8_t flags = buf[pos++];
+                    ValueKind kind = static_cast<ValueKind>(flags & 0x03);
+                    uint8_t precision = (uint8_t)((flags >> 2) & 0x07);
+                    if (i >= Entities::COUNT || precision > MAX_PRECISION ||
+                        (kind == ValueKind::TEXT && Entities::TABLE[i].kind != ValueKind::TEXT))
+                        return false;
+
+                    int32_t value = 0;
+                    size_t text_len = 0;
+                    switch (kind)
+                    {
+                    case ValueKind::BINARY:
+                        if (pos + 1 > end)
+                            return false;
+                        value = buf[pos] ? 1 : 0;
+                        pos += 1;
+                        break;
+                    case ValueKind::INT:
+                    case ValueKind::FLOAT:
+                        if (pos + 4 > end)
+                            return false;
+                        value = (int32_t)get32(buf + pos);
+                        pos += 4;
+                        break;
+                    case ValueKind::TEXT:
+                        if (pos + 1 > end)
+                            return false;
+                        text_len = buf[pos++];
+                        if (text_len >= TEXT_LEN || pos + text_len > end)
+                            return false;
+                        value = (int32_t)text_len;
+                        if (apply)
+                        {
+                            char *dest = text_[Entities::textSlot(static_cast<Id>(i))];
+                            memcpy(dest, buf + pos, text_len);
+                            dest[text_len] = '\0';
+                        }
+                        pos += text_len;
+                        break;
+                    }
+
+                    if (apply)
+                        slots_[i] = {value, kind, precision, true, (flags & 0x20) != 0};
+                }
+                if (pos != end)
+                    return false;
+            }
+            return true;
+        }
+
+        SentLog::SentLog() : entries_(), next_(0)
+        {
+        }
+
+        void SentLog::sent(uint32_t token, Id id)
+        {
+            entries_[next_] = {token, (uint8_t)Entities::index(id), true};
+            next_ = (next_ + 1) % SLOTS;
+        }
+
+        bool SentLog::take(uint32_t token, Id *id)
+        {
+            for (Entry &e : entries_)
+            {
+                if (e.valid && e.token == token)
+                {
+                    e.valid = false;
+                    *id = static_cast<Id>(e.id);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool SentLog::takeAny(Id *id)
+        {
+            for (Entry &e : entries_)
+            {
+                if (e.valid)
+                {
+                    e.valid = false;
+                    *id = static_cast<Id>(e.id);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    } // namespace Publish
+} // namespace OpenTherm
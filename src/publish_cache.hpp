@@ -0,0 +1,157 @@
+// Publish-on-change cache for Home Assistant state values
+//
+// One fixed slot per entity (see mqtt_entities.hpp). Values are kept in their
+// binary form - booleans and integers as-is, floats as integers scaled by the
+// publish precision - so the steady-state "did it change?" check is a single
+// integer compare. Topics come precomputed from a TopicArena and payloads
+// are only formatted, into stack buffers, when a value actually has to go on
+// the wire. Nothing in here touches the heap.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef PUBLISH_CACHE_HPP
+#define PUBLISH_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "mqtt_entities.hpp"
+#include "topic_arena.hpp"
+
+namespace OpenTherm
+{
+    namespace Publish
+    {
+        // Puts one message on the wire; returns false if the publish failed
+        typedef bool (*PublishSink)(const char *topic, const char *payload, bool retain);
+
+        class StateCache
+        {
+        public:
+            static constexpr size_t TOPIC_LEN = 128;   // Longest state topic (for wire size estimates)
+            static constexpr size_t PAYLOAD_LEN = 32;  // Formatted numeric payloads
+            static constexpr size_t TEXT_LEN = 64;     // Longest cached text value (incl. terminator)
+            static constexpr int MAX_PRECISION = 4;
+
+            explicit StateCache(PublishSink sink);
+
+            // State topics are looked up in `topics` (TopicArena::state()); nothing
+            // is published until it is set
+            void setTopics(const MQTTTopics::TopicArena *topics) { topics_ = topics; }
+
+            // Publish if the value differs from the last successful publish.
+            // Return true if the value is on the broker (published now or already cached).
+            bool publishBinary(Entities::Id id, bool value, bool retain = false);
+            bool publishInt(Entities::Id id, int32_t value, bool retain = false);
+            bool publishFloat(Entities::Id id, float value, int precision = 2, bool retain = false);
+            bool publishText(Entities::Id id, const char *value, bool retain = false);
+
+            // Forget every cached value so the next publish of each entity goes out
+            void clear();
+
+            // Forget one entity's cached value
+            void invalidate(Entities::Id id);
+
+            // Forget the cached value of every entity `pick` selects; returns how many were cached
+            size_t invalidateIf(bool (*pick)(Entities::Id id));
+
+            // Re-send every cached value as-is; returns the number of messages sent
+            size_t republishAll();
+
+            // The same, a message at a time so the caller can pace it: beginRefresh()
+            // starts over from the first entity, each refreshStep() re-sends the next
+            // cached value and returns false once there is none left. A failed send
+            // is not retried; the value goes out again when it next changes.
+            void beginRefresh();
+            bool refreshStep();
+            bool refreshing() const { return refresh_next_ < Entities::COUNT; }
+
+            // Number of entities with a cached value
+            size_t entryCount() const;
+
+            // ---- Hot start ----
+            // The cache can be saved to flash and restored after a reboot, so the
+            // first poll cycle only publishes what changed while the gateway was
+            // down (the broker still holds the rest, retained). The snapshot is a
+            // compact binary record: a header with format version and a hash of the
+            // entity table and state topics, one entry per cached value, and a
+            // CRC-32 trailer. Both directions need setTopics() first.
+
+            static constexpr uint8_t SNAPSHOT_VERSION = 1;
+            // Worst case: header, every entity with a 4-byte value, every text
+            // entity with a full-length text, trailer
+            static constexpr size_t SNAPSHOT_LEN =
+                12 + Entities::COUNT * 6 + Entities::textEntityCount() * (TEXT_LEN + 1) + 4;
+
+            // Write the cached values to `buf`; returns the snapshot length, 0 if it does not fit
+            size_t saveSnapshot(uint8_t *buf, size_t len) const;
+
+            // Replace the cache with a saved snapshot. Rejected - and the cache left
+            // alone - if the version, the entity table, the topics or the CRC do not match.
+            bool loadSnapshot(const uint8_t *buf, size_t len);
+
+            // Values stored since construction; tells the caller whether a saved snapshot is stale
+            uint32_t changes() const { return changes_; }
+
+            // Full state topic for an entity ("" before setTopics())
+            const char *topic(Entities::Id id) const { return topics_ ? topics_->state(id) : ""; }
+
+        private:
+            struct Slot
+            {
+                int32_t value;         // bool, int, or float scaled by 10^precision
+                Entities::ValueKind kind;
+                uint8_t precision;
+                bool valid;
+                bool retain;           // As last published, for republishing
+            };
+
+            bool unchanged(Entities::Id id, const Slot &next) const;
+            bool store(Entities::Id id, const Slot &next, const char *payload, bool retain);
+            bool send(Entities::Id id, const char *payload, bool retain);
+            void formatPayload(Entities::Id id, const Slot &slot, char *buf, size_t len) const;
+
+            PublishSink sink_;
+            const MQTTTopics::TopicArena *topics_;
+            Slot slots_[Entities::COUNT];
+            char text_[Entities::textEntityCount()][TEXT_LEN];
+            size_t refresh_next_; // Next slot refreshStep() looks at; COUNT when idle
+            uint32_t changes_;
+        };
+
+        // StateCache records a value once its publish is queued, but the network
+        // core can still fail it afterwards (lwIP refuses or times it out, or the
+        // connection drops with it in flight). The log remembers which entity
+        // each recent publish carried, by request token, so the caller can
+        // invalidate the entity when the failure comes back.
+        class SentLog
+        {
+        public:
+            // At least the publishes that can be in flight at once (one request credit each)
+            static constexpr size_t SLOTS = 16;
+
+            SentLog();
+
+            void sent(uint32_t token, Entities::Id id);
+
+            // Remove the entry for `token`; false if it was not logged (too old,
+            // or not a cached state value)
+            bool take(uint32_t token, Entities::Id *id);
+
+            // Remove any entry, for failures that cannot be told apart; false once empty
+            bool takeAny(Entities::Id *id);
+
+        private:
+            struct Entry
+            {
+                uint32_t token;
+                uint8_t id;
+                bool valid;
+            };
+
+            Entry entries_[SLOTS];
+            size_t next_; // Oldest entry, overwritten by the next sent()
+        };
+
+    } // namespace Publish
+} // namespace OpenTherm
+
+#endif // PUBLISH_CACHE_HPP
@@ -0,0 +1,376 @@
+#include "publish_filter.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace OpenTherm
+{
+    namespace Publish
+    {
+        using Entities::Id;
+
+        // f8.8 temperatures jitter in the last bit (1/256 degC); 0.1 degC is below
+        // what anyone reads off a boiler graph but well above that noise floor.
+        constexpr float TEMP_DEADBAND = 0.1f;
+        constexpr uint32_t DEFAULT_MAX_SILENCE_MS = 10 * 60 * 1000;
+
+        FilterConfig defaultFilterConfig(Id id)
+        {
+            FilterConfig cfg = {0.0f, false, false, 0.0f, 0};
+
+            switch (id)
+            {
+            // Water temperatures: sensor glitches show up as single-sample spikes
+            case Id::BOILER_TEMP:
+            case Id::DHW_TEMP:
+            case Id::RETURN_TEMP:
+                cfg.deadband = TEMP_DEADBAND;
+                cfg.median3 = true;
+                cfg.max_silence_ms = DEFAULT_MAX_SILENCE_MS;
+                break;
+
+            case Id::OUTSIDE_TEMP:
+            case Id::ROOM_TEMP:
+                cfg.deadband = TEMP_DEADBAND;
+                cfg.max_silence_ms = DEFAULT_MAX_SILENCE_MS;
+                break;
+
+            case Id::MODULATION:
+                cfg.deadband = 1.0f; // percent
+                cfg.max_silence_ms = DEFAULT_MAX_SILENCE_MS;
+                break;
+
+            case Id::PRESSURE:
+                cfg.deadband = 0.02f; // bar
+                cfg.median3 = true;
+                cfg.max_silence_ms = DEFAULT_MAX_SILENCE_MS;
+                break;
+
+            case Id::DHW_FLOW:
+                cfg.deadband = 0.1f; // l/min
+                cfg.max_silence_ms = DEFAULT_MAX_SILENCE_MS;
+                break;
+
+            case Id::OT_SUCCESS_RATE:
+                cfg.deadband = 0.1f; // percent
+                cfg.max_silence_ms = DEFAULT_MAX_SILENCE_MS;
+                break;
+
+            default:
+                // Setpoints and everything else publish every change unfiltered
+                break;
+            }
+            return cfg;
+        }
+
+        static float median3(float a, float b, float c)
+        {
+            if (a > b)
+            {
+                float t = a;
+                a = b;
+                b = t;
+            }
+            // a <= b
+            if (c <= a)
+                return a;
+            if (c >= b)
+                return b;
+            return c;
+        }
+
+        FilterBank::FilterBank()
+        {
+            memset(state_, 0, sizeof(state_));
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                configs_[i] = defaultFilterConfig(static_cast<Id>(i));
+            }
+        }
+
+        const FilterConfig &FilterBank::config(Id id) const
+        {
+            return configs_[Entities::index(id)];
+        }
+
+        void FilterBank::setConfig(Id id, const FilterConfig &config)
+        {
+            size_t i = Entities::index(id);
+            configs_[i] = config;
+            if (configs_[i].ewma_alpha < 0.0f)
+                configs_[i].ewma_alpha = 0.0f;
+            if (configs_[i].ewma_alpha > 1.0f)
+                configs_[i].ewma_alpha = 1.0f;
+            if (configs_[i].deadband < 0.0f)
+                configs_[i].deadband = 0.0f;
+
+            // Restart smoothing but keep the published reference for the deadband
+            State &st = state_[i];
+            st.samples = 0;
+            st.next = 0;
+            st.has_ewma = false;
+        }
+
+        FilterDecision FilterBank::process(Id id, float raw, uint32_t now_ms, float *out)
+        {
+            size_t i = Entities::index(id);
+            const FilterConfig &cfg = configs_[i];
+            State &st = state_[i];
+
+            float value = raw;
+
+            if (cfg.median3 && std::isfinite(raw))
+            {
+                st.window[st.next] = raw;
+                st.next = (uint8_t)((st.next + 1) % 3);
+                if (st.samples < 3)
+                    st.samples++;
+                if (st.samples == 3)
+                    value = median3(st.window[0], st.window[1], st.window[2]);
+            }
+
+            if (cfg.ewma_alpha > 0.0f && std::isfinite(value))
+            {
+                if (!st.has_ewma)
+                {
+                    st.ewma = value;
+                    st.has_ewma = true;
+                }
+                else
+                {
+                    st.ewma += cfg.ewma_alpha * (value - st.ewma);
+                }
+                value = st.ewma;
+            }
+
+            *out = value;
+
+            if (!st.has_published || !std::isfinite(value) || !std::isfinite(st.last_published))
+                return FilterDecision::PUBLISH;
+
+            float threshold = cfg.relative ? cfg.deadband * std::fabs(st.last_published) : cfg.deadband;
+            if (std::fabs(value - st.last_published) >= threshold)
+                return FilterDecision::PUBLISH;
+
+            if (cfg.max_silence_ms > 0 && now_ms - st.last_publish_ms >= cfg.max_silence_ms)
+                return FilterDecision::REFRESH;
+
+            return FilterDecision::HOLD;
+        }
+
+        void FilterBank::published(Id id, float value, uint32_t now_ms)
+        {
+            State &st = state_[Entities::index(id)];
+            st.last_published = value;
+            st.last_publish_ms = now_ms;
+            st.has_published = true;
+        }
+
+        void FilterBank::forgetPublished()
+        {
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                state_[i].has_published = false;
+            }
+        }
+
+        void FilterBank::forgetPublished(Entities::Id id)
+        {
+            state_[Entities::index(id)].has_published = false;
+        }
+
+        static bool parseFlag(const char *value, bool *out)
+        {
+            if (strcmp(value, "1") == 0 || strcmp(value, "on") == 0 || strcmp(value, "true") == 0)
+            {
+                *out = true;
+                return true;
+            }
+            if (strcmp(value, "0") == 0 || strcmp(value, "off") == 0 || strcmp(value, "false") == 0)
+            {
+                *out = false;
+                return true;
+            }
+            return false;
+        }
+
+        static bool parseNumber(const char *value, float *out, bool *percent)
+        {
+            char *end = nullptr;
+            float v = strtof(value, &end);
+            if (end == value || !std::isfinite(v) || v < 0.0f)
+                return false;
+            if (percent)
+                *percent = (*end == '%');
+            if (*end == '%')
+                end++;
+            if (*end != '\0')
+                return false;
+            *out = v;
+            return true;
+        }
+
+        bool parseFilterCommand(const char *payload, const FilterBank &current,
+                                Id *id, FilterConfig *config)
+        {
+            if (payload == nullptr)
+                return false;
+
+            char buf[128];
+            if (strlen(payload) >= sizeof(buf))
+            {
+                printf("Filter command too long\n");
+                return false;
+            }
+            strcpy(buf, payload);
+
+            char *save = nullptr;
+            char *token = strtok_r(buf, " \t", &save);
+            if (token == nullptr || !Entities::findBySuffix(token, id))
+            {
+                printf("Filter command: unknown entity '%s'\n", token ? token : "");
+                return false;
+            }
+            if (Entities::descriptor(*id).kind != Entities::ValueKind::FLOAT)
+            {
+                printf("Filter command: %s is not a numeric sensor\n", token);
+                return false;
+            }
+
+            FilterConfig cfg = current.config(*id);
+
+            while ((token = strtok_r(nullptr, " \t", &save)) != nullptr)
+            {
+                if (strcmp(token, "default") == 0)
+                {
+                    cfg = defaultFilterConfig(*id);
+                    continue;
+                }
+
+                char *eq = strchr(token, '=');
+                if (eq == nullptr)
+                {
+                    printf("Filter command: expected key=value, got '%s'\n", token);
+                    return false;
+                }
+                *eq = '\0';
+                const char *key = token;
+                const char *value = eq + 1;
+
+                bool ok = false;
+                if (strcmp(key, "deadband") == 0)
+                {
+                    ok = parseNumber(value, &cfg.deadband, &cfg.relative);
+                    if (ok && cfg.relative)
+                        cfg.deadband /= 100.0f;
+                }
+                else if (strcmp(key, "median") == 0)
+                {
+                    ok = parseFlag(value, &cfg.median3);
+                }
+                else if (strcmp(key, "ewma") == 0)
+                {
+                    ok = parseNumber(value, &cfg.ewma_alpha, nullptr) && cfg.ewma_alpha <= 1.0f;
+                }
+                else if (strcmp(key, "max_silence") == 0)
+                {
+                    float seconds = 0.0f;
+                    ok = parseNumber(value, &seconds, nullptr) && seconds <= 86400.0f;
+                    if (ok)
+                        cfg.max_silence_ms = (uint32_t)(seconds * 1000.0f);
+                }
+
+                if (!ok)
+                {
+                    printf("Filter command: invalid %s=%s\n", key, value);
+                    return false;
+                }
+            }
+
+            *config = cfg;
+            return true;
+        }
+
+        size_t formatFilterConfig(Id id, const FilterConfig &config, char *buf, size_t len)
+        {
+            int n;
+            if (config.relative)
+            {
+                n = snprintf(buf, len, "%s deadband=%g%% median=%d ewma=%g max_silence=%lu",
+                             Entities::descriptor(id).suffix, (double)(config.deadband * 100.0f),
+                             config.median3 ? 1 : 0, (double)config.ewma_alpha,
+                             (unsigned long)(config.max_silence_ms / 1000));
+            }
+            else
+            {
+                n = snprintf(buf, len, "%s deadband=%g median=%d ewma=%g max_silence=%lu",
+                             Entities::descriptor(id).suffix, (double)config.deadband,
+                             config.median3 ? 1 : 0, (double)config.ewma_alpha,
+                             (unsigned long)(config.max_silence_ms / 1000));
+            }
+            return n < 0 ? 0 : (size_t)n;
+        }
+
+        static bool sameConfig(const FilterConfig &a, const FilterConfig &b)
+        {
+            return a.deadband == b.deadband && a.relative == b.relative && a.median3 == b.median3 &&
+                   a.ewma_alpha == b.ewma_alpha && a.max_silence_ms == b.max_silence_ms;
+        }
+
+        bool formatFilterOverrides(const FilterBank &bank, char *buf, size_t len)
+        {
+            if (len == 0)
+                return false;
+            size_t used = 0;
+            buf[0] = '\0';
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                Id id = static_cast<Id>(i);
+                if (Entities::descriptor(id).kind != Entities::ValueKind::FLOAT ||
+                    sameConfig(bank.config(id), defaultFilterConfig(id)))
+                    continue;
+
+                if (used > 0)
+                {
+                    if (used + 1 >= len)
+                        return false;
+                    buf[used++] = '\n';
+                    buf[used] = '\0';
+                }
+                size_t n = formatFilterConfig(id, bank.config(id), buf + used, len - used);
+                if (used + n >= len)
+                    return false;
+                used += n;
+            }
+            return true;
+        }
+
+        size_t applyFilterOverrides(const char *text, FilterBank &bank)
+        {
+            size_t applied = 0;
+            while (text != nullptr && *text != '\0')
+            {
+                const char *end = strchr(text, '\n');
+                size_t n = end ? (size_t)(end - text) : strlen(text);
+
+                char line[128];
+                if (n > 0 && n < sizeof(line))
+                {
+                    memcpy(line, text, n);
+                    line[n] = '\0';
+                    Id id;
+                    FilterConfig config;
+                    if (parseFilterCommand(line, bank, &id, &config))
+                    {
+                        bank.setConfig(id, config);
+                        applied++;
+                    }
+                }
+                text = end ? end + 1 : text + n;
+            }
+            return applied;
+        }
+
+    } // namespace Publish
+} // namespace OpenTherm
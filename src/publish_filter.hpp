@@ -0,0 +1,96 @@
+// Per-entity filter stage applied to float values before publishing
+//
+// Pipeline per sample: optional median-of-3 (rejects single-sample glitches)
+// -> optional EWMA smoothing -> deadband against the last published value.
+// A max-silence interval forces a refresh even when the value is inside the
+// deadband, so Home Assistant never goes stale.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef PUBLISH_FILTER_HPP
+#define PUBLISH_FILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "mqtt_entities.hpp"
+
+namespace OpenTherm
+{
+    namespace Publish
+    {
+        struct FilterConfig
+        {
+            float deadband;          // 0 = publish every change
+            bool relative;           // deadband is a fraction of the last published value
+            bool median3;            // Median of the last 3 raw samples
+            float ewma_alpha;        // 0 = off, else weight of the newest sample (0..1]
+            uint32_t max_silence_ms; // 0 = never force a refresh
+        };
+
+        enum class FilterDecision : uint8_t
+        {
+            HOLD,    // Inside the deadband - nothing to publish
+            PUBLISH, // Moved outside the deadband (or first sample)
+            REFRESH  // Inside the deadband but max-silence expired - publish even if unchanged
+        };
+
+        // Built-in defaults per entity (all-zero = no filtering)
+        FilterConfig defaultFilterConfig(Entities::Id id);
+
+        class FilterBank
+        {
+        public:
+            FilterBank();
+
+            const FilterConfig &config(Entities::Id id) const;
+
+            // Replace an entity's config; resets its smoothing state
+            void setConfig(Entities::Id id, const FilterConfig &config);
+
+            // Feed a raw sample. Writes the filtered value to *out and decides whether to publish.
+            FilterDecision process(Entities::Id id, float raw, uint32_t now_ms, float *out);
+
+            // Record a successful publish of the filtered value
+            void published(Entities::Id id, float value, uint32_t now_ms);
+
+            // Forget last published values (smoothing state is kept), so the next sample publishes
+            void forgetPublished();
+            void forgetPublished(Entities::Id id);
+
+        private:
+            struct State
+            {
+                float window[3];
+                uint8_t samples; // Valid entries in window (saturates at 3)
+                uint8_t next;    // Next window slot to overwrite
+                bool has_ewma;
+                bool has_published;
+                float ewma;
+                float last_published;
+                uint32_t last_publish_ms;
+            };
+
+            FilterConfig configs_[Entities::COUNT];
+            State state_[Entities::COUNT];
+        };
+
+        // Parse "<entity> [deadband=<v>[%]] [median=0|1] [ewma=<alpha>] [max_silence=<s>]" or
+        // "<entity> default". Keys not given keep their value from `current`.
+        bool parseFilterCommand(const char *payload, const FilterBank &current,
+                                Entities::Id *id, FilterConfig *config);
+
+        // Format a config in the same syntax parseFilterCommand accepts; returns length
+        size_t formatFilterConfig(Entities::Id id, const FilterConfig &config, char *buf, size_t len);
+
+        // The configs that differ from the built-in defaults, one formatFilterConfig()
+        // line each ('\n' separated), for saving to flash. Writes "" if there are none;
+        // false if they do not all fit `len`.
+        bool formatFilterOverrides(const FilterBank &bank, char *buf, size_t len);
+
+        // Apply text from formatFilterOverrides(); lines that no longer parse (e.g. a
+        // removed entity) are skipped. Returns the number of configs applied.
+        size_t applyFilterOverrides(const char *text, FilterBank &bank);
+
+    } // namespace Publish
+} // namespace OpenTherm
+
+#endif // PUBLISH_FILTER_HPP
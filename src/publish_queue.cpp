@@ -0,0 +1,371 @@
+#include "publish_queue.hpp"
+#include <cstdio>
+#include <cstring>
+
+namespace OpenTherm
+{
+    namespace Publish
+    {
+        using Entities::Id;
+        using Entities::ValueKind;
+
+        Priority priorityOf(Id id)
+        {
+            switch (id)
+            {
+            // What a thermostat or automation reacts to, and echoes of HA commands
+            case Id::FAULT:
+            case Id::CH_MODE:
+            case Id::DHW_MODE:
+            case Id::FLAME:
+            case Id::COOLING:
+            case Id::DIAGNOSTIC:
+            case Id::CH_ENABLE:
+            case Id::DHW_ENABLE:
+            case Id::CONTROL_SETPOINT:
+            case Id::ROOM_SETPOINT:
+            case Id::DHW_SETPOINT:
+            case Id::MAX_CH_SETPOINT:
+            case Id::FAULT_CODE:
+            case Id::DEVICE_NAME:
+            case Id::DEVICE_ID:
+            case Id::OPENTHERM_TX_PIN:
+            case Id::OPENTHERM_RX_PIN:
+            case Id::UPDATE_INTERVAL:
+            case Id::FILTER:
+            case Id::POLL_TIERS:
+            case Id::STATS_WINDOW:
+            case Id::SHORT_CYCLING:
+                return Priority::CONTROL;
+
+            case Id::BOILER_TEMP:
+            case Id::DHW_TEMP:
+            case Id::RETURN_TEMP:
+            case Id::OUTSIDE_TEMP:
+            case Id::ROOM_TEMP:
+            case Id::EXHAUST_TEMP:
+            case Id::MODULATION:
+            case Id::MAX_MODULATION:
+            case Id::PRESSURE:
+            case Id::DHW_FLOW:
+                return Priority::TEMPERATURE;
+
+            case Id::BURNER_STARTS:
+            case Id::CH_PUMP_STARTS:
+            case Id::DHW_PUMP_STARTS:
+            case Id::BURNER_HOURS:
+            case Id::CH_PUMP_HOURS:
+            case Id::DHW_PUMP_HOURS:
+            case Id::DIAGNOSTIC_CODE:
+            case Id::DHW_PRESENT:
+            case Id::COOLING_SUPPORTED:
+            case Id::CH2_PRESENT:
+            case Id::OPENTHERM_VERSION:
+            case Id::DAY_OF_WEEK:
+            case Id::TIME_OF_DAY:
+            case Id::DATE:
+            case Id::YEAR:
+            case Id::DHW_SETPOINT_MIN:
+            case Id::DHW_SETPOINT_MAX:
+            case Id::CH_SETPOINT_MIN:
+            case Id::CH_SETPOINT_MAX:
+            // Low-rate aggregates: one value per statistics window
+            case Id::BOILER_TEMP_MEAN:
+            case Id::BOILER_TEMP_MIN:
+            case Id::BOILER_TEMP_MAX:
+            case Id::DELTA_T_MEAN:
+            case Id::DELTA_T_EWMA:
+            case Id::MODULATION_MEAN:
+            case Id::FLAME_DUTY:
+            case Id::CH_TIME:
+            case Id::DHW_TIME:
+            case Id::STARTS_PER_HOUR:
+            case Id::BURN_TIME_MIN:
+            case Id::BURN_TIME_MEAN:
+            case Id::BURN_TIME_MAX:
+            case Id::OFF_TIME_MEAN:
+            case Id::SHORT_CYCLES:
+                return Priority::COUNTER;
+
+            default:
+                // WiFi, system health, MQTT and OpenTherm statistics
+                return Priority::DIAGNOSTIC;
+            }
+        }
+
+        static const char *const PRIORITY_NAMES[PRIORITY_COUNT] = {"control", "temperature", "counter", "diagnostic"};
+
+        const char *priorityName(Priority priority)
+        {
+            return PRIORITY_NAMES[static_cast<size_t>(priority)];
+        }
+
+        bool restoresTentatively(Id id)
+        {
+            return priorityOf(id) == Priority::CONTROL || Entities::descriptor(id).kind == ValueKind::BINARY;
+        }
+
+        PublishQueue::PublishQueue(size_t capacity)
+            : capacity_(capacity > Entities::COUNT ? Entities::COUNT : capacity),
+              total_(0), high_water_(0), enqueued_(0)
+        {
+            memset(values_, 0, sizeof(values_));
+            memset(queued_, 0, sizeof(queued_));
+            memset(deferred_, 0, sizeof(deferred_));
+            memset(next_, NIL, sizeof(next_));
+            memset(head_, NIL, sizeof(head_));
+            memset(tail_, NIL, sizeof(tail_));
+            memset(count_, 0, sizeof(count_));
+            memset(stats_, 0, sizeof(stats_));
+            memset(text_, 0, sizeof(text_));
+        }
+
+        void PublishQueue::append(size_t cls, size_t i)
+        {
+            next_[i] = NIL;
+            if (tail_[cls] == NIL)
+                head_[cls] = (uint8_t)i;
+            else
+                next_[tail_[cls]] = (uint8_t)i;
+            tail_[cls] = (uint8_t)i;
+            count_[cls]++;
+            total_++;
+            queued_[i] = true;
+            deferred_[i] = false;
+        }
+
+        size_t PublishQueue::popFront(size_t cls)
+        {
+            size_t i = head_[cls];
+            head_[cls] = next_[i];
+            if (head_[cls] == NIL)
+                tail_[cls] = NIL;
+            count_[cls]--;
+            total_--;
+            queued_[i] = false;
+            return i;
+        }
+
+        bool PublishQueue::admit(Id id)
+        {
+            size_t i = Entities::index(id);
+            size_t cls = static_cast<size_t>(priorityOf(id));
+            if (queued_[i])
+            {
+                stats_[cls].coalesced++;
+                enqueued_++;
+                return true;
+            }
+
+            if (total_ >= capacity_)
+            {
+                // Make room by shedding the oldest record of the lowest class below ours
+                size_t victim = PRIORITY_COUNT;
+                for (size_t c = PRIORITY_COUNT; c-- > cls + 1;)
+                {
+                    if (count_[c] > 0)
+                    {
+                        victim = c;
+                        break;
+                    }
+                }
+                if (victim == PRIORITY_COUNT)
+                {
+                    stats_[cls].shed++;
+                    return false;
+                }
+                popFront(victim);
+                stats_[victim].shed++;
+            }
+
+            append(cls, i);
+            if (total_ > high_water_)
+                high_water_ = total_;
+            enqueued_++;
+            return true;
+        }
+
+        bool PublishQueue::pushBinary(Id id, bool value, bool retain)
+        {
+            if (!admit(id))
+                return false;
+            QueuedValue &v = values_[Entities::index(id)];
+            v.kind = ValueKind::BINARY;
+            v.retain = retain;
+            v.binary = value;
+            return true;
+        }
+
+        bool PublishQueue::pushInt(Id id, int32_t value, bool retain)
+        {
+            if (!admit(id))
+                return false;
+            QueuedValue &v = values_[Entities::index(id)];
+            v.kind = ValueKind::INT;
+            v.retain = retain;
+            v.integer = value;
+            return true;
+        }
+
+        bool PublishQueue::pushFloat(Id id, float value, int precision, bool retain)
+        {
+            if (!admit(id))
+                return false;
+            QueuedValue &v = values_[Entities::index(id)];
+            v.kind = ValueKind::FLOAT;
+            v.retain = retain;
+            v.precision = (uint8_t)(precision < 0 ? 0 : precision);
+            v.real = value;
+            return true;
+        }
+
+        bool PublishQueue::canQueueText(Id id, const char *value)
+        {
+            return value != nullptr && Entities::descriptor(id).kind == ValueKind::TEXT &&
+                   strnlen(value, TEXT_LEN) < TEXT_LEN;
+        }
+
+        bool PublishQueue::pushText(Id id, const char *value, bool retain)
+        {
+            if (!canQueueText(id, value) || !admit(id))
+                return false;
+
+            QueuedValue &v = values_[Entities::index(id)];
+            v.kind = ValueKind::TEXT;
+            v.retain = retain;
+            strcpy(text_[Entities::textSlot(id)], value);
+            return true;
+        }
+
+        size_t PublishQueue::drain(DrainHandler handler, HeadroomProbe headroom, size_t max_records)
+        {
+            size_t sent = 0;
+            for (size_t cls = 0; cls < PRIORITY_COUNT; cls++)
+            {
+                while (count_[cls] > 0)
+                {
+                    if (sent >= max_records)
+                        return sent;
+
+                    if (headroom != nullptr && DRAIN_RESERVE_PERCENT[cls] > 0 &&
+                        headroom() <= DRAIN_RESERVE_PERCENT[cls])
+                    {
+                        // Keep the remaining credits for higher classes; reserves grow
+                        // with the class, so everything from here down waits
+                        markDeferred(cls);
+                        return sent;
+                    }
+
+                    size_t i = head_[cls];
+
+                    Id id = static_cast<Id>(i);
+                    QueuedValue v = values_[i];
+                    v.text = v.kind == ValueKind::TEXT ? text_[Entities::textSlot(id)] : nullptr;
+
+                    if (!handler(id, v))
+                        return sent; // Back-pressure: leave it at the head for the next drain
+
+                    popFront(cls);
+                    sent++;
+                }
+            }
+            return sent;
+        }
+
+        void PublishQueue::markDeferred(size_t from_cls)
+        {
+            for (size_t cls = from_cls; cls < PRIORITY_COUNT; cls++)
+            {
+                for (size_t k = head_[cls]; k != NIL; k = next_[k])
+                {
+                    if (!deferred_[k])
+                    {
+                        deferred_[k] = true;
+                        stats_[cls].deferred++;
+                    }
+                }
+            }
+        }
+
+        void PublishQueue::clear()
+        {
+            for (size_t cls = 0; cls < PRIORITY_COUNT; cls++)
+            {
+                stats_[cls].shed += (uint32_t)count_[cls];
+                while (count_[cls] > 0)
+                    popFront(cls);
+            }
+        }
+
+        bool PublishQueue::queued(Id id) const
+        {
+            return queued_[Entities::index(id)];
+        }
+
+        size_t PublishQueue::takeHighWater()
+        {
+            size_t high = high_water_;
+            high_water_ = total_;
+            return high;
+        }
+
+        uint32_t PublishQueue::coalesced() const
+        {
+            uint32_t n = 0;
+            for (size_t cls = 0; cls < PRIORITY_COUNT; cls++)
+                n += stats_[cls].coalesced;
+            return n;
+        }
+
+        uint32_t PublishQueue::dropped() const
+        {
+            uint32_t n = 0;
+            for (size_t cls = 0; cls < PRIORITY_COUNT; cls++)
+                n += stats_[cls].shed;
+            return n;
+        }
+
+        static const char *const PRIORITY_TAGS[PRIORITY_COUNT] = {"ctl", "temp", "cnt", "diag"};
+
+        // At most four characters: 999, then 999k, 999M and 4G
+        static void formatCount(uint32_t n, char *buf, size_t len)
+        {
+            if (n < 1000)
+                snprintf(buf, len, "%lu", (unsigned long)n);
+            else if (n < 1000000)
+                snprintf(buf, len, "%luk", (unsigned long)(n / 1000));
+            else if (n < 1000000000)
+                snprintf(buf, len, "%luM", (unsigned long)(n / 1000000));
+            else
+                snprintf(buf, len, "%luG", (unsigned long)(n / 1000000000));
+        }
+
+        size_t formatPriorityStats(const PublishQueue &queue, char *buf, size_t len)
+        {
+            PriorityStats stats[PRIORITY_COUNT];
+            for (size_t cls = 0; cls < PRIORITY_COUNT; cls++)
+                stats[cls] = queue.stats(static_cast<Priority>(cls));
+            return formatPriorityStats(stats, buf, len);
+        }
+
+        size_t formatPriorityStats(const PriorityStats (&stats)[PRIORITY_COUNT], char *buf, size_t len)
+        {
+            size_t used = 0;
+            for (size_t cls = 0; cls < PRIORITY_COUNT; cls++)
+            {
+                const PriorityStats &s = stats[cls];
+                char deferred[8];
+                char shed[8];
+                formatCount(s.deferred, deferred, sizeof(deferred));
+                formatCount(s.shed, shed, sizeof(shed));
+                int n = snprintf(used < len ? buf + used : nullptr, used < len ? len - used : 0, "%s%s %s/%s",
+                                 cls == 0 ? "" : " ", PRIORITY_TAGS[cls], deferred, shed);
+                if (n < 0)
+                    return used;
+                used += (size_t)n;
+            }
+            return used;
+        }
+
+    } // namespace Publish
+} // namespace OpenTherm
@@ -0,0 +1,159 @@
+// Bounded publish queue between OpenTherm acquisition and MQTT
+//
+// The HA layer enqueues (entity, value) records and returns immediately; a
+// drain step later hands them to MQTT while flow-control credits last. Each
+// entity has one fixed slot, so a newer value for an entity that is still
+// queued replaces the old one in place (latest value wins, queue position
+// kept) and the queue can never hold more than one record per entity.
+// Records are plain structs in fixed arrays - nothing touches the heap.
+//
+// Every entity belongs to a priority class with its own FIFO. The drain
+// serves classes in order, and lower classes also need a share of the
+// flow-control credits to be free, so under back-pressure diagnostics wait
+// (and keep coalescing) while control state still goes out. When the queue
+// is full a new record evicts the oldest record of a lower class.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef PUBLISH_QUEUE_HPP
+#define PUBLISH_QUEUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "mqtt_entities.hpp"
+
+namespace OpenTherm
+{
+    namespace Publish
+    {
+        enum class Priority : uint8_t
+        {
+            CONTROL,     // Status flags, switches, setpoints, command echoes
+            TEMPERATURE, // Temperatures, modulation, pressure, flow
+            COUNTER,     // Starts/hours counters, date/time, bounds, boiler info
+            DIAGNOSTIC,  // WiFi, heap, MQTT and OpenTherm statistics
+            COUNT
+        };
+
+        constexpr size_t PRIORITY_COUNT = static_cast<size_t>(Priority::COUNT);
+
+        Priority priorityOf(Entities::Id id);
+        const char *priorityName(Priority priority);
+
+        // Hot start values that may lag the broker. The snapshot is saved at most
+        // every 30 minutes, so control state published after the last save (the
+        // flame coming on) is stale on flash. A first reading after the reboot
+        // that matches the stale copy would be suppressed while the broker still
+        // shows the newer value, so these are dropped from a restored cache and
+        // their first reading always goes out.
+        bool restoresTentatively(Entities::Id id);
+
+        // Free flow-control credits (percent) a class needs before it is drained
+        constexpr uint8_t DRAIN_RESERVE_PERCENT[PRIORITY_COUNT] = {0, 12, 25, 50};
+
+        struct QueuedValue
+        {
+            Entities::ValueKind kind;
+            bool retain;
+            uint8_t precision; // FLOAT only
+            union
+            {
+                bool binary;
+                int32_t integer;
+                float real;
+            };
+            const char *text;  // TEXT only; valid for the duration of the drain callback
+        };
+
+        // Sends one record; return false under back-pressure to stop the drain
+        // and keep the record at the head of the queue
+        typedef bool (*DrainHandler)(Entities::Id id, const QueuedValue &value);
+
+        // Percentage of flow-control credits currently free
+        typedef uint32_t (*HeadroomProbe)();
+
+        struct PriorityStats
+        {
+            uint32_t coalesced; // Values replaced by a newer one before they were sent
+            uint32_t deferred;  // Records held back at least once for lack of headroom
+            uint32_t shed;      // Records evicted or refused because the queue was full
+        };
+
+        class PublishQueue
+        {
+        public:
+            static constexpr size_t TEXT_LEN = 64; // Longest queued text value (incl. terminator)
+
+            // `capacity` limits how many distinct entities may wait at once
+            explicit PublishQueue(size_t capacity = Entities::COUNT);
+
+            // Return false if the record was shed (queue full of equal or higher classes)
+            bool pushBinary(Entities::Id id, bool value, bool retain = false);
+            bool pushInt(Entities::Id id, int32_t value, bool retain = false);
+            bool pushFloat(Entities::Id id, float value, int precision = 2, bool retain = false);
+            bool pushText(Entities::Id id, const char *value, bool retain = false);
+
+            // Text must belong to a TEXT entity and fit TEXT_LEN; pushText() rejects
+            // anything else without counting it as shed, and callers publish it directly
+            static bool canQueueText(Entities::Id id, const char *value);
+
+            // Hand up to `max_records` records to `handler`, highest class first and
+            // FIFO within a class; returns the number it accepted. With a `headroom`
+            // probe, a class is only drained while more than its
+            // DRAIN_RESERVE_PERCENT of credits is free.
+            size_t drain(DrainHandler handler, HeadroomProbe headroom = nullptr,
+                         size_t max_records = Entities::COUNT);
+
+            // Discard everything queued (counted as shed)
+            void clear();
+
+            bool queued(Entities::Id id) const;
+            size_t depth() const { return total_; }
+            size_t depth(Priority priority) const { return count_[static_cast<size_t>(priority)]; }
+            size_t capacity() const { return capacity_; }
+
+            // Deepest the queue has been since the last call; resets to the current depth
+            size_t takeHighWater();
+
+            uint32_t enqueued() const { return enqueued_; } // Records accepted (including coalesced)
+            uint32_t coalesced() const;
+            uint32_t dropped() const;                       // All classes' shed records
+            const PriorityStats &stats(Priority priority) const { return stats_[static_cast<size_t>(priority)]; }
+
+        private:
+            static constexpr uint8_t NIL = 0xFF;
+
+            // Claim the entity's slot: true if the value should be written there
+            bool admit(Entities::Id id);
+            void append(size_t cls, size_t i);
+            size_t popFront(size_t cls);
+            void markDeferred(size_t from_cls);
+
+            QueuedValue values_[Entities::COUNT];
+            bool queued_[Entities::COUNT];
+            bool deferred_[Entities::COUNT];
+            uint8_t next_[Entities::COUNT]; // Per-class singly linked FIFOs of entity indices
+            uint8_t head_[PRIORITY_COUNT];
+            uint8_t tail_[PRIORITY_COUNT];
+            size_t count_[PRIORITY_COUNT];
+            PriorityStats stats_[PRIORITY_COUNT];
+            char text_[Entities::textEntityCount()][TEXT_LEN];
+            size_t capacity_;
+            size_t total_;
+            size_t high_water_;
+            uint32_t enqueued_;
+        };
+
+        static_assert(Entities::COUNT < 0xFF, "PublishQueue stores entity indices as uint8_t");
+
+        // "ctl 0/0 temp 0/0 cnt 3/0 diag 12k/1" (deferred/shed); counts past 999
+        // are cut to three digits and a k/M/G suffix, so the text never grows
+        // past 57 characters and always fits a text value
+        static constexpr size_t PRIORITY_STATS_LEN = 4 * (4 + 1 + 4 + 1 + 4) + 3 + 1;
+        static_assert(PRIORITY_STATS_LEN <= PublishQueue::TEXT_LEN, "Priority stats must fit a text value");
+        size_t formatPriorityStats(const PublishQueue &queue, char *buf, size_t len);
+        size_t formatPriorityStats(const PriorityStats (&stats)[PRIORITY_COUNT], char *buf, size_t len);
+
+    } // namespace Publish
+} // namespace OpenTherm
+
+#endif // PUBLISH_QUEUE_HPP
@@ -0,0 +1,129 @@
+// Running aggregates with an O(1) update and fixed memory
+//
+// Building blocks for the boiler statistics (see boiler_stats.hpp), templated
+// over the signal type so the same code serves temperatures (float),
+// modulation steps or counters (integers):
+//
+//   RunningStats<T>  count, min, max, mean and variance (Welford's method)
+//   Ewma<T>          exponentially weighted moving average
+//   TimeShare        how long a binary signal was on (flame, CH, DHW)
+//
+// Nothing here keeps the samples themselves; a window is ended by reading the
+// aggregate and calling reset().
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef RUNNING_STATS_HPP
+#define RUNNING_STATS_HPP
+
+#include <cstdint>
+
+namespace OpenTherm
+{
+    namespace Stats
+    {
+        template <typename T>
+        class RunningStats
+        {
+        public:
+            RunningStats() { reset(); }
+
+            void reset()
+            {
+                count_ = 0;
+                min_ = T();
+                max_ = T();
+                mean_ = 0.0f;
+                m2_ = 0.0f;
+            }
+
+            // Welford: the mean and the sum of squared differences from it are
+            // updated in place, so no sum of squares can lose precision
+            void add(T value)
+            {
+                if (count_ == 0 || value < min_)
+                    min_ = value;
+                if (count_ == 0 || value > max_)
+                    max_ = value;
+                count_++;
+                float x = (float)value;
+                float delta = x - mean_;
+                mean_ += delta / (float)count_;
+                m2_ += delta * (x - mean_);
+            }
+
+            uint32_t count() const { return count_; }
+            T min() const { return min_; }
+            T max() const { return max_; }
+            float mean() const { return mean_; }
+            float variance() const { return count_ > 1 ? m2_ / (float)count_ : 0.0f; } // Population
+
+        private:
+            uint32_t count_;
+            T min_;
+            T max_;
+            float mean_;
+            float m2_;
+        };
+
+        template <typename T>
+        class Ewma
+        {
+        public:
+            // `alpha` is the weight of each new sample, 0 < alpha <= 1
+            explicit Ewma(float alpha) : alpha_(alpha), value_(0.0f), primed_(false) {}
+
+            void add(T value)
+            {
+                float x = (float)value;
+                value_ = primed_ ? value_ + alpha_ * (x - value_) : x; // The first sample seeds it
+                primed_ = true;
+            }
+
+            bool primed() const { return primed_; }
+            float value() const { return value_; }
+            void reset() { primed_ = false; }
+
+        private:
+            float alpha_;
+            float value_;
+            bool primed_;
+        };
+
+        class TimeShare
+        {
+        public:
+            TimeShare() : on_(false), known_(false), since_ms_(0), on_ms_(0) {}
+
+            // The signal's state as of `now_ms`; time before the first call is not counted
+            void set(bool on, uint32_t now_ms)
+            {
+                if (known_ && on_)
+                    on_ms_ += now_ms - since_ms_;
+                on_ = on;
+                known_ = true;
+                since_ms_ = now_ms;
+            }
+
+            bool known() const { return known_; }
+
+            // Time on since the previous take(), up to `now_ms`; starts the next window
+            uint32_t take(uint32_t now_ms)
+            {
+                if (known_)
+                    set(on_, now_ms);
+                uint32_t on_ms = on_ms_;
+                on_ms_ = 0;
+                return on_ms;
+            }
+
+        private:
+            bool on_;
+            bool known_;
+            uint32_t since_ms_;
+            uint32_t on_ms_;
+        };
+
+    } // namespace Stats
+} // namespace OpenTherm
+
+#endif // RUNNING_STATS_HPP
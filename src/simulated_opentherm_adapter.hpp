@@ -261,24 +261,41 @@ namespace OpenTherm
             }
 
             // Write functions
-            bool writeControlSetpoint(float temperature) override
+            bool writeControlSetpoint(float temperature, float *acknowledged) override
             {
-                return sim_.writeRoomSetpoint(temperature);
+                if (!sim_.writeRoomSetpoint(temperature))
+                    return false;
+                // The simulator's "WRITE-ACK" is the value it now holds
+                if (acknowledged)
+                    *acknowledged = sim_.readRoomSetpoint();
+                return true;
             }
 
-            bool writeRoomSetpoint(float temperature) override
+            bool writeRoomSetpoint(float temperature, float *acknowledged) override
             {
-                return sim_.writeRoomSetpoint(temperature);
+                if (!sim_.writeRoomSetpoint(temperature))
+                    return false;
+                if (acknowledged)
+                    *acknowledged = sim_.readRoomSetpoint();
+                return true;
             }
 
-            bool writeDHWSetpoint(float temperature) override
+            bool writeDHWSetpoint(float temperature, float *acknowledged) override
             {
-                return sim_.writeDHWSetpoint(temperature);
+                if (!sim_.writeDHWSetpoint(temperature))
+                    return false;
+                if (acknowledged)
+                    *acknowledged = sim_.readDHWSetpoint();
+                return true;
             }
 
-            bool writeMaxCHSetpoint(float temperature) override
+            bool writeMaxCHSetpoint(float temperature, float *acknowledged) override
             {
-                return sim_.writeMaxCHSetpoint(temperature);
+                if (!sim_.writeMaxCHSetpoint(temperature))
+                    return false;
+                if (acknowledged)
+                    *acknowledged = sim_.readMaxCHSetpoint();
+                return true;
             }
 
             bool writeCHEnable(bool enable) override
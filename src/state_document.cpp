@@ -0,0 +1,189 @@
+#include "state_document.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace OpenTherm
+{
+    namespace Publish
+    {
+        using Entities::Id;
+        using Entities::ValueKind;
+
+        static const int32_t PRECISION_SCALE[StateDocument::MAX_PRECISION + 1] = {1, 10, 100, 1000, 10000};
+
+        StateDocument::StateDocument()
+            : dirty_(false)
+        {
+            memset(text_, 0, sizeof(text_));
+            clear();
+        }
+
+        void StateDocument::update(Id id, const Slot &next)
+        {
+            Slot &slot = slots_[Entities::index(id)];
+            if (slot.valid && slot.kind == next.kind && slot.precision == next.precision &&
+                slot.finite == next.finite && slot.value == next.value)
+                return;
+            slot = next;
+            dirty_ = true;
+        }
+
+        void StateDocument::setBinary(Id id, bool value)
+        {
+            update(id, {value ? 1 : 0, ValueKind::BINARY, 0, true, true});
+        }
+
+        void StateDocument::setInt(Id id, int32_t value)
+        {
+            update(id, {value, ValueKind::INT, 0, true, true});
+        }
+
+        void StateDocument::setFloat(Id id, float value, int precision)
+        {
+            if (precision < 0)
+                precision = 0;
+            if (precision > MAX_PRECISION)
+                precision = MAX_PRECISION;
+
+            double scaled = (double)value * PRECISION_SCALE[precision];
+            bool finite = std::isfinite(scaled) && std::fabs(scaled) < 2147483647.0;
+            update(id, {finite ? (int32_t)std::lround(scaled) : 0, ValueKind::FLOAT, (uint8_t)precision, true, finite});
+        }
+
+        bool StateDocument::setText(Id id, const char *value)
+        {
+            if (value == nullptr || Entities::descriptor(id).kind != ValueKind::TEXT)
+                return false;
+            size_t len = strnlen(value, TEXT_LEN);
+            if (len >= TEXT_LEN)
+                return false;
+
+            Slot &slot = slots_[Entities::index(id)];
+            char *stored = text_[Entities::textSlot(id)];
+            if (slot.valid && strcmp(stored, value) == 0)
+                return true;
+
+            memcpy(stored, value, len + 1);
+            slot = {(int32_t)len, ValueKind::TEXT, 0, true, true};
+            dirty_ = true;
+            return true;
+        }
+
+        size_t StateDocument::formatValue(size_t i, char *buf, size_t len) const
+        {
+            const Slot &slot = slots_[i];
+            int n = 0;
+            switch (slot.kind)
+            {
+            case ValueKind::BINARY:
+                n = snprintf(buf, len, "\"%s\"", slot.value ? "ON" : "OFF");
+                break;
+            case ValueKind::INT:
+                n = snprintf(buf, len, "%ld", (long)slot.value);
+                break;
+            case ValueKind::FLOAT:
+                if (!slot.finite)
+                    n = snprintf(buf, len, "null");
+                else
+                    n = snprintf(buf, len, "%.*f", (int)slot.precision,
+                                 (double)slot.value / PRECISION_SCALE[slot.precision]);
+                break;
+            case ValueKind::TEXT:
+            {
+                // JSON string: escape quotes, backslashes and control characters
+                const char *text = text_[Entities::textSlot(static_cast<Id>(i))];
+                size_t used = 0;
+                if (used < len)
+                    buf[used] = '"';
+                used++;
+                for (const char *p = text; *p; p++)
+                {
+                    unsigned char c = (unsigned char)*p;
+                    char escaped[8];
+                    int e;
+                    if (c == '"' || c == '\\')
+                        e = snprintf(escaped, sizeof(escaped), "\\%c", c);
+                    else if (c < 0x20)
+                        e = snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    else
+                        e = snprintf(escaped, sizeof(escaped), "%c", c);
+                    for (int k = 0; k < e; k++, used++)
+                    {
+                        if (used < len)
+                            buf[used] = escaped[k];
+                    }
+                }
+                if (used < len)
+                    buf[used] = '"';
+                used++;
+                if (len > 0)
+                    buf[used < len ? used : len - 1] = '\0';
+                return used;
+            }
+            }
+            return n < 0 ? 0 : (size_t)n;
+        }
+
+        size_t StateDocument::build(char *buf, size_t len) const
+        {
+            if (len < 3)
+                return 0;
+
+            size_t used = 0;
+            buf[used++] = '{';
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                if (!slots_[i].valid)
+                    continue;
+
+                int n = snprintf(buf + used, len - used, "%s\"%s\":", used > 1 ? "," : "", Entities::TABLE[i].suffix);
+                if (n < 0 || (size_t)n >= len - used)
+                    return 0;
+                used += (size_t)n;
+
+                size_t v = formatValue(i, buf + used, len - used);
+                if (v >= len - used)
+                    return 0;
+                used += v;
+            }
+
+            if (used + 2 > len)
+                return 0;
+            buf[used++] = '}';
+            buf[used] = '\0';
+            return used;
+        }
+
+        void StateDocument::clear()
+        {
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                slots_[i].valid = false;
+            }
+        }
+
+        bool StateDocument::has(Id id) const
+        {
+            return slots_[Entities::index(id)].valid;
+        }
+
+        size_t StateDocument::entryCount() const
+        {
+            size_t count = 0;
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                if (slots_[i].valid)
+                    count++;
+            }
+            return count;
+        }
+
+        size_t formatValueTemplate(Id id, char *buf, size_t len)
+        {
+            int n = snprintf(buf, len, "{{ value_json.%s }}", Entities::descriptor(id).suffix);
+            return n < 0 ? 0 : (size_t)n;
+        }
+
+    } // namespace Publish
+} // namespace OpenTherm
@@ -0,0 +1,80 @@
+// Aggregated JSON state document
+//
+// Alternative to one MQTT message per value: the latest value of every
+// entity is kept here and rendered as a single JSON object,
+//   {"flame":"ON","boiler_temp":45.50,"burner_starts":1234,...}
+// published on "<topic_base>/<device_id>/<state_topic_base>". Discovery
+// configs point each entity at that topic with formatValueTemplate(), whose
+// key is the entity's state topic suffix. Values are held in binary form like
+// the publish cache, so repeated identical readings do not mark the document
+// dirty, and the document is rendered into a caller-supplied fixed buffer.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef STATE_DOCUMENT_HPP
+#define STATE_DOCUMENT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "mqtt_entities.hpp"
+
+namespace OpenTherm
+{
+    namespace Publish
+    {
+        class StateDocument
+        {
+        public:
+            static constexpr size_t TEXT_LEN = 64;         // Longest text value (incl. terminator)
+            static constexpr size_t DOCUMENT_LEN = 2300;   // Leaves room for the header in lwIP's 2.5 KB output ring
+            static constexpr size_t TOPIC_LEN = 3 * 63 + 2; // "<topic_base>/<device_id>/<state_topic_base>" at its longest
+            static constexpr int MAX_PRECISION = 4;
+
+            StateDocument();
+
+            // Store the latest value; a value that differs (at publish precision)
+            // from the stored one marks the document dirty
+            void setBinary(Entities::Id id, bool value);
+            void setInt(Entities::Id id, int32_t value);
+            void setFloat(Entities::Id id, float value, int precision = 2);
+            // Returns false for non-TEXT entities and values that do not fit TEXT_LEN
+            bool setText(Entities::Id id, const char *value);
+
+            // Render the document into buf; returns its length, or 0 if it does not fit
+            size_t build(char *buf, size_t len) const;
+
+            bool dirty() const { return dirty_; }
+            void markDirty() { dirty_ = true; } // Send the next document even if nothing changed
+            void markSent() { dirty_ = false; }
+
+            // Forget every value (the next document starts empty)
+            void clear();
+
+            bool has(Entities::Id id) const;
+            size_t entryCount() const;
+
+        private:
+            struct Slot
+            {
+                int32_t value; // bool, int, float scaled by 10^precision, or text length
+                Entities::ValueKind kind;
+                uint8_t precision;
+                bool valid;
+                bool finite; // FLOAT only; rendered as null otherwise
+            };
+
+            void update(Entities::Id id, const Slot &next);
+            size_t formatValue(size_t i, char *buf, size_t len) const;
+
+            Slot slots_[Entities::COUNT];
+            char text_[Entities::textEntityCount()][TEXT_LEN];
+            bool dirty_;
+        };
+
+        // Home Assistant value_template that extracts an entity from the document:
+        // "{{ value_json.<suffix> }}"; returns its length
+        size_t formatValueTemplate(Entities::Id id, char *buf, size_t len);
+
+    } // namespace Publish
+} // namespace OpenTherm
+
+#endif // STATE_DOCUMENT_HPP
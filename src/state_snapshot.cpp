@@ -0,0 +1,162 @@
+#include "state_snapshot.hpp"
+#include <cstring>
+
+namespace OpenTherm
+{
+    namespace Publish
+    {
+        using Entities::Id;
+        using Entities::ValueKind;
+
+        StateSnapshot::StateSnapshot()
+            : front_(0)
+        {
+            memset(slots_, 0, sizeof(slots_));
+            memset(text_, 0, sizeof(text_));
+            memset(recorded_, 0, sizeof(recorded_));
+            memset(swapped_, 0, sizeof(swapped_));
+        }
+
+        StateSnapshot::Slot &StateSnapshot::record(Id id, ValueKind kind, bool retain)
+        {
+            size_t i = Entities::index(id);
+            Slot &slot = slots_[front_ ^ 1][i];
+            slot.kind = kind;
+            slot.valid = true;
+            slot.retain = retain;
+            slot.precision = 0;
+            recorded_[i / 32] |= 1u << (i % 32);
+            return slot;
+        }
+
+        void StateSnapshot::setBinary(Id id, bool value, bool retain)
+        {
+            record(id, ValueKind::BINARY, retain).binary = value;
+        }
+
+        void StateSnapshot::setInt(Id id, int32_t value, bool retain)
+        {
+            record(id, ValueKind::INT, retain).integer = value;
+        }
+
+        void StateSnapshot::setFloat(Id id, float value, int precision, bool retain)
+        {
+            Slot &slot = record(id, ValueKind::FLOAT, retain);
+            slot.real = value;
+            slot.precision = (uint8_t)precision;
+        }
+
+        bool StateSnapshot::setText(Id id, const char *value, bool retain)
+        {
+            if (value == nullptr)
+                value = "";
+            size_t len = strnlen(value, TEXT_LEN);
+            if (Entities::descriptor(id).kind != ValueKind::TEXT || len >= TEXT_LEN)
+                return false;
+
+            memcpy(text_[front_ ^ 1][Entities::textSlot(id)], value, len + 1);
+            record(id, ValueKind::TEXT, retain);
+            return true;
+        }
+
+        bool StateSnapshot::pending() const
+        {
+            for (size_t w = 0; w < MASK_WORDS; w++)
+            {
+                if (recorded_[w] != 0)
+                    return true;
+            }
+            return false;
+        }
+
+        size_t StateSnapshot::swap()
+        {
+            front_ ^= 1;
+            memcpy(swapped_, recorded_, sizeof(swapped_));
+            memset(recorded_, 0, sizeof(recorded_));
+
+            // The new back buffer lags the front only in the slots that were just
+            // recorded; copy those so the next pass starts from the latest values
+            const uint8_t back = front_ ^ 1;
+            size_t count = 0;
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                if ((swapped_[i / 32] & (1u << (i % 32))) == 0)
+                    continue;
+                count++;
+                slots_[back][i] = slots_[front_][i];
+                if (slots_[front_][i].kind == ValueKind::TEXT)
+                {
+                    size_t t = Entities::textSlot(static_cast<Id>(i));
+                    memcpy(text_[back][t], text_[front_][t], TEXT_LEN);
+                }
+            }
+            return count;
+        }
+
+        void StateSnapshot::visitSlot(size_t i, SnapshotVisitor visit) const
+        {
+            const Slot &slot = slots_[front_][i];
+            Id id = static_cast<Id>(i);
+            QueuedValue value;
+            value.kind = slot.kind;
+            value.retain = slot.retain;
+            value.precision = slot.precision;
+            value.text = nullptr;
+            switch (slot.kind)
+            {
+            case ValueKind::BINARY:
+                value.binary = slot.binary;
+                break;
+            case ValueKind::INT:
+                value.integer = slot.integer;
+                break;
+            case ValueKind::FLOAT:
+                value.real = slot.real;
+                break;
+            case ValueKind::TEXT:
+                value.text = text_[front_][Entities::textSlot(id)];
+                break;
+            }
+            visit(id, value);
+        }
+
+        size_t StateSnapshot::forEachSwapped(SnapshotVisitor visit) const
+        {
+            size_t count = 0;
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                if ((swapped_[i / 32] & (1u << (i % 32))) == 0)
+                    continue;
+                visitSlot(i, visit);
+                count++;
+            }
+            return count;
+        }
+
+        size_t StateSnapshot::forEach(SnapshotVisitor visit) const
+        {
+            size_t count = 0;
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                if (!slots_[front_][i].valid)
+                    continue;
+                visitSlot(i, visit);
+                count++;
+            }
+            return count;
+        }
+
+        size_t StateSnapshot::entryCount() const
+        {
+            size_t count = 0;
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                if (slots_[front_][i].valid)
+                    count++;
+            }
+            return count;
+        }
+
+    } // namespace Publish
+} // namespace OpenTherm
@@ -0,0 +1,98 @@
+// Double-buffered snapshot of every state value
+//
+// Acquisition and publication are two stages. Stage one - the boiler reads -
+// records each value into the back buffer. swap() then makes the back
+// buffer the front one (a flip of the buffer index, so the front is never
+// seen half-written) and brings the new back buffer up to date with the
+// slots that changed hands. Stage two hands the front's values of the
+// finished pass to the publish queue, which the network core sends as
+// credits allow while stage one reads the next item.
+//
+// The front buffer always holds the latest value of every entity read so
+// far, so a forced republish can come from it without touching the bus.
+//
+// Stage two gets every value recorded in the pass, not only those that
+// differ from the previous front: the publish filter's max-silence refresh
+// needs to see unchanged values, and the publish cache already drops
+// repeats before they reach the wire.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef STATE_SNAPSHOT_HPP
+#define STATE_SNAPSHOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "mqtt_entities.hpp"
+#include "publish_queue.hpp"
+
+namespace OpenTherm
+{
+    namespace Publish
+    {
+        // Receives one snapshot value; value.text is valid for the duration of the call
+        typedef void (*SnapshotVisitor)(Entities::Id id, const QueuedValue &value);
+
+        class StateSnapshot
+        {
+        public:
+            static constexpr size_t TEXT_LEN = PublishQueue::TEXT_LEN; // Longest text value (incl. terminator)
+
+            StateSnapshot();
+
+            // ---- Stage one: acquisition (back buffer) ----
+
+            void setBinary(Entities::Id id, bool value, bool retain);
+            void setInt(Entities::Id id, int32_t value, bool retain);
+            void setFloat(Entities::Id id, float value, int precision, bool retain);
+            // False if `id` is not a text entity or the value does not fit TEXT_LEN
+            bool setText(Entities::Id id, const char *value, bool retain);
+
+            // Anything recorded since the last swap()
+            bool pending() const;
+
+            // Make the back buffer the front one; returns the number of entities
+            // recorded in the pass that just ended
+            size_t swap();
+
+            // ---- Stage two: publication (front buffer) ----
+
+            // Visit the entities recorded in the pass the last swap() ended
+            size_t forEachSwapped(SnapshotVisitor visit) const;
+
+            // Visit every entity the front buffer holds a value for
+            size_t forEach(SnapshotVisitor visit) const;
+
+            // Entities with a value in the front buffer
+            size_t entryCount() const;
+
+        private:
+            static constexpr size_t MASK_WORDS = (Entities::COUNT + 31) / 32;
+
+            struct Slot
+            {
+                Entities::ValueKind kind;
+                bool valid;
+                bool retain;
+                uint8_t precision;
+                union
+                {
+                    bool binary;
+                    int32_t integer;
+                    float real;
+                };
+            };
+
+            Slot &record(Entities::Id id, Entities::ValueKind kind, bool retain);
+            void visitSlot(size_t i, SnapshotVisitor visit) const;
+
+            Slot slots_[2][Entities::COUNT];
+            char text_[2][Entities::textEntityCount()][TEXT_LEN];
+            uint32_t recorded_[MASK_WORDS]; // Back buffer slots written since the last swap
+            uint32_t swapped_[MASK_WORDS];  // Front buffer slots the last swap brought in
+            uint8_t front_;
+        };
+
+    } // namespace Publish
+} // namespace OpenTherm
+
+#endif // STATE_SNAPSHOT_HPP
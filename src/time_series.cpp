@@ -0,0 +1,329 @@
+#include "time_series.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace OpenTherm
+{
+    namespace Publish
+    {
+        using Entities::Id;
+
+        const Id TimeSeries::SIGNAL_IDS[SIGNALS] = {
+            Id::BOILER_TEMP,
+            Id::RETURN_TEMP,
+            Id::MODULATION,
+            Id::FLAME,
+            Id::CONTROL_SETPOINT,
+        };
+
+        static constexpr size_t FLAME_SIGNAL = 3; // Stored as 0/1, not in tenths
+        static constexpr int32_t VALUE_LIMIT = 1000000; // Keeps every delta well inside int32
+        static constexpr uint8_t RUN = 0x80;
+        static constexpr uint8_t RUN_MAX = 0x7F; // Run length - 1
+        static constexpr uint8_t VALID_CHANGED = 0x20;
+
+        TimeSeries::TimeSeries()
+            : head_(0), count_(0), last_is_run_(false), valid_(0), encoded_valid_(0), last_s_(0)
+        {
+            memset(blocks_, 0, sizeof(blocks_));
+            memset(values_, 0, sizeof(values_));
+            memset(encoded_, 0, sizeof(encoded_));
+        }
+
+        void TimeSeries::set(Id id, float value)
+        {
+            if (!std::isfinite(value))
+                return;
+            for (size_t i = 0; i < SIGNALS; i++)
+            {
+                if (SIGNAL_IDS[i] != id)
+                    continue;
+                float scaled = i == FLAME_SIGNAL ? (value != 0.0f ? 1.0f : 0.0f) : value * SCALE;
+                if (scaled > VALUE_LIMIT)
+                    scaled = VALUE_LIMIT;
+                if (scaled < -VALUE_LIMIT)
+                    scaled = -VALUE_LIMIT;
+                values_[i] = (int32_t)std::lround(scaled);
+                valid_ |= (uint8_t)(1u << i);
+                return;
+            }
+        }
+
+        void TimeSeries::startBlock(uint32_t time_s)
+        {
+            if (count_ == BLOCKS)
+            {
+                // Full: the oldest block makes room
+                head_ = (head_ + 1) % BLOCKS;
+                count_--;
+            }
+            Block &b = blocks_[(head_ + count_) % BLOCKS];
+            count_++;
+            b.start_s = time_s;
+            b.end_s = time_s;
+            memcpy(b.base, encoded_, sizeof(b.base));
+            b.valid = encoded_valid_;
+            b.used = 0;
+            last_is_run_ = false;
+        }
+
+        void TimeSeries::appendRun(uint32_t first_s, uint32_t seconds)
+        {
+            while (seconds > 0)
+            {
+                Block &b = current();
+                uint32_t take;
+                if (last_is_run_ && (b.data[b.used - 1] & RUN_MAX) < RUN_MAX)
+                {
+                    // Extend the run in place
+                    uint32_t room = RUN_MAX - (b.data[b.used - 1] & RUN_MAX);
+                    take = seconds < room ? seconds : room;
+                    b.data[b.used - 1] += (uint8_t)take;
+                }
+                else if (b.used < BLOCK_BYTES)
+                {
+                    take = seconds < RUN_MAX + 1u ? seconds : RUN_MAX + 1u;
+                    b.data[b.used++] = (uint8_t)(RUN | (take - 1));
+                    last_is_run_ = true;
+                }
+                else
+                {
+                    // The new block's keyframe is the unchanged state at first_s
+                    startBlock(first_s);
+                    take = 1;
+                }
+                first_s += take;
+                seconds -= take;
+                current().end_s = first_s - 1;
+            }
+        }
+
+        void TimeSeries::appendChange(uint32_t time_s, uint8_t mask, bool valid_changed)
+        {
+            Block &b = current();
+            if (b.used + MAX_RECORD > BLOCK_BYTES)
+            {
+                // No room for a worst-case record: the change becomes the next keyframe
+                memcpy(encoded_, values_, sizeof(encoded_));
+                encoded_valid_ = valid_;
+                startBlock(time_s);
+                return;
+            }
+
+            b.data[b.used++] = (uint8_t)(mask | (valid_changed ? VALID_CHANGED : 0));
+            if (valid_changed)
+                b.data[b.used++] = valid_;
+            for (size_t i = 0; i < SIGNALS; i++)
+            {
+                if ((mask & (1u << i)) == 0)
+                    continue;
+                int32_t delta = values_[i] - encoded_[i];
+                uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+                while (zigzag >= 0x80)
+                {
+                    b.data[b.used++] = (uint8_t)(zigzag | 0x80);
+                    zigzag >>= 7;
+                }
+                b.data[b.used++] = (uint8_t)zigzag;
+            }
+            memcpy(encoded_, values_, sizeof(encoded_));
+            encoded_valid_ = valid_;
+            b.end_s = time_s;
+            last_is_run_ = false;
+        }
+
+        void TimeSeries::sample(uint32_t time_s)
+        {
+            if (count_ == 0)
+            {
+                memcpy(encoded_, values_, sizeof(encoded_));
+                encoded_valid_ = valid_;
+                startBlock(time_s);
+                last_s_ = time_s;
+                return;
+            }
+            if (time_s <= last_s_)
+                return;
+
+            // Seconds the loop did not sample hold the previous values
+            if (time_s - last_s_ > 1)
+                appendRun(last_s_ + 1, time_s - last_s_ - 1);
+
+            uint8_t mask = 0;
+            for (size_t i = 0; i < SIGNALS; i++)
+            {
+                if (values_[i] != encoded_[i])
+                    mask |= (uint8_t)(1u << i);
+            }
+            bool valid_changed = valid_ != encoded_valid_;
+            if (mask == 0 && !valid_changed)
+                appendRun(time_s, 1);
+            else
+                appendChange(time_s, mask, valid_changed);
+            last_s_ = time_s;
+        }
+
+        uint32_t TimeSeries::oldest() const
+        {
+            return count_ > 0 ? block(0).start_s : 0;
+        }
+
+        size_t TimeSeries::bytesUsed() const
+        {
+            size_t total = 0;
+            for (size_t i = 0; i < count_; i++)
+                total += block(i).used;
+            return total;
+        }
+
+        bool TimeSeries::step(const Block &b, size_t *offset, State *state) const
+        {
+            if (*offset >= b.used)
+                return false;
+            uint8_t record = b.data[(*offset)++];
+            if (record & RUN)
+            {
+                state->time_s += (record & RUN_MAX) + 1u;
+                return true;
+            }
+            if (record & VALID_CHANGED)
+                state->valid = b.data[(*offset)++];
+            for (size_t i = 0; i < SIGNALS; i++)
+            {
+                if ((record & (1u << i)) == 0)
+                    continue;
+                uint32_t zigzag = 0;
+                for (unsigned shift = 0; *offset < b.used && shift < 35; shift += 7)
+                {
+                    uint8_t byte = b.data[(*offset)++];
+                    zigzag |= (uint32_t)(byte & 0x7F) << shift;
+                    if ((byte & 0x80) == 0)
+                        break;
+                }
+                state->values[i] += (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+            }
+            state->time_s += 1;
+            return true;
+        }
+
+        // "[dt,v0,...]"; values in tenths are printed from the integer, so no float formatting
+        static int formatRow(char *buf, size_t len, bool comma, uint32_t dt, const int32_t *values, uint8_t valid)
+        {
+            char row[96];
+            int n = snprintf(row, sizeof(row), "%s[%lu", comma ? "," : "", (unsigned long)dt);
+            for (size_t i = 0; i < TimeSeries::SIGNALS; i++)
+            {
+                if ((valid & (1u << i)) == 0)
+                    n += snprintf(row + n, sizeof(row) - n, ",null");
+                else if (i == FLAME_SIGNAL)
+                    n += snprintf(row + n, sizeof(row) - n, ",%ld", (long)values[i]);
+                else
+                {
+                    int32_t v = values[i];
+                    uint32_t magnitude = v < 0 ? (uint32_t)(-(int64_t)v) : (uint32_t)v;
+                    n += snprintf(row + n, sizeof(row) - n, ",%s%lu.%lu", v < 0 ? "-" : "",
+                                  (unsigned long)(magnitude / TimeSeries::SCALE),
+                                  (unsigned long)(magnitude % TimeSeries::SCALE));
+                }
+            }
+            n += snprintf(row + n, sizeof(row) - n, "]");
+            if ((size_t)n >= len)
+                return -1;
+            memcpy(buf, row, (size_t)n + 1);
+            return n;
+        }
+
+        size_t TimeSeries::formatWindow(char *buf, size_t len, uint32_t from_s, uint32_t to_s, uint32_t now_s,
+                                        uint32_t *next_s) const
+        {
+            if (from_s < oldest())
+                from_s = oldest();
+            if (to_s > last_s_)
+                to_s = last_s_;
+            *next_s = to_s + 1;
+            if (count_ == 0 || from_s > to_s)
+                return 0;
+
+            int n = snprintf(buf, len, "{\"clock\":\"uptime\",\"now\":%lu,\"from\":%lu,\"signals\":[",
+                             (unsigned long)now_s, (unsigned long)from_s);
+            for (size_t i = 0; i < SIGNALS && n > 0 && (size_t)n < len; i++)
+                n += snprintf(buf + n, len - n, "%s\"%s\"", i > 0 ? "," : "", Entities::descriptor(SIGNAL_IDS[i]).suffix);
+            if (n > 0 && (size_t)n < len)
+                n += snprintf(buf + n, len - n, "],\"v\":[");
+            if (n < 0 || (size_t)n >= len)
+                return 0;
+            size_t used = (size_t)n;
+
+            // Room for the closing "],"to":4294967295}" and its terminator
+            const size_t TAIL = 20;
+            if (used + TAIL >= len)
+                return 0;
+            size_t limit = len - TAIL;
+
+            // The block holding from_s; blocks are contiguous in time
+            size_t b = 0;
+            while (b + 1 < count_ && block(b).end_s < from_s)
+                b++;
+
+            State state;
+            state.time_s = block(b).start_s;
+            memcpy(state.values, block(b).base, sizeof(state.values));
+            state.valid = block(b).valid;
+
+            // Decode up to the state at from_s
+            size_t offset = 0;
+            for (;;)
+            {
+                size_t peek_offset = offset;
+                State peek = state;
+                if (!step(block(b), &peek_offset, &peek) || peek.time_s > from_s)
+                    break;
+                offset = peek_offset;
+                state = peek;
+            }
+
+            int row = formatRow(buf + used, limit - used, false, 0, state.values, state.valid);
+            if (row < 0)
+                return 0;
+            used += (size_t)row;
+            uint32_t previous = from_s;
+            uint32_t covered = to_s;
+
+            for (;;)
+            {
+                // Next record, or the next block's keyframe; a run changes nothing
+                State next = state;
+                if (!step(block(b), &offset, &next))
+                {
+                    if (++b >= count_)
+                        break;
+                    offset = 0;
+                    next.time_s = block(b).start_s;
+                    memcpy(next.values, block(b).base, sizeof(next.values));
+                    next.valid = block(b).valid;
+                }
+                if (next.time_s > to_s)
+                    break;
+                if (memcmp(next.values, state.values, sizeof(next.values)) != 0 || next.valid != state.valid)
+                {
+                    row = formatRow(buf + used, limit - used, true, next.time_s - previous, next.values, next.valid);
+                    if (row < 0)
+                    {
+                        // Full: the next chunk starts with this row
+                        covered = next.time_s - 1;
+                        *next_s = next.time_s;
+                        break;
+                    }
+                    used += (size_t)row;
+                    previous = next.time_s;
+                }
+                state = next;
+            }
+
+            n = snprintf(buf + used, len - used, "],\"to\":%lu}", (unsigned long)covered);
+            return used + (size_t)n;
+        }
+
+    } // namespace Publish
+} // namespace OpenTherm
@@ -0,0 +1,120 @@
+// On-device history of the signals that matter for diagnosing short cycling
+//
+// Flow (boiler) and return temperature, modulation, flame and the control
+// setpoint are sampled once a second into a RAM ring. Values are kept as
+// integers in tenths (flame as 0/1) and delta-encoded against the previous
+// second, so one second costs one record:
+//
+//   0x80 | (n - 1)   n seconds (1..128) with no change; extended in place
+//   mask             bits 0-4: signals that changed, each followed by the
+//                    zigzag varint of its delta, in signal order; bit 5: the
+//                    set of known signals changed, its new mask follows first
+//
+// The ring is BLOCKS blocks of BLOCK_BYTES. Each block starts from a keyframe
+// (time and every value), so the oldest block can be dropped as a whole and a
+// query only decodes from the block holding its start. Idle periods cost a
+// byte per two minutes; see tests/bench_time_series.cpp for bytes/sample on a
+// heating trace.
+//
+// formatWindow() renders a window as compact JSON, one row per change:
+//
+//   {"clock":"uptime","now":9000,"from":5000,
+//    "signals":["boiler_temp","return_temp","modulation","flame","control_setpoint"],
+//    "v":[[0,45.5,38.0,30.0,1,50.0],[12,46.0,38.0,32.5,1,50.0]],"to":5100}
+//
+// The first row is the state at "from"; each row's first field is the seconds
+// since the previous row, and a signal not read yet is null. A window that does
+// not fit the buffer is split: "to" is the last second the chunk covers and the
+// next chunk starts right after it.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef TIME_SERIES_HPP
+#define TIME_SERIES_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "mqtt_entities.hpp"
+
+namespace OpenTherm
+{
+    namespace Publish
+    {
+        class TimeSeries
+        {
+        public:
+            static constexpr size_t SIGNALS = 5;
+            static constexpr size_t BLOCKS = 64;
+            static constexpr size_t BLOCK_BYTES = 512; // 64 x 512 = 32 KB of samples
+            static constexpr int32_t SCALE = 10;        // Values are stored in tenths (flame as 0/1)
+
+            TimeSeries();
+
+            // Latest value of a tracked entity; other ids and non-finite values are ignored
+            void set(Entities::Id id, float value);
+
+            // Record the current values for second `time_s`. Seconds skipped since
+            // the previous call keep the previous values; repeated seconds are ignored.
+            void sample(uint32_t time_s);
+
+            bool empty() const { return count_ == 0; }
+            uint32_t oldest() const; // First second still held (0 if empty)
+            uint32_t newest() const { return last_s_; }
+            size_t bytesUsed() const; // Encoded bytes across all blocks
+
+            // Render [from_s, to_s] (clamped to what is held) as JSON into `buf`.
+            // Returns the length, or 0 if nothing is held or not even one row fits.
+            // `next_s` is where the following chunk starts; past `to_s` when done.
+            size_t formatWindow(char *buf, size_t len, uint32_t from_s, uint32_t to_s, uint32_t now_s,
+                                uint32_t *next_s) const;
+
+            static const Entities::Id SIGNAL_IDS[SIGNALS];
+
+        private:
+            struct Block
+            {
+                uint32_t start_s; // Second of the keyframe
+                uint32_t end_s;   // Last second the block covers
+                int32_t base[SIGNALS];
+                uint8_t valid;
+                uint16_t used;
+                uint8_t data[BLOCK_BYTES];
+            };
+
+            struct State
+            {
+                uint32_t time_s;
+                int32_t values[SIGNALS];
+                uint8_t valid;
+            };
+
+            static constexpr size_t MAX_RECORD = 2 + SIGNALS * 5; // Mask, known-set and five varints
+
+            Block &current() { return blocks_[(head_ + count_ - 1) % BLOCKS]; }
+            const Block &block(size_t i) const { return blocks_[(head_ + i) % BLOCKS]; }
+            void startBlock(uint32_t time_s);
+            void appendRun(uint32_t first_s, uint32_t seconds);
+            void appendChange(uint32_t time_s, uint8_t mask, bool valid_changed);
+
+            // Decode the record at `*offset`; advances the state's time by the
+            // seconds it covers. False at the end of the block.
+            bool step(const Block &b, size_t *offset, State *state) const;
+
+            Block blocks_[BLOCKS];
+            size_t head_; // Oldest block
+            size_t count_;
+            bool last_is_run_; // The current block's last byte is a run that may be extended
+
+            // What the next sample will record
+            int32_t values_[SIGNALS];
+            uint8_t valid_;
+
+            // What the last sample recorded
+            int32_t encoded_[SIGNALS];
+            uint8_t encoded_valid_;
+            uint32_t last_s_;
+        };
+
+    } // namespace Publish
+} // namespace OpenTherm
+
+#endif // TIME_SERIES_HPP
@@ -0,0 +1,129 @@
+#include "topic_arena.hpp"
+#include "mqtt_topics.hpp"
+#include "opentherm_ha.hpp"
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+namespace OpenTherm
+{
+    namespace MQTTTopics
+    {
+        using Discovery::COMPONENT_COUNT;
+        using Discovery::COMPONENTS;
+
+        TopicArena::TopicArena()
+            : used_(0), ready_(false), overflow_(false), builds_(0)
+        {
+            memset(inputs_, 0, sizeof(inputs_));
+            reset();
+        }
+
+        void TopicArena::reset()
+        {
+            // Offset 0 is an empty string, so an unbuilt arena hands out "" rather than garbage
+            arena_[0] = '\0';
+            used_ = 1;
+            overflow_ = false;
+            ready_ = false;
+            for (size_t i = 0; i < Entities::COUNT; i++)
+                state_[i] = 0;
+            for (size_t i = 0; i < COMPONENT_COUNT; i++)
+                discovery_[i] = 0;
+            document_ = command_base_ = command_wildcard_ = device_discovery_ = discovery_hash_ = birth_ = history_ = time_series_ = 0;
+            command_base_len_ = 0;
+        }
+
+        uint16_t TopicArena::add(const char *fmt, ...)
+        {
+            if (overflow_)
+                return 0;
+
+            va_list args;
+            va_start(args, fmt);
+            int n = vsnprintf(arena_ + used_, ARENA_LEN - used_, fmt, args);
+            va_end(args);
+            if (n < 0 || (size_t)n >= ARENA_LEN - used_)
+            {
+                overflow_ = true;
+                return 0;
+            }
+
+            uint16_t offset = (uint16_t)used_;
+            used_ += (size_t)n + 1;
+            return offset;
+        }
+
+        bool TopicArena::unchanged(const HomeAssistant::Config &cfg) const
+        {
+            return ready_ && strcmp(inputs_[DEVICE_ID], cfg.device_id) == 0 &&
+                   strcmp(inputs_[MQTT_PREFIX], cfg.mqtt_prefix) == 0 &&
+                   strcmp(inputs_[TOPIC_BASE], cfg.topic_base) == 0 &&
+                   strcmp(inputs_[STATE_TOPIC_BASE], cfg.state_topic_base) == 0 &&
+                   strcmp(inputs_[COMMAND_TOPIC_BASE], cfg.command_topic_base) == 0;
+        }
+
+        bool TopicArena::render(const HomeAssistant::Config &cfg)
+        {
+            const char *tb = cfg.topic_base;
+            const char *id = cfg.device_id;
+
+            document_ = add("%s/%s/%s", tb, id, cfg.state_topic_base);
+            for (size_t i = 0; i < Entities::COUNT; i++)
+            {
+                state_[i] = add("%s/%s/%s/%s", tb, id, cfg.state_topic_base, Entities::TABLE[i].suffix);
+            }
+
+            command_base_ = add("%s/%s/%s/", tb, id, cfg.command_topic_base);
+            command_base_len_ = strlen(arena_ + command_base_);
+            command_wildcard_ = add("%s#", arena_ + command_base_);
+            for (size_t i = 0; i < COMPONENT_COUNT; i++)
+            {
+                const Discovery::Component &c = COMPONENTS[i];
+                discovery_[i] = add("%s/%s/%s/%s%s", cfg.mqtt_prefix, c.component, id, c.object_id,
+                                    MQTTDiscovery::CONFIG_SUFFIX);
+            }
+
+            device_discovery_ = add("%s/%s/%s%s", cfg.mqtt_prefix, MQTTDiscovery::COMPONENT_DEVICE, id,
+                                    MQTTDiscovery::CONFIG_SUFFIX);
+            discovery_hash_ = add("%s/%s/%s", tb, id, DISCOVERY_HASH);
+            birth_ = add("%s/%s", cfg.mqtt_prefix, MQTTDiscovery::BIRTH_TOPIC_SUFFIX);
+            history_ = add("%s/%s/%s", tb, id, HISTORY);
+            time_series_ = add("%s/%s/%s", tb, id, TIME_SERIES);
+            return !overflow_;
+        }
+
+        bool TopicArena::build(const HomeAssistant::Config &cfg)
+        {
+            if (unchanged(cfg))
+                return true;
+
+            reset();
+            const char *inputs[INPUT_COUNT] = {cfg.device_id, cfg.mqtt_prefix, cfg.topic_base,
+                                               cfg.state_topic_base, cfg.command_topic_base};
+            for (size_t i = 0; i < INPUT_COUNT; i++)
+            {
+                size_t len = strnlen(inputs[i], PART_LEN);
+                if (len >= PART_LEN)
+                {
+                    printf("ERROR: Topic part '%.16s...' longer than %zu characters\n", inputs[i], PART_LEN - 1);
+                    return false;
+                }
+                memcpy(inputs_[i], inputs[i], len + 1);
+            }
+
+            builds_++;
+            if (!render(cfg))
+            {
+                printf("ERROR: MQTT topics for device '%s' do not fit the %zu-byte topic arena\n",
+                       cfg.device_id, ARENA_LEN);
+                reset();
+                return false;
+            }
+
+            ready_ = true;
+            return true;
+        }
+
+    } // namespace MQTTTopics
+} // namespace OpenTherm
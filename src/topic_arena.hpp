@@ -0,0 +1,124 @@
+// Precomputed MQTT topics
+//
+// Every topic the gateway publishes or subscribes to depends only on the
+// device id and the configured prefixes, never on the value being sent.
+// TopicArena renders all of them once into a single contiguous buffer: state
+// topics indexed by Entities::Id, discovery topics indexed by their row in
+// Discovery::COMPONENTS. The publish paths then pass
+// `const char *` into the arena instead of formatting a topic per message.
+// build() compares its inputs with the last build and only re-renders when
+// the device id or a prefix changed.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef TOPIC_ARENA_HPP
+#define TOPIC_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "discovery_payload.hpp"
+#include "mqtt_entities.hpp"
+#include "state_document.hpp"
+
+namespace OpenTherm
+{
+    namespace HomeAssistant
+    {
+        struct Config;
+    }
+
+    namespace MQTTTopics
+    {
+        class TopicArena
+        {
+        public:
+            // Default ids need about 8.9 KB; each extra device id character adds ~190 bytes,
+            // so device ids up to about 39 characters fit
+            static constexpr size_t ARENA_LEN = 14336;
+            static constexpr size_t PART_LEN = 64; // Longest device id or prefix (incl. terminator)
+
+            TopicArena();
+
+            // Render every topic for `cfg`, unless the inputs match the last build.
+            // Returns false (leaving every topic empty) if an input or the topics do not fit.
+            bool build(const HomeAssistant::Config &cfg);
+
+            bool ready() const { return ready_; }
+
+            // "<topic_base>/<device_id>/<state_topic_base>/<suffix>"
+            const char *state(Entities::Id id) const { return arena_ + state_[Entities::index(id)]; }
+
+            // "<topic_base>/<device_id>/<state_topic_base>" (aggregated state document)
+            const char *stateDocument() const { return arena_ + document_; }
+
+            // "<topic_base>/<device_id>/<command_topic_base>/" - the prefix of every command topic
+            const char *commandBase() const { return arena_ + command_base_; }
+            size_t commandBaseLen() const { return command_base_len_; }
+
+            // "<topic_base>/<device_id>/<command_topic_base>/#" - the one command subscription
+            const char *commandWildcard() const { return arena_ + command_wildcard_; }
+
+            // "<prefix>/<component>/<device_id>/<object_id>/config"
+            const char *discovery(size_t component) const { return arena_ + discovery_[component]; }
+
+            // "<prefix>/device/<device_id>/config"
+            const char *deviceDiscovery() const { return arena_ + device_discovery_; }
+
+            // Retained discovery hash marker and Home Assistant's birth topic
+            const char *discoveryHash() const { return arena_ + discovery_hash_; }
+            const char *birth() const { return arena_ + birth_; }
+
+            // "<topic_base>/<device_id>/history" - offline history replay (see offline_buffer.hpp)
+            const char *history() const { return arena_ + history_; }
+
+            // "<topic_base>/<device_id>/timeseries" - time-series windows (see time_series.hpp)
+            const char *timeSeries() const { return arena_ + time_series_; }
+
+            size_t used() const { return used_; }
+            uint32_t builds() const { return builds_; } // Times the topics were (re)rendered
+
+        private:
+            enum Input
+            {
+                DEVICE_ID,
+                MQTT_PREFIX,
+                TOPIC_BASE,
+                STATE_TOPIC_BASE,
+                COMMAND_TOPIC_BASE,
+                INPUT_COUNT
+            };
+
+            bool unchanged(const HomeAssistant::Config &cfg) const;
+            bool render(const HomeAssistant::Config &cfg);
+            void reset();
+
+            // Append one printf-formatted, NUL-terminated topic; returns its offset, or 0
+            // (the empty string) once the arena has overflowed
+            uint16_t add(const char *fmt, ...);
+
+            char arena_[ARENA_LEN];
+            uint16_t state_[Entities::COUNT];
+            uint16_t discovery_[Discovery::COMPONENT_COUNT];
+            uint16_t document_;
+            uint16_t command_base_;
+            uint16_t command_wildcard_;
+            uint16_t device_discovery_;
+            uint16_t discovery_hash_;
+            uint16_t birth_;
+            uint16_t history_;
+            uint16_t time_series_;
+            size_t command_base_len_;
+            char inputs_[INPUT_COUNT][PART_LEN];
+            size_t used_;
+            bool ready_;
+            bool overflow_;
+            uint32_t builds_;
+        };
+
+        static_assert(TopicArena::ARENA_LEN < 0xFFFF, "TopicArena stores offsets as uint16_t");
+        static_assert(3 * (TopicArena::PART_LEN - 1) + 2 <= Publish::StateDocument::TOPIC_LEN,
+                      "StateDocument::TOPIC_LEN must cover the longest state document topic");
+
+    } // namespace MQTTTopics
+} // namespace OpenTherm
+
+#endif // TOPIC_ARENA_HPP
@@ -0,0 +1,100 @@
+#include "write_coalescer.hpp"
+#include <cstring>
+
+namespace OpenTherm
+{
+    namespace Commands
+    {
+        WriteCoalescer::WriteCoalescer(uint32_t window_ms)
+            : window_ms_(window_ms)
+        {
+            memset(slots_, 0, sizeof(slots_));
+            memset(&stats_, 0, sizeof(stats_));
+        }
+
+        WriteCoalescer::Slot *WriteCoalescer::find(uint8_t data_id, bool claim)
+        {
+            Slot *free_slot = nullptr;
+            for (size_t i = 0; i < SLOTS; i++)
+            {
+                if (slots_[i].used && slots_[i].data_id == data_id)
+                    return &slots_[i];
+                if (!slots_[i].used && free_slot == nullptr)
+                    free_slot = &slots_[i];
+            }
+            if (!claim || free_slot == nullptr)
+                return nullptr;
+            free_slot->used = true;
+            free_slot->data_id = data_id;
+            return free_slot;
+        }
+
+        bool WriteCoalescer::submit(uint8_t data_id, uint16_t value, uint32_t now_ms)
+        {
+            Slot *slot = find(data_id, true);
+            if (slot == nullptr)
+                return false;
+
+            if (slot->pending)
+            {
+                stats_.superseded++;
+            }
+            else
+            {
+                slot->pending = true;
+                slot->due_ms = now_ms + window_ms_;
+            }
+            slot->value = value;
+            return true;
+        }
+
+        bool WriteCoalescer::nextDue(uint32_t now_ms, uint8_t *data_id, uint16_t *value)
+        {
+            for (size_t i = 0; i < SLOTS; i++)
+            {
+                Slot &slot = slots_[i];
+                if (!slot.pending || (int32_t)(now_ms - slot.due_ms) < 0)
+                    continue;
+
+                slot.pending = false;
+                if (slot.acked_valid && slot.acked == slot.value)
+                {
+                    stats_.unchanged++;
+                    continue;
+                }
+
+                stats_.written++;
+                *data_id = slot.data_id;
+                *value = slot.value;
+                return true;
+            }
+            return false;
+        }
+
+        void WriteCoalescer::acknowledged(uint8_t data_id, uint16_t value)
+        {
+            Slot *slot = find(data_id, true);
+            if (slot == nullptr)
+                return;
+            slot->acked = value;
+            slot->acked_valid = true;
+        }
+
+        uint32_t WriteCoalescer::msUntilDue(uint32_t now_ms) const
+        {
+            uint32_t soonest = UINT32_MAX;
+            for (size_t i = 0; i < SLOTS; i++)
+            {
+                if (!slots_[i].pending)
+                    continue;
+                int32_t left = (int32_t)(slots_[i].due_ms - now_ms);
+                if (left <= 0)
+                    return 0;
+                if ((uint32_t)left < soonest)
+                    soonest = (uint32_t)left;
+            }
+            return soonest;
+        }
+
+    } // namespace Commands
+} // namespace OpenTherm
@@ -0,0 +1,81 @@
+// Coalescing of setpoint writes to the boiler
+//
+// Dragging a Home Assistant number slider sends a burst of commands, and
+// every OpenTherm write blocks the main loop for up to a second. Setpoint
+// commands are therefore not written straight away: submit() parks the value
+// in a slot per data ID and starts a short window. A newer value for the same
+// data ID within the window replaces the parked one, which never reaches the
+// bus. When the window expires nextDue() hands out the latest value - unless
+// it equals the value the boiler last acknowledged, in which case the write
+// is skipped. The window starts at the first value of a burst and is not
+// extended, so a slider held in motion still gets written every window.
+//
+// Values are kept in the wire encoding (f8.8 for setpoints), so "equal" means
+// equal on the bus rather than float-equal.
+//
+// Kept free of pico/lwIP dependencies so it can be unit tested on the host.
+#ifndef WRITE_COALESCER_HPP
+#define WRITE_COALESCER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace OpenTherm
+{
+    namespace Commands
+    {
+        struct CoalescerStats
+        {
+            uint32_t written;    // Writes handed out by nextDue()
+            uint32_t superseded; // Values replaced by a newer one before their write
+            uint32_t unchanged;  // Writes skipped because the boiler already had the value
+        };
+
+        class WriteCoalescer
+        {
+        public:
+            static constexpr size_t SLOTS = 4; // Data IDs tracked at once (the four setpoints)
+            static constexpr uint32_t DEFAULT_WINDOW_MS = 300;
+
+            explicit WriteCoalescer(uint32_t window_ms = DEFAULT_WINDOW_MS);
+
+            // Park `value` for `data_id`; false if every slot belongs to another data ID
+            bool submit(uint8_t data_id, uint16_t value, uint32_t now_ms);
+
+            // A write whose window has expired, if any; skipped writes are counted
+            // and passed over
+            bool nextDue(uint32_t now_ms, uint8_t *data_id, uint16_t *value);
+
+            // The boiler acknowledged `value` for `data_id` (after a write of ours or anyone's)
+            void acknowledged(uint8_t data_id, uint16_t value);
+
+            // Milliseconds until nextDue() has something, 0 if now, UINT32_MAX if nothing is parked
+            uint32_t msUntilDue(uint32_t now_ms) const;
+
+            // Bus frames the coalescing saved so far
+            uint32_t framesSaved() const { return stats_.superseded + stats_.unchanged; }
+            CoalescerStats stats() const { return stats_; }
+
+        private:
+            struct Slot
+            {
+                uint8_t data_id;
+                bool used;
+                bool pending;
+                bool acked_valid;
+                uint16_t value;
+                uint16_t acked;
+                uint32_t due_ms;
+            };
+
+            Slot *find(uint8_t data_id, bool claim);
+
+            Slot slots_[SLOTS];
+            uint32_t window_ms_;
+            CoalescerStats stats_;
+        };
+
+    } // namespace Commands
+} // namespace OpenTherm
+
+#endif // WRITE_COALESCER_HPP
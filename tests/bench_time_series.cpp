@@ -0,0 +1,99 @@
+/**
+ * Benchmark for the on-device time series
+ *
+ * Encodes a synthetic heating trace - burner cycles with flow and return
+ * temperature ramping behind modulation, a setpoint that changes now and
+ * then, and idle stretches between heat demands - one sample per second,
+ * and reports encoded bytes/sample, encode ns/sample and how many hours the
+ * ring holds at that rate.
+ *
+ * Usage: bench_time_series [hours] [iterations]
+ */
+
+#include "../src/time_series.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using OpenTherm::Entities::Id;
+using OpenTherm::Publish::TimeSeries;
+
+struct Sample
+{
+    float flow;
+    float ret;
+    float modulation;
+    float flame;
+    float setpoint;
+};
+
+// Heat demand for 40 of every 90 minutes; within it the burner short-cycles
+// (6 minutes on, 4 off), the way a boiler that is too big for the load does
+static std::vector<Sample> heatingTrace(size_t seconds)
+{
+    std::vector<Sample> trace(seconds);
+    float flow = 20.0f;
+    float ret = 20.0f;
+    uint32_t noise = 0xC0FFEE;
+    for (size_t t = 0; t < seconds; t++)
+    {
+        bool demand = (t % 5400) < 2400;
+        bool flame = demand && (t % 600) < 360;
+        float modulation = flame ? 20.0f + 0.1f * (float)((t % 600) / 6) : 0.0f;
+        float setpoint = demand ? ((t / 5400) % 2 == 0 ? 55.0f : 60.0f) : 10.0f;
+
+        // First-order response towards the setpoint while firing, cooling otherwise
+        float target = flame ? setpoint + 5.0f : 20.0f;
+        flow += (target - flow) * (flame ? 0.01f : 0.002f);
+        ret += (flow - 8.0f - ret) * 0.005f;
+
+        // F8.8 read noise: a 1/256 step now and then
+        noise = noise * 1664525u + 1013904223u;
+        float jitter = ((noise >> 28) == 0) ? 1.0f / 256 : 0.0f;
+
+        trace[t] = {flow + jitter, ret, modulation, flame ? 1.0f : 0.0f, setpoint};
+    }
+    return trace;
+}
+
+int main(int argc, char **argv)
+{
+    double hours = argc > 1 ? atof(argv[1]) : 4.0;
+    int iterations = argc > 2 ? atoi(argv[2]) : 20;
+    size_t seconds = (size_t)(hours * 3600);
+    std::vector<Sample> trace = heatingTrace(seconds);
+
+    // The ring is 32 KB; keep it off the stack
+    static TimeSeries series;
+    double total_ns = 0;
+    size_t bytes = 0;
+    for (int i = 0; i < iterations; i++)
+    {
+        series = TimeSeries();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t t = 0; t < seconds; t++)
+        {
+            const Sample &s = trace[t];
+            series.set(Id::BOILER_TEMP, s.flow);
+            series.set(Id::RETURN_TEMP, s.ret);
+            series.set(Id::MODULATION, s.modulation);
+            series.set(Id::FLAME, s.flame);
+            series.set(Id::CONTROL_SETPOINT, s.setpoint);
+            series.sample((uint32_t)t);
+        }
+        auto end = std::chrono::steady_clock::now();
+        total_ns += std::chrono::duration<double, std::nano>(end - start).count();
+        bytes = series.bytesUsed();
+    }
+
+    size_t held = series.newest() - series.oldest() + 1;
+    double bytes_per_sample = (double)bytes / held;
+    double capacity = TimeSeries::BLOCKS * TimeSeries::BLOCK_BYTES;
+    printf("Encoded %zu s of heating trace x %d iterations\n", seconds, iterations);
+    printf("%8.3f bytes/sample (%zu bytes for the %zu s held)\n", bytes_per_sample, bytes, held);
+    printf("%8.1f ns/sample (set x5 + sample)\n", total_ns / iterations / seconds);
+    printf("%8.1f hours fit the %.0f KB ring at this rate\n", capacity / bytes_per_sample / 3600, capacity / 1024);
+    return 0;
+}
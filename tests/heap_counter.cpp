@@ -0,0 +1,28 @@
+// Counting replacements for the global operator new and delete
+
+#include "heap_counter.hpp"
+#include <cstdlib>
+#include <new>
+
+size_t g_heap_allocations = 0;
+
+// Kept out of line so that, once inlined into a caller, the optimiser never
+// sees free() called on memory from operator new (-Wmismatched-new-delete)
+[[gnu::noinline]] void *operator new(size_t size)
+{
+    g_heap_allocations++;
+    void *p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+[[gnu::noinline]] void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
@@ -0,0 +1,14 @@
+// Heap allocation counter for the host tests
+//
+// heap_counter.cpp replaces the global operator new and delete so a test can
+// assert that a code path performs no heap allocations: read the count before
+// and after the path and compare. Link it into a test executable to use it.
+#ifndef HEAP_COUNTER_HPP
+#define HEAP_COUNTER_HPP
+
+#include <cstddef>
+
+// Number of calls to operator new since the program started
+extern size_t g_heap_allocations;
+
+#endif // HEAP_COUNTER_HPP
@@ -0,0 +1,217 @@
+/**
+ * Unit tests for the burner cycle analytics
+ *
+ * Flame sequences come from the simulator, read once a second the way the
+ * FAST status tier does, and the hourly summaries are checked against the
+ * edges counted straight from the same sequence. Hand-written sequences pin
+ * down the edge timestamps, the short-cycle threshold and the alarm.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "burner_cycles.hpp"
+#include "simulated_opentherm.hpp"
+
+using OpenTherm::Simulator::SimulatedInterface;
+using OpenTherm::Stats::BurnerCycles;
+using OpenTherm::Stats::CycleSummary;
+using Edge = OpenTherm::Stats::BurnerCycles::Edge;
+
+// One flame read per second from the simulator, seconds [from, to)
+static std::vector<bool> simulatedFlame(SimulatedInterface &sim, uint32_t from, uint32_t to)
+{
+    std::vector<bool> flame;
+    for (uint32_t t = from; t < to; t++)
+    {
+        sim.update((float)t);
+        flame.push_back(sim.readFlameStatus());
+    }
+    return flame;
+}
+
+// Feed reads starting at second `from`; returns the seconds of the OFF edges
+static std::vector<uint32_t> feed(BurnerCycles &cycles, const std::vector<bool> &flame, uint32_t from)
+{
+    std::vector<uint32_t> offs;
+    for (size_t i = 0; i < flame.size(); i++)
+    {
+        uint32_t t = from + (uint32_t)i;
+        if (cycles.sample(flame[i], t * 1000) == Edge::OFF)
+            offs.push_back(t);
+    }
+    return offs;
+}
+
+// ============================================================================
+// Simulated flame sequences
+// ============================================================================
+
+TEST(BurnerCyclesTest, SimulatedShortCyclingHour)
+{
+    SimulatedInterface sim;
+    std::vector<bool> flame = simulatedFlame(sim, 0, 3600);
+
+    // Reference: complete burns and pauses counted straight from the sequence
+    uint32_t starts = 0, burns = 0, pauses = 0, burn_total = 0, off_total = 0;
+    uint32_t burn_min = UINT32_MAX, burn_max = 0;
+    int32_t on_at = -1, off_at = -1;
+    for (uint32_t t = 1; t < flame.size(); t++)
+    {
+        if (flame[t] && !flame[t - 1])
+        {
+            starts++;
+            if (off_at >= 0)
+            {
+                pauses++;
+                off_total += t - off_at;
+            }
+            on_at = t;
+        }
+        else if (!flame[t] && flame[t - 1])
+        {
+            if (on_at >= 0)
+            {
+                uint32_t burn = t - on_at;
+                burns++;
+                burn_total += burn;
+                burn_min = std::min(burn_min, burn);
+                burn_max = std::max(burn_max, burn);
+            }
+            off_at = t;
+        }
+    }
+    // The simulator heats in bursts of about 80 s every 2 minutes: a short-cycling boiler
+    ASSERT_GT(burns, 20u);
+
+    BurnerCycles cycles;
+    std::vector<uint32_t> offs = feed(cycles, flame, 0);
+    EXPECT_EQ(offs.size(), burns + (flame[0] ? 1u : 0u)); // A burn running at the first read has no start
+    EXPECT_TRUE(cycles.alarm());
+    EXPECT_EQ(cycles.msUntilDue(3599 * 1000), 1000u);
+
+    CycleSummary s = cycles.close(3600 * 1000);
+    EXPECT_EQ(s.period_ms, 3600000u);
+    EXPECT_EQ(s.starts, starts);
+    ASSERT_TRUE(s.has_burns);
+    EXPECT_EQ(s.burn_min_s, burn_min);
+    EXPECT_EQ(s.burn_max_s, burn_max);
+    EXPECT_NEAR(s.burn_mean_s, (float)burn_total / burns, 0.01f);
+    ASSERT_TRUE(s.has_pauses);
+    EXPECT_NEAR(s.off_mean_s, (float)off_total / pauses, 0.01f);
+    EXPECT_EQ(s.short_cycles, burns);
+    EXPECT_TRUE(s.short_cycling);
+}
+
+TEST(BurnerCyclesTest, AlarmRaisedByTheThirdShortBurn)
+{
+    SimulatedInterface sim;
+    std::vector<bool> flame = simulatedFlame(sim, 0, 3600);
+
+    BurnerCycles cycles;
+    int short_burns = flame[0] ? -1 : 0; // The first OFF edge ends a burn with no known start
+    for (uint32_t t = 0; t < flame.size(); t++)
+    {
+        if (cycles.sample(flame[t], t * 1000) == Edge::OFF && ++short_burns == 2)
+        {
+            EXPECT_FALSE(cycles.alarm()) << t;
+        }
+        if (short_burns >= (int)BurnerCycles::ALARM_SHORT_CYCLES)
+        {
+            EXPECT_TRUE(cycles.alarm()) << t;
+            break;
+        }
+    }
+    EXPECT_EQ(short_burns, (int)BurnerCycles::ALARM_SHORT_CYCLES);
+}
+
+TEST(BurnerCyclesTest, AlarmHoldsUntilAQuietHourEnds)
+{
+    SimulatedInterface sim;
+    BurnerCycles cycles;
+    feed(cycles, simulatedFlame(sim, 0, 3600), 0);
+    EXPECT_TRUE(cycles.close(3600 * 1000).short_cycling);
+
+    // Demand well above what the simulated room reaches: one long burn
+    sim.writeRoomSetpoint(30.0f);
+    std::vector<bool> flame = simulatedFlame(sim, 3600, 7200);
+    std::vector<uint32_t> offs = feed(cycles, flame, 3600);
+    EXPECT_LE(offs.size(), 1u);
+    EXPECT_TRUE(cycles.alarm()); // Still the previous hour's verdict
+
+    CycleSummary s = cycles.close(7200 * 1000);
+    EXPECT_FALSE(s.short_cycling);
+    EXPECT_FALSE(cycles.alarm());
+    EXPECT_LE(s.starts, 1u);
+    EXPECT_EQ(s.short_cycles, 0u);
+}
+
+// ============================================================================
+// Edges
+// ============================================================================
+
+TEST(BurnerCyclesTest, EdgesAreStampedBetweenTheReads)
+{
+    BurnerCycles cycles;
+    EXPECT_EQ(cycles.msUntilDue(5000), UINT32_MAX);
+
+    EXPECT_EQ(cycles.sample(false, 0), Edge::NONE);
+    EXPECT_EQ(cycles.sample(false, 1000), Edge::NONE);
+    EXPECT_EQ(cycles.sample(true, 2000), Edge::ON);      // On at 1.5 s
+    EXPECT_EQ(cycles.sample(true, 300000), Edge::NONE);
+    EXPECT_EQ(cycles.sample(false, 302000), Edge::OFF);  // Off at 301 s: a 299.5 s burn
+    EXPECT_EQ(cycles.sample(true, 303000), Edge::ON);    // On at 302.5 s
+    EXPECT_EQ(cycles.sample(true, 603000), Edge::NONE);
+    // Reads failed for 10 s; the edge is put halfway through the gap
+    EXPECT_EQ(cycles.sample(false, 613000), Edge::OFF);  // Off at 608 s: a 305.5 s burn
+
+    CycleSummary s = cycles.close(700000);
+    EXPECT_EQ(s.starts, 2u);
+    EXPECT_EQ(s.burn_min_s, 300u); // 299.5 s rounds up
+    EXPECT_EQ(s.burn_max_s, 306u);
+    EXPECT_EQ(s.short_cycles, 0u);
+    EXPECT_FLOAT_EQ(s.off_mean_s, 2.0f); // 1.5 s rounds up
+}
+
+TEST(BurnerCyclesTest, ShortBurnThreshold)
+{
+    const uint32_t SHORT_MS = BurnerCycles::SHORT_BURN_S * 1000;
+    BurnerCycles cycles;
+    cycles.sample(false, 0);
+    cycles.sample(true, 1000);                // On at 0.5 s
+    cycles.sample(true, SHORT_MS - 1000);
+    cycles.sample(false, SHORT_MS);           // Off 1 s short of SHORT_BURN_S later
+    cycles.sample(false, 999000);
+    cycles.sample(true, 1000000);             // On at 999.5 s
+    cycles.sample(true, 999000 + SHORT_MS);
+    cycles.sample(false, 1000000 + SHORT_MS); // Off exactly SHORT_BURN_S later
+
+    CycleSummary s = cycles.close(2000000);
+    EXPECT_EQ(s.short_cycles, 1u);
+    EXPECT_FALSE(s.short_cycling);
+}
+
+TEST(BurnerCyclesTest, BurnsArePlacedInThePeriodTheyEnd)
+{
+    BurnerCycles cycles;
+    cycles.sample(true, 0); // Already burning at the first read: no known start
+    cycles.sample(true, 9000);
+    cycles.sample(false, 10000);
+    cycles.sample(false, 3589000);
+    cycles.sample(true, 3590000);
+
+    CycleSummary s = cycles.close(3600000);
+    EXPECT_EQ(s.starts, 1u);
+    EXPECT_FALSE(s.has_burns);
+    ASSERT_TRUE(s.has_pauses);
+
+    // The burn that crossed the hour counts in full in the next one
+    cycles.sample(true, 3699000);
+    cycles.sample(false, 3700000);
+    s = cycles.close(7200000);
+    EXPECT_EQ(s.starts, 0u);
+    ASSERT_TRUE(s.has_burns);
+    EXPECT_EQ(s.burn_min_s, 110u);
+    EXPECT_FALSE(s.has_pauses);
+}
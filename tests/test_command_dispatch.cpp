@@ -0,0 +1,143 @@
+/**
+ * Unit tests for command topic dispatch and payload parsing
+ *
+ * Every command suffix must resolve to its own Commands::Id through the
+ * compile-time perfect hash, anything else must miss, and the payload
+ * parsers must reject what atof/atoi used to turn into 0.
+ */
+
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include "command_dispatch.hpp"
+
+using OpenTherm::Commands::Id;
+using OpenTherm::Commands::lookup;
+using OpenTherm::Commands::parseDecimal;
+using OpenTherm::Commands::parseOnOff;
+using OpenTherm::Commands::parseUnsigned;
+
+// ============================================================================
+// Topic lookup
+// ============================================================================
+
+TEST(CommandDispatchTests, EverySuffixFindsItsCommand)
+{
+    for (size_t i = 0; i < OpenTherm::Commands::COUNT; i++)
+    {
+        Id id = Id::COUNT;
+        const char *suffix = OpenTherm::Commands::TABLE[i].suffix;
+        ASSERT_TRUE(lookup(suffix, &id)) << suffix;
+        EXPECT_EQ(OpenTherm::Commands::index(id), i) << suffix;
+    }
+}
+
+TEST(CommandDispatchTests, SlotTableIsCollisionFree)
+{
+    std::set<size_t> slots;
+    size_t filled = 0;
+    for (size_t i = 0; i < OpenTherm::Commands::SLOTS; i++)
+    {
+        if (OpenTherm::Commands::SLOT_TABLE.command[i] != OpenTherm::Commands::NO_COMMAND)
+            filled++;
+    }
+    for (size_t i = 0; i < OpenTherm::Commands::COUNT; i++)
+        slots.insert(OpenTherm::Commands::slotOf(OpenTherm::Commands::TABLE[i].suffix, OpenTherm::Commands::SEED));
+
+    EXPECT_EQ(filled, OpenTherm::Commands::COUNT);
+    EXPECT_EQ(slots.size(), OpenTherm::Commands::COUNT);
+}
+
+TEST(CommandDispatchTests, OtherSuffixesMiss)
+{
+    Id id = Id::COUNT;
+    const char *misses[] = {"", "ch_enable/extra", "ch_enabl", "ch_enablex", "CH_ENABLE", "boiler_temp", "#",
+                            nullptr};
+    for (const char *suffix : misses)
+    {
+        EXPECT_FALSE(lookup(suffix, &id)) << (suffix ? suffix : "(null)");
+    }
+    EXPECT_EQ(id, Id::COUNT);
+
+    // Whatever slot an unknown suffix lands in, the strcmp rejects it
+    for (size_t i = 0; i < OpenTherm::Commands::COUNT; i++)
+    {
+        std::string near_miss = std::string(OpenTherm::Commands::TABLE[i].suffix) + "_";
+        EXPECT_FALSE(lookup(near_miss.c_str(), &id)) << near_miss;
+    }
+}
+
+// ============================================================================
+// Payload parsing
+// ============================================================================
+
+TEST(CommandDispatchTests, ParsesOnOff)
+{
+    bool value = false;
+    EXPECT_TRUE(parseOnOff("ON", &value));
+    EXPECT_TRUE(value);
+    EXPECT_TRUE(parseOnOff("OFF", &value));
+    EXPECT_FALSE(value);
+
+    EXPECT_FALSE(parseOnOff("on", &value));
+    EXPECT_FALSE(parseOnOff("ON ", &value));
+    EXPECT_FALSE(parseOnOff("", &value));
+    EXPECT_FALSE(parseOnOff(nullptr, &value));
+}
+
+TEST(CommandDispatchTests, ParsesDecimals)
+{
+    float value = 0.0f;
+    EXPECT_TRUE(parseDecimal("21", &value));
+    EXPECT_FLOAT_EQ(value, 21.0f);
+    EXPECT_TRUE(parseDecimal("21.5", &value));
+    EXPECT_FLOAT_EQ(value, 21.5f);
+    EXPECT_TRUE(parseDecimal("-3.5", &value));
+    EXPECT_FLOAT_EQ(value, -3.5f);
+    EXPECT_TRUE(parseDecimal("+7", &value));
+    EXPECT_FLOAT_EQ(value, 7.0f);
+    EXPECT_TRUE(parseDecimal("45.", &value));
+    EXPECT_FLOAT_EQ(value, 45.0f);
+    EXPECT_TRUE(parseDecimal(".5", &value));
+    EXPECT_FLOAT_EQ(value, 0.5f);
+
+    // Digits past the sixth decimal are dropped, not rounded into overflow
+    EXPECT_TRUE(parseDecimal("55.12345678901234567890", &value));
+    EXPECT_NEAR(value, 55.123456f, 1e-5f);
+}
+
+TEST(CommandDispatchTests, RejectsMalformedDecimals)
+{
+    float value = 42.0f;
+    const char *bad[] = {"", ".", "-", "+", "21.5abc", "abc", " 21", "21 ", "1e3", "2..5", "--1", "1234567890",
+                         nullptr};
+    for (const char *payload : bad)
+    {
+        EXPECT_FALSE(parseDecimal(payload, &value)) << (payload ? payload : "(null)");
+    }
+    EXPECT_FLOAT_EQ(value, 42.0f); // Untouched on failure
+}
+
+TEST(CommandDispatchTests, ParsesUnsigned)
+{
+    uint32_t value = 0;
+    EXPECT_TRUE(parseUnsigned("0", &value));
+    EXPECT_EQ(value, 0u);
+    EXPECT_TRUE(parseUnsigned("60000", &value));
+    EXPECT_EQ(value, 60000u);
+    EXPECT_TRUE(parseUnsigned("60000.0", &value)); // Home Assistant number entity
+    EXPECT_EQ(value, 60000u);
+    EXPECT_TRUE(parseUnsigned("16.", &value));
+    EXPECT_EQ(value, 16u);
+    EXPECT_TRUE(parseUnsigned("4294967295", &value));
+    EXPECT_EQ(value, 4294967295u);
+
+    value = 7;
+    const char *bad[] = {"", "-1", "+1", "60000.5", "4294967296", "99999999999999999999", "16abc", ".5", " 1",
+                         nullptr};
+    for (const char *payload : bad)
+    {
+        EXPECT_FALSE(parseUnsigned(payload, &value)) << (payload ? payload : "(null)");
+    }
+    EXPECT_EQ(value, 7u);
+}
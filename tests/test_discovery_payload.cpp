@@ -0,0 +1,677 @@
+/**
+ * Unit tests for Home Assistant discovery payloads
+ *
+ * Both discovery modes are rendered from the same component table; these
+ * tests parse every payload back and check the device-based config carries
+ * exactly what the per-entity configs do, streamed through a small buffer.
+ * Compact payloads are expanded the way Home Assistant does it (abbreviated
+ * keys, "~" base topic) and must then match the full-key payloads.
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "discovery_payload.hpp"
+#include "mqtt_flow.hpp"
+#include "mqtt_topics.hpp"
+#include "opentherm_ha.hpp"
+
+using OpenTherm::Discovery::COMPONENT_COUNT;
+using OpenTherm::Discovery::COMPONENTS;
+using OpenTherm::Discovery::Component;
+
+// ============================================================================
+// Minimal JSON reader: objects, arrays, strings (\" and \\ escapes), scalars
+// ============================================================================
+
+struct JsonValue
+{
+    enum Type
+    {
+        OBJECT,
+        ARRAY,
+        STRING,
+        SCALAR
+    } type;
+    std::string text;                                        // STRING and SCALAR
+    std::vector<std::pair<std::string, JsonValue>> members;  // OBJECT, in document order
+    std::vector<JsonValue> items;                            // ARRAY
+
+    const JsonValue *get(const std::string &key) const
+    {
+        for (const auto &m : members)
+        {
+            if (m.first == key)
+                return &m.second;
+        }
+        return nullptr;
+    }
+};
+
+static bool parseValue(const char *&p, JsonValue *out);
+
+static bool parseString(const char *&p, std::string *out)
+{
+    if (*p != '"')
+        return false;
+    p++;
+    out->clear();
+    while (*p && *p != '"')
+    {
+        if (*p == '\\')
+        {
+            p++;
+            if (*p != '"' && *p != '\\')
+                return false;
+        }
+        out->push_back(*p++);
+    }
+    if (*p != '"')
+        return false;
+    p++;
+    return true;
+}
+
+static bool parseValue(const char *&p, JsonValue *out)
+{
+    if (*p == '{')
+    {
+        out->type = JsonValue::OBJECT;
+        p++;
+        std::set<std::string> seen;
+        while (*p != '}')
+        {
+            std::string key;
+            JsonValue value;
+            if (!parseString(p, &key) || *p++ != ':' || !parseValue(p, &value))
+                return false;
+            if (!seen.insert(key).second)
+                return false; // Duplicate key
+            out->members.emplace_back(key, value);
+            if (*p == ',')
+                p++;
+            else if (*p != '}')
+                return false;
+        }
+        p++;
+        return true;
+    }
+    if (*p == '[')
+    {
+        out->type = JsonValue::ARRAY;
+        p++;
+        while (*p != ']')
+        {
+            JsonValue item;
+            if (!parseValue(p, &item))
+                return false;
+            out->items.push_back(item);
+            if (*p == ',')
+                p++;
+            else if (*p != ']')
+                return false;
+        }
+        p++;
+        return true;
+    }
+    if (*p == '"')
+    {
+        out->type = JsonValue::STRING;
+        return parseString(p, &out->text);
+    }
+
+    out->type = JsonValue::SCALAR;
+    const char *start = p;
+    while (*p && *p != ',' && *p != '}' && *p != ']')
+        p++;
+    out->text.assign(start, p);
+    return !out->text.empty();
+}
+
+static bool parseJson(const std::string &json, JsonValue *out)
+{
+    const char *p = json.c_str();
+    return parseValue(p, out) && *p == '\0';
+}
+
+// Undo Home Assistant's abbreviations: rename keys and resolve "~" against the
+// nearest enclosing base topic, dropping the "~" entries themselves
+static JsonValue expand(const JsonValue &v, const std::string &inherited_base = "")
+{
+    using namespace OpenTherm::MQTTDiscovery;
+    static const std::map<std::string, std::string> FULL = {
+        {ABBR_UNIQUE_ID, JSON_UNIQUE_ID},
+        {ABBR_DEFAULT_ENTITY_ID, JSON_DEFAULT_ENTITY_ID},
+        {ABBR_STATE_TOPIC, JSON_STATE_TOPIC},
+        {ABBR_COMMAND_TOPIC, JSON_COMMAND_TOPIC},
+        {ABBR_DEVICE_CLASS, JSON_DEVICE_CLASS},
+        {ABBR_UNIT_OF_MEASUREMENT, JSON_UNIT_OF_MEASUREMENT},
+        {ABBR_ICON, JSON_ICON},
+        {ABBR_VALUE_TEMPLATE, JSON_VALUE_TEMPLATE},
+        {ABBR_DEVICE, JSON_DEVICE},
+        {ABBR_IDENTIFIERS, JSON_IDENTIFIERS},
+        {ABBR_MODEL, JSON_MODEL},
+        {ABBR_MANUFACTURER, JSON_MANUFACTURER},
+        {ABBR_PLATFORM, JSON_PLATFORM},
+        {ABBR_ORIGIN, JSON_ORIGIN},
+        {ABBR_COMPONENTS, JSON_COMPONENTS},
+    };
+
+    JsonValue out = v;
+    if (v.type != JsonValue::OBJECT)
+        return out;
+
+    std::string base = inherited_base;
+    if (const JsonValue *tilde = v.get(JSON_BASE_TOPIC))
+        base = tilde->text;
+
+    out.members.clear();
+    for (const auto &m : v.members)
+    {
+        if (m.first == JSON_BASE_TOPIC)
+            continue;
+        auto renamed = FULL.find(m.first);
+        JsonValue value = expand(m.second, base);
+        if (value.type == JsonValue::STRING && !value.text.empty() && value.text[0] == '~')
+            value.text = base + value.text.substr(1);
+        out.members.emplace_back(renamed == FULL.end() ? m.first : renamed->second, value);
+    }
+    return out;
+}
+
+// Same members with the same values, in any order
+static bool sameJson(const JsonValue &a, const JsonValue &b, std::string *where)
+{
+    if (a.type != b.type || a.text != b.text || a.members.size() != b.members.size() ||
+        a.items.size() != b.items.size())
+        return false;
+    for (const auto &m : a.members)
+    {
+        const JsonValue *other = b.get(m.first);
+        if (other == nullptr || !sameJson(m.second, *other, where))
+        {
+            *where = m.first + (where->empty() ? "" : "." + *where);
+            return false;
+        }
+    }
+    for (size_t i = 0; i < a.items.size(); i++)
+    {
+        if (!sameJson(a.items[i], b.items[i], where))
+            return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static OpenTherm::HomeAssistant::Config makeConfig(bool aggregate_state = false, bool compact = false)
+{
+    OpenTherm::HomeAssistant::Config cfg = {};
+    cfg.device_name = "OpenTherm Gateway";
+    cfg.device_id = "opentherm_gw";
+    cfg.mqtt_prefix = "homeassistant";
+    cfg.topic_base = "opentherm";
+    cfg.state_topic_base = "state";
+    cfg.command_topic_base = "cmd";
+    cfg.auto_discovery = true;
+    cfg.update_interval_ms = 10000;
+    cfg.aggregate_state = aggregate_state;
+    cfg.device_discovery = true;
+    cfg.compact_discovery = compact;
+    return cfg;
+}
+
+static std::string componentConfig(const OpenTherm::HomeAssistant::Config &cfg, const Component &c,
+                                   bool first = true)
+{
+    char buf[OpenTherm::Discovery::COMPONENT_CONFIG_LEN];
+    size_t len = OpenTherm::Discovery::formatComponentConfig(cfg, c, first, buf, sizeof(buf));
+    EXPECT_LT(len, sizeof(buf)) << c.object_id;
+    return len < sizeof(buf) ? std::string(buf, len) : std::string();
+}
+
+// Sink that collects the streamed device config and records piece sizes
+static std::string g_streamed;
+static size_t g_pieces = 0;
+static size_t g_fail_after = SIZE_MAX;
+
+static bool collect(const char *data, size_t len)
+{
+    if (g_pieces >= g_fail_after)
+        return false;
+    g_streamed.append(data, len);
+    g_pieces++;
+    return true;
+}
+
+static size_t streamDevice(const OpenTherm::HomeAssistant::Config &cfg, size_t chunk_len = 512)
+{
+    g_streamed.clear();
+    g_pieces = 0;
+    std::unique_ptr<char[]> chunk(new char[chunk_len]);
+    return OpenTherm::Discovery::streamDeviceConfig(cfg, chunk.get(), chunk_len, collect);
+}
+
+// ============================================================================
+// Component table
+// ============================================================================
+
+TEST(DiscoveryPayloadTests, EveryEntityIsAnnouncedOnce)
+{
+    std::set<std::string> object_ids;
+    for (size_t i = 0; i < COMPONENT_COUNT; i++)
+    {
+        EXPECT_TRUE(object_ids.insert(COMPONENTS[i].object_id).second)
+            << "duplicate component " << COMPONENTS[i].object_id;
+    }
+
+    // Every entity with a state topic needs a component, or HA never shows it
+    for (size_t i = 0; i < OpenTherm::Entities::COUNT; i++)
+    {
+        const char *suffix = OpenTherm::Entities::TABLE[i].suffix;
+        EXPECT_TRUE(object_ids.count(suffix)) << "no discovery component for " << suffix;
+    }
+}
+
+// ============================================================================
+// Per-entity configs
+// ============================================================================
+
+TEST(DiscoveryPayloadTests, PerEntityConfigsParse)
+{
+    auto cfg = makeConfig();
+    for (size_t i = 0; i < COMPONENT_COUNT; i++)
+    {
+        const Component &c = COMPONENTS[i];
+        std::string payload = componentConfig(cfg, c);
+        JsonValue doc;
+        ASSERT_TRUE(parseJson(payload, &doc)) << payload;
+
+        ASSERT_NE(doc.get("name"), nullptr);
+        EXPECT_EQ(doc.get("name")->text, c.name);
+        ASSERT_NE(doc.get("unique_id"), nullptr);
+        EXPECT_EQ(doc.get("unique_id")->text, std::string("opentherm_gw_") + c.object_id);
+        ASSERT_NE(doc.get("state_topic"), nullptr);
+        EXPECT_EQ(doc.get("state_topic")->text, std::string("opentherm/opentherm_gw/state/") + c.object_id);
+        EXPECT_EQ(doc.get("command_topic") != nullptr, c.command) << c.object_id;
+
+        const JsonValue *device = doc.get("device");
+        ASSERT_NE(device, nullptr);
+        ASSERT_NE(device->get("identifiers"), nullptr);
+        EXPECT_EQ(device->get("identifiers")->items[0].text, "opentherm_gw");
+    }
+}
+
+TEST(DiscoveryPayloadTests, NumberConfigCarriesRange)
+{
+    auto cfg = makeConfig();
+    for (size_t i = 0; i < COMPONENT_COUNT; i++)
+    {
+        const Component &c = COMPONENTS[i];
+        if (strcmp(c.object_id, OpenTherm::MQTTTopics::ROOM_SETPOINT) != 0)
+            continue;
+        JsonValue doc;
+        ASSERT_TRUE(parseJson(componentConfig(cfg, c), &doc));
+        EXPECT_EQ(doc.get("min")->text, "5.0");
+        EXPECT_EQ(doc.get("max")->text, "30.0");
+        EXPECT_EQ(doc.get("step")->text, "0.5");
+        EXPECT_EQ(doc.get("mode")->text, "box");
+        return;
+    }
+    FAIL() << "room setpoint component missing";
+}
+
+// ============================================================================
+// Device-based config
+// ============================================================================
+
+TEST(DiscoveryPayloadTests, DeviceConfigHoldsEveryComponent)
+{
+    auto cfg = makeConfig();
+    char chunk[512];
+    size_t measured = OpenTherm::Discovery::streamDeviceConfig(cfg, chunk, sizeof(chunk), nullptr);
+    size_t streamed = streamDevice(cfg);
+    ASSERT_GT(measured, 0u);
+    EXPECT_EQ(measured, streamed);
+    EXPECT_EQ(streamed, g_streamed.size());
+    EXPECT_EQ(g_pieces, COMPONENT_COUNT + 2); // Header, one per component, trailer
+
+    JsonValue doc;
+    ASSERT_TRUE(parseJson(g_streamed, &doc)) << g_streamed;
+    ASSERT_NE(doc.get("device"), nullptr);
+    ASSERT_NE(doc.get("origin"), nullptr);
+    const JsonValue *components = doc.get("components");
+    ASSERT_NE(components, nullptr);
+    ASSERT_EQ(components->members.size(), COMPONENT_COUNT);
+
+    // Each component is its per-entity config plus "platform", minus the device block
+    for (size_t i = 0; i < COMPONENT_COUNT; i++)
+    {
+        const Component &c = COMPONENTS[i];
+        const JsonValue *entry = components->get(c.object_id);
+        ASSERT_NE(entry, nullptr) << c.object_id;
+        ASSERT_NE(entry->get("platform"), nullptr);
+        EXPECT_EQ(entry->get("platform")->text, c.component);
+
+        JsonValue single;
+        ASSERT_TRUE(parseJson(componentConfig(cfg, c), &single));
+        EXPECT_EQ(entry->members.size(), single.members.size()) << c.object_id;
+        for (const auto &m : single.members)
+        {
+            if (m.first == "device")
+                continue;
+            const JsonValue *v = entry->get(m.first);
+            ASSERT_NE(v, nullptr) << c.object_id << "." << m.first;
+            EXPECT_EQ(v->text, m.second.text) << c.object_id << "." << m.first;
+        }
+    }
+
+    char topic[128];
+    OpenTherm::Discovery::formatDeviceDiscoveryTopic(cfg, topic, sizeof(topic));
+    EXPECT_STREQ(topic, "homeassistant/device/opentherm_gw/config");
+}
+
+TEST(DiscoveryPayloadTests, DeviceConfigFollowsAggregatedState)
+{
+    auto cfg = makeConfig(true);
+    ASSERT_GT(streamDevice(cfg), 0u);
+    JsonValue doc;
+    ASSERT_TRUE(parseJson(g_streamed, &doc));
+
+    const JsonValue *entry = doc.get("components")->get(OpenTherm::MQTTTopics::BOILER_TEMP);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->get("state_topic")->text, "opentherm/opentherm_gw/state");
+    EXPECT_EQ(entry->get("value_template")->text, "{{ value_json.boiler_temp }}");
+}
+
+TEST(DiscoveryPayloadTests, StreamFailsCleanly)
+{
+    auto cfg = makeConfig();
+
+    // A chunk smaller than one component is reported, not truncated
+    EXPECT_EQ(streamDevice(cfg, 64), 0u);
+
+    // A sink that gives up mid-way stops the stream
+    g_fail_after = 5;
+    EXPECT_EQ(streamDevice(cfg), 0u);
+    EXPECT_EQ(g_pieces, 5u);
+    g_fail_after = SIZE_MAX;
+}
+
+TEST(DiscoveryPayloadTests, DeviceConfigSendsOneMessageInsteadOfMany)
+{
+    auto cfg = makeConfig();
+
+    uint32_t per_entity_bytes = 0;
+    for (size_t i = 0; i < COMPONENT_COUNT; i++)
+    {
+        const Component &c = COMPONENTS[i];
+        std::string topic = std::string("homeassistant/") + c.component + "/opentherm_gw/" + c.object_id + "/config";
+        per_entity_bytes += OpenTherm::Common::publishWireSize(topic.size(), componentConfig(cfg, c).size(), 0);
+    }
+
+    size_t payload = streamDevice(cfg);
+    ASSERT_GT(payload, 0u);
+    uint32_t device_bytes = OpenTherm::Common::publishWireSize(strlen("homeassistant/device/opentherm_gw/config"),
+                                                               payload, 0);
+
+    // The device block and per-message topics are paid once instead of per entity
+    EXPECT_LT(device_bytes, per_entity_bytes);
+    printf("Discovery: %zu per-entity messages, %u bytes; device config 1 message, %u bytes\n",
+           COMPONENT_COUNT, per_entity_bytes, device_bytes);
+}
+
+// ============================================================================
+// Compact payloads
+// ============================================================================
+
+// Per-entity discovery bytes on the wire for one payload style
+static uint32_t perEntityWireBytes(const OpenTherm::HomeAssistant::Config &cfg)
+{
+    uint32_t bytes = 0;
+    for (size_t i = 0; i < COMPONENT_COUNT; i++)
+    {
+        const Component &c = COMPONENTS[i];
+        std::string topic = std::string("homeassistant/") + c.component + "/opentherm_gw/" + c.object_id + "/config";
+        bytes += OpenTherm::Common::publishWireSize(topic.size(), componentConfig(cfg, c, i == 0).size(), 0);
+    }
+    return bytes;
+}
+
+TEST(DiscoveryPayloadTests, CompactConfigsExpandToFullConfigs)
+{
+    for (bool aggregate : {false, true})
+    {
+        auto full_cfg = makeConfig(aggregate, false);
+        auto compact_cfg = makeConfig(aggregate, true);
+        for (size_t i = 0; i < COMPONENT_COUNT; i++)
+        {
+            const Component &c = COMPONENTS[i];
+            std::string compact = componentConfig(compact_cfg, c, i == 0);
+            JsonValue parsed, full;
+            ASSERT_TRUE(parseJson(compact, &parsed)) << compact;
+            ASSERT_TRUE(parseJson(componentConfig(full_cfg, c), &full));
+
+            JsonValue expanded = expand(parsed);
+            if (i > 0)
+            {
+                // Later configs only reference the device by its identifiers
+                const JsonValue *device = expanded.get("device");
+                ASSERT_NE(device, nullptr) << c.object_id;
+                ASSERT_EQ(device->members.size(), 1u) << compact;
+                EXPECT_EQ(device->get("identifiers")->items[0].text, "opentherm_gw");
+                for (auto &m : expanded.members)
+                {
+                    if (m.first == "device")
+                        m.second = *full.get("device");
+                }
+            }
+
+            std::string where;
+            EXPECT_TRUE(sameJson(expanded, full, &where)) << c.object_id << " differs at " << where << ": " << compact;
+        }
+    }
+}
+
+TEST(DiscoveryPayloadTests, CompactDeviceConfigExpandsToFullDeviceConfig)
+{
+    ASSERT_GT(streamDevice(makeConfig(false, false)), 0u);
+    JsonValue full;
+    ASSERT_TRUE(parseJson(g_streamed, &full));
+    size_t full_len = g_streamed.size();
+
+    ASSERT_GT(streamDevice(makeConfig(false, true)), 0u);
+    JsonValue compact;
+    ASSERT_TRUE(parseJson(g_streamed, &compact)) << g_streamed;
+
+    std::string where;
+    EXPECT_TRUE(sameJson(expand(compact), full, &where)) << "differs at " << where;
+    EXPECT_LT(g_streamed.size(), full_len);
+}
+
+TEST(DiscoveryPayloadTests, CompactDiscoveryByteBudget)
+{
+    uint32_t full = perEntityWireBytes(makeConfig(false, false));
+    uint32_t compact = perEntityWireBytes(makeConfig(false, true));
+    printf("Per-entity discovery: %u bytes with full keys, %u compact\n", full, compact);
+
+    // The whole per-entity burst with the default device and topic ids; about
+    // 10 KB of it is topics, which abbreviations cannot shorten
+    EXPECT_EQ(full, 40577u);
+    EXPECT_LE(compact, 29900u);
+    EXPECT_LE(compact * 100, full * 75);
+
+    // Even with aggregated state templates every compact config stays well clear
+    // of the buffer the full-key configs nearly fill
+    for (bool aggregate : {false, true})
+    {
+        auto cfg = makeConfig(aggregate, true);
+        for (size_t i = 0; i < COMPONENT_COUNT; i++)
+            EXPECT_LE(componentConfig(cfg, COMPONENTS[i], i == 0).size(), 400u) << COMPONENTS[i].object_id;
+    }
+}
+
+// ============================================================================
+// Skipping redundant discovery
+// ============================================================================
+
+using OpenTherm::Discovery::DiscoverySync;
+
+TEST(DiscoveryPayloadTests, HashCoversConfigAndMode)
+{
+    auto cfg = makeConfig(false, true);
+    cfg.device_discovery = false;
+    uint32_t base = OpenTherm::Discovery::discoveryHash(cfg);
+    EXPECT_EQ(OpenTherm::Discovery::discoveryHash(cfg), base);
+
+    auto other = cfg;
+    other.device_name = "Boiler";
+    EXPECT_NE(OpenTherm::Discovery::discoveryHash(other), base);
+    other = cfg;
+    other.device_id = "opentherm_gw2";
+    EXPECT_NE(OpenTherm::Discovery::discoveryHash(other), base);
+    other = cfg;
+    other.mqtt_prefix = "ha";
+    EXPECT_NE(OpenTherm::Discovery::discoveryHash(other), base);
+    other = cfg;
+    other.aggregate_state = true;
+    EXPECT_NE(OpenTherm::Discovery::discoveryHash(other), base);
+    other = cfg;
+    other.compact_discovery = false;
+    EXPECT_NE(OpenTherm::Discovery::discoveryHash(other), base);
+    other = cfg;
+    other.device_discovery = true;
+    EXPECT_NE(OpenTherm::Discovery::discoveryHash(other), base);
+
+    // Settings that discovery does not render leave the hash alone
+    other = cfg;
+    other.update_interval_ms = 60000;
+    EXPECT_EQ(OpenTherm::Discovery::discoveryHash(other), base);
+
+    char text[16];
+    EXPECT_EQ(OpenTherm::Discovery::formatDiscoveryHash(0x0000abcdu, text, sizeof(text)), 8u);
+    EXPECT_STREQ(text, "0000abcd");
+    char topic[128];
+    OpenTherm::Discovery::formatDiscoveryHashTopic(cfg, topic, sizeof(topic));
+    EXPECT_STREQ(topic, "opentherm/opentherm_gw/discovery_hash");
+    OpenTherm::Discovery::formatBirthTopic(cfg, topic, sizeof(topic));
+    EXPECT_STREQ(topic, "homeassistant/status");
+}
+
+TEST(DiscoveryPayloadTests, ReconnectWithCurrentMarkerSkipsDiscovery)
+{
+    DiscoverySync sync;
+    EXPECT_EQ(sync.poll(0), DiscoverySync::Action::NONE); // Auto discovery off
+
+    // Boot: nothing retained yet, so discovery goes out once the wait expires
+    sync.begin(0x1234abcdu, 1000);
+    EXPECT_EQ(sync.poll(1000), DiscoverySync::Action::WAIT);
+    EXPECT_EQ(sync.poll(1000 + DiscoverySync::MARKER_WAIT_MS - 1), DiscoverySync::Action::WAIT);
+    EXPECT_EQ(sync.msUntilTimeout(1100), DiscoverySync::MARKER_WAIT_MS - 100);
+    EXPECT_EQ(sync.poll(1000 + DiscoverySync::MARKER_WAIT_MS), DiscoverySync::Action::PUBLISH);
+    sync.published();
+    sync.onMarker("1234abcd"); // Our own retained marker echoed back
+    EXPECT_EQ(sync.poll(2000), DiscoverySync::Action::NONE);
+    EXPECT_EQ(sync.msUntilTimeout(2000), UINT32_MAX); // Nothing to wake up for
+
+    // Reconnect: the broker hands back the marker right after the SUBACK, so
+    // state publishing resumes as soon as it lands instead of after a full
+    // discovery burst
+    sync.begin(0x1234abcdu, 50000);
+    EXPECT_EQ(sync.poll(50010), DiscoverySync::Action::WAIT);
+    sync.onMarker("1234abcd");
+    EXPECT_EQ(sync.poll(50020), DiscoverySync::Action::NONE);
+    EXPECT_LE(50020u - 50000u, 1000u);
+}
+
+TEST(DiscoveryPayloadTests, StaleOrMissingMarkerRepublishes)
+{
+    DiscoverySync sync;
+
+    // Config changed since the retained discovery was published
+    sync.begin(0x1234abcdu, 0);
+    sync.onMarker("deadbeef");
+    EXPECT_EQ(sync.poll(1), DiscoverySync::Action::PUBLISH);
+    EXPECT_TRUE(sync.retainedValid());
+    EXPECT_EQ(sync.retained(), 0xdeadbeefu);
+    sync.published();
+    EXPECT_EQ(sync.poll(2), DiscoverySync::Action::NONE);
+
+    // Garbage and empty (deleted) markers do not count as a match
+    sync.begin(0x1234abcdu, 0);
+    sync.onMarker("");
+    EXPECT_EQ(sync.poll(1), DiscoverySync::Action::PUBLISH);
+    sync.begin(0x1234abcdu, 0);
+    sync.onMarker("1234abcdx");
+    EXPECT_EQ(sync.poll(1), DiscoverySync::Action::PUBLISH);
+
+    // Someone cleared or rewrote the marker while connected
+    sync.published();
+    sync.onMarker("00000000");
+    EXPECT_EQ(sync.poll(10), DiscoverySync::Action::PUBLISH);
+}
+
+TEST(DiscoveryPayloadTests, HomeAssistantRestartRepublishes)
+{
+    DiscoverySync sync;
+    sync.onBirth("online"); // Before begin(): auto discovery is off
+    EXPECT_EQ(sync.poll(0), DiscoverySync::Action::NONE);
+
+    sync.begin(0x1234abcdu, 0);
+    sync.onMarker("1234abcd");
+    EXPECT_EQ(sync.poll(1), DiscoverySync::Action::NONE);
+
+    sync.onBirth("offline"); // Last will: nothing to do yet
+    EXPECT_EQ(sync.poll(2), DiscoverySync::Action::NONE);
+    sync.onBirth("online");
+    EXPECT_EQ(sync.poll(3), DiscoverySync::Action::PUBLISH);
+    sync.published();
+    EXPECT_EQ(sync.poll(4), DiscoverySync::Action::NONE);
+
+    sync.requestPublish(); // Republish discovery button
+    EXPECT_EQ(sync.poll(5), DiscoverySync::Action::PUBLISH);
+}
+
+TEST(DiscoveryPayloadTests, FailedPublishBacksOff)
+{
+    DiscoverySync sync;
+    sync.failed(0); // Auto discovery off
+    EXPECT_EQ(sync.poll(1), DiscoverySync::Action::NONE);
+
+    sync.begin(0x1234abcdu, 0);
+    sync.onMarker("deadbeef");
+    ASSERT_EQ(sync.poll(10), DiscoverySync::Action::PUBLISH);
+
+    // Each failure waits twice as long as the last before the next attempt
+    uint32_t now = 10;
+    uint32_t wait = DiscoverySync::RETRY_MIN_MS;
+    for (int attempt = 0; attempt < 10; attempt++)
+    {
+        sync.failed(now);
+        EXPECT_EQ(sync.poll(now), DiscoverySync::Action::WAIT);
+        EXPECT_EQ(sync.msUntilTimeout(now), wait);
+        EXPECT_EQ(sync.poll(now + wait - 1), DiscoverySync::Action::WAIT);
+        now += wait;
+        EXPECT_EQ(sync.poll(now), DiscoverySync::Action::PUBLISH);
+        wait = wait * 2 < DiscoverySync::RETRY_MAX_MS ? wait * 2 : DiscoverySync::RETRY_MAX_MS;
+    }
+    EXPECT_EQ(wait, DiscoverySync::RETRY_MAX_MS);
+
+    // Home Assistant coming online does not wait for the backoff
+    sync.failed(now);
+    sync.onBirth("online");
+    EXPECT_EQ(sync.poll(now), DiscoverySync::Action::PUBLISH);
+
+    // Success starts the backoff over
+    sync.published();
+    EXPECT_EQ(sync.poll(now), DiscoverySync::Action::NONE);
+    sync.requestPublish();
+    sync.failed(now);
+    EXPECT_EQ(sync.msUntilTimeout(now), DiscoverySync::RETRY_MIN_MS);
+}
@@ -0,0 +1,265 @@
+/**
+ * Unit tests for the incoming MQTT message ring
+ *
+ * The single-threaded tests pin down FIFO order, the drop policy and the
+ * counters. The stress tests run a producer thread that feeds messages the
+ * way lwIP does (begin, payload pieces, commit) against a consumer thread
+ * draining the ring, and check every message arrives intact and in order.
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "message_ring.hpp"
+
+using OpenTherm::Common::IncomingMessage;
+using OpenTherm::Common::MessageRing;
+using OpenTherm::Common::MessageRingStats;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+// Feed one message in `piece`-byte chunks, as lwIP's data callback does
+static bool deliver(MessageRing &ring, const char *topic, const std::string &payload, size_t piece = 16)
+{
+    if (!ring.begin(topic, (uint32_t)payload.size()))
+        return false;
+    for (size_t off = 0; off < payload.size(); off += piece)
+    {
+        size_t len = payload.size() - off < piece ? payload.size() - off : piece;
+        ring.append(reinterpret_cast<const uint8_t *>(payload.data() + off), len);
+    }
+    return ring.commit();
+}
+
+// Payload whose length and contents both follow from the sequence number
+static std::string payloadFor(uint32_t seq)
+{
+    std::string payload = std::to_string(seq) + ":";
+    payload.append(seq % (IncomingMessage::PAYLOAD_LEN - 16), (char)('a' + seq % 26));
+    return payload;
+}
+
+// ============================================================================
+// Order and contents
+// ============================================================================
+
+TEST(MessageRingTests, EmptyRingHasNothing)
+{
+    MessageRing ring;
+    EXPECT_EQ(ring.front(), nullptr);
+    EXPECT_EQ(ring.size(), 0u);
+    ring.pop(); // Harmless
+    EXPECT_EQ(ring.size(), 0u);
+}
+
+TEST(MessageRingTests, DeliversInArrivalOrder)
+{
+    MessageRing ring;
+    // Arrival order, not topic order - the old map sorted these alphabetically
+    ASSERT_TRUE(deliver(ring, "opentherm/gw/cmd/room_setpoint", "21.5"));
+    ASSERT_TRUE(deliver(ring, "opentherm/gw/cmd/ch_enable", "ON"));
+    ASSERT_TRUE(deliver(ring, "opentherm/gw/cmd/room_setpoint", "19"));
+    EXPECT_EQ(ring.size(), 3u);
+
+    const char *expected[][2] = {{"opentherm/gw/cmd/room_setpoint", "21.5"},
+                                 {"opentherm/gw/cmd/ch_enable", "ON"},
+                                 {"opentherm/gw/cmd/room_setpoint", "19"}};
+    for (auto &e : expected)
+    {
+        const IncomingMessage *msg = ring.front();
+        ASSERT_NE(msg, nullptr);
+        EXPECT_STREQ(msg->topic, e[0]);
+        EXPECT_STREQ(msg->payload, e[1]);
+        EXPECT_EQ(msg->payload_len, strlen(e[1]));
+        ring.pop();
+    }
+    EXPECT_EQ(ring.front(), nullptr);
+    EXPECT_EQ(ring.stats().received, 3u);
+}
+
+TEST(MessageRingTests, AcceptsEmptyPayload)
+{
+    MessageRing ring;
+    ASSERT_TRUE(ring.begin("homeassistant/status", 0));
+    ring.append(nullptr, 0);
+    ASSERT_TRUE(ring.commit());
+    ASSERT_NE(ring.front(), nullptr);
+    EXPECT_STREQ(ring.front()->payload, "");
+}
+
+// ============================================================================
+// Drops and counters
+// ============================================================================
+
+TEST(MessageRingTests, FullRingDropsNewest)
+{
+    MessageRing ring;
+    char topic[32];
+    for (size_t i = 0; i < MessageRing::SLOTS; i++)
+    {
+        snprintf(topic, sizeof(topic), "t/%zu", i);
+        ASSERT_TRUE(deliver(ring, topic, "x"));
+    }
+    EXPECT_FALSE(deliver(ring, "t/late", "x"));
+    EXPECT_FALSE(deliver(ring, "t/later", "x"));
+
+    MessageRingStats stats = ring.stats();
+    EXPECT_EQ(stats.received, MessageRing::SLOTS);
+    EXPECT_EQ(stats.dropped_full, 2u);
+    EXPECT_EQ(stats.high_water, MessageRing::SLOTS);
+
+    // The oldest message survives and a freed slot is reused
+    EXPECT_STREQ(ring.front()->topic, "t/0");
+    ring.pop();
+    EXPECT_TRUE(deliver(ring, "t/next", "x"));
+    EXPECT_EQ(ring.size(), MessageRing::SLOTS);
+}
+
+TEST(MessageRingTests, RejectsOversizeMessages)
+{
+    MessageRing ring;
+    std::string long_topic(IncomingMessage::TOPIC_LEN, 't');
+    std::string long_payload(IncomingMessage::PAYLOAD_LEN, 'p');
+    EXPECT_FALSE(deliver(ring, long_topic.c_str(), "x"));
+    EXPECT_FALSE(deliver(ring, "t", long_payload));
+
+    // More data than announced is dropped rather than overrunning the slot
+    ASSERT_TRUE(ring.begin("t", 2));
+    ring.append(reinterpret_cast<const uint8_t *>("abc"), 3);
+    EXPECT_FALSE(ring.commit());
+
+    EXPECT_EQ(ring.stats().dropped_oversize, 3u);
+    EXPECT_EQ(ring.size(), 0u);
+
+    // The largest that fits still goes through
+    std::string fits(IncomingMessage::PAYLOAD_LEN - 1, 'p');
+    EXPECT_TRUE(deliver(ring, "t", fits));
+    EXPECT_EQ(ring.front()->payload_len, fits.size());
+}
+
+TEST(MessageRingTests, AbandonedMessageIsReplaced)
+{
+    MessageRing ring;
+    ASSERT_TRUE(ring.begin("t/lost", 4));
+    ring.append(reinterpret_cast<const uint8_t *>("ab"), 2);
+    // Connection dropped mid-message; the next one starts over in the same slot
+    ASSERT_TRUE(deliver(ring, "t/next", "cd"));
+    EXPECT_EQ(ring.size(), 1u);
+    EXPECT_STREQ(ring.front()->topic, "t/next");
+    EXPECT_STREQ(ring.front()->payload, "cd");
+}
+
+TEST(MessageRingTests, DiscardEmptiesTheRing)
+{
+    MessageRing ring;
+    deliver(ring, "a", "1");
+    deliver(ring, "b", "2");
+    EXPECT_EQ(ring.discard(), 2u);
+    EXPECT_EQ(ring.front(), nullptr);
+    EXPECT_EQ(ring.discard(), 0u);
+
+    ASSERT_TRUE(deliver(ring, "c", "3"));
+    EXPECT_STREQ(ring.front()->topic, "c");
+}
+
+// ============================================================================
+// Two-thread stress
+// ============================================================================
+
+// Empty if `msg` is the message after `last_seq`-or-later and intact
+static std::string checkMessage(const IncomingMessage *msg, int64_t last_seq)
+{
+    unsigned int seq = 0;
+    if (sscanf(msg->topic, "opentherm/gw/cmd/%u", &seq) != 1)
+        return std::string("bad topic ") + msg->topic;
+    if ((int64_t)seq <= last_seq)
+        return "seq " + std::to_string(seq) + " after " + std::to_string(last_seq);
+    std::string expected = payloadFor(seq);
+    if (msg->payload_len != expected.size() || std::string(msg->payload, msg->payload_len) != expected ||
+        msg->payload[msg->payload_len] != '\0')
+        return "corrupt payload for seq " + std::to_string(seq);
+    return std::string();
+}
+
+// The producer sends `count` messages. With `wait_for_space` it holds off while
+// the ring is full, so every message must arrive; otherwise it keeps sending and
+// the ring drops. Either way nothing may arrive reordered or corrupted.
+static void runStress(uint32_t count, bool wait_for_space)
+{
+    static MessageRing ring;
+    ring.discard();
+    MessageRingStats before = ring.stats();
+
+    std::atomic<bool> producer_done(false);
+    std::atomic<bool> abort(false);
+    std::thread producer([&]() {
+        char topic[32];
+        for (uint32_t seq = 0; seq < count && !abort.load(std::memory_order_relaxed); seq++)
+        {
+            while (wait_for_space && ring.size() == MessageRing::SLOTS && !abort.load(std::memory_order_relaxed))
+                std::this_thread::yield();
+            snprintf(topic, sizeof(topic), "opentherm/gw/cmd/%u", seq);
+            deliver(ring, topic, payloadFor(seq), 1 + seq % 40);
+        }
+        producer_done.store(true, std::memory_order_release);
+    });
+
+    uint32_t seen = 0;
+    int64_t last_seq = -1;
+    for (;;)
+    {
+        // Check for completion before looking at the ring, so nothing committed last is missed
+        bool done = producer_done.load(std::memory_order_acquire);
+        const IncomingMessage *msg = ring.front();
+        if (msg == nullptr)
+        {
+            if (done)
+                break;
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::string error = checkMessage(msg, last_seq);
+        if (!error.empty())
+        {
+            ADD_FAILURE() << error;
+            abort.store(true);
+            break;
+        }
+        last_seq = strtol(msg->topic + strlen("opentherm/gw/cmd/"), nullptr, 10);
+        seen++;
+        ring.pop();
+    }
+    producer.join();
+
+    MessageRingStats after = ring.stats();
+    uint32_t received = after.received - before.received;
+    uint32_t dropped = after.dropped_full - before.dropped_full;
+    printf("Stress (%s): %u sent, %u received, %u dropped full, high water %u of %zu\n",
+           wait_for_space ? "producer waits" : "producer drops", count, received, dropped, after.high_water,
+           MessageRing::SLOTS);
+    EXPECT_EQ(received + dropped, count);
+    EXPECT_EQ(seen, received);
+    EXPECT_EQ(after.dropped_oversize, before.dropped_oversize);
+    if (wait_for_space)
+    {
+        EXPECT_EQ(dropped, 0u);
+    }
+    EXPECT_EQ(ring.size(), 0u);
+}
+
+TEST(MessageRingTests, StressTwoThreadsLossless)
+{
+    runStress(200000, true);
+}
+
+TEST(MessageRingTests, StressTwoThreadsOverflowing)
+{
+    runStress(200000, false);
+}
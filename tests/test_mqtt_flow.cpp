@@ -0,0 +1,270 @@
+/**
+ * Unit tests for credit-based MQTT publish flow control
+ *
+ * A fake link stands in for lwIP: it drains queued messages at a fixed
+ * byte rate and calls release() like the mqtt_publish completion callback.
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "mqtt_flow.hpp"
+
+using namespace OpenTherm::Common;
+
+// Drains `bytes_per_ms` from the head of the queue each tick and completes
+// messages once fully sent, like TCP emptying lwIP's output ring
+class FakeLink
+{
+public:
+    FakeLink(PublishCredits &credits, uint32_t bytes_per_ms)
+        : credits_(credits), bytes_per_ms_(bytes_per_ms), head_sent_(0) {}
+
+    void send(uint32_t bytes) { queue_.push_back(bytes); }
+
+    void tick()
+    {
+        uint32_t budget = bytes_per_ms_;
+        while (budget > 0 && !queue_.empty())
+        {
+            uint32_t left = queue_.front() - head_sent_;
+            uint32_t n = left < budget ? left : budget;
+            head_sent_ += n;
+            budget -= n;
+            if (head_sent_ == queue_.front())
+            {
+                credits_.release(queue_.front());
+                queue_.pop_front();
+                head_sent_ = 0;
+            }
+        }
+    }
+
+    bool empty() const { return queue_.empty(); }
+
+private:
+    PublishCredits &credits_;
+    uint32_t bytes_per_ms_;
+    uint32_t head_sent_;
+    std::deque<uint32_t> queue_;
+};
+
+// ============================================================================
+// Wire size
+// ============================================================================
+
+TEST(MqttFlowTests, WireSizeMatchesPublishEncoding)
+{
+    // 1 header + 1 length byte + (2 + 10 topic + 5 payload)
+    EXPECT_EQ(publishWireSize(10, 5, 0), 19u);
+    // QoS 1 adds a packet identifier
+    EXPECT_EQ(publishWireSize(10, 5, 1), 21u);
+    // Remaining length 127 fits one byte, 128 needs two
+    EXPECT_EQ(publishWireSize(10, 115, 0), 1u + 1u + 127u);
+    EXPECT_EQ(publishWireSize(10, 116, 0), 1u + 2u + 128u);
+}
+
+TEST(MqttFlowTests, StreamedHeaderMatchesWireSize)
+{
+    // A 15 KB retained payload: 0x31, three length bytes, topic length, topic
+    const char *topic = "homeassistant/device/opentherm_gw/config";
+    uint8_t buf[64];
+    size_t len = encodePublishHeader(topic, 15000, true, buf, sizeof(buf));
+    ASSERT_EQ(len, 1u + 2u + 2u + strlen(topic));
+    EXPECT_EQ(len + 15000, publishWireSize(strlen(topic), 15000, 0));
+    EXPECT_EQ(buf[0], 0x31);
+    // 2 + 40 + 15000 = 15042 = 0x3AC2 -> 0xC2 0x75
+    EXPECT_EQ(buf[1], 0xC2);
+    EXPECT_EQ(buf[2], 0x75);
+    EXPECT_EQ(buf[3], 0x00);
+    EXPECT_EQ(buf[4], strlen(topic));
+    EXPECT_EQ(memcmp(buf + 5, topic, strlen(topic)), 0);
+
+    EXPECT_EQ(encodePublishHeader("a/b", 3, false, buf, sizeof(buf)), 7u);
+    EXPECT_EQ(buf[0], 0x30);
+    EXPECT_EQ(encodePublishHeader(topic, 15000, true, buf, len - 1), 0u);
+}
+
+// ============================================================================
+// Credits
+// ============================================================================
+
+TEST(MqttFlowTests, RequestCreditsLimitInFlight)
+{
+    PublishCredits credits(8, 2048);
+    for (int i = 0; i < 8; i++)
+        EXPECT_TRUE(credits.tryAcquire(10));
+    EXPECT_FALSE(credits.tryAcquire(10));
+    EXPECT_EQ(credits.inFlight(), 8u);
+
+    credits.release(10);
+    EXPECT_TRUE(credits.tryAcquire(10));
+}
+
+TEST(MqttFlowTests, ByteCreditsLimitRingUsage)
+{
+    PublishCredits credits(8, 2048);
+    EXPECT_TRUE(credits.tryAcquire(1000));
+    EXPECT_TRUE(credits.tryAcquire(1000));
+    EXPECT_FALSE(credits.tryAcquire(100));
+    EXPECT_EQ(credits.bytesInFlight(), 2000u);
+
+    credits.release(1000);
+    EXPECT_TRUE(credits.tryAcquire(100));
+    EXPECT_EQ(credits.bytesInFlight(), 1100u);
+}
+
+TEST(MqttFlowTests, OversizedMessageOnlyWhenIdle)
+{
+    PublishCredits credits(8, 2048);
+    EXPECT_TRUE(credits.tryAcquire(10));
+    EXPECT_FALSE(credits.tryAcquire(4000));
+    credits.release(10);
+    EXPECT_TRUE(credits.tryAcquire(4000));
+}
+
+TEST(MqttFlowTests, CancelReturnsCreditsWithoutCompleting)
+{
+    PublishCredits credits(8, 2048);
+    ASSERT_TRUE(credits.tryAcquire(300));
+    credits.cancel(300);
+    EXPECT_TRUE(credits.idle());
+    EXPECT_EQ(credits.completedMessages(), 0u);
+    EXPECT_EQ(credits.completedBytes(), 0u);
+}
+
+TEST(MqttFlowTests, ResetForgetsDroppedRequests)
+{
+    PublishCredits credits(8, 2048);
+    for (int i = 0; i < 8; i++)
+        ASSERT_TRUE(credits.tryAcquire(100));
+    credits.release(100);
+
+    credits.reset();
+    EXPECT_TRUE(credits.idle());
+    EXPECT_EQ(credits.bytesInFlight(), 0u);
+    for (int i = 0; i < 8; i++)
+        EXPECT_TRUE(credits.tryAcquire(100));
+    EXPECT_FALSE(credits.tryAcquire(100));
+    EXPECT_EQ(credits.completedMessages(), 1u);
+}
+
+// ============================================================================
+// Throughput
+// ============================================================================
+
+TEST(MqttFlowTests, ThroughputMeterCountsCompletedOnly)
+{
+    PublishCredits credits;
+    ThroughputMeter meter;
+    ASSERT_TRUE(credits.tryAcquire(100));
+    credits.release(100);
+
+    meter.start(credits, 1000);
+    for (int i = 0; i < 4; i++)
+        ASSERT_TRUE(credits.tryAcquire(250));
+    credits.release(250);
+    credits.release(250);
+
+    Throughput t = meter.read(credits, 1500);
+    EXPECT_EQ(t.messages, 2u);
+    EXPECT_EQ(t.bytes, 500u);
+    EXPECT_EQ(t.elapsed_ms, 500u);
+    EXPECT_EQ(t.messagesPerSecond(), 4u);
+    EXPECT_EQ(t.bytesPerSecond(), 1000u);
+}
+
+TEST(MqttFlowTests, ThroughputWithZeroElapsed)
+{
+    Throughput t = {5, 500, 0};
+    EXPECT_EQ(t.messagesPerSecond(), 0u);
+    EXPECT_EQ(t.bytesPerSecond(), 0u);
+}
+
+// ============================================================================
+// Bursts over a simulated link
+// ============================================================================
+
+TEST(MqttFlowTests, BurstRunsAtLinkSpeed)
+{
+    PublishCredits credits(8, 2048);
+    FakeLink link(credits, 100); // ~100 KB/s
+    const uint32_t messages = 80;
+    const uint32_t size = publishWireSize(60, 300, 0); // Discovery-sized
+
+    uint32_t sent = 0;
+    uint32_t now = 0;
+    ThroughputMeter meter;
+    meter.start(credits, now);
+    while (sent < messages || !link.empty())
+    {
+        while (sent < messages && credits.tryAcquire(size))
+        {
+            link.send(size);
+            sent++;
+            ASSERT_LE(credits.inFlight(), 8u);
+            ASSERT_LE(credits.bytesInFlight(), 2048u);
+        }
+        link.tick();
+        now++;
+    }
+
+    Throughput t = meter.read(credits, now);
+    EXPECT_EQ(t.messages, messages);
+    // The link is the only limit: total bytes / link rate, well under the
+    // 100 ms per message the fixed sleeps used to cost (8 s here)
+    EXPECT_LE(now, messages * size / 100 + 2);
+    EXPECT_TRUE(credits.idle());
+}
+
+TEST(MqttFlowTests, CreditsBalanceAcrossThreads)
+{
+    PublishCredits credits(8, 2048);
+    std::mutex mutex;
+    std::deque<uint32_t> pending;
+    std::atomic<bool> done(false);
+    const uint32_t total = 20000;
+
+    // Completion side, as the lwIP callback on core 1
+    std::thread completer([&]
+                          {
+        while (!done.load() || !credits.idle())
+        {
+            uint32_t bytes = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!pending.empty())
+                {
+                    bytes = pending.front();
+                    pending.pop_front();
+                }
+            }
+            if (bytes)
+                credits.release(bytes);
+            else
+                std::this_thread::yield();
+        } });
+
+    uint32_t max_in_flight = 0;
+    for (uint32_t i = 0; i < total; i++)
+    {
+        uint32_t bytes = 20 + i % 300;
+        while (!credits.tryAcquire(bytes))
+            std::this_thread::yield();
+        uint32_t n = credits.inFlight();
+        if (n > max_in_flight)
+            max_in_flight = n;
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(bytes);
+    }
+    done.store(true);
+    completer.join();
+
+    EXPECT_LE(max_in_flight, 8u);
+    EXPECT_TRUE(credits.idle());
+    EXPECT_EQ(credits.bytesInFlight(), 0u);
+    EXPECT_EQ(credits.completedMessages(), total);
+}
@@ -0,0 +1,306 @@
+/**
+ * Unit tests for the network actor's request and completion queues
+ *
+ * The single-threaded tests cover record layout, wrap-around padding and the
+ * full/oversize cases. The stress test runs the protocol the firmware uses:
+ * an application thread posts publishes, subscribes and streamed pieces with
+ * increasing tokens while an actor thread takes them off, checks them and
+ * posts a completion for each; the application thread checks that every
+ * completion comes back once, in order.
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include "net_queue.hpp"
+
+using OpenTherm::Common::NetCompletion;
+using OpenTherm::Common::NetCompletionQueue;
+using OpenTherm::Common::NetOp;
+using OpenTherm::Common::NetRequest;
+using OpenTherm::Common::NetRequestQueue;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static bool postPublish(NetRequestQueue &q, uint32_t token, const std::string &topic, const std::string &payload)
+{
+    return q.push(NetOp::PUBLISH, token, (uint32_t)payload.size(), true, topic.c_str(), payload.data(),
+                  payload.size());
+}
+
+// Request contents that follow from the token, so the actor can check them
+static NetOp opFor(uint32_t token)
+{
+    return token % 7 == 0 ? NetOp::SUBSCRIBE : token % 11 == 0 ? NetOp::STREAM_DATA : NetOp::PUBLISH;
+}
+
+static std::string topicFor(uint32_t token)
+{
+    return opFor(token) == NetOp::STREAM_DATA ? std::string() : "opentherm/gw/state/" + std::to_string(token);
+}
+
+static std::string payloadFor(uint32_t token)
+{
+    // Mostly small state values, now and then something the size of a discovery config
+    size_t len = token % 97 == 0 ? 1500 : token % 13 == 0 ? 600 : token % 40;
+    std::string payload = std::to_string(token) + "=";
+    payload.append(len, (char)('A' + token % 26));
+    return payload;
+}
+
+// ============================================================================
+// Records
+// ============================================================================
+
+TEST(NetQueueTests, RoundTripsEveryField)
+{
+    NetRequestQueue q;
+    NetRequest r;
+    EXPECT_FALSE(q.front(&r));
+    EXPECT_TRUE(q.empty());
+
+    ASSERT_TRUE(postPublish(q, 42, "opentherm/gw/state/boiler_temp", "55.5"));
+    ASSERT_TRUE(q.push(NetOp::CONNECT, 43, 1883, false, "pico_gw", "192.168.1.10", strlen("192.168.1.10")));
+    ASSERT_TRUE(q.push(NetOp::STREAM_END, 44, 0, false, nullptr, nullptr, 0));
+    EXPECT_FALSE(q.empty());
+
+    ASSERT_TRUE(q.front(&r));
+    EXPECT_EQ(r.op, NetOp::PUBLISH);
+    EXPECT_EQ(r.token, 42u);
+    EXPECT_EQ(r.arg, 4u);
+    EXPECT_TRUE(r.retain);
+    EXPECT_STREQ(r.topic, "opentherm/gw/state/boiler_temp");
+    EXPECT_EQ(r.topic_len, strlen("opentherm/gw/state/boiler_temp"));
+    EXPECT_EQ(std::string((const char *)r.data, r.data_len), "55.5");
+    EXPECT_EQ(r.data[r.data_len], '\0'); // Payloads can be passed on as strings
+    q.pop();
+
+    ASSERT_TRUE(q.front(&r));
+    EXPECT_EQ(r.op, NetOp::CONNECT);
+    EXPECT_EQ(r.arg, 1883u);
+    EXPECT_FALSE(r.retain);
+    EXPECT_STREQ(r.topic, "pico_gw");
+    EXPECT_STREQ((const char *)r.data, "192.168.1.10");
+    q.pop();
+
+    ASSERT_TRUE(q.front(&r));
+    EXPECT_EQ(r.op, NetOp::STREAM_END);
+    EXPECT_STREQ(r.topic, "");
+    EXPECT_EQ(r.data_len, 0u);
+    q.pop();
+
+    EXPECT_FALSE(q.front(&r));
+    EXPECT_TRUE(q.empty());
+}
+
+TEST(NetQueueTests, SmallRequestsTakeLittleRoom)
+{
+    // A typical state publish is tens of bytes, not a slot sized for the largest message
+    EXPECT_LE(NetRequestQueue::recordSize(strlen("opentherm/opentherm_gw/state/boiler_temp"), 4), 72u);
+    EXPECT_EQ(NetRequestQueue::recordSize(0, 0) % 4, 0u);
+}
+
+TEST(NetQueueTests, WrapsWithoutSplittingARecord)
+{
+    NetRequestQueue q;
+    NetRequest r;
+    std::string payload(300, 'x');
+    // Walk the ring around several times with records that do not divide it evenly
+    for (uint32_t token = 0; token < 100; token++)
+    {
+        payload[0] = (char)('a' + token % 26);
+        ASSERT_TRUE(postPublish(q, token, "t/" + std::to_string(token), payload)) << token;
+        ASSERT_TRUE(q.front(&r));
+        EXPECT_EQ(r.token, token);
+        EXPECT_EQ(r.topic, "t/" + std::to_string(token));
+        ASSERT_EQ(r.data_len, payload.size());
+        EXPECT_EQ(memcmp(r.data, payload.data(), payload.size()), 0);
+        q.pop();
+    }
+    EXPECT_TRUE(q.empty());
+}
+
+TEST(NetQueueTests, LargestStateDocumentFitsAtEveryOffset)
+{
+    // The longest document build() renders, on the longest document topic
+    using OpenTherm::Publish::StateDocument;
+    const std::string topic(StateDocument::TOPIC_LEN, 't');
+    const std::string document(StateDocument::DOCUMENT_LEN - 1, 'd');
+    const size_t MIN_RECORD = NetRequestQueue::recordSize(0, 0);
+    const std::string filler(2000, 'f');
+
+    NetRequest r;
+    for (size_t offset = 0; offset < NetRequestQueue::BYTES; offset += 4)
+    {
+        if (offset > 0 && offset < MIN_RECORD)
+            continue; // No record is that small
+
+        // Move the head of an empty queue to `offset` with records of no topic
+        std::unique_ptr<NetRequestQueue> q(new NetRequestQueue());
+        size_t remaining = offset;
+        while (remaining > 0)
+        {
+            size_t size = remaining < filler.size() ? remaining : filler.size();
+            if (remaining - size > 0 && remaining - size < MIN_RECORD)
+                size -= MIN_RECORD;
+            size_t data_len = size - MIN_RECORD + 2; // recordSize(0, data_len) == size
+            ASSERT_EQ(NetRequestQueue::recordSize(0, data_len), size);
+            ASSERT_TRUE(q->push(NetOp::STREAM_DATA, 0, 0, false, nullptr, filler.data(), data_len));
+            ASSERT_TRUE(q->front(&r));
+            q->pop();
+            remaining -= size;
+        }
+
+        ASSERT_TRUE(postPublish(*q, 1, topic, document)) << offset;
+        ASSERT_TRUE(q->front(&r));
+        EXPECT_EQ(r.topic_len, topic.size());
+        EXPECT_EQ(r.data_len, document.size());
+    }
+}
+
+TEST(NetQueueTests, RefusesWhatDoesNotFit)
+{
+    NetRequestQueue q;
+    std::string too_big(NetRequestQueue::maxData() + 1, 'x');
+    EXPECT_FALSE(q.push(NetOp::STREAM_DATA, 0, 0, false, nullptr, too_big.data(), too_big.size()));
+    too_big.pop_back();
+    EXPECT_TRUE(q.push(NetOp::STREAM_DATA, 0, 0, false, nullptr, too_big.data(), too_big.size()));
+
+    // Fill up, then one more is refused until the actor takes one off
+    std::string payload(500, 'p');
+    uint32_t token = 1;
+    while (postPublish(q, token, "t", payload))
+        token++;
+    EXPECT_GT(token, 1u);
+    EXPECT_LE(q.used(), NetRequestQueue::BYTES);
+
+    NetRequest r;
+    ASSERT_TRUE(q.front(&r));
+    EXPECT_EQ(r.token, 0u);
+    q.pop();
+    EXPECT_TRUE(postPublish(q, token, "t", payload));
+}
+
+TEST(NetQueueTests, CompletionsComeBackInOrder)
+{
+    NetCompletionQueue c;
+    NetCompletion out;
+    EXPECT_FALSE(c.pop(&out));
+    for (uint32_t i = 0; i < NetCompletionQueue::SLOTS; i++)
+    {
+        ASSERT_TRUE(c.hasRoom());
+        ASSERT_TRUE(c.push({i, NetOp::PUBLISH, (int8_t)(i % 3 == 0 ? -1 : 0)}));
+    }
+    EXPECT_FALSE(c.hasRoom());
+    EXPECT_FALSE(c.push({99, NetOp::PUBLISH, 0}));
+
+    for (uint32_t i = 0; i < NetCompletionQueue::SLOTS; i++)
+    {
+        ASSERT_TRUE(c.pop(&out));
+        EXPECT_EQ(out.token, i);
+        EXPECT_EQ(out.err, i % 3 == 0 ? -1 : 0);
+    }
+    EXPECT_FALSE(c.pop(&out));
+}
+
+TEST(NetQueueTests, OpNames)
+{
+    EXPECT_STREQ(OpenTherm::Common::netOpName(NetOp::PUBLISH), "publish");
+    EXPECT_STREQ(OpenTherm::Common::netOpName(NetOp::DISCONNECT), "disconnect");
+}
+
+// ============================================================================
+// Two-thread protocol stress
+// ============================================================================
+
+TEST(NetQueueTests, StressApplicationAndActorThreads)
+{
+    constexpr uint32_t COUNT = 100000;
+    static NetRequestQueue requests;
+    static NetCompletionQueue completions;
+    std::atomic<bool> failed(false);
+    std::atomic<uint32_t> actor_checked(0);
+
+    // Actor: take requests off only when a completion can be posted for them
+    std::thread actor([&]() {
+        uint32_t expected = 0;
+        NetRequest r;
+        while (expected < COUNT && !failed.load(std::memory_order_relaxed))
+        {
+            if (!completions.hasRoom() || !requests.front(&r))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            std::string payload = payloadFor(expected);
+            bool ok = r.token == expected && r.op == opFor(expected) && r.topic == topicFor(expected) &&
+                      r.data_len == payload.size() && memcmp(r.data, payload.data(), payload.size()) == 0 &&
+                      r.data[r.data_len] == '\0';
+            if (!ok)
+            {
+                ADD_FAILURE() << "request " << expected << " arrived as token " << r.token;
+                failed.store(true);
+                break;
+            }
+            requests.pop();
+            completions.push({r.token, r.op, (int8_t)(r.token % 5 == 0 ? -1 : 0)});
+            expected++;
+        }
+        actor_checked.store(expected);
+    });
+
+    // Application: post everything, draining completions whenever the queue is full
+    uint32_t next_completion = 0;
+    uint32_t errors = 0;
+    uint32_t full_waits = 0;
+    auto drain = [&]() {
+        NetCompletion c;
+        while (completions.pop(&c))
+        {
+            if (c.token != next_completion || c.op != opFor(next_completion))
+            {
+                ADD_FAILURE() << "completion " << c.token << " where " << next_completion << " was due";
+                failed.store(true);
+                return;
+            }
+            if (c.err != 0)
+                errors++;
+            next_completion++;
+        }
+    };
+
+    for (uint32_t token = 0; token < COUNT && !failed.load(); token++)
+    {
+        NetOp op = opFor(token);
+        std::string topic = topicFor(token);
+        std::string payload = payloadFor(token);
+        while (!requests.push(op, token, 0, false, topic.empty() ? nullptr : topic.c_str(), payload.data(),
+                              payload.size()))
+        {
+            full_waits++;
+            drain();
+            std::this_thread::yield();
+        }
+        drain();
+    }
+    while (next_completion < COUNT && !failed.load())
+    {
+        drain();
+        std::this_thread::yield();
+    }
+    actor.join();
+
+    printf("Net queue stress: %u requests, %u completions (%u errors), %u waits for ring space\n", COUNT,
+           next_completion, errors, full_waits);
+    EXPECT_EQ(actor_checked.load(), COUNT);
+    EXPECT_EQ(next_completion, COUNT);
+    EXPECT_EQ(errors, COUNT / 5);
+    EXPECT_TRUE(requests.empty());
+}
@@ -0,0 +1,171 @@
+/**
+ * Unit tests for the offline history buffer
+ *
+ * Simulates broker outages: values are recorded while "disconnected", then
+ * replayed in batches the way the publish pipeline does after reconnecting,
+ * including publishes that fail and a ring that overflows. Global operator
+ * new is counted (heap_counter.cpp) so the tests can assert that recording
+ * and replay perform no heap allocations.
+ */
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <string>
+#include "heap_counter.hpp"
+#include "offline_buffer.hpp"
+
+using OpenTherm::Entities::Id;
+using OpenTherm::Publish::OfflineBuffer;
+
+// ============================================================================
+// Replay helper
+// ============================================================================
+
+// Render one batch; the records stay in the buffer
+static std::string batch(const OfflineBuffer &buffer, uint32_t now_s, size_t *records, size_t len = 1024)
+{
+    char buf[1024];
+    size_t n = buffer.formatBatch(buf, len, now_s, records);
+    return std::string(buf, n);
+}
+
+class OfflineBufferTest : public ::testing::Test
+{
+protected:
+    OfflineBuffer buffer;
+};
+
+// ============================================================================
+// Recording
+// ============================================================================
+
+TEST_F(OfflineBufferTest, RecordsOnlyChanges)
+{
+    EXPECT_TRUE(buffer.recordFloat(Id::BOILER_TEMP, 45.5f, 1, 100));
+    EXPECT_FALSE(buffer.recordFloat(Id::BOILER_TEMP, 45.5f, 1, 110));
+    // Equal once rounded to the published precision
+    EXPECT_FALSE(buffer.recordFloat(Id::BOILER_TEMP, 45.52f, 1, 120));
+    EXPECT_TRUE(buffer.recordFloat(Id::BOILER_TEMP, 46.0f, 1, 130));
+
+    EXPECT_TRUE(buffer.recordBinary(Id::FLAME, true, 100));
+    EXPECT_FALSE(buffer.recordBinary(Id::FLAME, true, 140));
+    EXPECT_TRUE(buffer.recordBinary(Id::FLAME, false, 150));
+
+    EXPECT_FALSE(buffer.recordFloat(Id::OUTSIDE_TEMP, std::nanf(""), 1, 160));
+    EXPECT_EQ(buffer.size(), 4u);
+}
+
+TEST_F(OfflineBufferTest, EndOutageForgetsTheLastValues)
+{
+    buffer.recordInt(Id::MODULATION, 40, 10);
+    size_t records;
+    batch(buffer, 20, &records);
+    buffer.consume(records);
+    buffer.endOutage();
+
+    // The first value of the next outage is recorded even if it is unchanged
+    EXPECT_TRUE(buffer.recordInt(Id::MODULATION, 40, 500));
+    EXPECT_EQ(buffer.size(), 1u);
+}
+
+// ============================================================================
+// Replay
+// ============================================================================
+
+TEST_F(OfflineBufferTest, BatchUsesDeltaTimestamps)
+{
+    buffer.recordFloat(Id::BOILER_TEMP, 45.5f, 1, 4410);
+    buffer.recordBinary(Id::FLAME, true, 4440);
+    buffer.recordFloat(Id::BOILER_TEMP, 47.0f, 1, 4452);
+    buffer.recordInt(Id::MODULATION, 60, 4452);
+
+    size_t records;
+    EXPECT_EQ(batch(buffer, 5230, &records),
+              "{\"clock\":\"uptime\",\"now\":5230,\"t0\":4410,\"dropped\":0,"
+              "\"v\":[[0,\"boiler_temp\",45.5],[30,\"flame\",1],[12,\"boiler_temp\",47.0],[0,\"modulation\",60]]}");
+    EXPECT_EQ(records, 4u);
+
+    buffer.consume(records);
+    EXPECT_EQ(buffer.size(), 0u);
+    EXPECT_EQ(batch(buffer, 5231, &records), "");
+    EXPECT_EQ(records, 0u);
+}
+
+TEST_F(OfflineBufferTest, SmallPayloadBufferSplitsTheReplay)
+{
+    for (uint32_t t = 0; t < 40; t++)
+        buffer.recordInt(Id::MODULATION, (int32_t)t, t * 10);
+
+    // Every batch is complete JSON and the batches together carry every record in order
+    size_t replayed = 0;
+    int batches = 0;
+    while (buffer.size() > 0)
+    {
+        size_t records;
+        std::string json = batch(buffer, 1000, &records, 160);
+        ASSERT_GT(records, 0u);
+        EXPECT_LT(json.size(), 160u);
+        EXPECT_EQ(json.back(), '}');
+        std::string t0 = "\"t0\":" + std::to_string(replayed * 10) + ",";
+        EXPECT_NE(json.find(t0), std::string::npos) << json;
+        buffer.consume(records);
+        replayed += records;
+        batches++;
+    }
+    EXPECT_EQ(replayed, 40u);
+    EXPECT_GT(batches, 1);
+}
+
+TEST_F(OfflineBufferTest, FailedPublishKeepsTheBatch)
+{
+    buffer.recordBinary(Id::FLAME, true, 10);
+    buffer.recordBinary(Id::FLAME, false, 20);
+
+    size_t records;
+    std::string first = batch(buffer, 30, &records);
+    EXPECT_EQ(records, 2u);
+    // Publish failed: nothing consumed, the retry sends the same batch
+    EXPECT_EQ(batch(buffer, 30, &records), first);
+    EXPECT_EQ(records, 2u);
+    EXPECT_EQ(buffer.size(), 2u);
+}
+
+TEST_F(OfflineBufferTest, OverflowDropsTheOldestAndReportsIt)
+{
+    // A long outage: more changes than the ring holds
+    const uint32_t total = OfflineBuffer::CAPACITY + 10;
+    for (uint32_t t = 0; t < total; t++)
+        buffer.recordInt(Id::MODULATION, (int32_t)t, t);
+    EXPECT_EQ(buffer.size(), OfflineBuffer::CAPACITY);
+    EXPECT_EQ(buffer.dropped(), 10u);
+
+    // The newest records survive; the first batch reports the loss
+    size_t records;
+    std::string json = batch(buffer, total, &records);
+    EXPECT_NE(json.find("\"t0\":10,\"dropped\":10,"), std::string::npos) << json;
+    EXPECT_NE(json.find("[0,\"modulation\",10]"), std::string::npos) << json;
+    buffer.consume(records);
+
+    // ...and only the first
+    json = batch(buffer, total, &records);
+    EXPECT_NE(json.find("\"dropped\":0,"), std::string::npos) << json;
+    EXPECT_EQ(buffer.dropped(), 10u);
+}
+
+TEST_F(OfflineBufferTest, NoHeapAllocations)
+{
+    char buf[512];
+    size_t before = g_heap_allocations;
+    for (uint32_t t = 0; t < 2 * OfflineBuffer::CAPACITY; t++)
+    {
+        buffer.recordFloat(Id::BOILER_TEMP, 40.0f + (float)(t % 50) / 10, 1, t);
+        buffer.recordBinary(Id::FLAME, t % 3 == 0, t);
+    }
+    while (buffer.size() > 0)
+    {
+        size_t records;
+        buffer.formatBatch(buf, sizeof(buf), 1000, &records);
+        buffer.consume(records);
+    }
+    EXPECT_EQ(g_heap_allocations, before);
+}
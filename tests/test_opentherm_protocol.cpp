@@ -8,6 +8,7 @@
 #include "../src/opentherm_protocol.hpp"
 #include <gtest/gtest.h>
 #include <cmath>
+#include <vector>
 
 using namespace OpenTherm::Protocol;
 
@@ -167,6 +168,27 @@ TEST(RequestBuildingTests, WriteRequestSetpoint)
     EXPECT_TRUE(verify_parity(frame));
 }
 
+TEST(RequestBuildingTests, WriteAckCarriesTheAcceptedValue)
+{
+    uint32_t request = write_dhw_setpoint(70.0f);
+    opentherm_frame_t frame = {
+        .parity = 0,
+        .msg_type = OT_MSGTYPE_WRITE_ACK,
+        .spare = 0,
+        .data_id = OT_DATA_ID_DHW_SETPOINT,
+        .data_value = f8_8_from_float(60.0f)}; // Clamped by the boiler
+    uint16_t accepted = 0;
+    EXPECT_TRUE(parse_write_ack(request, pack_frame(&frame), &accepted));
+    EXPECT_NEAR(f8_8_to_float(accepted), 60.0f, 0.01f);
+
+    // Rejected, or an acknowledgement for some other data ID, is not an ack
+    frame.msg_type = OT_MSGTYPE_DATA_INVALID;
+    EXPECT_FALSE(parse_write_ack(request, pack_frame(&frame), &accepted));
+    frame.msg_type = OT_MSGTYPE_WRITE_ACK;
+    frame.data_id = OT_DATA_ID_MAX_CH_SETPOINT;
+    EXPECT_FALSE(parse_write_ack(request, pack_frame(&frame), &accepted));
+}
+
 // ============================================================================
 // Status Encoding/Decoding Tests
 // ============================================================================
@@ -359,3 +381,84 @@ TEST(SignedIntTests, ZeroValue)
     int16_t decoded = decode_s16(encoded);
     EXPECT_EQ(decoded, value);
 }
+
+// ============================================================================
+// Batch Decoding Tests
+// ============================================================================
+
+struct DecodedFrameBuffers
+{
+    explicit DecodedFrameBuffers(size_t n)
+        : msg_type(n), spare(n), data_id(n), data_value(n), parity_ok(n)
+    {
+        view = {msg_type.data(), spare.data(), data_id.data(), data_value.data(), parity_ok.data()};
+    }
+
+    std::vector<uint8_t> msg_type;
+    std::vector<uint8_t> spare;
+    std::vector<uint8_t> data_id;
+    std::vector<uint16_t> data_value;
+    std::vector<uint8_t> parity_ok;
+    DecodedFrame view;
+};
+
+TEST(BatchDecodeTests, MatchesPerFrameDecode)
+{
+    std::vector<uint32_t> frames = {
+        build_read_request(OT_DATA_ID_STATUS),
+        build_write_request(OT_DATA_ID_CONTROL_SETPOINT, f8_8_from_float(45.5f)),
+        write_dhw_setpoint(60.0f),
+        read_boiler_water_temp(),
+        build_read_request(OT_DATA_ID_STATUS) ^ (1u << 10), // corrupted data bit
+        0xFFFFFFFF,
+        0x00000000,
+    };
+
+    DecodedFrameBuffers out(frames.size());
+    decode_frames(frames.data(), frames.size(), &out.view);
+
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        opentherm_frame_t expected;
+        unpack_frame(frames[i], &expected);
+        EXPECT_EQ(out.msg_type[i], expected.msg_type) << "frame " << i;
+        EXPECT_EQ(out.spare[i], expected.spare) << "frame " << i;
+        EXPECT_EQ(out.data_id[i], expected.data_id) << "frame " << i;
+        EXPECT_EQ(out.data_value[i], expected.data_value) << "frame " << i;
+        EXPECT_EQ(out.parity_ok[i] != 0, verify_parity(frames[i])) << "frame " << i;
+    }
+
+    EXPECT_EQ(out.parity_ok[4], 0);
+}
+
+TEST(BatchDecodeTests, VectorAndScalarAgreeOnRandomTrace)
+{
+    // Odd length exercises the vector loop remainder
+    const size_t count = 4099;
+    std::vector<uint32_t> frames(count);
+    uint32_t state = 0x12345678;
+    for (auto &f : frames)
+    {
+        state = state * 1664525u + 1013904223u;
+        f = state;
+    }
+
+    DecodedFrameBuffers fast(count);
+    DecodedFrameBuffers reference(count);
+    decode_frames(frames.data(), count, &fast.view);
+    decode_frames_scalar(frames.data(), count, &reference.view);
+
+    EXPECT_EQ(fast.msg_type, reference.msg_type);
+    EXPECT_EQ(fast.spare, reference.spare);
+    EXPECT_EQ(fast.data_id, reference.data_id);
+    EXPECT_EQ(fast.data_value, reference.data_value);
+    EXPECT_EQ(fast.parity_ok, reference.parity_ok);
+}
+
+TEST(BatchDecodeTests, EmptyTrace)
+{
+    DecodedFrameBuffers out(1);
+    out.parity_ok[0] = 0xAA;
+    decode_frames(nullptr, 0, &out.view);
+    EXPECT_EQ(out.parity_ok[0], 0xAA);
+}
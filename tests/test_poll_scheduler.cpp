@@ -0,0 +1,393 @@
+/**
+ * Unit tests for the tiered polling scheduler
+ *
+ * Drives the scheduler with a simulated millisecond clock (as the firmware
+ * main loop would, in 100 ms ticks) and checks tier rates, even spreading,
+ * boot-only items, MQTT overrides and their saved form, and the frames/minute
+ * metric.
+ */
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "poll_scheduler.hpp"
+
+using namespace OpenTherm::Polling;
+
+struct PollEvent
+{
+    uint32_t time_ms;
+    Item item;
+};
+
+// Run the scheduler from `from_ms` to `to_ms` in `step_ms` ticks, collecting every poll
+static std::vector<PollEvent> run(Scheduler &s, uint32_t from_ms, uint32_t to_ms, uint32_t step_ms = 100)
+{
+    std::vector<PollEvent> events;
+    for (uint32_t t = from_ms; t != to_ms; t += step_ms)
+    {
+        Item item;
+        while (s.nextDue(t, &item))
+        {
+            events.push_back({t, item});
+            s.noteFrames(ITEMS[static_cast<size_t>(item)].frames);
+        }
+    }
+    return events;
+}
+
+static size_t countItem(const std::vector<PollEvent> &events, Item item)
+{
+    return std::count_if(events.begin(), events.end(), [item](const PollEvent &e)
+                         { return e.item == item; });
+}
+
+static size_t countTier(const Scheduler &s, Tier tier)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < ITEM_COUNT; i++)
+        if (s.itemTier(static_cast<Item>(i)) == tier)
+            n++;
+    return n;
+}
+
+// ============================================================================
+// Defaults and tier rates
+// ============================================================================
+
+TEST(PollSchedulerTests, NothingRunsBeforeStart)
+{
+    Scheduler s;
+    auto events = run(s, 0, 10000);
+    EXPECT_TRUE(events.empty());
+}
+
+TEST(PollSchedulerTests, DefaultTierAssignment)
+{
+    Scheduler s;
+    EXPECT_EQ(s.itemTier(Item::STATUS), Tier::FAST);
+    EXPECT_EQ(s.itemTier(Item::BOILER_TEMP), Tier::NORMAL);
+    EXPECT_EQ(s.itemTier(Item::BURNER_STARTS), Tier::SLOW);
+    EXPECT_EQ(s.itemTier(Item::OPENTHERM_VERSION), Tier::BOOT);
+    EXPECT_EQ(s.itemTier(Item::SLAVE_CONFIG), Tier::BOOT);
+    EXPECT_EQ(s.itemTier(Item::DHW_BOUNDS), Tier::BOOT);
+    EXPECT_EQ(s.tierPeriod(Tier::FAST), 1000u);
+    EXPECT_EQ(s.tierPeriod(Tier::NORMAL), 10000u);
+    EXPECT_EQ(s.tierPeriod(Tier::SLOW), 600000u);
+}
+
+TEST(PollSchedulerTests, EveryItemIsReadOnceDuringStartup)
+{
+    Scheduler s;
+    s.start(0);
+    auto events = run(s, 0, STARTUP_SPREAD_MS + 100);
+    for (size_t i = 0; i < ITEM_COUNT; i++)
+        EXPECT_GE(countItem(events, static_cast<Item>(i)), 1u) << ITEMS[i].name;
+}
+
+TEST(PollSchedulerTests, TiersRunAtTheirRates)
+{
+    Scheduler s;
+    s.start(0);
+    auto events = run(s, 0, 1200000); // 20 minutes
+
+    EXPECT_NEAR((double)countItem(events, Item::STATUS), 1200.0, 2.0);
+    EXPECT_NEAR((double)countItem(events, Item::BOILER_TEMP), 120.0, 2.0);
+    EXPECT_NEAR((double)countItem(events, Item::BURNER_STARTS), 3.0, 1.0);
+    EXPECT_EQ(countItem(events, Item::OPENTHERM_VERSION), 1u);
+    EXPECT_EQ(countItem(events, Item::CH_BOUNDS), 1u);
+}
+
+TEST(PollSchedulerTests, BootItemsReadAgainAfterRestart)
+{
+    Scheduler s;
+    s.start(0);
+    run(s, 0, 60000);
+    s.start(60000); // e.g. after an MQTT reconnect
+    auto events = run(s, 60000, 120000);
+    EXPECT_EQ(countItem(events, Item::OPENTHERM_VERSION), 1u);
+}
+
+// ============================================================================
+// Spreading
+// ============================================================================
+
+TEST(PollSchedulerTests, NormalTierIsSpreadEvenly)
+{
+    Scheduler s;
+    s.start(0);
+    auto events = run(s, 0, 120000, 10);
+
+    // After the startup pass, count NORMAL reads per second: a burst would put
+    // most of them in one second; even spreading keeps it to ~N/10 per second
+    size_t n = countTier(s, Tier::NORMAL);
+    std::map<uint32_t, size_t> per_second;
+    for (const auto &e : events)
+    {
+        if (e.time_ms >= 20000 && s.itemTier(e.item) == Tier::NORMAL)
+            per_second[e.time_ms / 1000]++;
+    }
+    size_t max_per_second = 0;
+    for (const auto &kv : per_second)
+        max_per_second = std::max(max_per_second, kv.second);
+
+    EXPECT_LE(max_per_second, (n + 9) / 10 + 1);
+}
+
+TEST(PollSchedulerTests, SlowTierIsSpreadOverItsPeriod)
+{
+    Scheduler s;
+    s.start(0);
+    auto events = run(s, 0, 1300000);
+
+    std::vector<uint32_t> times;
+    for (const auto &e : events)
+        if (e.time_ms > STARTUP_SPREAD_MS && s.itemTier(e.item) == Tier::SLOW)
+            times.push_back(e.time_ms);
+    ASSERT_GE(times.size(), countTier(s, Tier::SLOW));
+
+    std::sort(times.begin(), times.end());
+    uint32_t expected_gap = s.tierPeriod(Tier::SLOW) / countTier(s, Tier::SLOW);
+    for (size_t i = 1; i < times.size(); i++)
+        EXPECT_GE(times[i] - times[i - 1], expected_gap - 200);
+}
+
+TEST(PollSchedulerTests, StalledLoopDoesNotBurstToCatchUp)
+{
+    Scheduler s;
+    s.start(0);
+    run(s, 0, 20000);
+
+    // Main loop blocked for 60 s: each item runs once, not once per missed slot
+    auto events = run(s, 80000, 80100);
+    EXPECT_EQ(countItem(events, Item::STATUS), 1u);
+    EXPECT_LE(countItem(events, Item::BOILER_TEMP), 1u);
+}
+
+TEST(PollSchedulerTests, SkipNextDropsOnePollAndKeepsThePhase)
+{
+    Scheduler plain, skipped;
+    plain.start(0);
+    skipped.start(0);
+    run(plain, 0, 20000);
+    run(skipped, 0, 20000);
+
+    // e.g. a write's WRITE-ACK just told us the control setpoint
+    skipped.skipNext(Item::CONTROL_SETPOINT);
+    uint32_t period = plain.tierPeriod(Tier::NORMAL);
+    auto expected = run(plain, 20000, 20000 + 3 * period);
+    auto events = run(skipped, 20000, 20000 + 3 * period);
+
+    std::vector<uint32_t> expected_times, times;
+    for (const auto &e : expected)
+        if (e.item == Item::CONTROL_SETPOINT)
+            expected_times.push_back(e.time_ms);
+    for (const auto &e : events)
+        if (e.item == Item::CONTROL_SETPOINT)
+            times.push_back(e.time_ms);
+    ASSERT_EQ(expected_times.size(), 3u);
+    ASSERT_EQ(times.size(), 2u);
+    EXPECT_EQ(times[0], expected_times[1]);
+    EXPECT_EQ(times[1], expected_times[2]);
+    EXPECT_EQ(countItem(events, Item::STATUS), countItem(expected, Item::STATUS));
+}
+
+TEST(PollSchedulerTests, SkipNextLeavesStartupAndBootReadsAlone)
+{
+    Scheduler s;
+    s.start(0);
+    s.skipNext(Item::CONTROL_SETPOINT);
+    s.skipNext(Item::OPENTHERM_VERSION);
+    auto events = run(s, 0, STARTUP_SPREAD_MS + 100);
+    EXPECT_EQ(countItem(events, Item::CONTROL_SETPOINT), 1u);
+    EXPECT_EQ(countItem(events, Item::OPENTHERM_VERSION), 1u);
+}
+
+TEST(PollSchedulerTests, TimeUntilDueMatchesNextPoll)
+{
+    Scheduler s;
+    EXPECT_EQ(s.msUntilDue(0), MAX_PERIOD_MS); // Nothing armed before start
+
+    s.start(0);
+    run(s, 0, 20000);
+
+    // Sleeping for msUntilDue() never misses an item and never wakes for nothing
+    uint32_t t = 20000;
+    run(s, t, t + 1, 1);
+    for (int i = 0; i < 50; i++)
+    {
+        uint32_t wait = s.msUntilDue(t);
+        ASSERT_GT(wait, 0u) << "everything due was just polled";
+        Item item;
+        EXPECT_FALSE(s.nextDue(t + wait - 1, &item));
+        t += wait;
+        EXPECT_TRUE(s.nextDue(t, &item));
+        while (s.nextDue(t, &item))
+        {
+        }
+    }
+}
+
+// ============================================================================
+// Overrides
+// ============================================================================
+
+TEST(PollSchedulerTests, TierPeriodOverride)
+{
+    Scheduler s;
+    s.start(0);
+    run(s, 0, 10000);
+
+    ASSERT_TRUE(applyTierCommand("fast 5", s, 10000));
+    EXPECT_EQ(s.tierPeriod(Tier::FAST), 5000u);
+    auto events = run(s, 10000, 70000);
+    EXPECT_NEAR((double)countItem(events, Item::STATUS), 12.0, 1.0);
+}
+
+TEST(PollSchedulerTests, ItemReassignment)
+{
+    Scheduler s;
+    s.start(0);
+    run(s, 0, 10000);
+
+    ASSERT_TRUE(applyTierCommand("dhw_flow fast", s, 10000));
+    EXPECT_EQ(s.itemTier(Item::DHW_FLOW), Tier::FAST);
+    auto events = run(s, 10000, 20000);
+    EXPECT_NEAR((double)countItem(events, Item::DHW_FLOW), 10.0, 1.0);
+
+    ASSERT_TRUE(applyTierCommand("dhw_flow boot", s, 20000));
+    events = run(s, 20000, 80000);
+    EXPECT_EQ(countItem(events, Item::DHW_FLOW), 0u);
+}
+
+TEST(PollSchedulerTests, TierCommandRejectsBadInput)
+{
+    Scheduler s;
+    EXPECT_FALSE(applyTierCommand("", s, 0));
+    EXPECT_FALSE(applyTierCommand("fast", s, 0));
+    EXPECT_FALSE(applyTierCommand("fast abc", s, 0));
+    EXPECT_FALSE(applyTierCommand("fast 0", s, 0));
+    EXPECT_FALSE(applyTierCommand("boot 10", s, 0));
+    EXPECT_FALSE(applyTierCommand("nothing 10", s, 0));
+    EXPECT_FALSE(applyTierCommand("boiler_temp sometimes", s, 0));
+    EXPECT_FALSE(applyTierCommand("fast 1 extra", s, 0));
+    EXPECT_EQ(s.tierPeriod(Tier::FAST), DEFAULT_FAST_PERIOD_MS);
+}
+
+TEST(PollSchedulerTests, TierSummary)
+{
+    Scheduler s;
+    s.setTierPeriod(Tier::NORMAL, 30000, 0);
+    char buf[64];
+    formatTierSummary(s, buf, sizeof(buf));
+    EXPECT_STREQ(buf, "fast=1s normal=30s slow=600s");
+}
+
+TEST(PollSchedulerTests, DefaultTiersSaveAsEmptyText)
+{
+    Scheduler s;
+    s.setTierPeriod(Tier::NORMAL, 30000, 0); // The update interval; saved on its own
+    char buf[TIER_OVERRIDES_LEN];
+    ASSERT_TRUE(formatTierOverrides(s, buf, sizeof(buf)));
+    EXPECT_STREQ(buf, "");
+}
+
+TEST(PollSchedulerTests, OverridesSurviveARestart)
+{
+    Scheduler before;
+    ASSERT_TRUE(applyTierCommand("slow 300", before, 0));
+    ASSERT_TRUE(applyTierCommand("fast 2.5", before, 0));
+    ASSERT_TRUE(applyTierCommand("dhw_flow fast", before, 0));
+    ASSERT_TRUE(applyTierCommand("date boot", before, 0));
+
+    char buf[TIER_OVERRIDES_LEN];
+    ASSERT_TRUE(formatTierOverrides(before, buf, sizeof(buf)));
+    EXPECT_STREQ(buf, "fast 2.5\nslow 300\ndhw_flow fast\ndate boot");
+
+    Scheduler after;
+    EXPECT_EQ(applyTierOverrides(buf, after, 0), 4u);
+    EXPECT_EQ(after.tierPeriod(Tier::FAST), 2500u);
+    EXPECT_EQ(after.tierPeriod(Tier::SLOW), 300000u);
+    for (const ItemInfo &info : ITEMS)
+        EXPECT_EQ(after.itemTier(info.item), before.itemTier(info.item)) << info.name;
+}
+
+TEST(PollSchedulerTests, EveryOverrideFitsTheSavedText)
+{
+    Scheduler s;
+    s.setTierPeriod(Tier::FAST, MAX_PERIOD_MS - 100, 0);
+    s.setTierPeriod(Tier::SLOW, MAX_PERIOD_MS - 100, 0);
+    for (const ItemInfo &info : ITEMS)
+        s.setItemTier(info.item, info.default_tier == Tier::NORMAL ? Tier::SLOW : Tier::NORMAL, 0);
+
+    char buf[TIER_OVERRIDES_LEN];
+    EXPECT_TRUE(formatTierOverrides(s, buf, sizeof(buf)));
+}
+
+TEST(PollSchedulerTests, RestoreSkipsLinesThatNoLongerParse)
+{
+    Scheduler s;
+    EXPECT_EQ(applyTierOverrides("removed_item fast\n\nslow 120", s, 0), 1u);
+    EXPECT_EQ(s.tierPeriod(Tier::SLOW), 120000u);
+}
+
+// ============================================================================
+// Frames per minute
+// ============================================================================
+
+TEST(PollSchedulerTests, PlannedFramesPerMinute)
+{
+    Scheduler s;
+    // 1 status/s + N normal frames per 10 s + M slow frames per 10 min
+    size_t normal_frames = 0, slow_frames = 0;
+    for (size_t i = 0; i < ITEM_COUNT; i++)
+    {
+        if (ITEMS[i].default_tier == Tier::NORMAL)
+            normal_frames += ITEMS[i].frames;
+        if (ITEMS[i].default_tier == Tier::SLOW)
+            slow_frames += ITEMS[i].frames;
+    }
+    double expected = 60.0 + normal_frames * 6.0 + slow_frames * 0.1;
+    EXPECT_NEAR((double)s.plannedFramesPerMinute(), expected, 1.0);
+
+    // Far below polling every item every 10 s
+    size_t all_frames = 0;
+    for (size_t i = 0; i < ITEM_COUNT; i++)
+        all_frames += ITEMS[i].frames;
+    EXPECT_LT(s.plannedFramesPerMinute(), 60 + all_frames * 6);
+}
+
+TEST(PollSchedulerTests, MeasuredFrameRateMatchesPlan)
+{
+    Scheduler s;
+    s.start(0);
+    run(s, 0, 30000); // Past the startup pass
+
+    uint32_t fpm = 0;
+    s.takeFrameRate(30000, &fpm); // Reset window
+    run(s, 30000, 30000 + 3 * FRAME_RATE_WINDOW_MS);
+    ASSERT_TRUE(s.takeFrameRate(30000 + 3 * FRAME_RATE_WINDOW_MS, &fpm));
+    EXPECT_NEAR((double)fpm, (double)s.plannedFramesPerMinute(), 5.0);
+}
+
+TEST(PollSchedulerTests, FrameRateReportedOncePerWindow)
+{
+    Scheduler s;
+    s.start(0);
+    uint32_t fpm;
+    EXPECT_FALSE(s.takeFrameRate(1000, &fpm));
+    EXPECT_TRUE(s.takeFrameRate(FRAME_RATE_WINDOW_MS, &fpm));
+    EXPECT_FALSE(s.takeFrameRate(FRAME_RATE_WINDOW_MS + 1000, &fpm));
+}
+
+TEST(PollSchedulerTests, WorksAcrossTimerWrap)
+{
+    Scheduler s;
+    uint32_t start = 0xFFFFFFFFu - 30000 + 1; // multiple of 100 below 2^32 wrap
+    start -= start % 100;
+    s.start(start);
+    auto events = run(s, start, start + 120000);
+    EXPECT_NEAR((double)countItem(events, Item::STATUS), 120.0, 2.0);
+    EXPECT_NEAR((double)countItem(events, Item::BOILER_TEMP), 12.0, 1.0);
+}
@@ -0,0 +1,509 @@
+/**
+ * Unit tests for the entity-indexed publish-on-change cache
+ *
+ * The cache is exercised through a recording sink instead of MQTT. Global
+ * operator new is counted (heap_counter.cpp) so the tests can assert that
+ * the steady-state publish path performs no heap allocations.
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "heap_counter.hpp"
+#include "opentherm_ha.hpp"
+#include "publish_cache.hpp"
+#include "publish_queue.hpp"
+#include "topic_arena.hpp"
+
+using OpenTherm::Entities::Id;
+using OpenTherm::MQTTTopics::TopicArena;
+using OpenTherm::Publish::SentLog;
+using OpenTherm::Publish::StateCache;
+
+// ============================================================================
+// Recording sink
+// ============================================================================
+
+struct SentMessage
+{
+    std::string topic;
+    std::string payload;
+    bool retain;
+};
+
+static std::vector<SentMessage> g_sent;
+static size_t g_sink_calls = 0;
+static bool g_sink_fail = false;
+static bool g_sink_record = true;
+
+static bool recordingSink(const char *topic, const char *payload, bool retain)
+{
+    g_sink_calls++;
+    if (g_sink_fail)
+        return false;
+    if (g_sink_record)
+        g_sent.push_back({topic, payload, retain});
+    return true;
+}
+
+class PublishCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        g_sent.clear();
+        g_sent.reserve(256);
+        g_sink_calls = 0;
+        g_sink_fail = false;
+        g_sink_record = true;
+        OpenTherm::HomeAssistant::Config cfg = {};
+        cfg.device_id = "opentherm_gw";
+        cfg.mqtt_prefix = "homeassistant";
+        cfg.topic_base = "opentherm";
+        cfg.state_topic_base = "state";
+        cfg.command_topic_base = "cmd";
+        ASSERT_TRUE(topics.build(cfg));
+        cache.setTopics(&topics);
+    }
+
+    TopicArena topics;
+    StateCache cache{&recordingSink};
+};
+
+// ============================================================================
+// Change detection
+// ============================================================================
+
+TEST_F(PublishCacheTest, FirstPublishGoesOut)
+{
+    EXPECT_TRUE(cache.publishFloat(Id::BOILER_TEMP, 45.5f));
+    ASSERT_EQ(g_sent.size(), 1u);
+    EXPECT_EQ(g_sent[0].topic, "opentherm/opentherm_gw/state/boiler_temp");
+    EXPECT_EQ(g_sent[0].payload, "45.50");
+    EXPECT_FALSE(g_sent[0].retain);
+}
+
+TEST_F(PublishCacheTest, UnchangedValuesAreSuppressed)
+{
+    cache.publishBinary(Id::FLAME, true);
+    cache.publishInt(Id::BURNER_STARTS, 1234);
+    cache.publishFloat(Id::DHW_TEMP, 52.25f);
+    cache.publishText(Id::DAY_OF_WEEK, "Monday");
+    ASSERT_EQ(g_sent.size(), 4u);
+
+    EXPECT_TRUE(cache.publishBinary(Id::FLAME, true));
+    EXPECT_TRUE(cache.publishInt(Id::BURNER_STARTS, 1234));
+    EXPECT_TRUE(cache.publishFloat(Id::DHW_TEMP, 52.25f));
+    EXPECT_TRUE(cache.publishText(Id::DAY_OF_WEEK, "Monday"));
+    EXPECT_EQ(g_sent.size(), 4u);
+}
+
+TEST_F(PublishCacheTest, ChangedValuesArePublished)
+{
+    cache.publishBinary(Id::FLAME, false);
+    cache.publishBinary(Id::FLAME, true);
+    cache.publishInt(Id::BURNER_STARTS, 1);
+    cache.publishInt(Id::BURNER_STARTS, 2);
+    cache.publishText(Id::DAY_OF_WEEK, "Monday");
+    cache.publishText(Id::DAY_OF_WEEK, "Tuesday");
+
+    ASSERT_EQ(g_sent.size(), 6u);
+    EXPECT_EQ(g_sent[0].payload, "OFF");
+    EXPECT_EQ(g_sent[1].payload, "ON");
+    EXPECT_EQ(g_sent[2].payload, "1");
+    EXPECT_EQ(g_sent[3].payload, "2");
+    EXPECT_EQ(g_sent[4].payload, "Monday");
+    EXPECT_EQ(g_sent[5].payload, "Tuesday");
+}
+
+TEST_F(PublishCacheTest, FloatsCompareAtPublishPrecision)
+{
+    cache.publishFloat(Id::ROOM_TEMP, 21.001f, 2);
+    cache.publishFloat(Id::ROOM_TEMP, 21.004f, 2); // Still "21.00"
+    EXPECT_EQ(g_sent.size(), 1u);
+
+    cache.publishFloat(Id::ROOM_TEMP, 21.01f, 2);
+    ASSERT_EQ(g_sent.size(), 2u);
+    EXPECT_EQ(g_sent[1].payload, "21.01");
+
+    // Same value at a different precision is a different payload
+    cache.publishFloat(Id::ROOM_TEMP, 21.01f, 1);
+    ASSERT_EQ(g_sent.size(), 3u);
+    EXPECT_EQ(g_sent[2].payload, "21.0");
+}
+
+TEST_F(PublishCacheTest, NegativeFloats)
+{
+    cache.publishFloat(Id::OUTSIDE_TEMP, -3.5f);
+    cache.publishFloat(Id::OUTSIDE_TEMP, -3.5f);
+    ASSERT_EQ(g_sent.size(), 1u);
+    EXPECT_EQ(g_sent[0].payload, "-3.50");
+}
+
+TEST_F(PublishCacheTest, EntitiesAreIndependent)
+{
+    cache.publishFloat(Id::BOILER_TEMP, 50.0f);
+    cache.publishFloat(Id::RETURN_TEMP, 50.0f);
+    EXPECT_EQ(g_sent.size(), 2u);
+    EXPECT_EQ(cache.entryCount(), 2u);
+}
+
+TEST_F(PublishCacheTest, FailedPublishIsRetried)
+{
+    g_sink_fail = true;
+    EXPECT_FALSE(cache.publishInt(Id::FAULT_CODE, 7));
+    EXPECT_EQ(cache.entryCount(), 0u);
+
+    g_sink_fail = false;
+    EXPECT_TRUE(cache.publishInt(Id::FAULT_CODE, 7));
+    ASSERT_EQ(g_sent.size(), 1u);
+    EXPECT_EQ(g_sent[0].payload, "7");
+}
+
+TEST_F(PublishCacheTest, PublishFailedAfterQueueingIsForgotten)
+{
+    // The sink only queues: the value is cached before the broker has it
+    SentLog sent;
+    uint32_t token = 0;
+    EXPECT_TRUE(cache.publishBinary(Id::FLAME, true));
+    sent.sent(token++, Id::FLAME);
+    EXPECT_TRUE(cache.publishInt(Id::FAULT_CODE, 7));
+    sent.sent(token++, Id::FAULT_CODE);
+
+    // The network core reports the FLAME publish lost
+    Id id;
+    ASSERT_TRUE(sent.take(0, &id));
+    EXPECT_EQ(id, Id::FLAME);
+    EXPECT_FALSE(sent.take(0, &id));
+    cache.invalidate(id);
+
+    // The same reading goes out again; FAULT_CODE stays cached
+    EXPECT_TRUE(cache.publishBinary(Id::FLAME, true));
+    EXPECT_TRUE(cache.publishInt(Id::FAULT_CODE, 7));
+    ASSERT_EQ(g_sent.size(), 3u);
+    EXPECT_EQ(g_sent[2].topic, cache.topic(Id::FLAME));
+}
+
+TEST(SentLogTest, KeepsTheLastSlotsPublishes)
+{
+    SentLog sent;
+    for (uint32_t token = 0; token < SentLog::SLOTS + 2; token++)
+        sent.sent(token, token % 2 ? Id::FLAME : Id::BOILER_TEMP);
+
+    // The two oldest were overwritten; their publishes have long completed
+    Id id;
+    EXPECT_FALSE(sent.take(0, &id));
+    EXPECT_FALSE(sent.take(1, &id));
+    ASSERT_TRUE(sent.take(SentLog::SLOTS + 1, &id));
+    EXPECT_EQ(id, Id::FLAME);
+
+    // Failures that could not be told apart take every entry
+    size_t taken = 0;
+    while (sent.takeAny(&id))
+        taken++;
+    EXPECT_EQ(taken, SentLog::SLOTS - 1);
+    EXPECT_FALSE(sent.take(2, &id));
+}
+
+TEST_F(PublishCacheTest, OverlongTextIsPublishedUncached)
+{
+    std::string long_value(StateCache::TEXT_LEN + 10, 'x');
+    cache.publishText(Id::WIFI_SSID, long_value.c_str());
+    cache.publishText(Id::WIFI_SSID, long_value.c_str());
+    ASSERT_EQ(g_sent.size(), 2u);
+    EXPECT_EQ(g_sent[1].payload, long_value);
+}
+
+TEST_F(PublishCacheTest, ClearForcesRepublish)
+{
+    cache.publishBinary(Id::FAULT, false);
+    cache.clear();
+    EXPECT_EQ(cache.entryCount(), 0u);
+    cache.publishBinary(Id::FAULT, false);
+    EXPECT_EQ(g_sent.size(), 2u);
+}
+
+TEST_F(PublishCacheTest, RepublishAllSendsCachedPayloads)
+{
+    cache.publishBinary(Id::CH_ENABLE, true);
+    cache.publishInt(Id::WIFI_RSSI, -67);
+    cache.publishFloat(Id::PRESSURE, 1.456f, 2);
+    cache.publishText(Id::IP_ADDRESS, "192.168.1.50");
+    g_sent.clear();
+
+    EXPECT_EQ(cache.republishAll(), 4u);
+    ASSERT_EQ(g_sent.size(), 4u);
+    EXPECT_EQ(g_sent[0].topic, "opentherm/opentherm_gw/state/ch_enable");
+    EXPECT_EQ(g_sent[0].payload, "ON");
+    EXPECT_EQ(g_sent[1].payload, "1.46");
+    EXPECT_EQ(g_sent[2].payload, "-67");
+    EXPECT_EQ(g_sent[3].payload, "192.168.1.50");
+}
+
+TEST_F(PublishCacheTest, RepublishKeepsTheRetainFlag)
+{
+    cache.publishFloat(Id::BOILER_TEMP, 45.5f, 2, true);
+    cache.publishBinary(Id::FLAME, true, false);
+    g_sent.clear();
+
+    EXPECT_EQ(cache.republishAll(), 2u);
+    ASSERT_EQ(g_sent.size(), 2u);
+    for (const SentMessage &msg : g_sent)
+        EXPECT_EQ(msg.retain, msg.topic == "opentherm/opentherm_gw/state/boiler_temp") << msg.topic;
+}
+
+TEST_F(PublishCacheTest, RefreshSendsOneCachedValuePerStep)
+{
+    EXPECT_FALSE(cache.refreshing());
+    EXPECT_FALSE(cache.refreshStep()); // Nothing started
+
+    cache.publishBinary(Id::CH_ENABLE, true, true);
+    cache.publishFloat(Id::PRESSURE, 1.456f, 2, true);
+    cache.publishText(Id::IP_ADDRESS, "192.168.1.50", true);
+    g_sent.clear();
+
+    cache.beginRefresh();
+    EXPECT_TRUE(cache.refreshing());
+    EXPECT_TRUE(cache.refreshStep());
+    ASSERT_EQ(g_sent.size(), 1u);
+    EXPECT_EQ(g_sent[0].payload, "ON");
+    EXPECT_TRUE(g_sent[0].retain);
+
+    // A change mid-refresh goes out at once; the refresh then re-sends the new value
+    cache.publishFloat(Id::PRESSURE, 1.6f, 2, true);
+    while (cache.refreshStep())
+    {
+    }
+    EXPECT_FALSE(cache.refreshing());
+    ASSERT_EQ(g_sent.size(), 4u);
+    EXPECT_EQ(g_sent[1].payload, "1.60");
+    EXPECT_EQ(g_sent[2].payload, "1.60");
+    EXPECT_EQ(g_sent[3].payload, "192.168.1.50");
+
+    // Restarting covers everything again
+    g_sent.clear();
+    cache.beginRefresh();
+    while (cache.refreshStep())
+    {
+    }
+    EXPECT_EQ(g_sent.size(), 3u);
+}
+
+TEST_F(PublishCacheTest, EveryEntityHasADistinctTopic)
+{
+    std::vector<std::string> seen;
+    for (size_t i = 0; i < OpenTherm::Entities::COUNT; i++)
+    {
+        std::string topic = cache.topic(static_cast<Id>(i));
+        ASSERT_LT(topic.size(), StateCache::TOPIC_LEN);
+        seen.push_back(topic);
+    }
+    for (size_t i = 0; i < seen.size(); i++)
+        for (size_t j = i + 1; j < seen.size(); j++)
+            EXPECT_NE(seen[i], seen[j]);
+}
+
+// ============================================================================
+// Hot start snapshot
+// ============================================================================
+
+// The cache as a poll cycle leaves it
+static void fillCache(StateCache &cache)
+{
+    cache.publishBinary(Id::FLAME, true, true);
+    cache.publishInt(Id::WIFI_RSSI, -67, true);
+    cache.publishFloat(Id::BOILER_TEMP, 45.5f, 2, true);
+    cache.publishFloat(Id::PRESSURE, -1.5f, 1, false);
+    cache.publishText(Id::IP_ADDRESS, "192.168.1.50", true);
+}
+
+TEST_F(PublishCacheTest, SnapshotRestoresTheCacheAfterAReboot)
+{
+    fillCache(cache);
+    uint8_t buf[StateCache::SNAPSHOT_LEN];
+    size_t len = cache.saveSnapshot(buf, sizeof(buf));
+    ASSERT_GT(len, 0u);
+    EXPECT_LT(len, 64u); // A few bytes per value
+
+    // After the reboot: the first cycle only publishes what changed meanwhile
+    StateCache rebooted(&recordingSink);
+    rebooted.setTopics(&topics);
+    ASSERT_TRUE(rebooted.loadSnapshot(buf, len));
+    EXPECT_EQ(rebooted.entryCount(), 5u);
+    g_sent.clear();
+    fillCache(rebooted);
+    rebooted.publishFloat(Id::BOILER_TEMP, 52.0f, 2, true);
+    ASSERT_EQ(g_sent.size(), 1u);
+    EXPECT_EQ(g_sent[0].payload, "52.00");
+
+    // Restored values republish as they were, retain flag included
+    g_sent.clear();
+    EXPECT_EQ(rebooted.republishAll(), 5u);
+    for (const SentMessage &msg : g_sent)
+    {
+        if (msg.topic == "opentherm/opentherm_gw/state/pressure")
+        {
+            EXPECT_EQ(msg.payload, "-1.5");
+            EXPECT_FALSE(msg.retain);
+        }
+        if (msg.topic == "opentherm/opentherm_gw/state/ip_address")
+        {
+            EXPECT_EQ(msg.payload, "192.168.1.50");
+        }
+    }
+}
+
+TEST_F(PublishCacheTest, LaggingSnapshotRepublishesControlState)
+{
+    // Saved with the flame off; it came on afterwards and went out, then the
+    // gateway rebooted before the next save
+    fillCache(cache);
+    cache.publishBinary(Id::FLAME, false, true);
+    cache.publishFloat(Id::ROOM_SETPOINT, 20.0f, 1, true);
+    uint8_t buf[StateCache::SNAPSHOT_LEN];
+    size_t len = cache.saveSnapshot(buf, sizeof(buf));
+    ASSERT_GT(len, 0u);
+    cache.publishBinary(Id::FLAME, true, true);   // The broker now shows ON
+    cache.publishFloat(Id::ROOM_SETPOINT, 21.0f, 1, true);
+
+    StateCache rebooted(&recordingSink);
+    rebooted.setTopics(&topics);
+    ASSERT_TRUE(rebooted.loadSnapshot(buf, len));
+    EXPECT_EQ(rebooted.invalidateIf(&OpenTherm::Publish::restoresTentatively), 2u);
+
+    // The flame is off again and the setpoint back at 20: both match the stale
+    // snapshot but must still go out; the temperature is unchanged and does not
+    g_sent.clear();
+    rebooted.publishBinary(Id::FLAME, false, true);
+    rebooted.publishFloat(Id::ROOM_SETPOINT, 20.0f, 1, true);
+    rebooted.publishFloat(Id::BOILER_TEMP, 45.5f, 2, true);
+    ASSERT_EQ(g_sent.size(), 2u);
+    EXPECT_EQ(g_sent[0].topic, rebooted.topic(Id::FLAME));
+    EXPECT_EQ(g_sent[0].payload, "OFF");
+    EXPECT_EQ(g_sent[1].topic, rebooted.topic(Id::ROOM_SETPOINT));
+    EXPECT_EQ(g_sent[1].payload, "20.0");
+}
+
+TEST_F(PublishCacheTest, DamagedSnapshotIsRejected)
+{
+    fillCache(cache);
+    uint8_t buf[StateCache::SNAPSHOT_LEN];
+    size_t len = cache.saveSnapshot(buf, sizeof(buf));
+    ASSERT_GT(len, 0u);
+
+    StateCache other(&recordingSink);
+    other.setTopics(&topics);
+    other.publishInt(Id::WIFI_RSSI, -80);
+
+    // Any flipped bit fails the CRC
+    for (size_t i = 0; i < len; i++)
+    {
+        buf[i] ^= 0x10;
+        EXPECT_FALSE(other.loadSnapshot(buf, len)) << "byte " << i;
+        buf[i] ^= 0x10;
+    }
+    EXPECT_FALSE(other.loadSnapshot(buf, len - 1));
+    EXPECT_FALSE(other.loadSnapshot(buf, 3));
+
+    // The cache is left as it was
+    EXPECT_EQ(other.entryCount(), 1u);
+    g_sent.clear();
+    other.publishInt(Id::WIFI_RSSI, -80);
+    EXPECT_TRUE(g_sent.empty());
+}
+
+TEST_F(PublishCacheTest, SnapshotForAnotherDeviceIsRejected)
+{
+    fillCache(cache);
+    uint8_t buf[StateCache::SNAPSHOT_LEN];
+    size_t len = cache.saveSnapshot(buf, sizeof(buf));
+    ASSERT_GT(len, 0u);
+
+    // Renamed device: the retained values on the broker are under other topics
+    OpenTherm::HomeAssistant::Config cfg = {};
+    cfg.device_id = "boiler_2";
+    cfg.mqtt_prefix = "homeassistant";
+    cfg.topic_base = "opentherm";
+    cfg.state_topic_base = "state";
+    cfg.command_topic_base = "cmd";
+    TopicArena renamed;
+    ASSERT_TRUE(renamed.build(cfg));
+    StateCache other(&recordingSink);
+    other.setTopics(&renamed);
+    EXPECT_FALSE(other.loadSnapshot(buf, len));
+
+    // Nor without topics at all
+    StateCache untopical(&recordingSink);
+    EXPECT_FALSE(untopical.loadSnapshot(buf, len));
+    EXPECT_EQ(untopical.saveSnapshot(buf, sizeof(buf)), 0u);
+}
+
+TEST_F(PublishCacheTest, FullCacheFitsTheSnapshotBuffer)
+{
+    std::string longest(StateCache::TEXT_LEN - 1, 'x');
+    for (size_t i = 0; i < OpenTherm::Entities::COUNT; i++)
+    {
+        Id id = static_cast<Id>(i);
+        if (OpenTherm::Entities::descriptor(id).kind == OpenTherm::Entities::ValueKind::TEXT)
+            cache.publishText(id, longest.c_str());
+        else
+            cache.publishInt(id, -2000000000);
+    }
+    uint8_t buf[StateCache::SNAPSHOT_LEN];
+    size_t len = cache.saveSnapshot(buf, sizeof(buf));
+    ASSERT_GT(len, 0u);
+    EXPECT_EQ(cache.saveSnapshot(buf, len - 1), 0u); // Too small is refused, not truncated
+
+    StateCache rebooted(&recordingSink);
+    rebooted.setTopics(&topics);
+    ASSERT_TRUE(rebooted.loadSnapshot(buf, len));
+    EXPECT_EQ(rebooted.entryCount(), OpenTherm::Entities::COUNT);
+}
+
+// ============================================================================
+// Heap usage
+// ============================================================================
+
+// One poll cycle's worth of publishes across every value kind
+static void publishCycle(StateCache &cache, int tick)
+{
+    cache.publishBinary(Id::FLAME, tick & 1);
+    cache.publishBinary(Id::CH_MODE, true);
+    cache.publishFloat(Id::BOILER_TEMP, 45.0f + tick * 0.25f);
+    cache.publishFloat(Id::DHW_TEMP, 50.0f);
+    cache.publishFloat(Id::MODULATION, (float)(tick % 100));
+    cache.publishInt(Id::BURNER_STARTS, 1000 + tick);
+    cache.publishInt(Id::WIFI_RSSI, -60);
+    cache.publishText(Id::TIME_OF_DAY, (tick & 1) ? "12:00" : "12:01");
+    cache.publishText(Id::WIFI_SSID, "home-network");
+}
+
+TEST_F(PublishCacheTest, SteadyStateMakesNoHeapAllocations)
+{
+    g_sink_record = false; // The recording sink itself would allocate
+
+    publishCycle(cache, 0);
+    size_t first_cycle_calls = g_sink_calls;
+    EXPECT_EQ(first_cycle_calls, 9u);
+
+    // Unchanged values: no publishes, no allocations
+    size_t before = g_heap_allocations;
+    for (int i = 0; i < 100; i++)
+        publishCycle(cache, 0);
+    EXPECT_EQ(g_heap_allocations - before, 0u);
+    EXPECT_EQ(g_sink_calls, first_cycle_calls);
+
+    // Changing values: publishes go out, still no allocations
+    before = g_heap_allocations;
+    for (int i = 1; i <= 100; i++)
+        publishCycle(cache, i);
+    EXPECT_EQ(g_heap_allocations - before, 0u);
+    EXPECT_GT(g_sink_calls, first_cycle_calls + 100);
+
+    // Republish and clear are allocation-free too
+    before = g_heap_allocations;
+    cache.republishAll();
+    cache.clear();
+    EXPECT_EQ(g_heap_allocations - before, 0u);
+}
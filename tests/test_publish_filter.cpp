@@ -0,0 +1,378 @@
+/**
+ * Unit tests for the per-entity publish filter pipeline
+ *
+ * Covers deadband (absolute and relative), median-of-3 glitch rejection,
+ * EWMA smoothing, max-silence refresh, the Home Assistant command syntax and
+ * the saved form of filter overrides.
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include "publish_filter.hpp"
+
+using OpenTherm::Entities::Id;
+using OpenTherm::Publish::defaultFilterConfig;
+using OpenTherm::Publish::FilterBank;
+using OpenTherm::Publish::FilterConfig;
+using OpenTherm::Publish::FilterDecision;
+using OpenTherm::Publish::applyFilterOverrides;
+using OpenTherm::Publish::formatFilterConfig;
+using OpenTherm::Publish::formatFilterOverrides;
+using OpenTherm::Publish::parseFilterCommand;
+
+// Feed a sample and, like the publisher, record it when the filter lets it through
+static FilterDecision feed(FilterBank &bank, Id id, float raw, uint32_t now_ms, float *out = nullptr)
+{
+    float filtered = 0.0f;
+    FilterDecision d = bank.process(id, raw, now_ms, &filtered);
+    if (d != FilterDecision::HOLD)
+        bank.published(id, filtered, now_ms);
+    if (out)
+        *out = filtered;
+    return d;
+}
+
+static FilterConfig makeConfig(float deadband, bool relative, bool median3, float alpha, uint32_t silence_ms)
+{
+    FilterConfig cfg = {deadband, relative, median3, alpha, silence_ms};
+    return cfg;
+}
+
+// ============================================================================
+// Deadband
+// ============================================================================
+
+TEST(PublishFilterTests, FirstSampleAlwaysPublishes)
+{
+    FilterBank bank;
+    bank.setConfig(Id::BOILER_TEMP, makeConfig(5.0f, false, false, 0.0f, 0));
+    EXPECT_EQ(feed(bank, Id::BOILER_TEMP, 40.0f, 0), FilterDecision::PUBLISH);
+}
+
+TEST(PublishFilterTests, AbsoluteDeadbandSuppressesJitter)
+{
+    FilterBank bank;
+    bank.setConfig(Id::BOILER_TEMP, makeConfig(0.1f, false, false, 0.0f, 0));
+
+    feed(bank, Id::BOILER_TEMP, 45.0f, 0);
+    // f8.8 last-bit jitter
+    EXPECT_EQ(feed(bank, Id::BOILER_TEMP, 45.0f + 1.0f / 256, 1000), FilterDecision::HOLD);
+    EXPECT_EQ(feed(bank, Id::BOILER_TEMP, 45.0f - 1.0f / 256, 2000), FilterDecision::HOLD);
+    EXPECT_EQ(feed(bank, Id::BOILER_TEMP, 45.05f, 3000), FilterDecision::HOLD);
+    EXPECT_EQ(feed(bank, Id::BOILER_TEMP, 45.15f, 4000), FilterDecision::PUBLISH);
+}
+
+TEST(PublishFilterTests, DeadbandIsMeasuredFromLastPublished)
+{
+    FilterBank bank;
+    bank.setConfig(Id::DHW_TEMP, makeConfig(0.5f, false, false, 0.0f, 0));
+
+    feed(bank, Id::DHW_TEMP, 50.0f, 0);
+    // Slow drift: each step is small but the total crosses the deadband
+    EXPECT_EQ(feed(bank, Id::DHW_TEMP, 50.2f, 1), FilterDecision::HOLD);
+    EXPECT_EQ(feed(bank, Id::DHW_TEMP, 50.4f, 2), FilterDecision::HOLD);
+    EXPECT_EQ(feed(bank, Id::DHW_TEMP, 50.6f, 3), FilterDecision::PUBLISH);
+    EXPECT_EQ(feed(bank, Id::DHW_TEMP, 50.8f, 4), FilterDecision::HOLD);
+}
+
+TEST(PublishFilterTests, RelativeDeadband)
+{
+    FilterBank bank;
+    bank.setConfig(Id::PRESSURE, makeConfig(0.05f, true, false, 0.0f, 0)); // 5%
+
+    feed(bank, Id::PRESSURE, 2.0f, 0);
+    EXPECT_EQ(feed(bank, Id::PRESSURE, 2.08f, 1), FilterDecision::HOLD);
+    EXPECT_EQ(feed(bank, Id::PRESSURE, 2.11f, 2), FilterDecision::PUBLISH);
+}
+
+TEST(PublishFilterTests, ZeroDeadbandPublishesEverything)
+{
+    FilterBank bank;
+    bank.setConfig(Id::ROOM_SETPOINT, makeConfig(0.0f, false, false, 0.0f, 0));
+
+    feed(bank, Id::ROOM_SETPOINT, 20.0f, 0);
+    EXPECT_EQ(feed(bank, Id::ROOM_SETPOINT, 20.0f, 1), FilterDecision::PUBLISH);
+    EXPECT_EQ(feed(bank, Id::ROOM_SETPOINT, 20.5f, 2), FilterDecision::PUBLISH);
+}
+
+// ============================================================================
+// Median-of-3
+// ============================================================================
+
+TEST(PublishFilterTests, MedianRejectsSingleSampleGlitch)
+{
+    FilterBank bank;
+    bank.setConfig(Id::RETURN_TEMP, makeConfig(0.1f, false, true, 0.0f, 0));
+
+    feed(bank, Id::RETURN_TEMP, 35.0f, 0);
+    feed(bank, Id::RETURN_TEMP, 35.0f, 1);
+    feed(bank, Id::RETURN_TEMP, 35.0f, 2);
+
+    float out = 0.0f;
+    EXPECT_EQ(feed(bank, Id::RETURN_TEMP, 127.0f, 3, &out), FilterDecision::HOLD); // Spike
+    EXPECT_FLOAT_EQ(out, 35.0f);
+    EXPECT_EQ(feed(bank, Id::RETURN_TEMP, 35.0f, 4, &out), FilterDecision::HOLD);
+    EXPECT_FLOAT_EQ(out, 35.0f);
+}
+
+TEST(PublishFilterTests, MedianFollowsRealStep)
+{
+    FilterBank bank;
+    bank.setConfig(Id::RETURN_TEMP, makeConfig(0.1f, false, true, 0.0f, 0));
+
+    for (uint32_t t = 0; t < 3; t++)
+        feed(bank, Id::RETURN_TEMP, 35.0f, t);
+
+    EXPECT_EQ(feed(bank, Id::RETURN_TEMP, 40.0f, 3), FilterDecision::HOLD);
+    float out = 0.0f;
+    EXPECT_EQ(feed(bank, Id::RETURN_TEMP, 40.0f, 4, &out), FilterDecision::PUBLISH);
+    EXPECT_FLOAT_EQ(out, 40.0f);
+}
+
+// ============================================================================
+// EWMA
+// ============================================================================
+
+TEST(PublishFilterTests, EwmaSmoothsTowardsInput)
+{
+    FilterBank bank;
+    bank.setConfig(Id::OUTSIDE_TEMP, makeConfig(0.0f, false, false, 0.5f, 0));
+
+    float out = 0.0f;
+    feed(bank, Id::OUTSIDE_TEMP, 10.0f, 0, &out);
+    EXPECT_FLOAT_EQ(out, 10.0f); // Seeded with the first sample
+    feed(bank, Id::OUTSIDE_TEMP, 20.0f, 1, &out);
+    EXPECT_FLOAT_EQ(out, 15.0f);
+    feed(bank, Id::OUTSIDE_TEMP, 20.0f, 2, &out);
+    EXPECT_FLOAT_EQ(out, 17.5f);
+}
+
+TEST(PublishFilterTests, SetConfigResetsSmoothing)
+{
+    FilterBank bank;
+    bank.setConfig(Id::OUTSIDE_TEMP, makeConfig(0.0f, false, false, 0.1f, 0));
+
+    float out = 0.0f;
+    feed(bank, Id::OUTSIDE_TEMP, 10.0f, 0);
+    bank.setConfig(Id::OUTSIDE_TEMP, makeConfig(0.0f, false, false, 0.1f, 0));
+    feed(bank, Id::OUTSIDE_TEMP, 20.0f, 1, &out);
+    EXPECT_FLOAT_EQ(out, 20.0f);
+}
+
+// ============================================================================
+// Max silence
+// ============================================================================
+
+TEST(PublishFilterTests, MaxSilenceForcesRefresh)
+{
+    FilterBank bank;
+    bank.setConfig(Id::ROOM_TEMP, makeConfig(1.0f, false, false, 0.0f, 60000));
+
+    feed(bank, Id::ROOM_TEMP, 21.0f, 0);
+    EXPECT_EQ(feed(bank, Id::ROOM_TEMP, 21.1f, 30000), FilterDecision::HOLD);
+    EXPECT_EQ(feed(bank, Id::ROOM_TEMP, 21.1f, 60000), FilterDecision::REFRESH);
+    // Refresh restarts the silence timer
+    EXPECT_EQ(feed(bank, Id::ROOM_TEMP, 21.1f, 90000), FilterDecision::HOLD);
+    EXPECT_EQ(feed(bank, Id::ROOM_TEMP, 21.1f, 120000), FilterDecision::REFRESH);
+}
+
+TEST(PublishFilterTests, MaxSilenceHandlesTimerWrap)
+{
+    FilterBank bank;
+    bank.setConfig(Id::ROOM_TEMP, makeConfig(1.0f, false, false, 0.0f, 60000));
+
+    uint32_t start = 0xFFFFFFFFu - 10000;
+    feed(bank, Id::ROOM_TEMP, 21.0f, start);
+    EXPECT_EQ(feed(bank, Id::ROOM_TEMP, 21.0f, start + 30000), FilterDecision::HOLD);
+    EXPECT_EQ(feed(bank, Id::ROOM_TEMP, 21.0f, start + 60000), FilterDecision::REFRESH);
+}
+
+TEST(PublishFilterTests, ForgetPublishedRepublishesNextSample)
+{
+    FilterBank bank;
+    bank.setConfig(Id::BOILER_TEMP, makeConfig(1.0f, false, false, 0.0f, 0));
+
+    feed(bank, Id::BOILER_TEMP, 45.0f, 0);
+    EXPECT_EQ(feed(bank, Id::BOILER_TEMP, 45.0f, 1), FilterDecision::HOLD);
+    bank.forgetPublished();
+    EXPECT_EQ(feed(bank, Id::BOILER_TEMP, 45.0f, 2), FilterDecision::PUBLISH);
+}
+
+TEST(PublishFilterTests, ForgetOneEntityKeepsTheOthers)
+{
+    FilterBank bank;
+    bank.setConfig(Id::BOILER_TEMP, makeConfig(1.0f, false, false, 0.0f, 0));
+    bank.setConfig(Id::RETURN_TEMP, makeConfig(1.0f, false, false, 0.0f, 0));
+
+    feed(bank, Id::BOILER_TEMP, 45.0f, 0);
+    feed(bank, Id::RETURN_TEMP, 35.0f, 0);
+    bank.forgetPublished(Id::BOILER_TEMP); // Its publish failed
+    EXPECT_EQ(feed(bank, Id::BOILER_TEMP, 45.0f, 1), FilterDecision::PUBLISH);
+    EXPECT_EQ(feed(bank, Id::RETURN_TEMP, 35.0f, 1), FilterDecision::HOLD);
+}
+
+// ============================================================================
+// Defaults
+// ============================================================================
+
+TEST(PublishFilterTests, DefaultsFilterTemperaturesButNotSetpoints)
+{
+    FilterConfig temp = defaultFilterConfig(Id::BOILER_TEMP);
+    EXPECT_GT(temp.deadband, 0.0f);
+    EXPECT_GT(temp.max_silence_ms, 0u);
+
+    FilterConfig setpoint = defaultFilterConfig(Id::CONTROL_SETPOINT);
+    EXPECT_EQ(setpoint.deadband, 0.0f);
+    EXPECT_FALSE(setpoint.median3);
+    EXPECT_EQ(setpoint.ewma_alpha, 0.0f);
+}
+
+TEST(PublishFilterTests, DefaultDeadbandAbsorbsF88Jitter)
+{
+    FilterBank bank;
+    feed(bank, Id::OUTSIDE_TEMP, 8.0f, 0);
+    for (int i = 1; i < 50; i++)
+    {
+        float jitter = (i & 1) ? 1.0f / 256 : -1.0f / 256;
+        EXPECT_EQ(feed(bank, Id::OUTSIDE_TEMP, 8.0f + jitter, i * 1000), FilterDecision::HOLD);
+    }
+}
+
+// ============================================================================
+// Command parsing
+// ============================================================================
+
+TEST(PublishFilterTests, ParseFullCommand)
+{
+    FilterBank bank;
+    Id id;
+    FilterConfig cfg;
+    ASSERT_TRUE(parseFilterCommand("boiler_temp deadband=0.25 median=0 ewma=0.3 max_silence=120", bank, &id, &cfg));
+    EXPECT_EQ(id, Id::BOILER_TEMP);
+    EXPECT_FLOAT_EQ(cfg.deadband, 0.25f);
+    EXPECT_FALSE(cfg.relative);
+    EXPECT_FALSE(cfg.median3);
+    EXPECT_FLOAT_EQ(cfg.ewma_alpha, 0.3f);
+    EXPECT_EQ(cfg.max_silence_ms, 120000u);
+}
+
+TEST(PublishFilterTests, ParseKeepsUnspecifiedKeys)
+{
+    FilterBank bank;
+    bank.setConfig(Id::PRESSURE, makeConfig(0.02f, false, true, 0.0f, 600000));
+
+    Id id;
+    FilterConfig cfg;
+    ASSERT_TRUE(parseFilterCommand("pressure deadband=2%", bank, &id, &cfg));
+    EXPECT_FLOAT_EQ(cfg.deadband, 0.02f);
+    EXPECT_TRUE(cfg.relative);
+    EXPECT_TRUE(cfg.median3);
+    EXPECT_EQ(cfg.max_silence_ms, 600000u);
+}
+
+TEST(PublishFilterTests, ParseDefaultRestoresBuiltIns)
+{
+    FilterBank bank;
+    bank.setConfig(Id::ROOM_TEMP, makeConfig(5.0f, false, true, 0.9f, 0));
+
+    Id id;
+    FilterConfig cfg;
+    ASSERT_TRUE(parseFilterCommand("room_temp default", bank, &id, &cfg));
+    FilterConfig def = defaultFilterConfig(Id::ROOM_TEMP);
+    EXPECT_FLOAT_EQ(cfg.deadband, def.deadband);
+    EXPECT_EQ(cfg.median3, def.median3);
+    EXPECT_EQ(cfg.max_silence_ms, def.max_silence_ms);
+}
+
+TEST(PublishFilterTests, ParseRejectsBadInput)
+{
+    FilterBank bank;
+    Id id;
+    FilterConfig cfg;
+    EXPECT_FALSE(parseFilterCommand("", bank, &id, &cfg));
+    EXPECT_FALSE(parseFilterCommand("no_such_entity deadband=1", bank, &id, &cfg));
+    EXPECT_FALSE(parseFilterCommand("flame deadband=1", bank, &id, &cfg)); // Not numeric
+    EXPECT_FALSE(parseFilterCommand("boiler_temp deadband=abc", bank, &id, &cfg));
+    EXPECT_FALSE(parseFilterCommand("boiler_temp deadband=-1", bank, &id, &cfg));
+    EXPECT_FALSE(parseFilterCommand("boiler_temp ewma=1.5", bank, &id, &cfg));
+    EXPECT_FALSE(parseFilterCommand("boiler_temp median=maybe", bank, &id, &cfg));
+    EXPECT_FALSE(parseFilterCommand("boiler_temp bogus=1", bank, &id, &cfg));
+    EXPECT_FALSE(parseFilterCommand("boiler_temp deadband", bank, &id, &cfg));
+}
+
+TEST(PublishFilterTests, FormatRoundTrips)
+{
+    FilterBank bank;
+    FilterConfig in = makeConfig(0.03f, true, true, 0.25f, 300000);
+
+    char buf[128];
+    formatFilterConfig(Id::DHW_FLOW, in, buf, sizeof(buf));
+    EXPECT_STREQ(buf, "dhw_flow deadband=3% median=1 ewma=0.25 max_silence=300");
+
+    Id id;
+    FilterConfig out;
+    ASSERT_TRUE(parseFilterCommand(buf, bank, &id, &out));
+    EXPECT_EQ(id, Id::DHW_FLOW);
+    EXPECT_NEAR(out.deadband, in.deadband, 1e-6f);
+    EXPECT_EQ(out.relative, in.relative);
+    EXPECT_EQ(out.median3, in.median3);
+    EXPECT_FLOAT_EQ(out.ewma_alpha, in.ewma_alpha);
+    EXPECT_EQ(out.max_silence_ms, in.max_silence_ms);
+}
+
+// ============================================================================
+// Saved overrides
+// ============================================================================
+
+TEST(PublishFilterTests, DefaultsSaveAsEmptyText)
+{
+    FilterBank bank;
+    char buf[256];
+    ASSERT_TRUE(formatFilterOverrides(bank, buf, sizeof(buf)));
+    EXPECT_STREQ(buf, "");
+}
+
+TEST(PublishFilterTests, OverridesSurviveARestart)
+{
+    FilterBank before;
+    before.setConfig(Id::BOILER_TEMP, makeConfig(0.5f, false, false, 0.3f, 120000));
+    before.setConfig(Id::PRESSURE, makeConfig(0.02f, true, true, 0.0f, 0));
+
+    char buf[256];
+    ASSERT_TRUE(formatFilterOverrides(before, buf, sizeof(buf)));
+    EXPECT_STREQ(buf, "boiler_temp deadband=0.5 median=0 ewma=0.3 max_silence=120\n"
+                      "pressure deadband=2% median=1 ewma=0 max_silence=0");
+
+    FilterBank after;
+    EXPECT_EQ(applyFilterOverrides(buf, after), 2u);
+    for (Id id : {Id::BOILER_TEMP, Id::PRESSURE, Id::ROOM_TEMP})
+    {
+        EXPECT_NEAR(after.config(id).deadband, before.config(id).deadband, 1e-6f);
+        EXPECT_EQ(after.config(id).relative, before.config(id).relative);
+        EXPECT_EQ(after.config(id).median3, before.config(id).median3);
+        EXPECT_FLOAT_EQ(after.config(id).ewma_alpha, before.config(id).ewma_alpha);
+        EXPECT_EQ(after.config(id).max_silence_ms, before.config(id).max_silence_ms);
+    }
+}
+
+TEST(PublishFilterTests, OverridesThatDoNotFitAreReported)
+{
+    FilterBank bank;
+    bank.setConfig(Id::BOILER_TEMP, makeConfig(0.5f, false, false, 0.3f, 120000));
+    bank.setConfig(Id::PRESSURE, makeConfig(0.02f, true, true, 0.0f, 0));
+
+    char buf[70]; // Room for the first line only
+    EXPECT_FALSE(formatFilterOverrides(bank, buf, sizeof(buf)));
+}
+
+TEST(PublishFilterTests, RestoreSkipsLinesThatNoLongerParse)
+{
+    FilterBank bank;
+    EXPECT_EQ(applyFilterOverrides("removed_sensor deadband=1\n"
+                                   "flame deadband=1\n"
+                                   "\n"
+                                   "room_temp deadband=0.4",
+                                   bank),
+              1u);
+    EXPECT_FLOAT_EQ(bank.config(Id::ROOM_TEMP).deadband, 0.4f);
+}
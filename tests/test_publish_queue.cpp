@@ -0,0 +1,474 @@
+/**
+ * Unit tests for the bounded publish queue
+ *
+ * The queue is drained into the real StateCache, whose sink is a fake
+ * broker: it takes flow-control credits like mqtt_publish_wrapper and only
+ * returns them as a simulated link drains a few bytes per tick. Throttling
+ * the link shows the priority policy under back-pressure.
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include "mqtt_flow.hpp"
+#include "opentherm_ha.hpp"
+#include "publish_cache.hpp"
+#include "publish_queue.hpp"
+#include "topic_arena.hpp"
+
+using OpenTherm::Common::PublishCredits;
+using OpenTherm::Common::publishWireSize;
+using OpenTherm::Entities::Id;
+using OpenTherm::Publish::Priority;
+using OpenTherm::Publish::PublishQueue;
+using OpenTherm::Publish::QueuedValue;
+using OpenTherm::Publish::StateCache;
+
+// ============================================================================
+// Fake slow broker
+// ============================================================================
+
+struct FakeBroker
+{
+    PublishCredits credits{8, 2048};
+    uint32_t bytes_per_tick = 0; // 0 = stalled
+    uint32_t head_sent = 0;
+    std::deque<uint32_t> link;
+    std::vector<std::pair<std::string, std::string>> received; // Delivered to the broker, in order
+    std::deque<std::pair<std::string, std::string>> in_flight;
+
+    void tick()
+    {
+        uint32_t budget = bytes_per_tick;
+        while (budget > 0 && !link.empty())
+        {
+            uint32_t left = link.front() - head_sent;
+            uint32_t n = left < budget ? left : budget;
+            head_sent += n;
+            budget -= n;
+            if (head_sent == link.front())
+            {
+                credits.release(link.front());
+                received.push_back(in_flight.front());
+                in_flight.pop_front();
+                link.pop_front();
+                head_sent = 0;
+            }
+        }
+    }
+};
+
+static FakeBroker *g_broker = nullptr;
+static StateCache *g_cache = nullptr;
+
+static const uint32_t MAX_STATE_MESSAGE = publishWireSize(StateCache::TOPIC_LEN, StateCache::TEXT_LEN, 0);
+
+static bool brokerSink(const char *topic, const char *payload, bool)
+{
+    uint32_t size = publishWireSize(strlen(topic), strlen(payload), 0);
+    if (!g_broker->credits.tryAcquire(size))
+        return false;
+    g_broker->link.push_back(size);
+    g_broker->in_flight.push_back({topic, payload});
+    return true;
+}
+
+// Mirrors Publish::publishQueued in the firmware
+static bool publishQueued(Id id, const QueuedValue &value)
+{
+    if (!g_broker->credits.available(MAX_STATE_MESSAGE))
+        return false;
+    switch (value.kind)
+    {
+    case OpenTherm::Entities::ValueKind::BINARY:
+        g_cache->publishBinary(id, value.binary, value.retain);
+        break;
+    case OpenTherm::Entities::ValueKind::INT:
+        g_cache->publishInt(id, value.integer, value.retain);
+        break;
+    case OpenTherm::Entities::ValueKind::FLOAT:
+        g_cache->publishFloat(id, value.real, value.precision, value.retain);
+        break;
+    case OpenTherm::Entities::ValueKind::TEXT:
+        g_cache->publishText(id, value.text, value.retain);
+        break;
+    }
+    return true;
+}
+
+// Mirrors the firmware's credit headroom probe
+static uint32_t brokerHeadroom()
+{
+    return g_broker->credits.headroomPercent();
+}
+
+class PublishQueueTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        g_broker = &broker;
+        g_cache = &cache;
+        OpenTherm::HomeAssistant::Config cfg = {};
+        cfg.device_id = "gw";
+        cfg.mqtt_prefix = "homeassistant";
+        cfg.topic_base = "opentherm";
+        cfg.state_topic_base = "state";
+        cfg.command_topic_base = "cmd";
+        ASSERT_TRUE(topics.build(cfg));
+        cache.setTopics(&topics);
+    }
+
+    // Let the broker take everything in flight
+    void settle()
+    {
+        broker.bytes_per_tick = 100000;
+        while (queue.depth() > 0 || !broker.link.empty())
+        {
+            queue.drain(&publishQueued);
+            broker.tick();
+        }
+    }
+
+    std::vector<std::string> payloadsFor(const char *suffix) const
+    {
+        std::vector<std::string> out;
+        std::string topic = std::string("opentherm/gw/state/") + suffix;
+        for (const auto &m : broker.received)
+            if (m.first == topic)
+                out.push_back(m.second);
+        return out;
+    }
+
+    FakeBroker broker;
+    OpenTherm::MQTTTopics::TopicArena topics;
+    StateCache cache{&brokerSink};
+    PublishQueue queue;
+};
+
+// ============================================================================
+// Queueing
+// ============================================================================
+
+TEST_F(PublishQueueTest, LatestValueWins)
+{
+    queue.pushFloat(Id::BOILER_TEMP, 40.0f);
+    queue.pushFloat(Id::BOILER_TEMP, 41.0f);
+    queue.pushFloat(Id::BOILER_TEMP, 42.0f);
+    EXPECT_EQ(queue.depth(), 1u);
+    EXPECT_EQ(queue.coalesced(), 2u);
+
+    settle();
+    EXPECT_EQ(payloadsFor("boiler_temp"), std::vector<std::string>{"42.00"});
+}
+
+TEST_F(PublishQueueTest, ClassOrderThenFifoAndCoalescingKeepsPosition)
+{
+    queue.pushInt(Id::BURNER_STARTS, 1);
+    queue.pushInt(Id::CH_PUMP_STARTS, 1);
+    queue.pushFloat(Id::DHW_TEMP, 50.0f);
+    queue.pushBinary(Id::FLAME, true);
+    queue.pushInt(Id::BURNER_STARTS, 2); // Replaces in place, stays ahead of CH_PUMP_STARTS
+    queue.pushFloat(Id::BOILER_TEMP, 60.0f);
+
+    settle();
+    ASSERT_EQ(broker.received.size(), 5u);
+    EXPECT_EQ(broker.received[0].first, "opentherm/gw/state/flame");
+    EXPECT_EQ(broker.received[1].first, "opentherm/gw/state/dhw_temp");
+    EXPECT_EQ(broker.received[2].first, "opentherm/gw/state/boiler_temp");
+    EXPECT_EQ(broker.received[3].first, "opentherm/gw/state/burner_starts");
+    EXPECT_EQ(broker.received[3].second, "2");
+    EXPECT_EQ(broker.received[4].first, "opentherm/gw/state/ch_pump_starts");
+}
+
+TEST_F(PublishQueueTest, DropsWhenFull)
+{
+    PublishQueue small(2);
+    EXPECT_TRUE(small.pushInt(Id::BURNER_STARTS, 1));
+    EXPECT_TRUE(small.pushInt(Id::CH_PUMP_STARTS, 1));
+    EXPECT_FALSE(small.pushInt(Id::DHW_PUMP_STARTS, 1));
+    EXPECT_TRUE(small.pushInt(Id::BURNER_STARTS, 2)); // Already queued - coalesces
+    EXPECT_EQ(small.depth(), 2u);
+    EXPECT_EQ(small.dropped(), 1u);
+    EXPECT_EQ(small.coalesced(), 1u);
+}
+
+TEST_F(PublishQueueTest, TextIsCopiedAtPush)
+{
+    char buf[32];
+    strcpy(buf, "12:34");
+    ASSERT_TRUE(queue.pushText(Id::TIME_OF_DAY, buf));
+    strcpy(buf, "garbage");
+
+    settle();
+    EXPECT_EQ(payloadsFor("time_of_day"), std::vector<std::string>{"12:34"});
+}
+
+TEST_F(PublishQueueTest, RejectsTextItCannotHold)
+{
+    std::string long_text(PublishQueue::TEXT_LEN, 'x');
+    EXPECT_FALSE(PublishQueue::canQueueText(Id::DEVICE_NAME, long_text.c_str()));
+    EXPECT_FALSE(PublishQueue::canQueueText(Id::BOILER_TEMP, "42"));
+    EXPECT_FALSE(PublishQueue::canQueueText(Id::DEVICE_NAME, nullptr));
+    EXPECT_TRUE(PublishQueue::canQueueText(Id::DEVICE_NAME, "boiler"));
+
+    EXPECT_FALSE(queue.pushText(Id::DEVICE_NAME, long_text.c_str()));
+    EXPECT_EQ(queue.depth(), 0u);
+    EXPECT_EQ(queue.dropped(), 0u);
+}
+
+TEST_F(PublishQueueTest, HighWaterResetsToCurrentDepth)
+{
+    queue.pushInt(Id::BURNER_STARTS, 1);
+    queue.pushInt(Id::CH_PUMP_STARTS, 1);
+    queue.pushInt(Id::DHW_PUMP_STARTS, 1);
+    queue.drain(&publishQueued, nullptr, 2);
+    EXPECT_EQ(queue.depth(), 1u);
+    EXPECT_EQ(queue.takeHighWater(), 3u);
+    EXPECT_EQ(queue.takeHighWater(), 1u);
+}
+
+// ============================================================================
+// Slow broker
+// ============================================================================
+
+TEST_F(PublishQueueTest, StalledBrokerNeverBlocksProducer)
+{
+    broker.bytes_per_tick = 0;
+
+    // A minute of 100 ms main-loop ticks against a broker that accepts nothing
+    for (int tick = 0; tick < 600; tick++)
+    {
+        EXPECT_TRUE(queue.pushFloat(Id::BOILER_TEMP, 40.0f + tick * 0.1f));
+        EXPECT_TRUE(queue.pushBinary(Id::FLAME, tick % 2 == 0));
+        EXPECT_TRUE(queue.pushInt(Id::UPTIME, tick));
+        queue.drain(&publishQueued);
+        broker.tick();
+    }
+
+    // Only as much went out as credits allow; the rest is collapsed, not piled up
+    EXPECT_LE(broker.link.size(), 8u);
+    EXPECT_LE(queue.depth(), 3u);
+    EXPECT_EQ(queue.dropped(), 0u);
+    EXPECT_GT(queue.coalesced(), 1700u);
+
+    settle();
+    EXPECT_EQ(payloadsFor("boiler_temp").back(), "99.90");
+    EXPECT_EQ(payloadsFor("uptime").back(), "599");
+    EXPECT_EQ(payloadsFor("flame").back(), "OFF");
+}
+
+TEST_F(PublishQueueTest, SlowBrokerConvergesToLatestValues)
+{
+    broker.bytes_per_tick = 40; // A couple of state messages per second
+
+    const Id ids[] = {Id::BOILER_TEMP, Id::DHW_TEMP, Id::RETURN_TEMP, Id::MODULATION,
+                      Id::PRESSURE, Id::CONTROL_SETPOINT, Id::OUTSIDE_TEMP, Id::ROOM_TEMP};
+    std::map<Id, std::string> last_pushed;
+    size_t max_depth = 0;
+
+    for (int tick = 0; tick < 3000; tick++)
+    {
+        for (size_t k = 0; k < sizeof(ids) / sizeof(ids[0]); k++)
+        {
+            float v = 20.0f + (float)((tick + (int)k * 7) % 50);
+            ASSERT_TRUE(queue.pushFloat(ids[k], v));
+            char buf[16];
+            snprintf(buf, sizeof(buf), "%.2f", v);
+            last_pushed[ids[k]] = buf;
+        }
+        queue.drain(&publishQueued);
+        broker.tick();
+        if (queue.depth() > max_depth)
+            max_depth = queue.depth();
+    }
+
+    // Bounded by the number of distinct entities, whatever the backlog
+    EXPECT_LE(max_depth, sizeof(ids) / sizeof(ids[0]));
+    EXPECT_EQ(queue.dropped(), 0u);
+
+    settle();
+    for (const auto &kv : last_pushed)
+    {
+        auto sent = payloadsFor(OpenTherm::Entities::descriptor(kv.first).suffix);
+        ASSERT_FALSE(sent.empty());
+        EXPECT_EQ(sent.back(), kv.second) << OpenTherm::Entities::descriptor(kv.first).suffix;
+    }
+}
+
+TEST_F(PublishQueueTest, BackPressureKeepsHeadForNextDrain)
+{
+    broker.bytes_per_tick = 0;
+    // All one class, so the order below is plain FIFO
+    const Id ids[] = {Id::BOILER_TEMP, Id::DHW_TEMP, Id::RETURN_TEMP, Id::OUTSIDE_TEMP,
+                      Id::ROOM_TEMP, Id::EXHAUST_TEMP, Id::MODULATION, Id::PRESSURE,
+                      Id::DHW_FLOW, Id::MAX_MODULATION};
+    const size_t n = sizeof(ids) / sizeof(ids[0]);
+    for (size_t k = 0; k < n; k++)
+        queue.pushFloat(ids[k], 10.0f + k);
+
+    // Eight request credits: the drain stops there and keeps the rest, in order
+    EXPECT_EQ(queue.drain(&publishQueued), 8u);
+    EXPECT_EQ(queue.depth(), n - 8);
+    EXPECT_TRUE(queue.queued(ids[8]));
+    EXPECT_EQ(queue.drain(&publishQueued), 0u);
+
+    settle();
+    ASSERT_EQ(broker.received.size(), n);
+    for (size_t k = 0; k < n; k++)
+        EXPECT_EQ(broker.received[k].first,
+                  std::string("opentherm/gw/state/") + OpenTherm::Entities::descriptor(ids[k]).suffix);
+}
+
+// ============================================================================
+// Priority classes
+// ============================================================================
+
+TEST_F(PublishQueueTest, EntitiesAreClassified)
+{
+    EXPECT_EQ(OpenTherm::Publish::priorityOf(Id::FLAME), Priority::CONTROL);
+    EXPECT_EQ(OpenTherm::Publish::priorityOf(Id::CONTROL_SETPOINT), Priority::CONTROL);
+    EXPECT_EQ(OpenTherm::Publish::priorityOf(Id::BOILER_TEMP), Priority::TEMPERATURE);
+    EXPECT_EQ(OpenTherm::Publish::priorityOf(Id::BURNER_STARTS), Priority::COUNTER);
+    EXPECT_EQ(OpenTherm::Publish::priorityOf(Id::WIFI_RSSI), Priority::DIAGNOSTIC);
+    EXPECT_EQ(OpenTherm::Publish::priorityOf(Id::MQTT_PRIORITY_STATS), Priority::DIAGNOSTIC);
+
+    // Reserves grow with the class so a deferred class never blocks a higher one
+    for (size_t c = 1; c < OpenTherm::Publish::PRIORITY_COUNT; c++)
+        EXPECT_GT(OpenTherm::Publish::DRAIN_RESERVE_PERCENT[c], OpenTherm::Publish::DRAIN_RESERVE_PERCENT[c - 1]);
+}
+
+TEST_F(PublishQueueTest, FullQueueShedsLowerClassFirst)
+{
+    PublishQueue small(2);
+    EXPECT_TRUE(small.pushInt(Id::UPTIME, 1));
+    EXPECT_TRUE(small.pushInt(Id::BURNER_STARTS, 1));
+    EXPECT_TRUE(small.pushBinary(Id::FLAME, true));          // Evicts the diagnostic
+    EXPECT_TRUE(small.pushFloat(Id::BOILER_TEMP, 50.0f));    // Evicts the counter
+    EXPECT_FALSE(small.pushFloat(Id::DHW_TEMP, 45.0f));      // Nothing lower left: shed itself
+    EXPECT_FALSE(small.pushInt(Id::FREE_HEAP, 1000));
+
+    EXPECT_TRUE(small.queued(Id::FLAME));
+    EXPECT_TRUE(small.queued(Id::BOILER_TEMP));
+    EXPECT_FALSE(small.queued(Id::UPTIME));
+    EXPECT_EQ(small.stats(Priority::CONTROL).shed, 0u);
+    EXPECT_EQ(small.stats(Priority::TEMPERATURE).shed, 1u);
+    EXPECT_EQ(small.stats(Priority::COUNTER).shed, 1u);
+    EXPECT_EQ(small.stats(Priority::DIAGNOSTIC).shed, 2u);
+    EXPECT_EQ(small.dropped(), 4u);
+}
+
+TEST_F(PublishQueueTest, NoHeadroomDefersLowerClasses)
+{
+    broker.bytes_per_tick = 0;
+    for (int i = 0; i < 3; i++) // Three of eight request credits in use
+        ASSERT_TRUE(brokerSink("opentherm/gw/state/x", "1", false));
+
+    queue.pushInt(Id::UPTIME, 1);
+    queue.pushInt(Id::BURNER_STARTS, 1);
+    queue.pushFloat(Id::BOILER_TEMP, 50.0f);
+    queue.pushBinary(Id::FLAME, true);
+
+    // Each send takes 12% of the headroom: control, temperature and counter
+    // go out (62% -> 25% free) and the diagnostic hits its 50% reserve
+    EXPECT_EQ(queue.drain(&publishQueued, &brokerHeadroom), 3u);
+    EXPECT_TRUE(queue.queued(Id::UPTIME));
+    EXPECT_EQ(queue.stats(Priority::DIAGNOSTIC).deferred, 1u);
+
+    // A deferred record is only counted once while it waits
+    queue.drain(&publishQueued, &brokerHeadroom);
+    EXPECT_EQ(queue.stats(Priority::DIAGNOSTIC).deferred, 1u);
+    EXPECT_EQ(queue.stats(Priority::CONTROL).deferred, 0u);
+
+    char text[PublishQueue::TEXT_LEN];
+    OpenTherm::Publish::formatPriorityStats(queue, text, sizeof(text));
+    EXPECT_STREQ(text, "ctl 0/0 temp 0/0 cnt 0/0 diag 1/0");
+
+    settle();
+    EXPECT_EQ(payloadsFor("uptime"), std::vector<std::string>{"1"});
+}
+
+TEST_F(PublishQueueTest, FormatPriorityStatsTruncates)
+{
+    char text[12];
+    size_t n = OpenTherm::Publish::formatPriorityStats(queue, text, sizeof(text));
+    EXPECT_GT(n, sizeof(text));
+    EXPECT_STREQ(text, "ctl 0/0 tem");
+}
+
+TEST_F(PublishQueueTest, FormatPriorityStatsFitsATextValue)
+{
+    // Cumulative counters never wrap the text past TEXT_LEN
+    OpenTherm::Publish::PriorityStats stats[OpenTherm::Publish::PRIORITY_COUNT];
+    for (auto &s : stats)
+        s = {0, 999999999, 999999999}; // The widest counts
+    char text[PublishQueue::TEXT_LEN];
+    size_t n = OpenTherm::Publish::formatPriorityStats(stats, text, sizeof(text));
+    EXPECT_LT(n, OpenTherm::Publish::PRIORITY_STATS_LEN);
+    EXPECT_STREQ(text, "ctl 999M/999M temp 999M/999M cnt 999M/999M diag 999M/999M");
+    ASSERT_TRUE(queue.pushText(Id::MQTT_PRIORITY_STATS, text));
+
+    for (auto &s : stats)
+        s = {UINT32_MAX, UINT32_MAX, UINT32_MAX};
+    OpenTherm::Publish::formatPriorityStats(stats, text, sizeof(text));
+    EXPECT_STREQ(text, "ctl 4G/4G temp 4G/4G cnt 4G/4G diag 4G/4G");
+
+    stats[0] = {0, 999, 1000};
+    stats[1] = {0, 999999, 1000000};
+    stats[2] = {0, 999999999, 1000000000};
+    stats[3] = {0, 12345, 0};
+    OpenTherm::Publish::formatPriorityStats(stats, text, sizeof(text));
+    EXPECT_STREQ(text, "ctl 999/1k temp 999k/1M cnt 999M/1G diag 12k/0");
+}
+
+// Ticks FLAME changes spent queued while diagnostics and counters flood a
+// throttled link
+static int controlWaitTicks(FakeBroker &broker, PublishQueue &queue, bool with_probe)
+{
+    const Id noise[] = {Id::WIFI_RSSI, Id::FREE_HEAP, Id::UPTIME, Id::MQTT_PUBLISH_RATE,
+                        Id::OT_TOTAL_REQUESTS, Id::OT_FAILED_REQUESTS, Id::BURNER_STARTS, Id::BURNER_HOURS};
+    broker.bytes_per_tick = 30; // Roughly one state message per tick
+    int waited = 0;
+    for (int tick = 0; tick < 2000; tick++)
+    {
+        for (size_t k = 0; k < sizeof(noise) / sizeof(noise[0]); k++)
+            queue.pushInt(noise[k], tick);
+        if (tick % 20 == 0)
+            queue.pushBinary(Id::FLAME, (tick / 20) % 2 == 0);
+
+        queue.drain(&publishQueued, with_probe ? &brokerHeadroom : nullptr);
+        if (queue.queued(Id::FLAME))
+            waited++;
+        broker.tick();
+    }
+    return waited;
+}
+
+TEST_F(PublishQueueTest, ThrottledBrokerNeverHoldsBackControl)
+{
+    int waited = controlWaitTicks(broker, queue, true);
+
+    // Lower classes leave credits free, so control goes out the tick it changes
+    EXPECT_EQ(waited, 0);
+    EXPECT_EQ(queue.stats(Priority::CONTROL).deferred, 0u);
+    EXPECT_EQ(queue.stats(Priority::CONTROL).shed, 0u);
+    EXPECT_GT(queue.stats(Priority::DIAGNOSTIC).deferred, 0u);
+    EXPECT_GT(queue.stats(Priority::DIAGNOSTIC).coalesced, queue.stats(Priority::COUNTER).coalesced);
+    EXPECT_EQ(queue.dropped(), 0u);
+
+    // Once the link recovers the deferred classes catch up with their latest values
+    settle();
+    EXPECT_EQ(payloadsFor("uptime").back(), "1999");
+    EXPECT_EQ(payloadsFor("burner_starts").back(), "1999");
+    EXPECT_EQ(payloadsFor("flame").size(), 100u);
+}
+
+TEST_F(PublishQueueTest, WithoutReserveControlWaitsForCredits)
+{
+    // Same load with the probe off: diagnostics take every credit and control
+    // has to wait for one to come back
+    EXPECT_GT(controlWaitTicks(broker, queue, false), 0);
+}
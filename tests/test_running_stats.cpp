@@ -0,0 +1,257 @@
+/**
+ * Unit tests for the running aggregates and the windowed boiler statistics
+ *
+ * Known sequences go through RunningStats, Ewma and TimeShare and are checked
+ * against the values worked out by hand; BoilerStats is then fed readings the
+ * way HAInterface does and each window's Summary is checked.
+ */
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdint>
+#include "running_stats.hpp"
+#include "boiler_stats.hpp"
+
+using OpenTherm::Entities::Id;
+using OpenTherm::Stats::BoilerStats;
+using OpenTherm::Stats::Ewma;
+using OpenTherm::Stats::RunningStats;
+using OpenTherm::Stats::Summary;
+using OpenTherm::Stats::TimeShare;
+
+// ============================================================================
+// RunningStats
+// ============================================================================
+
+TEST(RunningStatsTest, KnownSequence)
+{
+    RunningStats<float> stats;
+    const float values[] = {2, 4, 4, 4, 5, 5, 7, 9};
+    for (float v : values)
+        stats.add(v);
+
+    EXPECT_EQ(stats.count(), 8u);
+    EXPECT_FLOAT_EQ(stats.min(), 2.0f);
+    EXPECT_FLOAT_EQ(stats.max(), 9.0f);
+    EXPECT_FLOAT_EQ(stats.mean(), 5.0f);
+    EXPECT_FLOAT_EQ(stats.variance(), 4.0f);
+}
+
+TEST(RunningStatsTest, LargeOffsetKeepsPrecision)
+{
+    // A naive sum of squares loses the variance of small changes on a large value
+    RunningStats<float> stats;
+    for (int i = 0; i < 1000; i++)
+        stats.add(10000.0f + (i % 2 == 0 ? -0.5f : 0.5f));
+
+    EXPECT_NEAR(stats.mean(), 10000.0f, 0.01f);
+    EXPECT_NEAR(stats.variance(), 0.25f, 0.01f);
+}
+
+TEST(RunningStatsTest, IntegerSignal)
+{
+    RunningStats<int> stats;
+    stats.add(-3);
+    stats.add(10);
+    stats.add(2);
+
+    EXPECT_EQ(stats.min(), -3);
+    EXPECT_EQ(stats.max(), 10);
+    EXPECT_FLOAT_EQ(stats.mean(), 3.0f);
+}
+
+TEST(RunningStatsTest, ResetStartsOver)
+{
+    RunningStats<float> stats;
+    stats.add(100.0f);
+    stats.reset();
+    EXPECT_EQ(stats.count(), 0u);
+    EXPECT_FLOAT_EQ(stats.variance(), 0.0f);
+
+    stats.add(1.0f);
+    EXPECT_FLOAT_EQ(stats.min(), 1.0f);
+    EXPECT_FLOAT_EQ(stats.max(), 1.0f);
+    EXPECT_FLOAT_EQ(stats.mean(), 1.0f);
+}
+
+// ============================================================================
+// Ewma and TimeShare
+// ============================================================================
+
+TEST(EwmaTest, FirstSampleSeedsThenWeighsEachSample)
+{
+    Ewma<float> ewma(0.5f);
+    EXPECT_FALSE(ewma.primed());
+    ewma.add(10.0f);
+    EXPECT_TRUE(ewma.primed());
+    EXPECT_FLOAT_EQ(ewma.value(), 10.0f);
+    ewma.add(20.0f);
+    EXPECT_FLOAT_EQ(ewma.value(), 15.0f);
+    ewma.add(20.0f);
+    EXPECT_FLOAT_EQ(ewma.value(), 17.5f);
+
+    ewma.reset();
+    ewma.add(4.0f);
+    EXPECT_FLOAT_EQ(ewma.value(), 4.0f);
+}
+
+TEST(TimeShareTest, CountsOnTimeAcrossTakes)
+{
+    TimeShare share;
+    EXPECT_FALSE(share.known());
+    EXPECT_EQ(share.take(1000), 0u);
+
+    share.set(true, 1000);
+    share.set(true, 1500); // Unchanged: still on
+    share.set(false, 3000);
+    share.set(true, 4000);
+    EXPECT_EQ(share.take(5000), 3000u);
+
+    // Still on: the next window counts from the take
+    EXPECT_EQ(share.take(5500), 500u);
+    share.set(false, 5600);
+    EXPECT_EQ(share.take(9000), 100u);
+}
+
+// ============================================================================
+// BoilerStats
+// ============================================================================
+
+TEST(BoilerStatsTest, NoWindowBeforeTheFirstReading)
+{
+    BoilerStats stats;
+    EXPECT_EQ(stats.msUntilDue(123456), UINT32_MAX);
+    stats.add(Id::OUTSIDE_TEMP, 5.0f, 1000); // Untracked, but it still starts the window
+    EXPECT_EQ(stats.msUntilDue(1000), BoilerStats::DEFAULT_WINDOW_S * 1000);
+}
+
+TEST(BoilerStatsTest, WindowSummary)
+{
+    BoilerStats stats;
+    ASSERT_TRUE(stats.setWindow(60));
+
+    // Flame on for 15 of the 60 seconds, CH for 45, DHW never
+    stats.add(Id::CH_MODE, 1.0f, 0);
+    stats.add(Id::DHW_MODE, 0.0f, 0);
+    stats.add(Id::FLAME, 0.0f, 0);
+    stats.add(Id::BOILER_TEMP, 40.0f, 0);
+    stats.add(Id::RETURN_TEMP, 35.0f, 1000);  // delta-T 5
+    stats.add(Id::FLAME, 1.0f, 10000);
+    stats.add(Id::MODULATION, 20.0f, 10000);
+    stats.add(Id::BOILER_TEMP, 50.0f, 20000);
+    stats.add(Id::RETURN_TEMP, 35.0f, 21000); // delta-T 15
+    stats.add(Id::MODULATION, 40.0f, 20000);
+    stats.add(Id::FLAME, 0.0f, 25000);
+    stats.add(Id::CH_MODE, 0.0f, 45000);
+    stats.add(Id::BOILER_TEMP, 45.0f, 50000);
+    stats.add(Id::RETURN_TEMP, 35.0f, 51000); // delta-T 10
+
+    EXPECT_EQ(stats.msUntilDue(59999), 1u);
+    EXPECT_EQ(stats.msUntilDue(60000), 0u);
+    Summary s = stats.close(60000);
+
+    EXPECT_EQ(s.window_ms, 60000u);
+    ASSERT_TRUE(s.has_flow);
+    EXPECT_FLOAT_EQ(s.flow_min, 40.0f);
+    EXPECT_FLOAT_EQ(s.flow_max, 50.0f);
+    EXPECT_FLOAT_EQ(s.flow_mean, 45.0f);
+    ASSERT_TRUE(s.has_delta_t);
+    EXPECT_FLOAT_EQ(s.delta_t_mean, 10.0f);
+    // 5, then 5 + 0.1 * (15 - 5), then 6 + 0.1 * (10 - 6)
+    EXPECT_NEAR(s.delta_t_ewma, 6.4f, 1e-5f);
+    ASSERT_TRUE(s.has_modulation);
+    EXPECT_FLOAT_EQ(s.modulation_mean, 30.0f);
+    ASSERT_TRUE(s.has_flame);
+    EXPECT_FLOAT_EQ(s.flame_duty, 25.0f);
+    ASSERT_TRUE(s.has_modes);
+    EXPECT_EQ(s.ch_s, 45u);
+    EXPECT_EQ(s.dhw_s, 0u);
+}
+
+TEST(BoilerStatsTest, InterleavedReadsGiveOneDeltaTPerPair)
+{
+    BoilerStats stats;
+    ASSERT_TRUE(stats.setWindow(60));
+
+    // Flow and return are read a second apart in every 10 s pass. Pairing each
+    // new reading with the other's latest would count 70 - 40 twice.
+    stats.add(Id::BOILER_TEMP, 50.0f, 0);
+    stats.add(Id::RETURN_TEMP, 40.0f, 1000);  // delta-T 10
+    stats.add(Id::BOILER_TEMP, 70.0f, 10000);
+    stats.add(Id::RETURN_TEMP, 40.0f, 11000); // delta-T 30
+    stats.add(Id::BOILER_TEMP, 60.0f, 20000); // Its return read fails
+
+    Summary s = stats.close(60000);
+    ASSERT_TRUE(s.has_delta_t);
+    EXPECT_FLOAT_EQ(s.delta_t_mean, 20.0f);
+    EXPECT_NEAR(s.delta_t_ewma, 12.0f, 1e-5f); // 10, then 10 + 0.1 * (30 - 10)
+}
+
+TEST(BoilerStatsTest, StaleReadingIsNotPaired)
+{
+    BoilerStats stats;
+    ASSERT_TRUE(stats.setWindow(600));
+
+    // The return read that belonged to the first flow read failed
+    stats.add(Id::BOILER_TEMP, 50.0f, 0);
+    stats.add(Id::RETURN_TEMP, 40.0f, BoilerStats::DELTA_T_MAX_SKEW_MS + 1); // Not paired with 50
+
+    // The return reading then waits for the next flow reading
+    stats.add(Id::BOILER_TEMP, 45.0f, BoilerStats::DELTA_T_MAX_SKEW_MS + 2000);
+    Summary s = stats.close(600000);
+    ASSERT_TRUE(s.has_delta_t);
+    EXPECT_FLOAT_EQ(s.delta_t_mean, 5.0f);
+    EXPECT_FLOAT_EQ(s.delta_t_ewma, 5.0f);
+}
+
+TEST(BoilerStatsTest, StatesAndEwmaCarryIntoTheNextWindow)
+{
+    BoilerStats stats;
+    ASSERT_TRUE(stats.setWindow(60));
+    stats.add(Id::BOILER_TEMP, 60.0f, 0);
+    stats.add(Id::RETURN_TEMP, 40.0f, 0);
+    stats.add(Id::FLAME, 1.0f, 30000);
+    stats.add(Id::DHW_MODE, 1.0f, 30000);
+    stats.close(60000);
+
+    // No readings at all in the second window: the flame and DHW were on
+    // throughout, the EWMA is kept and the per-window aggregates are empty
+    Summary s = stats.close(120000);
+    EXPECT_FALSE(s.has_flow);
+    EXPECT_FALSE(s.has_delta_t);
+    EXPECT_FALSE(s.has_modulation);
+    EXPECT_FLOAT_EQ(s.delta_t_ewma, 20.0f);
+    EXPECT_FLOAT_EQ(s.flame_duty, 100.0f);
+    EXPECT_EQ(s.dhw_s, 60u);
+    EXPECT_EQ(s.ch_s, 0u);
+}
+
+TEST(BoilerStatsTest, WindowChangeTakesEffectAtTheNextWindow)
+{
+    BoilerStats stats;
+    EXPECT_FALSE(stats.setWindow(59));
+    EXPECT_FALSE(stats.setWindow(86401));
+
+    ASSERT_TRUE(stats.setWindow(60));
+    stats.add(Id::MODULATION, 10.0f, 0);
+    ASSERT_TRUE(stats.setWindow(120));
+
+    // The running window keeps its length
+    EXPECT_EQ(stats.window(), 60u);
+    EXPECT_EQ(stats.msUntilDue(30000), 30000u);
+    stats.close(60000);
+    EXPECT_EQ(stats.window(), 120u);
+    EXPECT_EQ(stats.msUntilDue(60000), 120000u);
+}
+
+TEST(BoilerStatsTest, NonFiniteReadingsAreIgnored)
+{
+    BoilerStats stats;
+    stats.add(Id::BOILER_TEMP, std::nanf(""), 0);
+    EXPECT_EQ(stats.msUntilDue(0), UINT32_MAX);
+
+    stats.add(Id::BOILER_TEMP, 42.0f, 0);
+    stats.add(Id::BOILER_TEMP, INFINITY, 1000);
+    Summary s = stats.close(stats.window() * 1000);
+    EXPECT_FLOAT_EQ(s.flow_max, 42.0f);
+}
@@ -0,0 +1,305 @@
+/**
+ * Unit tests for the aggregated JSON state document
+ *
+ * The key check parses the rendered document with a small JSON reader and
+ * resolves every entity's discovery value_template against it, so a key that
+ * Home Assistant would look up but the document does not contain fails here.
+ */
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <string>
+#include "mqtt_flow.hpp"
+#include "net_queue.hpp"
+#include "state_document.hpp"
+
+using OpenTherm::Entities::Id;
+using OpenTherm::Entities::ValueKind;
+using OpenTherm::Publish::StateDocument;
+using OpenTherm::Publish::formatValueTemplate;
+
+// ============================================================================
+// Minimal JSON object reader: {"key":"string"|number|null,...}
+// Values are returned as their decoded text ("null" for null).
+// ============================================================================
+
+static bool parseString(const char *&p, std::string *out)
+{
+    if (*p != '"')
+        return false;
+    p++;
+    out->clear();
+    while (*p && *p != '"')
+    {
+        if (*p == '\\')
+        {
+            p++;
+            if (*p == 'u')
+            {
+                char hex[5] = {p[1], p[2], p[3], p[4], 0};
+                out->push_back((char)strtol(hex, nullptr, 16));
+                p += 5;
+                continue;
+            }
+            if (*p != '"' && *p != '\\')
+                return false;
+        }
+        out->push_back(*p++);
+    }
+    if (*p != '"')
+        return false;
+    p++;
+    return true;
+}
+
+static bool parseObject(const char *json, std::map<std::string, std::string> *out)
+{
+    const char *p = json;
+    if (*p++ != '{')
+        return false;
+    while (*p && *p != '}')
+    {
+        std::string key, value;
+        if (!parseString(p, &key) || *p++ != ':')
+            return false;
+        if (*p == '"')
+        {
+            if (!parseString(p, &value))
+                return false;
+        }
+        else
+        {
+            const char *start = p;
+            while (*p && *p != ',' && *p != '}')
+                p++;
+            value.assign(start, p);
+        }
+        if (out->count(key))
+            return false; // Duplicate key
+        (*out)[key] = value;
+        if (*p == ',')
+            p++;
+    }
+    return *p == '}' && p[1] == '\0';
+}
+
+// Key a Home Assistant "{{ value_json.<key> }}" template reads
+static std::string templateKey(const char *tmpl)
+{
+    const char *prefix = "{{ value_json.";
+    const char *suffix = " }}";
+    std::string t(tmpl);
+    if (t.compare(0, strlen(prefix), prefix) != 0 || t.size() < strlen(prefix) + strlen(suffix) ||
+        t.compare(t.size() - strlen(suffix), strlen(suffix), suffix) != 0)
+        return "";
+    return t.substr(strlen(prefix), t.size() - strlen(prefix) - strlen(suffix));
+}
+
+// The longest document that fits all three limits on its way out: the
+// render buffer, a network-queue record and lwIP's output ring, each with
+// the longest document topic
+static size_t largestSendableDocument()
+{
+    using OpenTherm::Common::NetRequestQueue;
+    const size_t topic = StateDocument::TOPIC_LEN;
+    size_t len = StateDocument::DOCUMENT_LEN - 1;
+    while (len > 0 && (NetRequestQueue::recordSize(topic, len) > NetRequestQueue::MAX_RECORD ||
+                       OpenTherm::Common::publishWireSize(topic, len, 0) > OpenTherm::Common::DEFAULT_BYTE_CREDITS))
+        len--;
+    return len;
+}
+
+// Fill every entity with a representative value; returns the text each should render as
+static std::map<Id, std::string> fillAll(StateDocument &doc)
+{
+    std::map<Id, std::string> expected;
+    for (size_t i = 0; i < OpenTherm::Entities::COUNT; i++)
+    {
+        Id id = static_cast<Id>(i);
+        switch (OpenTherm::Entities::descriptor(id).kind)
+        {
+        case ValueKind::BINARY:
+            doc.setBinary(id, i % 2 == 0);
+            expected[id] = i % 2 == 0 ? "ON" : "OFF";
+            break;
+        case ValueKind::INT:
+            doc.setInt(id, (int32_t)i * 100 - 7);
+            expected[id] = std::to_string((int)i * 100 - 7);
+            break;
+        case ValueKind::FLOAT:
+        {
+            doc.setFloat(id, 20.0f + (float)i * 0.25f);
+            char buf[16];
+            snprintf(buf, sizeof(buf), "%.2f", 20.0f + (float)i * 0.25f);
+            expected[id] = buf;
+            break;
+        }
+        case ValueKind::TEXT:
+        {
+            std::string text = std::string(OpenTherm::Entities::descriptor(id).suffix) + " \"v\\1\"";
+            EXPECT_TRUE(doc.setText(id, text.c_str()));
+            expected[id] = text;
+            break;
+        }
+        }
+    }
+    return expected;
+}
+
+// ============================================================================
+// Discovery templates against the document
+// ============================================================================
+
+TEST(StateDocumentTests, EveryTemplateResolvesInDocument)
+{
+    StateDocument doc;
+    std::map<Id, std::string> expected = fillAll(doc);
+
+    static char payload[StateDocument::DOCUMENT_LEN];
+    size_t len = doc.build(payload, sizeof(payload));
+    ASSERT_GT(len, 0u);
+    EXPECT_EQ(len, strlen(payload));
+
+    std::map<std::string, std::string> parsed;
+    ASSERT_TRUE(parseObject(payload, &parsed)) << payload;
+    EXPECT_EQ(parsed.size(), OpenTherm::Entities::COUNT);
+
+    for (const auto &kv : expected)
+    {
+        const char *suffix = OpenTherm::Entities::descriptor(kv.first).suffix;
+
+        // Discovery finds the entity by its object_id and asks for its template
+        Id found;
+        ASSERT_TRUE(OpenTherm::Entities::findBySuffix(suffix, &found));
+        ASSERT_EQ(found, kv.first);
+
+        char tmpl[64];
+        ASSERT_LT(formatValueTemplate(kv.first, tmpl, sizeof(tmpl)), sizeof(tmpl));
+        std::string key = templateKey(tmpl);
+        ASSERT_EQ(key, suffix) << tmpl;
+        ASSERT_TRUE(parsed.count(key)) << "document has no key for " << tmpl;
+        EXPECT_EQ(parsed[key], kv.second) << key;
+    }
+}
+
+TEST(StateDocumentTests, OnlyKnownValuesAreRendered)
+{
+    StateDocument doc;
+    char payload[128];
+    EXPECT_EQ(doc.build(payload, sizeof(payload)), 2u);
+    EXPECT_STREQ(payload, "{}");
+
+    doc.setBinary(Id::FLAME, true);
+    doc.setFloat(Id::BOILER_TEMP, 45.5f, 1);
+    doc.setInt(Id::BURNER_STARTS, 1234);
+    doc.build(payload, sizeof(payload));
+    EXPECT_STREQ(payload, "{\"flame\":\"ON\",\"boiler_temp\":45.5,\"burner_starts\":1234}");
+    EXPECT_EQ(doc.entryCount(), 3u);
+}
+
+TEST(StateDocumentTests, NonFiniteFloatIsNull)
+{
+    StateDocument doc;
+    doc.setFloat(Id::BOILER_TEMP, NAN);
+    char payload[64];
+    doc.build(payload, sizeof(payload));
+    EXPECT_STREQ(payload, "{\"boiler_temp\":null}");
+}
+
+// ============================================================================
+// Change tracking
+// ============================================================================
+
+TEST(StateDocumentTests, DirtyOnlyOnChangeAtPublishPrecision)
+{
+    StateDocument doc;
+    EXPECT_FALSE(doc.dirty());
+
+    doc.setFloat(Id::BOILER_TEMP, 45.001f);
+    EXPECT_TRUE(doc.dirty());
+    doc.markSent();
+
+    doc.setFloat(Id::BOILER_TEMP, 45.004f); // Same at 2 decimals
+    EXPECT_FALSE(doc.dirty());
+
+    doc.setText(Id::DEVICE_NAME, "boiler");
+    doc.markSent();
+    doc.setText(Id::DEVICE_NAME, "boiler");
+    EXPECT_FALSE(doc.dirty());
+
+    doc.setInt(Id::BURNER_STARTS, 1);
+    EXPECT_TRUE(doc.dirty());
+    doc.markSent();
+    doc.markDirty();
+    EXPECT_TRUE(doc.dirty());
+}
+
+TEST(StateDocumentTests, RejectsTextItCannotHold)
+{
+    StateDocument doc;
+    std::string long_text(StateDocument::TEXT_LEN, 'x');
+    EXPECT_FALSE(doc.setText(Id::DEVICE_NAME, long_text.c_str()));
+    EXPECT_FALSE(doc.setText(Id::BOILER_TEMP, "42"));
+    EXPECT_FALSE(doc.setText(Id::DEVICE_NAME, nullptr));
+    EXPECT_FALSE(doc.has(Id::DEVICE_NAME));
+    EXPECT_FALSE(doc.dirty());
+}
+
+// ============================================================================
+// Fixed buffer
+// ============================================================================
+
+TEST(StateDocumentTests, TooSmallBufferFailsWithoutOverrun)
+{
+    StateDocument doc;
+    fillAll(doc);
+
+    static char full[StateDocument::DOCUMENT_LEN];
+    size_t len = doc.build(full, sizeof(full));
+    ASSERT_GT(len, 0u);
+
+    // Every size short of the document fails cleanly and never writes past the end
+    std::string buf(len + 8, '#');
+    for (size_t size = 0; size <= len; size++)
+    {
+        std::fill(buf.begin(), buf.end(), '#');
+        EXPECT_EQ(doc.build(&buf[0], size), 0u) << size;
+        for (size_t k = size; k < buf.size(); k++)
+            ASSERT_EQ(buf[k], '#') << "overrun at " << k << " with size " << size;
+    }
+    EXPECT_EQ(doc.build(&buf[0], len + 1), len);
+}
+
+TEST(StateDocumentTests, OneMessageReplacesAMessagePerValue)
+{
+    StateDocument doc;
+    fillAll(doc);
+    static char payload[StateDocument::DOCUMENT_LEN];
+    size_t len = doc.build(payload, sizeof(payload));
+    ASSERT_GT(len, 0u);
+
+    // What the same values cost as one message each on opentherm/opentherm_gw/state/<suffix>
+    const std::string base = "opentherm/opentherm_gw/state";
+    std::map<std::string, std::string> parsed;
+    ASSERT_TRUE(parseObject(payload, &parsed));
+    uint32_t per_topic_bytes = 0;
+    for (size_t i = 0; i < OpenTherm::Entities::COUNT; i++)
+    {
+        const char *suffix = OpenTherm::Entities::TABLE[i].suffix;
+        per_topic_bytes += OpenTherm::Common::publishWireSize(base.size() + 1 + strlen(suffix),
+                                                              parsed[suffix].size(), 0);
+    }
+    uint32_t document_bytes = OpenTherm::Common::publishWireSize(base.size(), len, 0);
+
+    EXPECT_LT(document_bytes, per_topic_bytes);
+    EXPECT_LE(len, largestSendableDocument());
+}
+
+TEST(StateDocumentTests, LargestDocumentIsSendable)
+{
+    // build() never renders more than DOCUMENT_LEN - 1 bytes; that much has to
+    // go through the network queue and lwIP's output ring in one piece
+    EXPECT_EQ(largestSendableDocument(), StateDocument::DOCUMENT_LEN - 1);
+}
@@ -0,0 +1,183 @@
+/**
+ * Unit tests for the double-buffered state snapshot
+ *
+ * Records values the way the boiler reads do, swaps at the end of each pass
+ * and checks what stage two (the publish queue) and a forced republish get
+ * to see from the front buffer.
+ */
+
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include "state_snapshot.hpp"
+
+using OpenTherm::Entities::Id;
+using OpenTherm::Entities::ValueKind;
+using OpenTherm::Publish::QueuedValue;
+using OpenTherm::Publish::StateSnapshot;
+
+// What a visit handed over, rendered per entity
+static std::map<Id, std::string> g_seen;
+static std::map<Id, bool> g_retained;
+
+static void collect(Id id, const QueuedValue &value)
+{
+    char buf[80];
+    switch (value.kind)
+    {
+    case ValueKind::BINARY:
+        snprintf(buf, sizeof(buf), "%s", value.binary ? "ON" : "OFF");
+        break;
+    case ValueKind::INT:
+        snprintf(buf, sizeof(buf), "%ld", (long)value.integer);
+        break;
+    case ValueKind::FLOAT:
+        snprintf(buf, sizeof(buf), "%.*f", (int)value.precision, (double)value.real);
+        break;
+    case ValueKind::TEXT:
+        snprintf(buf, sizeof(buf), "%s", value.text);
+        break;
+    }
+    g_seen[id] = buf;
+    g_retained[id] = value.retain;
+}
+
+class StateSnapshotTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        g_seen.clear();
+        g_retained.clear();
+    }
+
+    StateSnapshot snapshot;
+};
+
+// ============================================================================
+// Acquisition and swap
+// ============================================================================
+
+TEST_F(StateSnapshotTest, EmptyUntilTheFirstSwap)
+{
+    EXPECT_FALSE(snapshot.pending());
+    EXPECT_EQ(snapshot.entryCount(), 0u);
+
+    snapshot.setFloat(Id::BOILER_TEMP, 45.5f, 2, true);
+    EXPECT_TRUE(snapshot.pending());
+    // Stage two only ever reads the front buffer
+    EXPECT_EQ(snapshot.forEach(&collect), 0u);
+
+    EXPECT_EQ(snapshot.swap(), 1u);
+    EXPECT_FALSE(snapshot.pending());
+    EXPECT_EQ(snapshot.entryCount(), 1u);
+    EXPECT_EQ(snapshot.forEachSwapped(&collect), 1u);
+    EXPECT_EQ(g_seen[Id::BOILER_TEMP], "45.50");
+    EXPECT_TRUE(g_retained[Id::BOILER_TEMP]);
+}
+
+TEST_F(StateSnapshotTest, FrontStaysPutWhileTheNextPassIsRead)
+{
+    snapshot.setFloat(Id::BOILER_TEMP, 45.5f, 2, true);
+    snapshot.swap();
+
+    snapshot.setFloat(Id::BOILER_TEMP, 50.0f, 2, true);
+    snapshot.forEach(&collect);
+    EXPECT_EQ(g_seen[Id::BOILER_TEMP], "45.50");
+
+    snapshot.swap();
+    snapshot.forEach(&collect);
+    EXPECT_EQ(g_seen[Id::BOILER_TEMP], "50.00");
+}
+
+TEST_F(StateSnapshotTest, SwapHandsOverOnlyThePassJustRead)
+{
+    snapshot.setBinary(Id::FLAME, true, true);
+    snapshot.setInt(Id::WIFI_RSSI, -67, false);
+    EXPECT_EQ(snapshot.swap(), 2u);
+
+    // Next pass reads one entity, with the same value as before: it is still
+    // handed over, so the publish filter's max-silence refresh can see it
+    snapshot.setInt(Id::WIFI_RSSI, -67, false);
+    EXPECT_EQ(snapshot.swap(), 1u);
+    EXPECT_EQ(snapshot.forEachSwapped(&collect), 1u);
+    EXPECT_EQ(g_seen.count(Id::FLAME), 0u);
+    EXPECT_EQ(g_seen[Id::WIFI_RSSI], "-67");
+    EXPECT_FALSE(g_retained[Id::WIFI_RSSI]);
+
+    // A pass that read nothing hands over nothing
+    g_seen.clear();
+    EXPECT_EQ(snapshot.swap(), 0u);
+    EXPECT_EQ(snapshot.forEachSwapped(&collect), 0u);
+    EXPECT_TRUE(g_seen.empty());
+}
+
+TEST_F(StateSnapshotTest, BackBufferCarriesEveryValueForward)
+{
+    // Alternating passes each touch a different entity; the front must always
+    // hold both, whichever buffer it is
+    snapshot.setBinary(Id::FLAME, true, true);
+    snapshot.swap();
+    snapshot.setText(Id::IP_ADDRESS, "192.168.1.50", true);
+    snapshot.swap();
+    snapshot.setFloat(Id::BOILER_TEMP, 45.5f, 2, true);
+    snapshot.swap();
+    snapshot.setText(Id::IP_ADDRESS, "192.168.1.51", true);
+    snapshot.swap();
+
+    EXPECT_EQ(snapshot.forEach(&collect), 3u);
+    EXPECT_EQ(g_seen[Id::FLAME], "ON");
+    EXPECT_EQ(g_seen[Id::IP_ADDRESS], "192.168.1.51");
+    EXPECT_EQ(g_seen[Id::BOILER_TEMP], "45.50");
+}
+
+// ============================================================================
+// Text values
+// ============================================================================
+
+TEST_F(StateSnapshotTest, TextMustFitAndBelongToATextEntity)
+{
+    std::string overlong(StateSnapshot::TEXT_LEN, 'x');
+    EXPECT_FALSE(snapshot.setText(Id::IP_ADDRESS, overlong.c_str(), true));
+    EXPECT_FALSE(snapshot.setText(Id::BOILER_TEMP, "45.5", true));
+    EXPECT_FALSE(snapshot.pending());
+
+    EXPECT_TRUE(snapshot.setText(Id::IP_ADDRESS, nullptr, true));
+    snapshot.swap();
+    snapshot.forEach(&collect);
+    EXPECT_EQ(g_seen[Id::IP_ADDRESS], "");
+}
+
+// ============================================================================
+// Forced republish
+// ============================================================================
+
+TEST_F(StateSnapshotTest, ForEachCoversEveryEntityRead)
+{
+    // A full poll cycle spread over many passes, as the scheduler runs it
+    for (size_t i = 0; i < OpenTherm::Entities::COUNT; i++)
+    {
+        Id id = static_cast<Id>(i);
+        switch (OpenTherm::Entities::descriptor(id).kind)
+        {
+        case ValueKind::BINARY:
+            snapshot.setBinary(id, i % 2 == 0, true);
+            break;
+        case ValueKind::INT:
+            snapshot.setInt(id, (int32_t)i, true);
+            break;
+        case ValueKind::FLOAT:
+            snapshot.setFloat(id, (float)i / 4, 2, true);
+            break;
+        case ValueKind::TEXT:
+            snapshot.setText(id, "text", true);
+            break;
+        }
+        snapshot.swap();
+    }
+
+    // Everything is in the front buffer: no boiler read needed to republish it
+    EXPECT_EQ(snapshot.entryCount(), OpenTherm::Entities::COUNT);
+    EXPECT_EQ(snapshot.forEach(&collect), OpenTherm::Entities::COUNT);
+    EXPECT_EQ(g_seen.size(), OpenTherm::Entities::COUNT);
+}
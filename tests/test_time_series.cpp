@@ -0,0 +1,219 @@
+/**
+ * Unit tests for the on-device time series
+ *
+ * Feeds the cycling signals second by second, then reads windows back through
+ * formatWindow() the way a backfill request does: the state at the start of
+ * the window, one row per change, chunks that resume where the previous one
+ * stopped, and a ring that drops its oldest block when full.
+ */
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "time_series.hpp"
+
+using OpenTherm::Entities::Id;
+using OpenTherm::Publish::TimeSeries;
+
+static const char *SIGNALS =
+    "\"signals\":[\"boiler_temp\",\"return_temp\",\"modulation\",\"flame\",\"control_setpoint\"]";
+
+class TimeSeriesTest : public ::testing::Test
+{
+protected:
+    std::string window(uint32_t from_s, uint32_t to_s, uint32_t *next_s, size_t len = 4096)
+    {
+        std::string buf(len, '\0');
+        size_t n = series.formatWindow(&buf[0], len, from_s, to_s, 9000, next_s);
+        return buf.substr(0, n);
+    }
+
+    // The "v" rows of a reply
+    static std::string rows(const std::string &json)
+    {
+        size_t start = json.find("\"v\":[");
+        size_t end = json.rfind("],\"to\":");
+        if (start == std::string::npos || end == std::string::npos)
+            return "";
+        return json.substr(start + 5, end - start - 5);
+    }
+
+    // Rows with absolute times ("<second>:<values>") so chunks can be compared
+    static std::vector<std::string> timedRows(const std::string &json)
+    {
+        std::vector<std::string> out;
+        size_t from_at = json.find("\"from\":");
+        if (from_at == std::string::npos)
+            return out;
+        uint32_t t = (uint32_t)strtoul(json.c_str() + from_at + 7, nullptr, 10);
+        std::string r = rows(json);
+        size_t pos = 0;
+        while (pos < r.size())
+        {
+            size_t end = r.find(']', pos);
+            std::string row = r.substr(pos + 1, end - pos - 1); // Without the brackets
+            size_t comma = row.find(',');
+            t += (uint32_t)strtoul(row.c_str(), nullptr, 10);
+            out.push_back(std::to_string(t) + ":" + row.substr(comma + 1));
+            pos = end + 2; // Past "],"
+        }
+        return out;
+    }
+
+    TimeSeries series;
+};
+
+// ============================================================================
+// Encoding
+// ============================================================================
+
+TEST_F(TimeSeriesTest, UnchangedSecondsCollapseIntoRuns)
+{
+    series.set(Id::BOILER_TEMP, 45.5f);
+    series.set(Id::FLAME, 1.0f);
+    for (uint32_t t = 100; t < 100 + 3600; t++)
+        series.sample(t);
+
+    // An idle hour: the keyframe plus one run byte per 128 seconds
+    EXPECT_EQ(series.bytesUsed(), (3600u - 1 + 127) / 128);
+    EXPECT_EQ(series.oldest(), 100u);
+    EXPECT_EQ(series.newest(), 3699u);
+}
+
+TEST_F(TimeSeriesTest, UntrackedAndNonFiniteValuesAreIgnored)
+{
+    series.set(Id::OUTSIDE_TEMP, 5.0f);
+    series.set(Id::BOILER_TEMP, std::nanf(""));
+    series.sample(10);
+
+    uint32_t next;
+    std::string json = window(10, 10, &next);
+    EXPECT_EQ(rows(json), "[0,null,null,null,null,null]");
+}
+
+// ============================================================================
+// Windows
+// ============================================================================
+
+TEST_F(TimeSeriesTest, WindowStartsWithTheStateAtFromThenOneRowPerChange)
+{
+    series.set(Id::BOILER_TEMP, 40.0f);
+    series.set(Id::RETURN_TEMP, 35.0f);
+    series.set(Id::CONTROL_SETPOINT, 55.0f);
+    series.sample(1000);
+    series.set(Id::FLAME, 1.0f);
+    series.set(Id::MODULATION, 20.0f);
+    series.sample(1010);
+    series.set(Id::BOILER_TEMP, 41.25f); // Kept in tenths
+    series.sample(1015);
+    series.set(Id::FLAME, 0.0f);
+    series.set(Id::MODULATION, 0.0f);
+    series.sample(1030);
+    series.sample(1040);
+
+    uint32_t next;
+    std::string json = window(1012, 2000, &next);
+    EXPECT_EQ(json, std::string("{\"clock\":\"uptime\",\"now\":9000,\"from\":1012,") + SIGNALS +
+                        ",\"v\":[[0,40.0,35.0,20.0,1,55.0],[3,41.3,35.0,20.0,1,55.0],"
+                        "[15,41.3,35.0,0.0,0,55.0]],\"to\":1040}");
+    EXPECT_EQ(next, 1041u);
+}
+
+TEST_F(TimeSeriesTest, SkippedSecondsHoldThePreviousValues)
+{
+    series.set(Id::BOILER_TEMP, 40.0f);
+    series.sample(0);
+    // The loop was busy for a while
+    series.set(Id::BOILER_TEMP, 42.0f);
+    series.sample(500);
+
+    uint32_t next;
+    EXPECT_EQ(rows(window(0, 500, &next)), "[0,40.0,null,null,null,null],[500,42.0,null,null,null,null]");
+    EXPECT_EQ(rows(window(499, 499, &next)), "[0,40.0,null,null,null,null]");
+}
+
+TEST_F(TimeSeriesTest, NegativeValuesRoundTrip)
+{
+    series.set(Id::BOILER_TEMP, -0.5f);
+    series.sample(0);
+    series.set(Id::BOILER_TEMP, -12.3f);
+    series.sample(1);
+
+    uint32_t next;
+    EXPECT_EQ(rows(window(0, 1, &next)), "[0,-0.5,null,null,null,null],[1,-12.3,null,null,null,null]");
+}
+
+TEST_F(TimeSeriesTest, SmallBufferSplitsTheWindowIntoChunks)
+{
+    for (uint32_t t = 0; t < 600; t++)
+    {
+        series.set(Id::BOILER_TEMP, 40.0f + (float)(t % 20) / 10);
+        series.set(Id::FLAME, (t / 60) % 2 == 0 ? 1.0f : 0.0f);
+        series.sample(t);
+    }
+    uint32_t next;
+    std::vector<std::string> whole = timedRows(window(0, 599, &next, 65536));
+    EXPECT_EQ(next, 600u);
+
+    // Each chunk resumes at the change that did not fit the previous one, so
+    // the chunks together carry exactly the rows of the whole window
+    std::vector<std::string> joined;
+    uint32_t from = 0;
+    int chunks = 0;
+    while (from <= 599)
+    {
+        std::string json = window(from, 599, &next, 300);
+        ASSERT_FALSE(json.empty());
+        EXPECT_LT(json.size(), 300u);
+        std::string to = ",\"to\":" + std::to_string(next - 1) + "}";
+        EXPECT_EQ(json.substr(json.size() - to.size()), to);
+        ASSERT_GT(next, from);
+        std::vector<std::string> part = timedRows(json);
+        joined.insert(joined.end(), part.begin(), part.end());
+        from = next;
+        chunks++;
+    }
+    EXPECT_GT(chunks, 5);
+    EXPECT_EQ(joined, whole);
+}
+
+TEST_F(TimeSeriesTest, FullRingDropsTheOldestBlock)
+{
+    // Every second changes every signal: no runs, blocks fill quickly
+    uint32_t t = 0;
+    while (series.oldest() == 0)
+    {
+        series.set(Id::BOILER_TEMP, (float)(t % 800));
+        series.set(Id::RETURN_TEMP, (float)((t * 7) % 800));
+        series.set(Id::MODULATION, (float)(t % 100));
+        series.set(Id::FLAME, (float)(t % 2));
+        series.set(Id::CONTROL_SETPOINT, (float)((t * 3) % 900));
+        series.sample(t++);
+    }
+    EXPECT_GT(series.oldest(), 0u);
+    EXPECT_LE(series.bytesUsed(), TimeSeries::BLOCKS * TimeSeries::BLOCK_BYTES);
+
+    // A window reaching before the ring is clamped to what is held, and the
+    // decoded values still match what was recorded
+    uint32_t next;
+    std::string json = window(0, series.newest(), &next, 256);
+    EXPECT_NE(json.find("\"from\":" + std::to_string(series.oldest()) + ","), std::string::npos) << json;
+
+    uint32_t last = series.newest();
+    char expected[96];
+    snprintf(expected, sizeof(expected), "[0,%u.0,%u.0,%u.0,%u,%u.0]", last % 800, (last * 7) % 800, last % 100,
+             last % 2, (last * 3) % 900);
+    EXPECT_EQ(rows(window(last, last, &next)), expected);
+}
+
+TEST_F(TimeSeriesTest, EmptyOrOutOfRangeWindowRendersNothing)
+{
+    uint32_t next;
+    EXPECT_EQ(window(0, 100, &next), "");
+
+    series.sample(50);
+    EXPECT_EQ(window(60, 100, &next), "");
+    EXPECT_EQ(window(40, 49, &next), ""); // Clamped to 50..49
+}
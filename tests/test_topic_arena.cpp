@@ -0,0 +1,265 @@
+/**
+ * Unit tests for the precomputed topic arena
+ *
+ * Every topic is checked against the formatting it replaces. Global operator
+ * new is counted (heap_counter.cpp) so an update cycle can be measured both
+ * ways: topics concatenated into std::string per publish, as the removed
+ * Discovery::buildStateTopic/buildDiscoveryTopic did, and topics looked up
+ * in the arena.
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <set>
+#include <string>
+#include "discovery_payload.hpp"
+#include "heap_counter.hpp"
+#include "mqtt_topics.hpp"
+#include "opentherm_ha.hpp"
+#include "publish_cache.hpp"
+#include "topic_arena.hpp"
+
+using OpenTherm::Discovery::COMPONENT_COUNT;
+using OpenTherm::Discovery::COMPONENTS;
+using OpenTherm::Entities::Id;
+using OpenTherm::MQTTTopics::TopicArena;
+using OpenTherm::Publish::StateCache;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static OpenTherm::HomeAssistant::Config makeConfig(const char *device_id = "opentherm_gw")
+{
+    OpenTherm::HomeAssistant::Config cfg = {};
+    cfg.device_name = "OpenTherm Gateway";
+    cfg.device_id = device_id;
+    cfg.mqtt_prefix = "homeassistant";
+    cfg.topic_base = "opentherm";
+    cfg.state_topic_base = "state";
+    cfg.command_topic_base = "cmd";
+    cfg.auto_discovery = true;
+    cfg.compact_discovery = true;
+    return cfg;
+}
+
+// Stands in for MQTT; the cycle measures the topic path alone
+static size_t g_sink_calls = 0;
+static size_t g_topic_bytes = 0;
+
+static bool countingSink(const char *topic, const char *, bool)
+{
+    g_sink_calls++;
+    g_topic_bytes += strlen(topic);
+    return true;
+}
+
+// The pre-arena topic builders, kept here as the baseline
+static std::string legacyStateTopic(const OpenTherm::HomeAssistant::Config &cfg, const char *suffix)
+{
+    std::string topic;
+    topic.reserve(strlen(cfg.topic_base) + strlen(cfg.device_id) + strlen(cfg.state_topic_base) + strlen(suffix) + 3);
+    topic = std::string(cfg.topic_base) + "/" + cfg.device_id + "/" + cfg.state_topic_base + "/" + suffix;
+    return topic;
+}
+
+static std::string legacyDiscoveryTopic(const OpenTherm::HomeAssistant::Config &cfg, const char *component,
+                                        const char *object_id)
+{
+    std::string topic;
+    topic.reserve(strlen(cfg.mqtt_prefix) + strlen(component) + strlen(cfg.device_id) + strlen(object_id) +
+                  strlen(OpenTherm::MQTTDiscovery::CONFIG_SUFFIX) + 4);
+    topic = std::string(cfg.mqtt_prefix) + "/" + component + "/" + cfg.device_id + "/" + object_id +
+            OpenTherm::MQTTDiscovery::CONFIG_SUFFIX;
+    return topic;
+}
+
+// One update cycle: every entity's state changes and is published
+static void publishCycle(StateCache &cache, int tick)
+{
+    for (size_t i = 0; i < OpenTherm::Entities::COUNT; i++)
+    {
+        Id id = static_cast<Id>(i);
+        switch (OpenTherm::Entities::descriptor(id).kind)
+        {
+        case OpenTherm::Entities::ValueKind::BINARY:
+            cache.publishBinary(id, tick & 1);
+            break;
+        case OpenTherm::Entities::ValueKind::INT:
+            cache.publishInt(id, tick);
+            break;
+        case OpenTherm::Entities::ValueKind::FLOAT:
+            cache.publishFloat(id, 20.0f + tick);
+            break;
+        case OpenTherm::Entities::ValueKind::TEXT:
+            cache.publishText(id, tick & 1 ? "odd" : "even");
+            break;
+        }
+    }
+}
+
+// ============================================================================
+// Topic contents
+// ============================================================================
+
+TEST(TopicArenaTests, TopicsMatchTheFormatsTheyReplace)
+{
+    auto cfg = makeConfig();
+    TopicArena topics;
+    EXPECT_FALSE(topics.ready());
+    EXPECT_STREQ(topics.state(Id::BOILER_TEMP), "");
+    ASSERT_TRUE(topics.build(cfg));
+    ASSERT_TRUE(topics.ready());
+
+    EXPECT_STREQ(topics.state(Id::BOILER_TEMP), "opentherm/opentherm_gw/state/boiler_temp");
+    EXPECT_STREQ(topics.stateDocument(), "opentherm/opentherm_gw/state");
+    EXPECT_STREQ(topics.commandBase(), "opentherm/opentherm_gw/cmd/");
+    EXPECT_EQ(topics.commandBaseLen(), strlen("opentherm/opentherm_gw/cmd/"));
+    EXPECT_STREQ(topics.commandWildcard(), "opentherm/opentherm_gw/cmd/#");
+    for (size_t i = 0; i < OpenTherm::Entities::COUNT; i++)
+    {
+        const char *suffix = OpenTherm::Entities::TABLE[i].suffix;
+        EXPECT_EQ(topics.state(static_cast<Id>(i)), legacyStateTopic(cfg, suffix));
+    }
+
+    for (size_t i = 0; i < COMPONENT_COUNT; i++)
+    {
+        const auto &c = COMPONENTS[i];
+        EXPECT_EQ(topics.discovery(i), legacyDiscoveryTopic(cfg, c.component, c.object_id));
+    }
+
+    char buf[128];
+    OpenTherm::Discovery::formatDeviceDiscoveryTopic(cfg, buf, sizeof(buf));
+    EXPECT_STREQ(topics.deviceDiscovery(), buf);
+    OpenTherm::Discovery::formatDiscoveryHashTopic(cfg, buf, sizeof(buf));
+    EXPECT_STREQ(topics.discoveryHash(), buf);
+    OpenTherm::Discovery::formatBirthTopic(cfg, buf, sizeof(buf));
+    EXPECT_STREQ(topics.birth(), buf);
+    EXPECT_STREQ(topics.history(), "opentherm/opentherm_gw/history");
+    EXPECT_STREQ(topics.timeSeries(), "opentherm/opentherm_gw/timeseries");
+}
+
+TEST(TopicArenaTests, EveryTopicIsDistinct)
+{
+    TopicArena topics;
+    ASSERT_TRUE(topics.build(makeConfig()));
+    std::set<std::string> seen;
+    size_t count = 0;
+    for (size_t i = 0; i < OpenTherm::Entities::COUNT; i++, count++)
+        seen.insert(topics.state(static_cast<Id>(i)));
+    for (size_t i = 0; i < COMPONENT_COUNT; i++, count++)
+        seen.insert(topics.discovery(i));
+    EXPECT_EQ(seen.size(), count);
+}
+
+// ============================================================================
+// Rebuilding
+// ============================================================================
+
+TEST(TopicArenaTests, RebuildsOnlyWhenInputsChange)
+{
+    TopicArena topics;
+    ASSERT_TRUE(topics.build(makeConfig()));
+    EXPECT_EQ(topics.builds(), 1u);
+    const char *boiler = topics.state(Id::BOILER_TEMP);
+
+    // Same text in a different buffer, as after reloading the config
+    char same_id[] = "opentherm_gw";
+    ASSERT_TRUE(topics.build(makeConfig(same_id)));
+    EXPECT_EQ(topics.builds(), 1u);
+    EXPECT_EQ(topics.state(Id::BOILER_TEMP), boiler);
+
+    ASSERT_TRUE(topics.build(makeConfig("boiler_2")));
+    EXPECT_EQ(topics.builds(), 2u);
+    EXPECT_STREQ(topics.state(Id::BOILER_TEMP), "opentherm/boiler_2/state/boiler_temp");
+
+    auto cfg = makeConfig("boiler_2");
+    cfg.command_topic_base = "set";
+    ASSERT_TRUE(topics.build(cfg));
+    EXPECT_EQ(topics.builds(), 3u);
+    EXPECT_STREQ(topics.commandBase(), "opentherm/boiler_2/set/");
+}
+
+TEST(TopicArenaTests, SizedForLongDeviceIds)
+{
+    TopicArena topics;
+    ASSERT_TRUE(topics.build(makeConfig()));
+    size_t default_used = topics.used();
+    printf("Topic arena: %zu of %zu bytes with the default ids\n", default_used, TopicArena::ARENA_LEN);
+    EXPECT_LT(default_used, TopicArena::ARENA_LEN * 3 / 4);
+
+    std::string long_id(36, 'x');
+    ASSERT_TRUE(topics.build(makeConfig(long_id.c_str())));
+    EXPECT_GT(topics.used(), default_used);
+}
+
+TEST(TopicArenaTests, RejectsWhatDoesNotFit)
+{
+    TopicArena topics;
+    std::string too_long(TopicArena::PART_LEN, 'x');
+    EXPECT_FALSE(topics.build(makeConfig(too_long.c_str())));
+    EXPECT_FALSE(topics.ready());
+    EXPECT_STREQ(topics.state(Id::BOILER_TEMP), "");
+    EXPECT_STREQ(topics.discovery(0), "");
+    EXPECT_STREQ(topics.commandWildcard(), "");
+
+    // Every part at the limit overflows the arena instead of the buffer
+    std::string longest(TopicArena::PART_LEN - 1, 'y');
+    auto cfg = makeConfig(longest.c_str());
+    cfg.mqtt_prefix = longest.c_str();
+    cfg.topic_base = longest.c_str();
+    cfg.state_topic_base = longest.c_str();
+    cfg.command_topic_base = longest.c_str();
+    EXPECT_FALSE(topics.build(cfg));
+    EXPECT_FALSE(topics.ready());
+    EXPECT_STREQ(topics.stateDocument(), "");
+
+    // A failed build does not stick
+    ASSERT_TRUE(topics.build(makeConfig()));
+    EXPECT_STREQ(topics.state(Id::BOILER_TEMP), "opentherm/opentherm_gw/state/boiler_temp");
+}
+
+TEST(TopicArenaTests, CacheWithoutTopicsPublishesNothing)
+{
+    g_sink_calls = 0;
+    StateCache cache(&countingSink);
+    EXPECT_FALSE(cache.publishInt(Id::BURNER_STARTS, 1));
+    EXPECT_EQ(g_sink_calls, 0u);
+}
+
+// ============================================================================
+// Heap usage per update cycle
+// ============================================================================
+
+TEST(TopicArenaTests, UpdateCycleAllocatesNothing)
+{
+    auto cfg = makeConfig();
+    static TopicArena topics;
+    ASSERT_TRUE(topics.build(cfg));
+    StateCache cache(&countingSink);
+    cache.setTopics(&topics);
+    publishCycle(cache, 0); // Warm up
+
+    // Before: a std::string per state topic and per discovery topic
+    size_t before = g_heap_allocations;
+    for (size_t i = 0; i < OpenTherm::Entities::COUNT; i++)
+        g_topic_bytes += legacyStateTopic(cfg, OpenTherm::Entities::TABLE[i].suffix).size();
+    for (size_t i = 0; i < COMPONENT_COUNT; i++)
+        g_topic_bytes += legacyDiscoveryTopic(cfg, COMPONENTS[i].component, COMPONENTS[i].object_id).size();
+    size_t legacy = g_heap_allocations - before;
+
+    // After: the same topics straight from the arena
+    g_sink_calls = 0;
+    before = g_heap_allocations;
+    publishCycle(cache, 1);
+    for (size_t i = 0; i < COMPONENT_COUNT; i++)
+        g_topic_bytes += strlen(topics.discovery(i));
+    ASSERT_TRUE(topics.build(cfg)); // Reconnect with the same config
+    size_t arena = g_heap_allocations - before;
+
+    printf("Heap allocations per update cycle: %zu with std::string topics, %zu with the arena\n", legacy, arena);
+    EXPECT_EQ(g_sink_calls, OpenTherm::Entities::COUNT);
+    EXPECT_GE(legacy, OpenTherm::Entities::COUNT + COMPONENT_COUNT);
+    EXPECT_EQ(arena, 0u);
+    EXPECT_EQ(topics.builds(), 1u);
+}
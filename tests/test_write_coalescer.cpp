@@ -0,0 +1,185 @@
+/**
+ * Unit tests for setpoint write coalescing
+ *
+ * Drives the coalescer with a simulated millisecond clock the way the main
+ * loop does: commands are submitted as they arrive, and due writes are taken
+ * (and acknowledged, as a successful boiler write would) on every pass.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <vector>
+#include "opentherm_protocol.hpp"
+#include "write_coalescer.hpp"
+
+using OpenTherm::Commands::CoalescerStats;
+using OpenTherm::Commands::WriteCoalescer;
+
+struct Write
+{
+    uint32_t time_ms;
+    uint8_t data_id;
+    uint16_t value;
+};
+
+// Take every write due at `now_ms`, acknowledging each as the boiler would
+static void takeDue(WriteCoalescer &c, uint32_t now_ms, std::vector<Write> *writes)
+{
+    uint8_t data_id;
+    uint16_t value;
+    while (c.nextDue(now_ms, &data_id, &value))
+    {
+        writes->push_back({now_ms, data_id, value});
+        c.acknowledged(data_id, value);
+    }
+}
+
+static uint16_t f88(float value)
+{
+    return OpenTherm::Protocol::f8_8_from_float(value);
+}
+
+// ============================================================================
+// Coalescing
+// ============================================================================
+
+TEST(WriteCoalescerTests, SingleCommandIsWrittenAfterTheWindow)
+{
+    WriteCoalescer c(300);
+    std::vector<Write> writes;
+    EXPECT_EQ(c.msUntilDue(0), UINT32_MAX);
+
+    ASSERT_TRUE(c.submit(OT_DATA_ID_ROOM_SETPOINT, f88(21.5f), 1000));
+    EXPECT_EQ(c.msUntilDue(1000), 300u);
+    takeDue(c, 1299, &writes);
+    EXPECT_TRUE(writes.empty());
+    takeDue(c, 1300, &writes);
+    ASSERT_EQ(writes.size(), 1u);
+    EXPECT_EQ(writes[0].data_id, OT_DATA_ID_ROOM_SETPOINT);
+    EXPECT_EQ(writes[0].value, f88(21.5f));
+    EXPECT_EQ(c.msUntilDue(1300), UINT32_MAX);
+}
+
+TEST(WriteCoalescerTests, SliderBurstWritesOnlyTheLatestValue)
+{
+    WriteCoalescer c(300);
+    std::vector<Write> writes;
+
+    // A slider dragged from 20 to 23 in half-degree steps within 150 ms
+    uint32_t t = 5000;
+    for (float v = 20.0f; v <= 23.0f; v += 0.5f, t += 25)
+        c.submit(OT_DATA_ID_ROOM_SETPOINT, f88(v), t);
+    takeDue(c, 5300, &writes);
+
+    ASSERT_EQ(writes.size(), 1u);
+    EXPECT_EQ(writes[0].value, f88(23.0f));
+    CoalescerStats stats = c.stats();
+    EXPECT_EQ(stats.written, 1u);
+    EXPECT_EQ(stats.superseded, 6u);
+    EXPECT_EQ(c.framesSaved(), 6u);
+}
+
+TEST(WriteCoalescerTests, HeldSliderStillWritesEveryWindow)
+{
+    WriteCoalescer c(300);
+    std::vector<Write> writes;
+
+    // A command every 50 ms for 2 s: the window is not pushed back by each one
+    float v = 40.0f;
+    for (uint32_t t = 0; t < 2000; t += 50, v += 0.5f)
+    {
+        c.submit(OT_DATA_ID_DHW_SETPOINT, f88(v), t);
+        takeDue(c, t, &writes);
+    }
+    takeDue(c, 2300, &writes);
+
+    EXPECT_GE(writes.size(), 6u);
+    EXPECT_LE(writes.size(), 8u);
+    for (size_t i = 1; i < writes.size(); i++)
+        EXPECT_GE(writes[i].time_ms - writes[i - 1].time_ms, 300u);
+    EXPECT_EQ(writes.back().value, f88(v - 0.5f)); // The last value always lands
+}
+
+TEST(WriteCoalescerTests, DataIdsAreCoalescedSeparately)
+{
+    WriteCoalescer c(300);
+    std::vector<Write> writes;
+    c.submit(OT_DATA_ID_ROOM_SETPOINT, f88(21.0f), 0);
+    c.submit(OT_DATA_ID_DHW_SETPOINT, f88(50.0f), 100);
+    c.submit(OT_DATA_ID_ROOM_SETPOINT, f88(21.5f), 200);
+
+    EXPECT_EQ(c.msUntilDue(200), 100u);
+    takeDue(c, 300, &writes);
+    ASSERT_EQ(writes.size(), 1u);
+    EXPECT_EQ(writes[0].data_id, OT_DATA_ID_ROOM_SETPOINT);
+    EXPECT_EQ(writes[0].value, f88(21.5f));
+
+    takeDue(c, 400, &writes);
+    ASSERT_EQ(writes.size(), 2u);
+    EXPECT_EQ(writes[1].data_id, OT_DATA_ID_DHW_SETPOINT);
+}
+
+// ============================================================================
+// Skipping acknowledged values
+// ============================================================================
+
+TEST(WriteCoalescerTests, ValueTheBoilerAlreadyHasIsSkipped)
+{
+    WriteCoalescer c(300);
+    std::vector<Write> writes;
+    c.acknowledged(OT_DATA_ID_CONTROL_SETPOINT, f88(55.0f));
+
+    c.submit(OT_DATA_ID_CONTROL_SETPOINT, f88(55.0f), 0);
+    takeDue(c, 300, &writes);
+    EXPECT_TRUE(writes.empty());
+    EXPECT_EQ(c.stats().unchanged, 1u);
+
+    // Dragged away and back again within one window: nothing reaches the bus
+    c.submit(OT_DATA_ID_CONTROL_SETPOINT, f88(56.0f), 1000);
+    c.submit(OT_DATA_ID_CONTROL_SETPOINT, f88(55.0f), 1100);
+    takeDue(c, 1300, &writes);
+    EXPECT_TRUE(writes.empty());
+    EXPECT_EQ(c.framesSaved(), 3u);
+
+    // A different value is written, and becomes the one to compare with
+    c.submit(OT_DATA_ID_CONTROL_SETPOINT, f88(60.0f), 2000);
+    takeDue(c, 2300, &writes);
+    ASSERT_EQ(writes.size(), 1u);
+    c.submit(OT_DATA_ID_CONTROL_SETPOINT, f88(60.0f), 3000);
+    takeDue(c, 3300, &writes);
+    EXPECT_EQ(writes.size(), 1u);
+}
+
+TEST(WriteCoalescerTests, ComparesTheWireEncoding)
+{
+    WriteCoalescer c(300);
+    std::vector<Write> writes;
+    c.acknowledged(OT_DATA_ID_ROOM_SETPOINT, f88(21.1f));
+    // Differs as a float but encodes to the same f8.8 value
+    ASSERT_EQ(f88(21.1f), f88(21.1001f));
+    c.submit(OT_DATA_ID_ROOM_SETPOINT, f88(21.1001f), 0);
+    takeDue(c, 300, &writes);
+    EXPECT_TRUE(writes.empty());
+}
+
+TEST(WriteCoalescerTests, RefusesMoreDataIdsThanSlots)
+{
+    WriteCoalescer c(300);
+    for (uint8_t id = 0; id < WriteCoalescer::SLOTS; id++)
+        EXPECT_TRUE(c.submit(id, 1, 0));
+    EXPECT_FALSE(c.submit(WriteCoalescer::SLOTS, 1, 0));
+    EXPECT_TRUE(c.submit(0, 2, 0)); // Known data IDs still coalesce
+}
+
+TEST(WriteCoalescerTests, WorksAcrossTimerWrap)
+{
+    WriteCoalescer c(300);
+    std::vector<Write> writes;
+    uint32_t start = 0xFFFFFF00u;
+    c.submit(OT_DATA_ID_ROOM_SETPOINT, f88(19.0f), start);
+    EXPECT_EQ(c.msUntilDue(start), 300u);
+    takeDue(c, start + 299, &writes);
+    EXPECT_TRUE(writes.empty());
+    takeDue(c, start + 300, &writes);
+    EXPECT_EQ(writes.size(), 1u);
+}